@@ -2,6 +2,8 @@
 
 const Gio = imports.gi.Gio;
 
+const ProxyCache = imports.misc.proxyCache;
+
 const ConsoleKitManagerIface = <interface name='org.freedesktop.ConsoleKit.Manager'>
 <method name='CanRestart'>
     <arg type='b' direction='out'/>
@@ -13,7 +15,7 @@ const ConsoleKitManagerIface = <interface name='org.freedesktop.ConsoleKit.Manag
 <method name='Stop' />
 </interface>;
 
-const ConsoleKitProxy = Gio.DBusProxy.makeProxyWrapper(ConsoleKitManagerIface);
+const ConsoleKitProxy = ProxyCache.makeProxyWrapper(ConsoleKitManagerIface);
 
 function ConsoleKitManager() {
     return new ConsoleKitProxy(Gio.DBus.system,
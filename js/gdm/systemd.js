@@ -3,6 +3,8 @@
 const GLib = imports.gi.GLib;
 const Gio = imports.gi.Gio;
 
+const ProxyCache = imports.misc.proxyCache;
+
 const SystemdLoginManagerIface = <interface name='org.freedesktop.login1.Manager'>
 <method name='PowerOff'>
     <arg type='b' direction='in'/>
@@ -18,7 +20,7 @@ const SystemdLoginManagerIface = <interface name='org.freedesktop.login1.Manager
 </method>
 </interface>;
 
-const SystemdLoginManagerProxy = Gio.DBusProxy.makeProxyWrapper(SystemdLoginManagerIface);
+const SystemdLoginManagerProxy = ProxyCache.makeProxyWrapper(SystemdLoginManagerIface);
 
 function SystemdLoginManager() {
     return new SystemdLoginManagerProxy(Gio.DBus.system,
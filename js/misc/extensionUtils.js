@@ -89,19 +89,27 @@ function isOutOfDate(extension) {
     return false;
 }
 
-function createExtensionObject(uuid, dir, type) {
+// createExtensionObject:
+// @uuid: the uuid of the extension
+// @dir: the #GFile of its directory
+// @type: an #ExtensionType
+// @metadataContents: (optional): the contents of its metadata.json,
+//   if already loaded, as done by scanExtensionsAsync()
+function createExtensionObject(uuid, dir, type, metadataContents) {
     let info;
 
-    let metadataFile = dir.get_child('metadata.json');
-    if (!metadataFile.query_exists(null)) {
-        throw new Error('Missing metadata.json');
-    }
+    if (metadataContents == null) {
+        let metadataFile = dir.get_child('metadata.json');
+        if (!metadataFile.query_exists(null)) {
+            throw new Error('Missing metadata.json');
+        }
 
-    let metadataContents, success, tag;
-    try {
-        [success, metadataContents, tag] = metadataFile.load_contents(null);
-    } catch (e) {
-        throw new Error('Failed to load metadata.json: ' + e);
+        let success, tag;
+        try {
+            [success, metadataContents, tag] = metadataFile.load_contents(null);
+        } catch (e) {
+            throw new Error('Failed to load metadata.json: ' + e);
+        }
     }
     let meta;
     try {
@@ -182,13 +190,151 @@ function scanExtensionsInDirectory(callback, dir, type) {
     fileEnum.close(null);
 }
 
-function scanExtensions(callback) {
+function _getSystemExtensionsDirs() {
     let systemDataDirs = GLib.get_system_data_dirs();
-    scanExtensionsInDirectory(callback, userExtensionsDir, ExtensionType.PER_USER);
+    let dirs = [];
     for (let i = 0; i < systemDataDirs.length; i++) {
         let dirPath = GLib.build_filenamev([systemDataDirs[i], 'gnome-shell', 'extensions']);
-        let dir = Gio.file_new_for_path(dirPath);
+        dirs.push(Gio.file_new_for_path(dirPath));
+    }
+    return dirs;
+}
+
+function scanExtensions(callback) {
+    let systemDirs = _getSystemExtensionsDirs();
+    scanExtensionsInDirectory(callback, userExtensionsDir, ExtensionType.PER_USER);
+    for (let i = 0; i < systemDirs.length; i++) {
+        if (systemDirs[i].query_exists(null))
+            scanExtensionsInDirectory(callback, systemDirs[i], ExtensionType.SYSTEM);
+    }
+}
+
+// findExtension:
+// @uuid: the uuid of an extension
+//
+// Looks for the directory of the extension @uuid, the same way
+// scanExtensions() would find it.
+//
+// Returns: [dir, type], or %null if it isn't installed
+function findExtension(uuid) {
+    let dir = userExtensionsDir.get_child(uuid);
+    if (dir.query_exists(null))
+        return [dir, ExtensionType.PER_USER];
+
+    let systemDirs = _getSystemExtensionsDirs();
+    for (let i = 0; i < systemDirs.length; i++) {
+        dir = systemDirs[i].get_child(uuid);
         if (dir.query_exists(null))
-            scanExtensionsInDirectory(callback, dir, ExtensionType.SYSTEM);
+            return [dir, ExtensionType.SYSTEM];
     }
+
+    return null;
+}
+
+// scanExtensionsAsync:
+// @callback: function called as callback(uuid, dir, type, metadataContents)
+//   for each extension found
+// @doneCallback: function called after the last call to @callback
+//
+// Like scanExtensions(), but the extension directories are listed
+// and all the metadata.json files are read asynchronously, and in
+// parallel, by GIO's worker threads. @callback is then called for
+// all extensions in the same order as with scanExtensions();
+// @metadataContents is %null if metadata.json couldn't be read, so
+// that createExtensionObject() reports the problem.
+function scanExtensionsAsync(callback, doneCallback) {
+    let dirs = [{ dir: userExtensionsDir,
+                  type: ExtensionType.PER_USER,
+                  extensions: [] }];
+    let systemDirs = _getSystemExtensionsDirs();
+    for (let i = 0; i < systemDirs.length; i++)
+        dirs.push({ dir: systemDirs[i],
+                    type: ExtensionType.SYSTEM,
+                    extensions: [] });
+
+    // Number of directory listings and metadata reads in progress
+    let pending = 0;
+
+    function operationDone() {
+        pending--;
+        if (pending > 0)
+            return;
+
+        for (let i = 0; i < dirs.length; i++) {
+            let extensions = dirs[i].extensions;
+            for (let j = 0; j < extensions.length; j++)
+                callback(extensions[j].uuid, extensions[j].dir,
+                         dirs[i].type, extensions[j].metadataContents);
+        }
+
+        if (doneCallback)
+            doneCallback();
+    }
+
+    function loadMetadata(extension) {
+        pending++;
+        let metadataFile = extension.dir.get_child('metadata.json');
+        metadataFile.load_contents_async(null, function(file, result) {
+            try {
+                let [success, contents, tag] = file.load_contents_finish(result);
+                extension.metadataContents = contents;
+            } catch (e) {
+                // Left to createExtensionObject() to report
+            }
+            operationDone();
+        });
+    }
+
+    function listDir(entry) {
+        pending++;
+        entry.dir.enumerate_children_async('standard::name,standard::type',
+                                           Gio.FileQueryInfoFlags.NONE,
+                                           GLib.PRIORITY_LOW, null,
+                                           function(dir, result) {
+            let enumerator;
+            try {
+                enumerator = dir.enumerate_children_finish(result);
+            } catch (e) {
+                // System extension directories don't need to exist
+                if (entry.type == ExtensionType.PER_USER)
+                    global.logError('' + e);
+                operationDone();
+                return;
+            }
+
+            function onNextFiles(enumerator, result) {
+                let infos;
+                try {
+                    infos = enumerator.next_files_finish(result);
+                } catch (e) {
+                    global.logError('' + e);
+                    infos = [];
+                }
+
+                if (infos.length == 0) {
+                    enumerator.close(null);
+                    operationDone();
+                    return;
+                }
+
+                for (let i = 0; i < infos.length; i++) {
+                    if (infos[i].get_file_type() != Gio.FileType.DIRECTORY)
+                        continue;
+
+                    let uuid = infos[i].get_name();
+                    let extension = { uuid: uuid,
+                                      dir: entry.dir.get_child(uuid),
+                                      metadataContents: null };
+                    entry.extensions.push(extension);
+                    loadMetadata(extension);
+                }
+
+                enumerator.next_files_async(100, GLib.PRIORITY_LOW, null, onNextFiles);
+            }
+            enumerator.next_files_async(100, GLib.PRIORITY_LOW, null, onNextFiles);
+        });
+    }
+
+    for (let i = 0; i < dirs.length; i++)
+        listDir(dirs[i]);
 }
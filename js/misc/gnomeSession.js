@@ -4,6 +4,8 @@ const Gio = imports.gi.Gio;
 const Lang = imports.lang;
 const Signals = imports.signals;
 
+const ProxyCache = imports.misc.proxyCache;
+
 const PresenceIface = <interface name="org.gnome.SessionManager.Presence">
 <method name="SetStatus">
     <arg type="u" direction="in"/>
@@ -21,10 +23,10 @@ const PresenceStatus = {
     IDLE: 3
 };
 
-var PresenceProxy = Gio.DBusProxy.makeProxyWrapper(PresenceIface);
-function Presence(initCallback, cancellable) {
+var PresenceProxy = ProxyCache.makeProxyWrapper(PresenceIface);
+function Presence(initCallback) {
     return new PresenceProxy(Gio.DBus.session, 'org.gnome.SessionManager',
-                             '/org/gnome/SessionManager/Presence', initCallback, cancellable);
+                             '/org/gnome/SessionManager/Presence', initCallback);
 }
 
 // Note inhibitors are immutable objects, so they don't
@@ -55,7 +57,7 @@ const SessionManagerIface = <interface name="org.gnome.SessionManager">
 </method>
 </interface>;
 
-var SessionManagerProxy = Gio.DBusProxy.makeProxyWrapper(SessionManagerIface);
-function SessionManager(initCallback, cancellable) {
-    return new SessionManagerProxy(Gio.DBus.session, 'org.gnome.SessionManager', '/org/gnome/SessionManager', initCallback, cancellable);
+var SessionManagerProxy = ProxyCache.makeProxyWrapper(SessionManagerIface);
+function SessionManager(initCallback) {
+    return new SessionManagerProxy(Gio.DBus.session, 'org.gnome.SessionManager', '/org/gnome/SessionManager', initCallback);
 }
@@ -5,6 +5,8 @@ const Lang = imports.lang;
 const Shell = imports.gi.Shell;
 const Signals = imports.signals;
 
+const ProxyCache = imports.misc.proxyCache;
+
 // The following are not the complete interfaces, just the methods we need
 // (or may need in the future)
 
@@ -26,7 +28,7 @@ const ModemGsmNetworkInterface = <interface name="org.freedesktop.ModemManager.M
 </signal>
 </interface>;
 
-const ModemGsmNetworkProxy = Gio.DBusProxy.makeProxyWrapper(ModemGsmNetworkInterface);
+const ModemGsmNetworkProxy = ProxyCache.makeProxyWrapper(ModemGsmNetworkInterface);
 
 const ModemCdmaInterface = <interface name="org.freedesktop.ModemManager.Modem.Cdma">
 <method name="GetSignalQuality">
@@ -40,15 +42,7 @@ const ModemCdmaInterface = <interface name="org.freedesktop.ModemManager.Modem.C
 </signal>
 </interface>;
 
-const ModemCdmaProxy = Gio.DBusProxy.makeProxyWrapper(ModemCdmaInterface);
-
-let _providersTable;
-function _getProvidersTable() {
-    if (_providersTable)
-        return _providersTable;
-    let [providers, countryCodes] = Shell.mobile_providers_parse();
-    return _providersTable = providers;
-}
+const ModemCdmaProxy = ProxyCache.makeProxyWrapper(ModemCdmaInterface);
 
 const ModemGsm = new Lang.Class({
     Name: 'ModemGsm',
@@ -114,41 +108,7 @@ const ModemGsm = new Lang.Class({
     },
 
     _findProviderForMCCMNC: function(needle) {
-        let table = _getProvidersTable();
-        let needlemcc = needle.substring(0, 3);
-        let needlemnc = needle.substring(3, needle.length);
-
-        let name2, name3;
-        for (let iter in table) {
-            let providers = table[iter];
-
-            // Search through each country's providers
-            for (let i = 0; i < providers.length; i++) {
-                let provider = providers[i];
-
-                // Search through MCC/MNC list
-                let list = provider.get_gsm_mcc_mnc();
-                for (let j = 0; j < list.length; j++) {
-                    let mccmnc = list[j];
-
-                    // Match both 2-digit and 3-digit MNC; prefer a
-                    // 3-digit match if found, otherwise a 2-digit one.
-                    if (mccmnc.mcc != needlemcc)
-                        continue;  // MCC was wrong
-
-                    if (!name3 && needle.length == 6 && needlemnc == mccmnc.mnc)
-                        name3 = provider.name;
-
-                    if (!name2 && needlemnc.substring(0, 2) == mccmnc.mnc.substring(0, 2))
-                        name2 = provider.name;
-
-                    if (name2 && name3)
-                        break;
-                }
-            }
-        }
-
-        return name3 || name2 || null;
+        return Shell.mobile_providers_find_for_mcc_mnc(needle);
     }
 });
 Signals.addSignalMethods(ModemGsm.prototype);
@@ -199,29 +159,7 @@ const ModemCdma = new Lang.Class({
     },
 
     _findProviderForSid: function(sid) {
-        if (sid == 0)
-            return null;
-
-        let table = _getProvidersTable();
-
-        // Search through each country
-        for (let iter in table) {
-            let providers = table[iter];
-
-            // Search through each country's providers
-            for (let i = 0; i < providers.length; i++) {
-                let provider = providers[i];
-                let cdma_sid = provider.get_cdma_sid();
-
-                // Search through CDMA SID list
-                for (let j = 0; j < cdma_sid.length; j++) {
-                    if (cdma_sid[j] == sid)
-                        return provider.name;
-                }
-            }
-        }
-
-        return null;
+        return Shell.mobile_providers_find_for_sid(sid);
     }
 });
 Signals.addSignalMethods(ModemCdma.prototype);
@@ -0,0 +1,95 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const Gio = imports.gi.Gio;
+const GLib = imports.gi.GLib;
+const Mainloop = imports.mainloop;
+const Shell = imports.gi.Shell;
+
+// Proxies by bus, name, object path and interface; each is
+// { proxy, ready, error, callbacks }
+let _proxies = {};
+let _perfEventsDefined = false;
+
+// Time spent initializing each proxy, in milliseconds, by the same
+// key, for inspection from the looking glass
+let initTimes = {};
+
+function _ensurePerfEvents() {
+    if (_perfEventsDefined)
+        return;
+
+    let perfLog = Shell.PerfLog.get_default();
+    perfLog.define_event('dbus.proxyInitStart',
+                         'Starting to initialize a D-Bus proxy; argument is interface@path',
+                         's');
+    perfLog.define_event('dbus.proxyInitDone',
+                         'Done initializing a D-Bus proxy; argument is interface@path',
+                         's');
+    _perfEventsDefined = true;
+}
+
+// makeProxyWrapper:
+// @interfaceXml: the interface, as for Gio.DBusProxy.makeProxyWrapper()
+//
+// Like Gio.DBusProxy.makeProxyWrapper(), returns a constructor for
+// proxies, called as new Proxy(bus, name, objectPath, initCallback).
+// But its proxies are always initialized asynchronously, so that
+// loading their properties doesn't block us, and all callers asking
+// for the same object on the same bus share one proxy and its
+// property cache. @initCallback, if given, is called with the proxy
+// and the error, if any, once the proxy is initialized (right away,
+// but always from the main loop, for a proxy that already was).
+// Until then, properties of the proxy are null, but methods can be
+// called and signals connected.
+function makeProxyWrapper(interfaceXml) {
+    let wrapper = Gio.DBusProxy.makeProxyWrapper(interfaceXml);
+    let interfaceName = Gio.DBusInterfaceInfo.new_for_xml(interfaceXml).name;
+
+    return function(bus, name, objectPath, initCallback) {
+        let key = [bus.get_unique_name(), name, objectPath, interfaceName].join(' ');
+        let entry = _proxies[key];
+
+        if (!entry) {
+            entry = { proxy: null,
+                      ready: false,
+                      error: null,
+                      callbacks: [] };
+            _proxies[key] = entry;
+
+            _ensurePerfEvents();
+            let perfLog = Shell.PerfLog.get_default();
+            let description = interfaceName + '@' + objectPath;
+            let start = GLib.get_monotonic_time();
+
+            perfLog.event_s('dbus.proxyInitStart', description);
+            entry.proxy = new wrapper(bus, name, objectPath, function(proxy, error) {
+                perfLog.event_s('dbus.proxyInitDone', description);
+                initTimes[key] = (GLib.get_monotonic_time() - start) / 1000;
+
+                entry.ready = true;
+                entry.error = error;
+                // Let the next caller try again
+                if (error)
+                    delete _proxies[key];
+
+                let callbacks = entry.callbacks;
+                entry.callbacks = [];
+                for (let i = 0; i < callbacks.length; i++)
+                    callbacks[i](entry.proxy, error);
+            });
+        }
+
+        if (initCallback) {
+            if (entry.ready) {
+                Mainloop.idle_add(function() {
+                    initCallback(entry.proxy, entry.error);
+                    return false;
+                });
+            } else {
+                entry.callbacks.push(initCallback);
+            }
+        }
+
+        return entry.proxy;
+    };
+}
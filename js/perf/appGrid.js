@@ -0,0 +1,132 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const St = imports.gi.St;
+
+const Main = imports.ui.main;
+const Scripting = imports.ui.scripting;
+const Tweener = imports.ui.tweener;
+
+// This performance script measures how smoothly the applications view
+// of the overview scrolls from the top to the bottom of the grid.
+
+let METRICS = {
+    appGridScrollFpsFirst:
+    { description: "Frame rate when scrolling through the applications view, first time",
+      units: "frames / s" },
+    appGridScrollFpsSubsequent:
+    { description: "Frame rate when scrolling through the applications view, second time",
+      units: "frames / s" },
+    appGridScrollMaxFrameTime:
+    { description: "Longest time between two frames when scrolling through the applications view",
+      units: "us" }
+};
+
+// Seconds to scroll from the top of the grid to the bottom
+const SCROLL_TIME = 3;
+
+function _findScrollView(actor) {
+    if (actor instanceof St.ScrollView)
+        return actor;
+
+    let children = actor.get_children ? actor.get_children() : [];
+    for (let i = 0; i < children.length; i++) {
+        let scrollView = _findScrollView(children[i]);
+        if (scrollView)
+            return scrollView;
+    }
+
+    return null;
+}
+
+function run() {
+    Scripting.defineScriptEvent("scrollStart", "Starting to scroll the applications view");
+    Scripting.defineScriptEvent("scrollDone", "Done scrolling the applications view");
+
+    yield Scripting.sleep(1000);
+
+    Main.overview.show();
+    yield Scripting.waitLeisure();
+
+    Main.overview._viewSelector.switchTab('applications');
+    yield Scripting.waitLeisure();
+
+    let tabs = Main.overview._viewSelector._tabs;
+    let scrollView = null;
+    for (let i = 0; i < tabs.length; i++)
+        if (tabs[i].id == 'applications')
+            scrollView = _findScrollView(tabs[i].page);
+
+    let adjustment = scrollView.vscroll.adjustment;
+
+    for (let i = 0; i < 2; i++) {
+        adjustment.value = 0;
+        yield Scripting.waitLeisure();
+
+        Scripting.scriptEvent('scrollStart');
+        Tweener.addTween(adjustment,
+                         { value: adjustment.upper - adjustment.page_size,
+                           time: SCROLL_TIME,
+                           transition: 'linear' });
+        yield Scripting.waitLeisure();
+        Scripting.scriptEvent('scrollDone');
+    }
+
+    Main.overview._viewSelector.switchTab('windows');
+    Main.overview.hide();
+    yield Scripting.waitLeisure();
+}
+
+let scrolling = false;
+let scrollCount = 0;
+let scrollFrames;
+let firstFrameTime;
+let lastFrameTime;
+let maxFrameTime = 0;
+let haveSwapComplete = false;
+
+function script_scrollStart(time) {
+    scrolling = true;
+    scrollFrames = 0;
+}
+
+function script_scrollDone(time) {
+    scrolling = false;
+    scrollCount++;
+
+    // As in core.js, the first and the last frame together make up
+    // one frame of the FPS computation
+    let dt = (lastFrameTime - firstFrameTime) / 1000000;
+    let fps = (scrollFrames - 1) / dt;
+
+    if (scrollCount == 1)
+        METRICS.appGridScrollFpsFirst.value = fps;
+    else
+        METRICS.appGridScrollFpsSubsequent.value = fps;
+
+    METRICS.appGridScrollMaxFrameTime.value = maxFrameTime;
+}
+
+function _frameDone(time) {
+    if (!scrolling)
+        return;
+
+    if (scrollFrames == 0)
+        firstFrameTime = time;
+    else
+        maxFrameTime = Math.max(maxFrameTime, time - lastFrameTime);
+
+    lastFrameTime = time;
+    scrollFrames++;
+}
+
+function glx_swapComplete(time, swapTime) {
+    haveSwapComplete = true;
+
+    _frameDone(swapTime);
+}
+
+function clutter_stagePaintDone(time) {
+    // See the comment in core.js
+    if (!haveSwapComplete)
+        _frameDone(time);
+}
@@ -0,0 +1,79 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const Scripting = imports.ui.scripting;
+
+// This performance script measures how the shell copes with a burst
+// of notifications with images, as sent by a chat client that just
+// reconnected.
+
+let METRICS = {
+    notificationBurstTime:
+    { description: "Time until the shell replied to all notifications of a burst",
+      units: "us" },
+    notificationBurstSettleTime:
+    { description: "Time until the shell is idle again after a burst of notifications",
+      units: "us" },
+    notificationBurstMaxFrameTime:
+    { description: "Longest time between two frames while handling a burst of notifications",
+      units: "us" }
+};
+
+const N_NOTIFICATIONS = 50;
+const IMAGE_SIZE = 96;
+
+function run() {
+    Scripting.defineScriptEvent("burstStart", "Starting to send a burst of notifications");
+    Scripting.defineScriptEvent("burstReplied", "All notifications of the burst were replied to");
+    Scripting.defineScriptEvent("burstDone", "Done handling a burst of notifications");
+
+    yield Scripting.sleep(1000);
+    yield Scripting.waitLeisure();
+
+    Scripting.scriptEvent('burstStart');
+    yield Scripting.sendTestNotifications(N_NOTIFICATIONS, IMAGE_SIZE);
+    Scripting.scriptEvent('burstReplied');
+    yield Scripting.waitLeisure();
+    Scripting.scriptEvent('burstDone');
+}
+
+let inBurst = false;
+let burstStart;
+let lastFrameTime = 0;
+let maxFrameTime = 0;
+let haveSwapComplete = false;
+
+function script_burstStart(time) {
+    inBurst = true;
+    burstStart = time;
+    lastFrameTime = time;
+}
+
+function script_burstReplied(time) {
+    METRICS.notificationBurstTime.value = time - burstStart;
+}
+
+function script_burstDone(time) {
+    inBurst = false;
+    METRICS.notificationBurstSettleTime.value = time - burstStart;
+    METRICS.notificationBurstMaxFrameTime.value = maxFrameTime;
+}
+
+function _frameDone(time) {
+    if (!inBurst)
+        return;
+
+    maxFrameTime = Math.max(maxFrameTime, time - lastFrameTime);
+    lastFrameTime = time;
+}
+
+function glx_swapComplete(time, swapTime) {
+    haveSwapComplete = true;
+
+    _frameDone(swapTime);
+}
+
+function clutter_stagePaintDone(time) {
+    // See the comment in core.js
+    if (!haveSwapComplete)
+        _frameDone(time);
+}
@@ -0,0 +1,245 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const Lang = imports.lang;
+const Mainloop = imports.mainloop;
+const Shell = imports.gi.Shell;
+const St = imports.gi.St;
+
+const Main = imports.ui.main;
+const Scripting = imports.ui.scripting;
+const Search = imports.ui.search;
+
+// This performance script measures how long it takes from typing a
+// character into the overview search entry until the updated results
+// are on the screen. Besides the providers of the running shell, we add
+// providers with synthetic application and contact lists, so that the
+// numbers don't depend too much on what is installed on the test system.
+
+let METRICS = {
+    searchLatencyFirstKeystroke:
+    { description: "Mean time to first frame after typing the first character of a search",
+      units: "us" },
+    searchLatencyMean:
+    { description: "Mean time to first frame after typing a character of a search",
+      units: "us" },
+    searchLatencyMax:
+    { description: "Maximum time to first frame after typing a character of a search",
+      units: "us" }
+};
+
+const N_SYNTHETIC_APPS = 2000;
+const N_SYNTHETIC_CONTACTS = 5000;
+
+// A mix of queries that match many, few and no results, including
+// multi-term queries and ones that only match approximately
+const QUERIES = [ 'ter', 'calcul', 'mar', 'john sm', 'firfox', 'xyzzy' ];
+
+const SYLLABLES = [ 'an', 'bel', 'cal', 'dor', 'el', 'fir', 'gar', 'hel',
+                    'in', 'jo', 'ka', 'lor', 'mar', 'nel', 'or', 'pa',
+                    'qui', 'ros', 'sam', 'ter', 'ul', 'vin', 'wil', 'yo',
+                    'zen' ];
+const APP_KINDS = [ 'Editor', 'Viewer', 'Manager', 'Player', 'Terminal',
+                    'Browser', 'Calculator', 'Monitor', 'Settings', 'Studio' ];
+const FIRST_NAMES = [ 'John', 'Mary', 'Peter', 'Anna', 'Michael', 'Laura',
+                      'David', 'Sarah', 'Thomas', 'Julia', 'Daniel', 'Emma' ];
+
+// Simple linear congruential generator, so that every run of the
+// script searches the same corpora
+let _seed = 1;
+
+function _random(n) {
+    _seed = (_seed * 1103515245 + 12345) % 2147483648;
+    return _seed % n;
+}
+
+function _randomWord(nSyllables) {
+    let word = '';
+    for (let i = 0; i < nSyllables; i++)
+        word += SYLLABLES[_random(SYLLABLES.length)];
+    return word.charAt(0).toUpperCase() + word.slice(1);
+}
+
+function _createAppNames(count) {
+    let names = [];
+    for (let i = 0; i < count; i++)
+        names.push(_randomWord(1 + _random(3)) + ' ' + APP_KINDS[_random(APP_KINDS.length)]);
+    return names;
+}
+
+function _createContactNames(count) {
+    let names = [];
+    for (let i = 0; i < count; i++)
+        names.push(FIRST_NAMES[_random(FIRST_NAMES.length)] + ' ' + _randomWord(2 + _random(2)));
+    return names;
+}
+
+const SyntheticSearchProvider = new Lang.Class({
+    Name: 'SyntheticSearchProvider',
+    Extends: Search.SearchProvider,
+
+    _init: function(title, names, iconName) {
+        this.parent(title);
+
+        this._names = names;
+        this._iconName = iconName;
+    },
+
+    _search: function(ids, terms) {
+        let matcher = Shell.SearchMatcher.new(terms);
+        let results = [];
+
+        for (let i = 0; i < ids.length; i++) {
+            let score = matcher.match(this._names[ids[i]]);
+            if (score > 0)
+                results.push({ id: ids[i], score: score });
+        }
+
+        results.sort(function(a, b) { return b.score - a.score; });
+        return results.map(function(result) { return result.id; });
+    },
+
+    getInitialResultSet: function(terms) {
+        let ids = [];
+        for (let i = 0; i < this._names.length; i++)
+            ids.push(i);
+        return this._search(ids, terms);
+    },
+
+    getSubsearchResultSet: function(previousResults, terms) {
+        return this._search(previousResults, terms);
+    },
+
+    getResultMetas: function(ids) {
+        let iconName = this._iconName;
+
+        return ids.map(Lang.bind(this, function(id) {
+            return { 'id': id,
+                     'name': this._names[id],
+                     'createIcon': function(size) {
+                         return new St.Icon({ icon_name: iconName,
+                                              icon_size: size,
+                                              icon_type: St.IconType.FULLCOLOR });
+                     }
+                   };
+        }));
+    },
+
+    activateResult: function(id) {
+    }
+});
+
+function run() {
+    Scripting.defineScriptEvent("queryStart", "Starting to type a new search query");
+    Scripting.defineScriptEvent("keystrokeStart", "Starting a search after typing a character");
+    Scripting.defineScriptEvent("keystrokeDone", "Done searching after typing a character");
+
+    let providers = [ new SyntheticSearchProvider('PERF APPLICATIONS',
+                                                  _createAppNames(N_SYNTHETIC_APPS),
+                                                  'application-x-executable'),
+                      new SyntheticSearchProvider('PERF CONTACTS',
+                                                  _createContactNames(N_SYNTHETIC_CONTACTS),
+                                                  'avatar-default') ];
+    for (let i = 0; i < providers.length; i++)
+        Main.overview.addSearchProvider(providers[i]);
+
+    yield Scripting.sleep(1000);
+
+    Main.overview.show();
+    yield Scripting.waitLeisure();
+
+    let searchTab = Main.overview._viewSelector._searchTab;
+
+    for (let i = 0; i < QUERIES.length; i++) {
+        let query = QUERIES[i];
+
+        Scripting.scriptEvent('queryStart');
+
+        for (let j = 1; j <= query.length; j++) {
+            searchTab._entry.text = query.substring(0, j);
+
+            // Search right away instead of waiting for the typing
+            // timeout; we want to measure the search, not the timeout
+            if (searchTab._searchTimeoutId > 0) {
+                Mainloop.source_remove(searchTab._searchTimeoutId);
+                searchTab._searchTimeoutId = 0;
+            }
+
+            Scripting.scriptEvent('keystrokeStart');
+            searchTab._doSearch();
+            Scripting.scriptEvent('keystrokeDone');
+
+            yield Scripting.waitLeisure();
+        }
+
+        searchTab.reset();
+        yield Scripting.waitLeisure();
+    }
+
+    Main.overview.hide();
+    yield Scripting.waitLeisure();
+
+    for (let i = 0; i < providers.length; i++)
+        Main.overview.removeSearchProvider(providers[i]);
+}
+
+let firstKeystroke = false;
+let keystrokeStart;
+let waitingForFrame = false;
+let latencies = [];
+let firstLatencies = [];
+let haveSwapComplete = false;
+
+function script_queryStart(time) {
+    firstKeystroke = true;
+}
+
+function script_keystrokeStart(time) {
+    keystrokeStart = time;
+}
+
+function script_keystrokeDone(time) {
+    // The results are only visible once the next frame is painted
+    waitingForFrame = true;
+}
+
+function _mean(values) {
+    let sum = 0;
+    for (let i = 0; i < values.length; i++)
+        sum += values[i];
+    return sum / values.length;
+}
+
+function finish() {
+    METRICS.searchLatencyFirstKeystroke.value = _mean(firstLatencies);
+    METRICS.searchLatencyMean.value = _mean(latencies);
+    METRICS.searchLatencyMax.value = Math.max.apply(Math, latencies);
+}
+
+function _frameDone(time) {
+    if (!waitingForFrame)
+        return;
+
+    let latency = time - keystrokeStart;
+
+    // The first character of a query starts the search from scratch
+    // and switches to the search results, so it is the most expensive
+    if (firstKeystroke) {
+        firstLatencies.push(latency);
+        firstKeystroke = false;
+    }
+
+    latencies.push(latency);
+    waitingForFrame = false;
+}
+
+function glx_swapComplete(time, swapTime) {
+    haveSwapComplete = true;
+
+    _frameDone(swapTime);
+}
+
+function clutter_stagePaintDone(time) {
+    // See the comment in core.js
+    if (!haveSwapComplete)
+        _frameDone(time);
+}
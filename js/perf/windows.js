@@ -0,0 +1,159 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const Clutter = imports.gi.Clutter;
+const Mainloop = imports.mainloop;
+
+const AltTab = imports.ui.altTab;
+const Scripting = imports.ui.scripting;
+
+// This performance script measures window switching with many windows
+// open: how long it takes to bring up the alt-tab popup, and how
+// smoothly we animate switching between workspaces.
+
+let METRICS = {
+    altTabLatencyFirst:
+    { description: "Time to first frame after triggering alt-tab with 60 windows, first time",
+      units: "us" },
+    altTabLatencySubsequent:
+    { description: "Time to first frame after triggering alt-tab with 60 windows, second time",
+      units: "us" },
+    workspaceSwitchFrameTimeMean:
+    { description: "Mean time between frames when switching workspaces with 60 windows",
+      units: "us" },
+    workspaceSwitchFrameTimeMax:
+    { description: "Longest time between frames when switching workspaces with 60 windows",
+      units: "us" }
+};
+
+const N_WINDOWS = 60;
+const N_APPLICATIONS = 10;
+const N_WORKSPACE_SWITCHES = 6;
+
+function _showAltTab() {
+    let popup = new AltTab.AltTabPopup();
+
+    // The popup hides itself right away if Alt isn't pressed when it
+    // is shown, so pretend that it is
+    let getPointer = global.get_pointer;
+    let shown;
+    global.get_pointer = function() {
+        return [0, 0, Clutter.ModifierType.MOD1_MASK];
+    };
+    try {
+        shown = popup.show(false, 'switch-windows', Clutter.ModifierType.MOD1_MASK);
+    } finally {
+        global.get_pointer = getPointer;
+    }
+
+    // Skip the delay before the popup becomes visible; we want to
+    // measure how long it takes to build it, not the timeout
+    if (shown && popup._initialDelayTimeoutId) {
+        Mainloop.source_remove(popup._initialDelayTimeoutId);
+        popup._initialDelayTimeoutId = 0;
+        popup.actor.opacity = 255;
+    }
+
+    return popup;
+}
+
+function run() {
+    Scripting.defineScriptEvent("altTabStart", "Starting to show the alt-tab popup");
+    Scripting.defineScriptEvent("altTabDone", "Alt-tab popup is shown");
+    Scripting.defineScriptEvent("switchStart", "Starting to switch workspaces");
+    Scripting.defineScriptEvent("switchDone", "Done switching workspaces");
+
+    yield Scripting.destroyTestWindows();
+    yield Scripting.createTestWindows(N_WINDOWS, 640, 480,
+                                      { type: 'mixed',
+                                        nApplications: N_APPLICATIONS });
+    yield Scripting.waitTestWindows();
+    yield Scripting.sleep(1000);
+    yield Scripting.waitLeisure();
+
+    for (let i = 0; i < 2; i++) {
+        Scripting.scriptEvent('altTabStart');
+        let popup = _showAltTab();
+        Scripting.scriptEvent('altTabDone');
+        yield Scripting.waitLeisure();
+
+        popup.destroy();
+        yield Scripting.waitLeisure();
+    }
+
+    if (global.screen.n_workspaces < 2)
+        global.screen.append_new_workspace(false, global.get_current_time());
+
+    for (let i = 0; i < N_WORKSPACE_SWITCHES; i++) {
+        let workspace = global.screen.get_workspace_by_index((i + 1) % 2);
+
+        Scripting.scriptEvent('switchStart');
+        workspace.activate(global.get_current_time());
+        yield Scripting.waitLeisure();
+        Scripting.scriptEvent('switchDone');
+    }
+
+    yield Scripting.destroyTestWindows();
+}
+
+let altTabStart;
+let altTabWaitingForFrame = false;
+let altTabCount = 0;
+let switching = false;
+let lastFrameTime = 0;
+let frameTimes = [];
+let haveSwapComplete = false;
+
+function script_altTabStart(time) {
+    altTabStart = time;
+}
+
+function script_altTabDone(time) {
+    altTabWaitingForFrame = true;
+}
+
+function script_switchStart(time) {
+    switching = true;
+    lastFrameTime = time;
+}
+
+function script_switchDone(time) {
+    switching = false;
+}
+
+function finish() {
+    let sum = 0;
+    for (let i = 0; i < frameTimes.length; i++)
+        sum += frameTimes[i];
+
+    METRICS.workspaceSwitchFrameTimeMean.value = sum / frameTimes.length;
+    METRICS.workspaceSwitchFrameTimeMax.value = Math.max.apply(Math, frameTimes);
+}
+
+function _frameDone(time) {
+    if (altTabWaitingForFrame) {
+        altTabWaitingForFrame = false;
+        altTabCount++;
+
+        if (altTabCount == 1)
+            METRICS.altTabLatencyFirst.value = time - altTabStart;
+        else
+            METRICS.altTabLatencySubsequent.value = time - altTabStart;
+    }
+
+    if (switching) {
+        frameTimes.push(time - lastFrameTime);
+        lastFrameTime = time;
+    }
+}
+
+function glx_swapComplete(time, swapTime) {
+    haveSwapComplete = true;
+
+    _frameDone(swapTime);
+}
+
+function clutter_stagePaintDone(time) {
+    // See the comment in core.js
+    if (!haveSwapComplete)
+        _frameDone(time);
+}
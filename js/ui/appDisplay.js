@@ -31,11 +31,15 @@ const AlphabeticalView = new Lang.Class({
     Name: 'AlphabeticalView',
 
     _init: function() {
-        this._grid = new IconGrid.IconGrid({ xAlign: St.Align.START });
+        // With all installed applications, the grid can get very long,
+        // so only create icons for what is scrolled into view
+        this._grid = new IconGrid.IconGrid({ xAlign: St.Align.START,
+                                             createItem: Lang.bind(this, this._createAppIcon),
+                                             bindItem: Lang.bind(this, this._bindAppIcon) });
         this._appSystem = Shell.AppSystem.get_default();
 
         this._pendingAppLaterId = 0;
-        this._appIcons = {}; // desktop file id
+        this._allApps = [];
 
         let box = new St.BoxLayout({ vertical: true });
         box.add(this._grid.actor, { y_align: St.Align.START, expand: true });
@@ -46,6 +50,7 @@ const AlphabeticalView = new Lang.Class({
                                          style_class: 'vfade' });
         this.actor.add_actor(box);
         this.actor.set_policy(Gtk.PolicyType.NEVER, Gtk.PolicyType.AUTOMATIC);
+        this._grid.setScrollView(this.actor);
         this.actor.connect('notify::mapped', Lang.bind(this,
             function() {
                 if (!this.actor.mapped)
@@ -60,19 +65,14 @@ const AlphabeticalView = new Lang.Class({
             }));
     },
 
-    _removeAll: function() {
-        this._grid.removeAll();
-        this._appIcons = {};
-    },
-
-    _addApp: function(app) {
-        var id = app.get_id();
+    _createAppIcon: function(app) {
         let appIcon = new AppWellIcon(app);
-
-        this._grid.addItem(appIcon.actor);
         appIcon.actor.connect('key-focus-in', Lang.bind(this, this._ensureIconVisible));
+        return appIcon.actor;
+    },
 
-        this._appIcons[id] = appIcon;
+    _bindAppIcon: function(actor, app) {
+        actor._delegate.setApp(app);
     },
 
     _ensureIconVisible: function(icon) {
@@ -102,32 +102,15 @@ const AlphabeticalView = new Lang.Class({
     },
 
     setVisibleApps: function(apps) {
-        if (apps == null) { // null implies "all"
-            for (var id in this._appIcons) {
-                var icon = this._appIcons[id];
-                icon.actor.visible = true;
-            }
-        } else {
-            // Set everything to not-visible, then set to visible what we should see
-            for (var id in this._appIcons) {
-                var icon = this._appIcons[id];
-                icon.actor.visible = false;
-            }
-            for (var i = 0; i < apps.length; i++) {
-                var app = apps[i];
-                var id = app.get_id();
-                var icon = this._appIcons[id];
-                icon.actor.visible = true;
-            }
-        }
+        if (apps == null) // null implies "all"
+            this._grid.setItems(this._allApps);
+        else
+            this._grid.setItems(apps);
     },
 
     setAppList: function(apps) {
-        this._removeAll();
-        for (var i = 0; i < apps.length; i++) {
-            var app = apps[i];
-            this._addApp(app);
-         }
+        this._allApps = apps;
+        this._grid.setItems(apps);
     }
 });
 
@@ -430,6 +413,12 @@ const AppIcon = new Lang.Class({
         this.parent(label, params);
     },
 
+    setApp: function(app) {
+        this.app = app;
+        this.setLabel(this.app.get_name());
+        this.reloadIcon();
+    },
+
     createIcon: function(iconSize) {
         return this.app.create_icon_texture(iconSize);
     }
@@ -494,6 +483,28 @@ const AppWellIcon = new Lang.Class({
         this._removeMenuTimeout();
     },
 
+    // Rebinds the icon to a different application, so that grids
+    // can reuse it instead of creating a new one
+    setApp: function(app) {
+        if (app == this.app)
+            return;
+
+        this._removeMenuTimeout();
+        if (this._menu)
+            this._menu.close();
+
+        if (this._stateChangedId > 0)
+            this.app.disconnect(this._stateChangedId);
+
+        this.app = app;
+        this.icon.setApp(app);
+
+        this._stateChangedId = this.app.connect('notify::state',
+                                                Lang.bind(this,
+                                                          this._onStateChanged));
+        this._onStateChanged();
+    },
+
     _removeMenuTimeout: function() {
         if (this._menuTimeoutId > 0) {
             Mainloop.source_remove(this._menuTimeoutId);
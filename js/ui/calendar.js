@@ -158,7 +158,8 @@ function _getEventDayAbbreviation(dayNumber) {
 const CalendarEvent = new Lang.Class({
     Name: 'CalendarEvent',
 
-    _init: function(date, end, summary, allDay) {
+    _init: function(id, date, end, summary, allDay) {
+        this.id = id;
         this.date = date;
         this.end = end;
         this.summary = summary;
@@ -197,6 +198,16 @@ const CalendarServerIface = <interface name="org.gnome.Shell.CalendarServer">
     <arg type="b" direction="in" />
     <arg type="a(sssbxxa{sv})" direction="out" />
 </method>
+<method name="GetEventsInRange">
+    <arg type="x" direction="in" />
+    <arg type="x" direction="in" />
+    <arg type="b" direction="in" />
+    <arg type="t" direction="in" />
+    <arg type="a(sssbxxa{sv})" direction="out" />
+    <arg type="as" direction="out" />
+    <arg type="b" direction="out" />
+    <arg type="t" direction="out" />
+</method>
 <signal name="Changed" />
 </interface>;
 
@@ -253,6 +264,7 @@ const DBusEventSource = new Lang.Class({
 
     _resetCache: function() {
         this._events = [];
+        this._serial = 0;
         this._lastRequestBegin = null;
         this._lastRequestEnd = null;
     },
@@ -268,40 +280,61 @@ const DBusEventSource = new Lang.Class({
     },
 
     _onChanged: function() {
-        this._loadEvents(false);
+        // Only fetch what changed since our last answer
+        this._loadEvents(false, this._serial);
     },
 
-    _onEventsReceived: function([appointments]) {
-        let newEvents = [];
-        if (appointments != null) {
-            for (let n = 0; n < appointments.length; n++) {
-                let a = appointments[n];
-                let date = new Date(a[4] * 1000);
-                let end = new Date(a[5] * 1000);
-                let summary = a[1];
-                let allDay = a[3];
-                let event = new CalendarEvent(date, end, summary, allDay);
-                newEvents.push(event);
-            }
-            newEvents.sort(function(event1, event2) {
-                return event1.date.getTime() - event2.date.getTime();
+    _onEventsReceived: function(result, excp) {
+        if (!result)
+            return;
+
+        let [appointments, invalidated, complete, serial] = result;
+        let newEvents;
+
+        if (complete) {
+            newEvents = [];
+        } else {
+            // Drop everything we knew about appointments that changed
+            // or went away; their current occurrences are in @appointments
+            let invalid = {};
+            for (let n = 0; n < invalidated.length; n++)
+                invalid[invalidated[n]] = true;
+            newEvents = this._events.filter(function(event) {
+                return !invalid.hasOwnProperty(event.id);
             });
         }
 
+        for (let n = 0; n < appointments.length; n++) {
+            let a = appointments[n];
+            let date = new Date(a[4] * 1000);
+            let end = new Date(a[5] * 1000);
+            let summary = a[1];
+            let allDay = a[3];
+            let event = new CalendarEvent(a[0], date, end, summary, allDay);
+            newEvents.push(event);
+        }
+        newEvents.sort(function(event1, event2) {
+            return event1.date.getTime() - event2.date.getTime();
+        });
+
         this._events = newEvents;
+        this._serial = serial;
         this.emit('changed');
     },
 
-    _loadEvents: function(forceReload) {
+    _loadEvents: function(forceReload, changedSince) {
         if (this._curRequestBegin && this._curRequestEnd){
             let callFlags = Gio.DBusCallFlags.NO_AUTO_START;
             if (forceReload)
                 callFlags = Gio.DBusCallFlags.NONE;
-            this._dbusProxy.GetEventsRemote(this._curRequestBegin.getTime() / 1000,
-                                            this._curRequestEnd.getTime() / 1000,
-                                            forceReload,
-                                            Lang.bind(this, this._onEventsReceived),
-                                            callFlags);
+            // The server answers with what it has cached, and emits
+            // Changed once it has loaded anything new
+            this._dbusProxy.GetEventsInRangeRemote(this._curRequestBegin.getTime() / 1000,
+                                                   this._curRequestEnd.getTime() / 1000,
+                                                   forceReload,
+                                                   changedSince || 0,
+                                                   Lang.bind(this, this._onEventsReceived),
+                                                   callFlags);
         }
     },
 
@@ -678,7 +711,7 @@ const EventsList = new Lang.Class({
         if (events.length == 0 && showNothingScheduled) {
             let now = new Date();
             /* Translators: Text to show if there are no events */
-            let nothingEvent = new CalendarEvent(now, now, _("Nothing Scheduled"), true);
+            let nothingEvent = new CalendarEvent('', now, now, _("Nothing Scheduled"), true);
             let timeString = _formatEventTime(nothingEvent, clockFormat);
             this._addEvent(dayNameBox, timeBox, eventTitleBox, false, "", timeString, nothingEvent.summary);
         }
@@ -1,6 +1,7 @@
 // -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
 
 const Lang = imports.lang;
+const Mainloop = imports.mainloop;
 const Signals = imports.signals;
 
 const Clutter = imports.gi.Clutter;
@@ -55,6 +56,7 @@ _httpSession.ssl_ca_file = _getCertFile();
 
 // Arrays of uuids
 var enabledExtensions;
+var criticalExtensions;
 // Contains the order that extensions were enabled in.
 const extensionOrder = [];
 
@@ -68,6 +70,25 @@ const connect = Lang.bind(_signals, _signals.connect);
 const disconnect = Lang.bind(_signals, _signals.disconnect);
 
 const ENABLED_EXTENSIONS_KEY = 'enabled-extensions';
+const CRITICAL_EXTENSIONS_KEY = 'critical-extensions';
+
+// The steps of loading an extension we keep track of the cost of,
+// in extension.cost, the looking glass and the perf log
+const LoadStep = {
+    LOAD: 'load',
+    INIT: 'init',
+    ENABLE: 'enable'
+};
+
+const LOAD_STEP_DESCRIPTIONS = {
+    load: 'creating the extension object from its metadata',
+    init: 'importing an extension and running its init()',
+    enable: 'running the enable() of an extension'
+};
+
+// Extensions found by loadExtensions(), loaded one per idle
+let _loadQueue = [];
+let _loadQueueId = 0;
 
 function installExtensionFromUUID(uuid, version_tag) {
     let params = { uuid: uuid,
@@ -218,7 +239,9 @@ function enableExtension(uuid) {
     extensionOrder.push(uuid);
 
     try {
-        extension.stateObj.enable();
+        _measureLoadStep(uuid, extension.cost, LoadStep.ENABLE, function() {
+            extension.stateObj.enable();
+        });
     } catch(e) {
         logExtensionError(uuid, e.toString());
         return;
@@ -244,9 +267,28 @@ function logExtensionError(uuid, message, state) {
                                                state: state });
 }
 
-function loadExtension(dir, type, enabled) {
+// Runs @func, and records in @cost how long it took, and how much the
+// JS heap grew meanwhile. A garbage collection in between can make
+// the heap shrink, so the latter is only an estimate.
+function _measureLoadStep(uuid, cost, step, func) {
+    let perfLog = Shell.PerfLog.get_default();
+    let startTime = GLib.get_monotonic_time();
+    let startBytes = global.get_memory_info().js_bytes;
+
+    perfLog.event_s('extensions.' + step + 'Start', uuid);
+    try {
+        func();
+    } finally {
+        perfLog.event_s('extensions.' + step + 'Done', uuid);
+        cost[step] = { time: (GLib.get_monotonic_time() - startTime) / 1000,
+                       jsBytes: Math.max(global.get_memory_info().js_bytes - startBytes, 0) };
+    }
+}
+
+function loadExtension(dir, type, enabled, metadataContents) {
     let uuid = dir.get_basename();
     let extension;
+    let cost = {};
 
     if (ExtensionUtils.extensions[uuid] != undefined) {
         global.logError('Extension "%s" is already loaded'.format(uuid));
@@ -254,12 +296,16 @@ function loadExtension(dir, type, enabled) {
     }
 
     try {
-        extension = ExtensionUtils.createExtensionObject(uuid, dir, type);
+        _measureLoadStep(uuid, cost, LoadStep.LOAD, function() {
+            extension = ExtensionUtils.createExtensionObject(uuid, dir, type, metadataContents);
+        });
     } catch(e) {
         logExtensionError(uuid, e.message);
         return;
     }
 
+    extension.cost = cost;
+
     // Default to error, we set success as the last step
     extension.state = ExtensionState.ERROR;
 
@@ -283,11 +329,19 @@ function loadExtension(dir, type, enabled) {
 
 function initExtension(uuid) {
     let extension = ExtensionUtils.extensions[uuid];
-    let dir = extension.dir;
 
     if (!extension)
         throw new Error("Extension was not properly created. Call loadExtension first");
 
+    _measureLoadStep(uuid, extension.cost, LoadStep.INIT, function() {
+        _initExtension(extension);
+    });
+}
+
+function _initExtension(extension) {
+    let uuid = extension.uuid;
+    let dir = extension.dir;
+
     let extensionJs = dir.get_child('extension.js');
     if (!extensionJs.query_exists(null)) {
         logExtensionError(uuid, 'Missing extension.js');
@@ -375,14 +429,83 @@ function onEnabledExtensionsChanged() {
 function init() {
     ExtensionUtils.init();
 
+    let perfLog = Shell.PerfLog.get_default();
+    for (let step in LOAD_STEP_DESCRIPTIONS) {
+        let description = LOAD_STEP_DESCRIPTIONS[step];
+        perfLog.define_event('extensions.' + step + 'Start',
+                             'Started ' + description + '; argument is its uuid',
+                             's');
+        perfLog.define_event('extensions.' + step + 'Done',
+                             'Done ' + description + '; argument is its uuid',
+                             's');
+    }
+
     global.settings.connect('changed::' + ENABLED_EXTENSIONS_KEY, onEnabledExtensionsChanged);
     enabledExtensions = global.settings.get_strv(ENABLED_EXTENSIONS_KEY);
+    criticalExtensions = global.settings.get_strv(CRITICAL_EXTENSIONS_KEY);
 }
 
+function _isCritical(uuid) {
+    return criticalExtensions.indexOf(uuid) != -1 &&
+           enabledExtensions.indexOf(uuid) != -1;
+}
+
+function hasCriticalExtensions() {
+    return criticalExtensions.some(_isCritical);
+}
+
+// loadCriticalExtensions:
+//
+// Synchronously loads and enables the enabled extensions that are
+// listed in the critical-extensions key, in that order.
+function loadCriticalExtensions() {
+    for (let i = 0; i < criticalExtensions.length; i++) {
+        let uuid = criticalExtensions[i];
+        if (!_isCritical(uuid))
+            continue;
+
+        let found = ExtensionUtils.findExtension(uuid);
+        if (!found) {
+            global.logError('Critical extension "%s" is not installed'.format(uuid));
+            continue;
+        }
+
+        let [dir, type] = found;
+        loadExtension(dir, type, true);
+    }
+}
+
+function _loadNextExtension() {
+    let [dir, type, metadataContents] = _loadQueue.shift();
+    let enabled = enabledExtensions.indexOf(dir.get_basename()) != -1;
+
+    try {
+        loadExtension(dir, type, enabled, metadataContents);
+    } catch (e) {
+        logError(e, 'Loading extension ' + dir.get_basename() + ' failed');
+    }
+
+    if (_loadQueue.length > 0)
+        return true;
+
+    _loadQueueId = 0;
+    return false;
+}
+
+// loadExtensions:
+//
+// Looks for all the other extensions in the background, and then
+// loads them one per main loop iteration, so that we keep drawing
+// frames in between.
 function loadExtensions() {
-    ExtensionUtils.scanExtensions(function(uuid, dir, type) {
-        let enabled = enabledExtensions.indexOf(uuid) != -1;
-        loadExtension(dir, type, enabled);
+    ExtensionUtils.scanExtensionsAsync(function(uuid, dir, type, metadataContents) {
+        if (_isCritical(uuid) && ExtensionUtils.extensions[uuid])
+            return;
+
+        _loadQueue.push([dir, type, metadataContents]);
+    }, function() {
+        if (_loadQueue.length > 0 && _loadQueueId == 0)
+            _loadQueueId = Mainloop.idle_add(_loadNextExtension);
     });
 }
 
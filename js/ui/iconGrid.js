@@ -1,6 +1,7 @@
 // -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
 
 const Clutter = imports.gi.Clutter;
+const Meta = imports.gi.Meta;
 const Shell = imports.gi.Shell;
 const St = imports.gi.St;
 
@@ -9,6 +10,10 @@ const Params = imports.misc.params;
 
 const ICON_SIZE = 48;
 
+// Number of rows above and below the visible area of a virtualized
+// grid for which we keep item actors around
+const VIRTUAL_PREFETCH_ROWS = 2;
+
 
 const BaseIcon = new Lang.Class({
     Name: 'BaseIcon',
@@ -104,6 +109,18 @@ const BaseIcon = new Lang.Class({
         }
     },
 
+    setLabel: function(label) {
+        if (this.label)
+            this.label.text = label;
+    },
+
+    // Recreates the icon texture, for when what createIcon() returns
+    // has changed
+    reloadIcon: function() {
+        if (this._iconBin.child)
+            this._createIconTexture(this.iconSize);
+    },
+
     // This can be overridden by a subclass, or by the createIcon
     // parameter to _init()
     createIcon: function(size) {
@@ -155,17 +172,42 @@ const BaseIcon = new Lang.Class({
     }
 });
 
+/**
+ * IconGrid:
+ *
+ * Lays out item actors in a grid. Items are normally added as actors
+ * with addItem(); if the createItem and bindItem parameters are given,
+ * the grid is virtualized instead: the items are set as a list of
+ * arbitrary objects with setItems(), and actors are only created -
+ * with createItem(item) - for the rows inside the visible area of the
+ * scroll view set with setScrollView(), plus a few rows around it.
+ * Actors scrolling out of view are recycled for other items with
+ * bindItem(actor, item). rowLimit is not supported for virtualized
+ * grids.
+ */
 const IconGrid = new Lang.Class({
     Name: 'IconGrid',
 
     _init: function(params) {
         params = Params.parse(params, { rowLimit: null,
                                         columnLimit: null,
-                                        xAlign: St.Align.MIDDLE });
+                                        xAlign: St.Align.MIDDLE,
+                                        createItem: null,
+                                        bindItem: null });
         this._rowLimit = params.rowLimit;
         this._colLimit = params.columnLimit;
         this._xAlign = params.xAlign;
 
+        this._virtual = params.createItem != null;
+        this._createItem = params.createItem;
+        this._bindItem = params.bindItem;
+        this._items = [];
+        this._itemActors = {}; // item index => actor
+        this._recycledActors = [];
+        this._scrollView = null;
+        this._nColumns = 0;
+        this._updateId = 0;
+
         this.actor = new St.BoxLayout({ style_class: 'icon-grid',
                                         vertical: true });
         // Pulled from CSS, but hardcode some defaults here
@@ -180,11 +222,17 @@ const IconGrid = new Lang.Class({
         this._grid.connect('allocate', Lang.bind(this, this._allocate));
     },
 
+    _getItemCount: function() {
+        if (this._virtual)
+            return this._items.length;
+        return this._getVisibleChildren().length;
+    },
+
     _getPreferredWidth: function (grid, forHeight, alloc) {
-        let children = this._grid.get_children();
-        let nColumns = this._colLimit ? Math.min(this._colLimit,
-                                                 children.length)
-                                      : children.length;
+        let nItems = this._virtual ? this._items.length
+                                   : this._grid.get_children().length;
+        let nColumns = this._colLimit ? Math.min(this._colLimit, nItems)
+                                      : nItems;
         let totalSpacing = Math.max(0, nColumns - 1) * this._spacing;
         // Kind of a lie, but not really an issue right now.  If
         // we wanted to support some sort of hidden/overflow that would
@@ -202,11 +250,11 @@ const IconGrid = new Lang.Class({
     },
 
     _getPreferredHeight: function (grid, forWidth, alloc) {
-        let children = this._getVisibleChildren();
+        let nItems = this._getItemCount();
         let [nColumns, usedWidth] = this._computeLayout(forWidth);
         let nRows;
         if (nColumns > 0)
-            nRows = Math.ceil(children.length / nColumns);
+            nRows = Math.ceil(nItems / nColumns);
         else
             nRows = 0;
         if (this._rowLimit)
@@ -218,7 +266,6 @@ const IconGrid = new Lang.Class({
     },
 
     _allocate: function (grid, box, flags) {
-        let children = this._getVisibleChildren();
         let availWidth = box.x2 - box.x1;
         let availHeight = box.y2 - box.y1;
 
@@ -236,35 +283,21 @@ const IconGrid = new Lang.Class({
                 leftPadding = availWidth - usedWidth;
         }
 
+        if (this._virtual) {
+            this._allocateVirtual(box, flags, nColumns, leftPadding);
+            return;
+        }
+
+        let children = this._getVisibleChildren();
         let x = box.x1 + leftPadding;
         let y = box.y1;
         let columnIndex = 0;
         let rowIndex = 0;
         for (let i = 0; i < children.length; i++) {
-            let [childMinWidth, childMinHeight, childNaturalWidth, childNaturalHeight]
-                = children[i].get_preferred_size();
-
-            /* Center the item in its allocation horizontally */
-            let width = Math.min(this._hItemSize, childNaturalWidth);
-            let childXSpacing = Math.max(0, width - childNaturalWidth) / 2;
-            let height = Math.min(this._vItemSize, childNaturalHeight);
-            let childYSpacing = Math.max(0, height - childNaturalHeight) / 2;
-
-            let childBox = new Clutter.ActorBox();
-            if (Clutter.get_default_text_direction() == Clutter.TextDirection.RTL) {
-                let _x = box.x2 - (x + width);
-                childBox.x1 = Math.floor(_x - childXSpacing);
-            } else {
-                childBox.x1 = Math.floor(x + childXSpacing);
-            }
-            childBox.y1 = Math.floor(y + childYSpacing);
-            childBox.x2 = childBox.x1 + width;
-            childBox.y2 = childBox.y1 + height;
-
             if (this._rowLimit && rowIndex >= this._rowLimit) {
                 this._grid.set_skip_paint(children[i], true);
             } else {
-                children[i].allocate(childBox, flags);
+                this._allocateChild(children[i], box, x, y, flags);
                 this._grid.set_skip_paint(children[i], false);
             }
 
@@ -283,6 +316,182 @@ const IconGrid = new Lang.Class({
         }
     },
 
+    _allocateVirtual: function(box, flags, nColumns, leftPadding) {
+        this._nColumns = nColumns;
+
+        if (nColumns > 0) {
+            for (let key in this._itemActors) {
+                let index = parseInt(key);
+                let columnIndex = index % nColumns;
+                let rowIndex = Math.floor(index / nColumns);
+
+                let x = box.x1 + leftPadding + columnIndex * (this._hItemSize + this._spacing);
+                let y = box.y1 + rowIndex * (this._vItemSize + this._spacing);
+                this._allocateChild(this._itemActors[key], box, x, y, flags);
+            }
+        }
+
+        // The number of columns or our position in the scroll view
+        // might have changed what's visible; we can't add or remove
+        // actors while allocating, so check again later
+        this._queueUpdate();
+    },
+
+    _allocateChild: function(child, box, x, y, flags) {
+        let [childMinWidth, childMinHeight, childNaturalWidth, childNaturalHeight]
+            = child.get_preferred_size();
+
+        /* Center the item in its allocation horizontally */
+        let width = Math.min(this._hItemSize, childNaturalWidth);
+        let childXSpacing = Math.max(0, width - childNaturalWidth) / 2;
+        let height = Math.min(this._vItemSize, childNaturalHeight);
+        let childYSpacing = Math.max(0, height - childNaturalHeight) / 2;
+
+        let childBox = new Clutter.ActorBox();
+        if (Clutter.get_default_text_direction() == Clutter.TextDirection.RTL) {
+            let _x = box.x2 - (x + width);
+            childBox.x1 = Math.floor(_x - childXSpacing);
+        } else {
+            childBox.x1 = Math.floor(x + childXSpacing);
+        }
+        childBox.y1 = Math.floor(y + childYSpacing);
+        childBox.x2 = childBox.x1 + width;
+        childBox.y2 = childBox.y1 + height;
+
+        child.allocate(childBox, flags);
+    },
+
+    // Returns the vertical position of the grid in the scrolled content
+    _getScrollOffset: function() {
+        let scrolled = this._scrollView.get_child();
+        let offset = 0;
+        for (let actor = this._grid; actor && actor != scrolled; actor = actor.get_parent())
+            offset += actor.get_allocation_box().y1;
+        return offset;
+    },
+
+    // Returns the range of item indices [first, last) that need actors
+    _getVirtualRange: function() {
+        if (this._nColumns == 0)
+            return [0, 0];
+        if (!this._scrollView)
+            return [0, this._items.length];
+
+        let adjustment = this._scrollView.vscroll.adjustment;
+        let pageSize = adjustment.page_size || global.stage.height;
+        let top = adjustment.value - this._getScrollOffset();
+        let rowHeight = this._vItemSize + this._spacing;
+
+        let firstRow = Math.max(0, Math.floor(top / rowHeight) - VIRTUAL_PREFETCH_ROWS);
+        let lastRow = Math.ceil((top + pageSize) / rowHeight) + VIRTUAL_PREFETCH_ROWS;
+        return [Math.min(this._items.length, firstRow * this._nColumns),
+                Math.min(this._items.length, lastRow * this._nColumns)];
+    },
+
+    _queueUpdate: function() {
+        if (this._updateId)
+            return;
+
+        this._updateId = Meta.later_add(Meta.LaterType.BEFORE_REDRAW, Lang.bind(this,
+            function() {
+                this._updateId = 0;
+                this._updateVirtual();
+                return false;
+            }));
+    },
+
+    _updateVirtual: function() {
+        let [first, last] = this._getVirtualRange();
+        let focus = global.stage.get_key_focus();
+        let itemActors = {};
+        let changed = false;
+
+        // Recycle the actors which scrolled out of view, except for
+        // the one with the keyboard focus
+        for (let key in this._itemActors) {
+            let index = parseInt(key);
+            let actor = this._itemActors[key];
+            if ((index < first || index >= last) && actor != focus) {
+                actor.hide();
+                this._recycledActors.push(actor);
+                changed = true;
+            } else {
+                itemActors[index] = actor;
+            }
+        }
+
+        for (let i = first; i < last; i++) {
+            if (itemActors[i])
+                continue;
+
+            let actor = this._recycledActors.pop();
+            if (actor) {
+                this._bindItem(actor, this._items[i]);
+                actor.show();
+            } else {
+                actor = this._createItem(this._items[i]);
+                this._grid.add_actor(actor);
+            }
+            itemActors[i] = actor;
+            changed = true;
+        }
+
+        this._itemActors = itemActors;
+
+        // Don't hold on to more spare actors than we have in use
+        while (this._recycledActors.length > last - first)
+            this._recycledActors.pop().destroy();
+
+        if (!changed)
+            return;
+
+        // Keep the children in item order, for keyboard navigation
+        for (let i = first; i < last; i++)
+            itemActors[i].raise_top();
+
+        this._grid.queue_relayout();
+    },
+
+    _recycleAll: function() {
+        for (let key in this._itemActors) {
+            let actor = this._itemActors[key];
+            actor.hide();
+            this._recycledActors.push(actor);
+        }
+        this._itemActors = {};
+    },
+
+    /**
+     * setScrollView:
+     * @scrollView: the St.ScrollView the grid is scrolled in
+     *
+     * For virtualized grids, sets the scroll view whose visible area
+     * determines which items need actors.
+     */
+    setScrollView: function(scrollView) {
+        this._scrollView = scrollView;
+
+        let adjustment = scrollView.vscroll.adjustment;
+        adjustment.connect('notify::value', Lang.bind(this, this._queueUpdate));
+        adjustment.connect('changed', Lang.bind(this, this._queueUpdate));
+    },
+
+    /**
+     * setItems:
+     * @items: array of items
+     *
+     * Sets the items of a virtualized grid.
+     */
+    setItems: function(items) {
+        if (!this._virtual)
+            throw new Error('setItems() can only be used on virtualized grids');
+
+        this._recycleAll();
+        this._items = items;
+        this._grid.queue_relayout();
+        this._queueUpdate();
+    },
+
     childrenInRow: function(rowWidth) {
         return this._computeLayout(rowWidth)[0];
     },
@@ -314,17 +523,31 @@ const IconGrid = new Lang.Class({
         this._grid.get_children().forEach(Lang.bind(this, function (child) {
             child.destroy();
         }));
+        this._items = [];
+        this._itemActors = {};
+        this._recycledActors = [];
     },
 
     addItem: function(actor) {
+        if (this._virtual)
+            throw new Error('addItem() can\'t be used on virtualized grids');
+
         this._grid.add_actor(actor);
     },
 
+    // For virtualized grids, this returns null if the item at @index
+    // has no actor currently
     getItemAtIndex: function(index) {
+        if (this._virtual)
+            return this._itemActors[index] || null;
+
         return this._grid.get_children()[index];
     },
 
     visibleItemsCount: function() {
+        if (this._virtual)
+            return this._items.length;
+
         return this._grid.get_children().length - this._grid.get_n_skip_paint();
     }
 });
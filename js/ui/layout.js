@@ -573,6 +573,10 @@ const Chrome = new Lang.Class({
 
         this._trackedActors = [];
 
+        // The struts as last set on the workspaces, as
+        // [x1, y1, x2, y2, side] arrays
+        this._struts = null;
+
         this._layoutManager.connect('monitors-changed',
                                     Lang.bind(this, this._relayout));
         global.screen.connect('restacked',
@@ -580,7 +584,10 @@ const Chrome = new Lang.Class({
 
         // Need to update struts on new workspaces when they are added
         global.screen.connect('notify::n-workspaces',
-                              Lang.bind(this, this._queueUpdateRegions));
+                              Lang.bind(this, function() {
+                                  this._struts = null;
+                                  this._queueUpdateRegions();
+                              }));
 
         this._screenSaverActive = false;
         this._screenSaverProxy = new ScreenSaver.ScreenSaverProxy();
@@ -867,8 +874,22 @@ const Chrome = new Lang.Class({
         }
     },
 
+    _strutsChanged: function(newStruts) {
+        if (!this._struts || this._struts.length != newStruts.length)
+            return true;
+
+        for (let i = 0; i < newStruts.length; i++) {
+            for (let j = 0; j < newStruts[i].length; j++) {
+                if (newStruts[i][j] != this._struts[i][j])
+                    return true;
+            }
+        }
+
+        return false;
+    },
+
     updateRegions: function() {
-        let rects = [], struts = [], i;
+        let rects = [], struts = [], strutKeys = [], i;
 
         if (this._updateRegionIdle) {
             Mainloop.source_remove(this._updateRegionIdle);
@@ -966,14 +987,23 @@ const Chrome = new Lang.Class({
             let strutRect = new Meta.Rectangle({ x: x1, y: y1, width: x2 - x1, height: y2 - y1});
             let strut = new Meta.Strut({ rect: strutRect, side: side });
             struts.push(strut);
+            strutKeys.push([x1, y1, x2, y2, side]);
         }
 
+        // This is a no-op if the region didn't change
         global.set_stage_input_region(rects);
 
-        let screen = global.screen;
-        for (let w = 0; w < screen.n_workspaces; w++) {
-            let workspace = screen.get_workspace_by_index(w);
-            workspace.set_builtin_struts(struts);
+        // Setting the struts makes mutter recompute the work area of
+        // every workspace, and chrome allocation changes mostly don't
+        // affect them, so only do it when they actually changed
+        if (this._strutsChanged(strutKeys)) {
+            this._struts = strutKeys;
+
+            let screen = global.screen;
+            for (let w = 0; w < screen.n_workspaces; w++) {
+                let workspace = screen.get_workspace_by_index(w);
+                workspace.set_builtin_struts(struts);
+            }
         }
 
         return false;
@@ -731,6 +731,7 @@ const Extensions = new Lang.Class({
         this._noExtensions = new St.Label({ style_class: 'lg-extensions-none',
                                              text: _("No extensions installed") });
         this._numExtensions = 0;
+        this._extensionDisplays = {};
         this._extensionsList = new St.BoxLayout({ vertical: true,
                                                   style_class: 'lg-extensions-list' });
         this._extensionsList.add(this._noExtensions);
@@ -741,6 +742,18 @@ const Extensions = new Lang.Class({
 
         ExtensionSystem.connect('extension-loaded',
                                 Lang.bind(this, this._loadExtension));
+        ExtensionSystem.connect('extension-state-changed',
+                                Lang.bind(this, this._onExtensionStateChanged));
+    },
+
+    _onExtensionStateChanged: function(o, meta) {
+        let extensionDisplay = this._extensionDisplays[meta.uuid];
+        if (!extensionDisplay)
+            return;
+
+        let extension = ExtensionUtils.extensions[meta.uuid] || meta;
+        extensionDisplay._state.text = this._stateToString(extension.state);
+        extensionDisplay._cost.text = this._costToString(extension);
     },
 
     _loadExtension: function(o, uuid) {
@@ -756,6 +769,7 @@ const Extensions = new Lang.Class({
 
         this._numExtensions ++;
         this._extensionsList.add(extensionDisplay);
+        this._extensionDisplays[uuid] = extensionDisplay;
     },
 
     _onViewSource: function (actor) {
@@ -816,6 +830,28 @@ const Extensions = new Lang.Class({
         return 'Unknown'; // Not translated, shouldn't appear
     },
 
+    _costToString: function(extension) {
+        let cost = extension.cost;
+        if (!cost)
+            return '';
+
+        let time = 0;
+        let jsBytes = 0;
+        let steps = [];
+        for (let step in cost) {
+            time += cost[step].time;
+            jsBytes += cost[step].jsBytes;
+            steps.push('%s %d ms'.format(step, Math.round(cost[step].time)));
+        }
+
+        /* Translators: the first argument is the time it took to load an
+         * extension, the second how that time was spent, in English, and
+         * the third by how much it grew the JavaScript heap */
+        return _("Loaded in %d ms (%s), JS heap +%d kB").format(Math.round(time),
+                                                                steps.join(', '),
+                                                                Math.round(jsBytes / 1024));
+    },
+
     _createExtensionDisplay: function(extension) {
         let box = new St.BoxLayout({ style_class: 'lg-extension', vertical: true });
         let name = new St.Label({ style_class: 'lg-extension-name',
@@ -831,6 +867,7 @@ const Extensions = new Lang.Class({
         let state = new St.Label({ style_class: 'lg-extension-state',
                                    text: this._stateToString(extension.state) });
         metaBox.add(state);
+        box._state = state;
 
         let viewsource = new Link.Link({ label: _("View Source") });
         viewsource.actor._extension = extension;
@@ -851,6 +888,11 @@ const Extensions = new Lang.Class({
         viewerrors.actor.connect('clicked', Lang.bind(this, this._onViewErrors));
         metaBox.add(viewerrors.actor);
 
+        let cost = new St.Label({ style_class: 'lg-extension-cost',
+                                  text: this._costToString(extension) });
+        box.add(cost);
+        box._cost = cost;
+
         return box;
     }
 });
@@ -31,6 +31,7 @@ const NotificationDaemon = imports.ui.notificationDaemon;
 const WindowAttentionHandler = imports.ui.windowAttentionHandler;
 const Scripting = imports.ui.scripting;
 const ShellDBus = imports.ui.shellDBus;
+const Startup = imports.ui.startup;
 const TelepathyClient = imports.ui.telepathyClient;
 const WindowManager = imports.ui.windowManager;
 const Magnifier = imports.ui.magnifier;
@@ -67,6 +68,7 @@ let statusIconDispatcher = null;
 let keyboard = null;
 let layoutManager = null;
 let networkAgent = null;
+let startup = null;
 let _errorLogStack = [];
 let _startDate;
 let _defaultCssStylesheet = null;
@@ -79,13 +81,23 @@ let background = null;
 function _createUserSession() {
     // Load the calendar server. Note that we are careful about
     // not loading any events until the user presses the clock
-    global.launch_calendar_server();
+    startup.add('calendarServer', Startup.Phase.AFTER_FIRST_FRAME, function() {
+        global.launch_calendar_server();
+    });
 
-    placesManager = new PlaceDisplay.PlacesManager();
-    telepathyClient = new TelepathyClient.Client();
-    automountManager = new AutomountManager.AutomountManager();
-    autorunManager = new AutorunManager.AutorunManager();
-    networkAgent = new NetworkAgent.NetworkAgent();
+    startup.add('placesManager', Startup.Phase.AFTER_FIRST_FRAME, function() {
+        placesManager = new PlaceDisplay.PlacesManager();
+    });
+    startup.add('networkAgent', Startup.Phase.AFTER_FIRST_FRAME, function() {
+        networkAgent = new NetworkAgent.NetworkAgent();
+    });
+    startup.add('telepathyClient', Startup.Phase.AFTER_FIRST_FRAME, function() {
+        telepathyClient = new TelepathyClient.Client();
+    });
+    startup.add('automountManager', Startup.Phase.IDLE, function() {
+        automountManager = new AutomountManager.AutomountManager();
+        autorunManager = new AutorunManager.AutorunManager();
+    });
 }
 
 function _createGDMSession() {
@@ -130,12 +142,22 @@ function _initRecorder() {
 }
 
 function _initUserSession() {
-    _initRecorder();
+    startup.add('recorder', Startup.Phase.IDLE, _initRecorder);
 
     global.screen.override_workspace_layout(Meta.ScreenCorner.TOPLEFT, false, -1, 1);
 
-    ExtensionSystem.init();
-    ExtensionSystem.loadExtensions();
+    // Extensions often hook into the overview and the status area,
+    // so they are loaded after those; the ones that need to be there
+    // from the first frame on have these set up early
+    startup.add('criticalExtensions', Startup.Phase.FIRST_FRAME, function() {
+        ExtensionSystem.init();
+        if (ExtensionSystem.hasCriticalExtensions())
+            startup.ensure('overview');
+        ExtensionSystem.loadCriticalExtensions();
+    });
+    startup.add('extensions', Startup.Phase.AFTER_FIRST_FRAME, function() {
+        ExtensionSystem.loadExtensions();
+    });
 
     Meta.keybindings_set_custom_handler('panel-run-dialog', function() {
        getRunDialog().open();
@@ -161,7 +183,20 @@ function start() {
 
     Gio.DesktopAppInfo.set_desktop_env('GNOME');
 
-    shellDBusService = new ShellDBus.GnomeShell();
+    // Enable the perf log right away when running a perf script, so
+    // that it also has the startup trace
+    let perfModuleName = GLib.getenv("SHELL_PERF_MODULE");
+    if (perfModuleName)
+        Shell.PerfLog.get_default().set_enabled(true);
+
+    // Only what is needed to draw the first frame is created right
+    // here; everything else is added to the startup scheduler, see
+    // startup.js
+    startup = new Startup.StartupScheduler();
+
+    startup.add('shellDBus', Startup.Phase.FIRST_FRAME, function() {
+        shellDBusService = new ShellDBus.GnomeShell();
+    });
 
     // Ensure ShellWindowTracker and ShellAppUsage are initialized; this will
     // also initialize ShellAppSystem first.  ShellAppSystem
@@ -171,74 +206,129 @@ function start() {
     // and recalculate application associations, so to avoid
     // races for now we initialize it here.  It's better to
     // be predictable anyways.
-    let tracker = Shell.WindowTracker.get_default();
-    Shell.AppUsage.get_default();
-
-    tracker.connect('startup-sequence-changed', _queueCheckWorkspaces);
-
-    // The stage is always covered so Clutter doesn't need to clear it; however
-    // the color is used as the default contents for the Mutter root background
-    // actor so set it anyways.
-    global.stage.color = DEFAULT_BACKGROUND_COLOR;
-    global.stage.no_clear_hint = true;
-
-    _defaultCssStylesheet = global.datadir + '/theme/gnome-shell.css';
-    _gdmCssStylesheet = global.datadir + '/theme/gdm.css';
-    loadTheme();
-
-    // Set up stage hierarchy to group all UI actors under one container.
-    uiGroup = new Shell.GenericContainer({ name: 'uiGroup' });
-    uiGroup.connect('allocate',
-                    function (actor, box, flags) {
-                        let children = uiGroup.get_children();
-                        for (let i = 0; i < children.length; i++)
-                            children[i].allocate_preferred_size(flags);
-                    });
-    let constraint = new Clutter.BindConstraint({ source: global.stage,
-                                                  coordinate: Clutter.BindCoordinate.SIZE });
-    uiGroup.add_constraint(constraint);
-    global.window_group.reparent(uiGroup);
-    global.overlay_group.reparent(uiGroup);
-    global.stage.add_actor(uiGroup);
-
-    layoutManager = new Layout.LayoutManager();
-    xdndHandler = new XdndHandler.XdndHandler();
-    ctrlAltTabManager = new CtrlAltTab.CtrlAltTabManager();
-    // This overview object is just a stub for non-user sessions
-    overview = new Overview.Overview({ isDummy: global.session_type != Shell.SessionType.USER });
-    magnifier = new Magnifier.Magnifier();
-    statusIconDispatcher = new StatusIconDispatcher.StatusIconDispatcher();
-    panel = new Panel.Panel();
-    wm = new WindowManager.WindowManager();
-    messageTray = new MessageTray.MessageTray();
-    keyboard = new Keyboard.Keyboard();
-    notificationDaemon = new NotificationDaemon.NotificationDaemon();
-    windowAttentionHandler = new WindowAttentionHandler.WindowAttentionHandler();
+    startup.add('windowTracker', Startup.Phase.FIRST_FRAME, function() {
+        let tracker = Shell.WindowTracker.get_default();
+        Shell.AppUsage.get_default();
+
+        tracker.connect('startup-sequence-changed', _queueCheckWorkspaces);
+    });
+
+    startup.add('theme', Startup.Phase.FIRST_FRAME, function() {
+        // The stage is always covered so Clutter doesn't need to clear it; however
+        // the color is used as the default contents for the Mutter root background
+        // actor so set it anyways.
+        global.stage.color = DEFAULT_BACKGROUND_COLOR;
+        global.stage.no_clear_hint = true;
+
+        _defaultCssStylesheet = global.datadir + '/theme/gnome-shell.css';
+        _gdmCssStylesheet = global.datadir + '/theme/gdm.css';
+        loadTheme();
+    });
+
+    startup.add('uiGroup', Startup.Phase.FIRST_FRAME, function() {
+        // Set up stage hierarchy to group all UI actors under one container.
+        uiGroup = new Shell.GenericContainer({ name: 'uiGroup' });
+        uiGroup.connect('allocate',
+                        function (actor, box, flags) {
+                            let children = uiGroup.get_children();
+                            for (let i = 0; i < children.length; i++)
+                                children[i].allocate_preferred_size(flags);
+                        });
+        let constraint = new Clutter.BindConstraint({ source: global.stage,
+                                                      coordinate: Clutter.BindCoordinate.SIZE });
+        uiGroup.add_constraint(constraint);
+        global.window_group.reparent(uiGroup);
+        global.overlay_group.reparent(uiGroup);
+        global.stage.add_actor(uiGroup);
+    });
+
+    startup.add('layoutManager', Startup.Phase.FIRST_FRAME, function() {
+        layoutManager = new Layout.LayoutManager();
+        xdndHandler = new XdndHandler.XdndHandler();
+        ctrlAltTabManager = new CtrlAltTab.CtrlAltTabManager();
+    });
+    startup.add('overviewStub', Startup.Phase.FIRST_FRAME, function() {
+        // This overview object is just a stub for non-user sessions
+        overview = new Overview.Overview({ isDummy: global.session_type != Shell.SessionType.USER });
+    });
+    startup.add('magnifier', Startup.Phase.FIRST_FRAME, function() {
+        magnifier = new Magnifier.Magnifier();
+    });
+    startup.add('panel', Startup.Phase.FIRST_FRAME, function() {
+        statusIconDispatcher = new StatusIconDispatcher.StatusIconDispatcher();
+        panel = new Panel.Panel();
+    });
+    startup.add('windowManager', Startup.Phase.FIRST_FRAME, function() {
+        wm = new WindowManager.WindowManager();
+    });
+    startup.add('messageTray', Startup.Phase.FIRST_FRAME, function() {
+        messageTray = new MessageTray.MessageTray();
+    });
+    startup.add('keyboard', Startup.Phase.FIRST_FRAME, function() {
+        keyboard = new Keyboard.Keyboard();
+    });
+    startup.add('notificationDaemon', Startup.Phase.FIRST_FRAME, function() {
+        notificationDaemon = new NotificationDaemon.NotificationDaemon();
+    });
+    startup.add('windowAttentionHandler', Startup.Phase.AFTER_FIRST_FRAME, function() {
+        windowAttentionHandler = new WindowAttentionHandler.WindowAttentionHandler();
+    });
 
     if (global.session_type == Shell.SessionType.USER)
         _createUserSession();
     else if (global.session_type == Shell.SessionType.GDM)
-        _createGDMSession();
+        startup.add('loginDialog', Startup.Phase.FIRST_FRAME, _createGDMSession);
 
-    panel.startStatusArea();
+    startup.add('statusArea', Startup.Phase.AFTER_FIRST_FRAME, function() {
+        panel.startStatusArea();
+    });
 
-    layoutManager.init();
-    keyboard.init();
-    overview.init();
+    startup.add('layout', Startup.Phase.FIRST_FRAME, function() {
+        layoutManager.init();
+    });
+    startup.add('onScreenKeyboard', Startup.Phase.AFTER_FIRST_FRAME, function() {
+        keyboard.init();
+    });
+    // The overview contents are by far the most expensive part of
+    // startup; if the overview is needed before we get to it,
+    // Overview.show() runs this early
+    startup.add('overview', Startup.Phase.AFTER_FIRST_FRAME, function() {
+        overview.init();
+    });
 
     if (global.session_type == Shell.SessionType.USER)
         _initUserSession();
-    statusIconDispatcher.start(messageTray.actor);
+
+    startup.add('trayIcons', Startup.Phase.AFTER_FIRST_FRAME, function() {
+        statusIconDispatcher.start(messageTray.actor);
+    });
 
     // Provide the bus object for gnome-session to
     // initiate logouts.
-    EndSessionDialog.init();
+    startup.add('endSessionDialog', Startup.Phase.AFTER_FIRST_FRAME, function() {
+        EndSessionDialog.init();
+    });
 
     // Attempt to become a PolicyKit authentication agent
-    PolkitAuthenticationAgent.init()
+    startup.add('polkitAgent', Startup.Phase.AFTER_FIRST_FRAME, function() {
+        PolkitAuthenticationAgent.init();
+    });
 
     // Become a prompter for gnome keyring
-    KeyringPrompt.init();
+    startup.add('keyringPrompt', Startup.Phase.AFTER_FIRST_FRAME, function() {
+        KeyringPrompt.init();
+    });
+
+    // Perf scripts expect a fully initialized shell
+    if (perfModuleName) {
+        startup.add('perfModule', Startup.Phase.IDLE, function() {
+            let perfOutput = GLib.getenv("SHELL_PERF_OUTPUT");
+            let module = eval('imports.perf.' + perfModuleName + ';');
+            Scripting.runPerfScript(module, perfOutput);
+        });
+    }
+
+    startup.start();
 
     _startDate = new Date();
 
@@ -247,13 +337,6 @@ function start() {
     _log('info', 'loaded at ' + _startDate);
     log('GNOME Shell started at ' + _startDate);
 
-    let perfModuleName = GLib.getenv("SHELL_PERF_MODULE");
-    if (perfModuleName) {
-        let perfOutput = GLib.getenv("SHELL_PERF_OUTPUT");
-        let module = eval('imports.perf.' + perfModuleName + ';');
-        Scripting.runPerfScript(module, perfOutput);
-    }
-
     _overridesSettings = new Gio.Settings({ schema: OVERRIDES_SCHEMA });
     _overridesSettings.connect('changed::dynamic-workspaces', _queueCheckWorkspaces);
 
@@ -1125,6 +1125,12 @@ const Source = new Lang.Class({
     open: function(notification) {
     },
 
+    // Called before the notifications of the source are shown in the
+    // summary. Default implementation is to do nothing, but subclasses
+    // that hold back notifications can override to add them now.
+    prepareNotifications: function() {
+    },
+
     destroyNonResidentNotifications: function() {
         for (let i = this.notifications.length - 1; i >= 0; i--)
             if (!this.notifications[i].resident)
@@ -1252,6 +1258,8 @@ const SummaryItem = new Lang.Class({
     },
 
     prepareNotificationStackForShowing: function() {
+        this.source.prepareNotifications();
+
         if (this.notificationStack.get_children().length > 0)
             return;
 
@@ -1437,6 +1445,7 @@ const MessageTray = new Lang.Class({
         this._overviewVisible = Main.overview.visible;
         this._notificationRemoved = false;
         this._reNotifyAfterHideNotification = null;
+        this._updateStateIdleId = 0;
 
         this._corner = new Clutter.Rectangle({ width: 1,
                                                height: 1,
@@ -1705,12 +1714,43 @@ const MessageTray = new Lang.Class({
         } else if (this._notificationQueue.indexOf(notification) < 0) {
             notification.connect('destroy',
                                  Lang.bind(this, this._onNotificationDestroy));
-            this._notificationQueue.push(notification);
-            this._notificationQueue.sort(function(notification1, notification2) {
-                return (notification2.urgency - notification1.urgency);
-            });
+            this._enqueueNotification(notification);
+        } else {
+            // The update may have changed the urgency
+            let index = this._notificationQueue.indexOf(notification);
+            let previous = this._notificationQueue[index - 1];
+            let next = this._notificationQueue[index + 1];
+            if ((previous && previous.urgency < notification.urgency) ||
+                (next && next.urgency > notification.urgency)) {
+                this._notificationQueue.splice(index, 1);
+                this._enqueueNotification(notification);
+            }
         }
-        this._updateState();
+
+        // Applications can send many notifications in a row; only work
+        // out what to show once they are all queued
+        this._queueUpdateState();
+    },
+
+    // Keeps the queue sorted by urgency, and notifications of the
+    // same urgency in the order they arrived in
+    _enqueueNotification: function(notification) {
+        let i = this._notificationQueue.length;
+        while (i > 0 && this._notificationQueue[i - 1].urgency < notification.urgency)
+            i--;
+        this._notificationQueue.splice(i, 0, notification);
+    },
+
+    _queueUpdateState: function() {
+        if (this._updateStateIdleId)
+            return;
+
+        this._updateStateIdleId = Mainloop.idle_add(Lang.bind(this,
+            function() {
+                this._updateStateIdleId = 0;
+                this._updateState();
+                return false;
+            }));
     },
 
     _onSummaryItemHoverChanged: function(summaryItem) {
@@ -16,6 +16,16 @@ const Util = imports.misc.util;
 
 let nextNotificationId = 1;
 
+// Each sender can show RATE_LIMIT_BURST notifications in a row, and one
+// more every RATE_LIMIT_INTERVAL seconds after that; further ones are
+// held back until it is their turn. Once more than RATE_LIMIT_MAX_HELD
+// notifications of a sender are held back, the oldest ones are dropped
+// as if they had expired, so that a flood doesn't cost us more than
+// keeping their data around.
+const RATE_LIMIT_BURST = 5;
+const RATE_LIMIT_INTERVAL = 2;
+const RATE_LIMIT_MAX_HELD = 20;
+
 // Should really be defined in Gio.js
 const BusIface = <interface name="org.freedesktop.DBus">
 <method name="GetConnectionUnixProcessID">
@@ -99,6 +109,12 @@ const NotificationDaemon = new Lang.Class({
         this._notifications = {};
         this._busProxy = new Bus();
 
+        // Ids of notifications that haven't been handed to a source yet
+        this._queue = [];
+        this._queueIdleId = 0;
+        this._rateLimits = {};
+        this._rateLimitTimeoutId = 0;
+
         Main.statusIconDispatcher.connect('message-icon-added', Lang.bind(this, this._onTrayIconAdded));
         Main.statusIconDispatcher.connect('message-icon-removed', Lang.bind(this, this._onTrayIconRemoved));
 
@@ -202,6 +218,8 @@ const NotificationDaemon = new Lang.Class({
 
         let source = new Source(title, pid, sender, trayIcon);
         source.setTransient(isForTransientNotification);
+        source.connect('prepare-notifications',
+                       Lang.bind(this, this._releaseHeldNotifications));
 
         if (!isForTransientNotification) {
             this._sources.push(source);
@@ -269,38 +287,183 @@ const NotificationDaemon = new Lang.Class({
                 // early versions of the spec; 'icon_data' should only be used if 'image-path' is not available
                 hints['image-data'] = hints['icon_data'];
 
+        let sender = invocation.get_sender();
         let ndata = { appName: appName,
                       icon: icon,
                       summary: summary,
                       body: body,
                       actions: actions,
                       hints: hints,
-                      timeout: timeout };
+                      timeout: timeout,
+                      sender: sender };
         if (replacesId != 0 && this._notifications[replacesId]) {
             ndata.id = id = replacesId;
             ndata.notification = this._notifications[replacesId].notification;
+            ndata.pidPending = this._notifications[replacesId].pidPending;
         } else {
-            replacesId = 0;
+            // Applications that fire the same notification repeatedly
+            // get the id of the one that is still waiting to be shown
+            let duplicate = this._findQueuedDuplicate(ndata);
+            if (duplicate)
+                return invocation.return_value(GLib.Variant.new('(u)', [duplicate.id]));
+
             ndata.id = id = nextNotificationId++;
         }
         this._notifications[id] = ndata;
 
-        let sender = invocation.get_sender();
+        // Updates of a notification that is still in the queue replace
+        // its data there, so that we only build it once
+        if (this._queue.indexOf(id) < 0)
+            this._queue.push(id);
+        this._queueProcessNotifications();
+
+        return invocation.return_value(GLib.Variant.new('(u)', [id]));
+    },
+
+    _findQueuedDuplicate: function(ndata) {
+        for (let i = 0; i < this._queue.length; i++) {
+            let queued = this._notifications[this._queue[i]];
+            if (queued && !queued.notification &&
+                queued.sender == ndata.sender &&
+                queued.appName == ndata.appName &&
+                queued.summary == ndata.summary &&
+                queued.body == ndata.body)
+                return queued;
+        }
+        return null;
+    },
+
+    _queueProcessNotifications: function() {
+        if (this._queueIdleId)
+            return;
+
+        // Handle all notifications of a burst at once, once we are
+        // done receiving them
+        this._queueIdleId = Mainloop.idle_add(Lang.bind(this,
+            function() {
+                this._queueIdleId = 0;
+                this._processNotifications();
+                return false;
+            }));
+    },
+
+    // Returns whether the sender of @ndata may show another notification
+    // now, and if so, counts it.
+    _takeRateLimitToken: function(ndata) {
+        // Updates of notifications we already have and critical
+        // notifications are never held back
+        if (ndata.notification || ndata.hints.urgency == Urgency.CRITICAL)
+            return true;
+
+        let now = GLib.get_monotonic_time() / 1000000;
+        let limit = this._rateLimits[ndata.sender];
+        if (!limit)
+            limit = this._rateLimits[ndata.sender] = { tokens: RATE_LIMIT_BURST,
+                                                       time: now };
+
+        limit.tokens = Math.min(RATE_LIMIT_BURST,
+                                limit.tokens + (now - limit.time) / RATE_LIMIT_INTERVAL);
+        limit.time = now;
+
+        if (limit.tokens < 1)
+            return false;
+
+        limit.tokens--;
+        return true;
+    },
+
+    _processNotifications: function() {
+        let queue = this._queue;
+        let held = [];
+        let heldPerSender = {};
+
+        this._queue = [];
+
+        for (let i = 0; i < queue.length; i++) {
+            let ndata = this._notifications[queue[i]];
+            // The notification may have been closed meanwhile
+            if (!ndata)
+                continue;
+
+            if (this._takeRateLimitToken(ndata)) {
+                this._deliverNotification(ndata, false);
+                continue;
+            }
+
+            held.push(ndata.id);
+            heldPerSender[ndata.sender] = (heldPerSender[ndata.sender] || 0) + 1;
+        }
+
+        for (let i = 0; i < held.length; i++) {
+            let ndata = this._notifications[held[i]];
+            if (heldPerSender[ndata.sender] > RATE_LIMIT_MAX_HELD) {
+                heldPerSender[ndata.sender]--;
+                delete this._notifications[ndata.id];
+                this._emitNotificationClosed(ndata.id, NotificationClosedReason.EXPIRED);
+            } else {
+                this._queue.push(ndata.id);
+            }
+        }
+
+        // Forget about senders that are back to a full burst
+        let now = GLib.get_monotonic_time() / 1000000;
+        for (let sender in this._rateLimits) {
+            let limit = this._rateLimits[sender];
+            if (limit.tokens + (now - limit.time) / RATE_LIMIT_INTERVAL >= RATE_LIMIT_BURST)
+                delete this._rateLimits[sender];
+        }
+
+        if (this._queue.length > 0 && this._rateLimitTimeoutId == 0)
+            this._rateLimitTimeoutId = Mainloop.timeout_add_seconds(RATE_LIMIT_INTERVAL,
+                Lang.bind(this, function() {
+                    this._rateLimitTimeoutId = 0;
+                    this._queueProcessNotifications();
+                    return false;
+                }));
+    },
+
+    // Hands the notifications held back for @source over to it without
+    // showing them, when the user looks at its notifications anyway
+    _releaseHeldNotifications: function(source) {
+        let queue = this._queue;
+
+        this._queue = [];
+
+        for (let i = 0; i < queue.length; i++) {
+            let ndata = this._notifications[queue[i]];
+            if (!ndata)
+                continue;
+
+            let pid = this._senderToPid[ndata.sender];
+            if (pid && this._lookupSource(ndata.appName, pid, null) == source)
+                this._deliverNotification(ndata, true);
+            else
+                this._queue.push(ndata.id);
+        }
+    },
+
+    _deliverNotification: function(ndata, quiet) {
+        let id = ndata.id;
+        let sender = ndata.sender;
+        let appName = ndata.appName;
         let pid = this._senderToPid[sender];
 
+        ndata.quiet = quiet;
+
         let source = this._getSource(appName, pid, ndata, sender, null);
 
         if (source) {
             this._notifyForSource(source, ndata);
-            return invocation.return_value(GLib.Variant.new('(u)', [id]));
+            return;
         }
 
-        if (replacesId) {
+        if (ndata.pidPending) {
             // There's already a pending call to GetConnectionUnixProcessID,
             // which will see the new notification data when it finishes,
             // so we don't have to do anything.
-            return invocation.return_value(GLib.Variant.new('(u)', [id]));;
+            return;
         }
+        ndata.pidPending = true;
 
         this._busProxy.GetConnectionUnixProcessIDRemote(sender, Lang.bind(this, function (result, excp) {
             // The app may have updated or removed the notification
@@ -332,8 +495,6 @@ const NotificationDaemon = new Lang.Class({
             }
             this._notifyForSource(source, ndata);
         }));
-
-        return invocation.return_value(GLib.Variant.new('(u)', [id]));
     },
 
     _notifyForSource: function(source, ndata) {
@@ -422,7 +583,7 @@ const NotificationDaemon = new Lang.Class({
         notification.setTransient(hints['transient'] == true);
 
         let sourceIconActor = source.useNotificationIcon ? this._iconForNotificationData(icon, hints, source.ICON_SIZE) : null;
-        source.processNotification(notification, sourceIconActor);
+        source.processNotification(notification, sourceIconActor, ndata.quiet);
     },
 
     CloseNotification: function(id) {
@@ -534,19 +695,24 @@ const Source = new Lang.Class({
             this.destroy();
     },
 
-    processNotification: function(notification, icon) {
+    processNotification: function(notification, icon, quiet) {
         if (!this.app)
             this._setApp();
         if (!this.app && icon)
             this._setSummaryIcon(icon);
 
         let tracker = Shell.WindowTracker.get_default();
-        if (notification.resident && this.app && tracker.focus_app == this.app)
+        if (quiet || (notification.resident && this.app && tracker.focus_app == this.app))
             this.pushNotification(notification);
         else
             this.notify(notification);
     },
 
+    prepareNotifications: function() {
+        // The daemon may be holding back notifications for us
+        this.emit('prepare-notifications');
+    },
+
     handleSummaryClick: function() {
         if (!this.trayIcon)
             return false;
@@ -148,6 +148,7 @@ const Overview = new Lang.Class({
         this._buttonPressId = 0;
 
         this._workspacesDisplay = null;
+        this._initialized = false;
 
         this.visible = false;           // animating to overview, in overview, animating out
         this._shown = false;            // show() and not hide()
@@ -189,10 +190,16 @@ const Overview = new Lang.Class({
     // want to access the overview as Main.overview to connect
     // signal handlers and so forth. So we create them after
     // construction in this init() method.
+    //
+    // This is one of the startup tasks run after the first frame;
+    // methods that need the contents call _ensureInitialized() in
+    // case they are used before we got to it.
     init: function() {
-        if (this.isDummy)
+        if (this.isDummy || this._initialized)
             return;
 
+        this._initialized = true;
+
         this._shellInfo = new ShellInfo();
 
         this._viewSelector = new ViewSelector.ViewSelector();
@@ -234,11 +241,18 @@ const Overview = new Lang.Class({
         this._relayout();
     },
 
+    _ensureInitialized: function() {
+        if (!this._initialized)
+            Main.startup.ensure('overview');
+    },
+
     addSearchProvider: function(provider) {
+        this._ensureInitialized();
         this._viewSelector.addSearchProvider(provider);
     },
 
     removeSearchProvider: function(provider) {
+        this._ensureInitialized();
         this._viewSelector.removeSearchProvider(provider);
     },
 
@@ -246,6 +260,8 @@ const Overview = new Lang.Class({
         if (this.isDummy)
             return;
 
+        this._ensureInitialized();
+
         this._shellInfo.setMessage(text, undoCallback, undoLabel);
     },
 
@@ -487,6 +503,9 @@ const Overview = new Lang.Class({
     },
 
     _relayout: function () {
+        if (!this._initialized)
+            return;
+
         // To avoid updating the position and size of the workspaces
         // we just hide the overview. The positions will be updated
         // when it is next shown.
@@ -558,6 +577,9 @@ const Overview = new Lang.Class({
             return;
         if (this._shown)
             return;
+
+        this._ensureInitialized();
+
         // Do this manually instead of using _syncInputMode, to handle failure
         if (!Main.pushModal(this._group))
             return;
@@ -638,6 +660,8 @@ const Overview = new Lang.Class({
         if (this._shownTemporarily)
             return;
 
+        this._ensureInitialized();
+
         this._syncInputMode();
         this._animateVisible();
         this._shownTemporarily = true;
@@ -28,26 +28,12 @@ const PlaceInfo = new Lang.Class({
     _init: function(id, name, iconFactory, launch) {
         this.id = id;
         this.name = name;
-        this._lowerName = name.toLowerCase();
         this.iconFactory = iconFactory;
         this.launch = launch;
     },
 
-    matchTerms: function(terms) {
-        let mtype = Search.MatchType.NONE;
-        for (let i = 0; i < terms.length; i++) {
-            let term = terms[i];
-            let idx = this._lowerName.indexOf(term);
-            if (idx == 0) {
-                mtype = Search.MatchType.PREFIX;
-            } else if (idx > 0) {
-                if (mtype == Search.MatchType.NONE)
-                    mtype = Search.MatchType.SUBSTRING;
-            } else {
-                return Search.MatchType.NONE;
-            }
-        }
-        return mtype;
+    matchTerms: function(matcher) {
+        return matcher.match(this.name);
     },
 
     isRemovable: function() {
@@ -77,7 +63,6 @@ const PlaceDeviceInfo = new Lang.Class({
     _init: function(mount) {
         this._mount = mount;
         this.name = mount.get_name();
-        this._lowerName = this.name.toLowerCase();
         this.id = 'mount:' + mount.get_root().get_uri();
     },
 
@@ -396,30 +381,21 @@ const PlaceSearchProvider = new Lang.Class({
     },
 
     _searchPlaces: function(places, terms) {
-        let multiplePrefixResults = [];
-        let prefixResults = [];
-        let multipleSubstringResults = [];
-        let substringResults = [];
-
-        terms = terms.map(String.toLowerCase);
+        let matcher = Shell.SearchMatcher.new(terms);
+        let results = [];
 
         for (let i = 0; i < places.length; i++) {
             let place = places[i];
-            let mtype = place.matchTerms(terms);
-            if (mtype == Search.MatchType.MULTIPLE_PREFIX)
-                multiplePrefixResults.push(place.id);
-            else if (mtype == Search.MatchType.PREFIX)
-                prefixResults.push(place.id);
-            else if (mtype == Search.MatchType.MULTIPLE_SUBSTRING)
-                multipleSubstringResults.push(place.id);
-            else if (mtype == Search.MatchType.SUBSTRING)
-                substringResults.push(place.id);
+            let score = place.matchTerms(matcher);
+            if (score > 0)
+                results.push({ id: place.id, score: score });
         }
-        multiplePrefixResults.sort(this._compareResultMeta);
-        prefixResults.sort(this._compareResultMeta);
-        multipleSubstringResults.sort(this._compareResultMeta);
-        substringResults.sort(this._compareResultMeta);
-        return multiplePrefixResults.concat(prefixResults.concat(multipleSubstringResults.concat(substringResults)));
+        results.sort(Lang.bind(this, function(a, b) {
+            if (a.score != b.score)
+                return b.score - a.score;
+            return this._compareResultMeta(a.id, b.id);
+        }));
+        return results.map(function(result) { return result.id; });
     },
 
     getInitialResultSet: function(terms) {
@@ -6,6 +6,7 @@ const Lang = imports.lang;
 const St = imports.gi.St;
 
 const FileUtils = imports.misc.fileUtils;
+const ProxyCache = imports.misc.proxyCache;
 const Search = imports.ui.search;
 
 const KEY_FILE_GROUP = 'Shell Search Provider';
@@ -29,7 +30,7 @@ const SearchProviderIface = <interface name="org.gnome.Shell.SearchProvider">
 </method>
 </interface>;
 
-var SearchProviderProxy = Gio.DBusProxy.makeProxyWrapper(SearchProviderIface);
+var SearchProviderProxy = ProxyCache.makeProxyWrapper(SearchProviderIface);
 
 
 function loadRemoteSearchProviders(addProviderCallback) {
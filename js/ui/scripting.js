@@ -6,6 +6,7 @@ const Meta = imports.gi.Meta;
 const Shell = imports.gi.Shell;
 
 const Main = imports.ui.main;
+const Params = imports.misc.params;
 
 // This module provides functionality for driving the shell user interface
 // in an automated fashion. The primary current use case for this is
@@ -76,8 +77,21 @@ const PerfHelperIface = <interface name="org.gnome.Shell.PerfHelper">
     <arg type="b" direction="in" />
     <arg type="b" direction="in" />
 </method>
+<method name="CreateWindows">
+    <arg type="i" direction="in" />
+    <arg type="i" direction="in" />
+    <arg type="i" direction="in" />
+    <arg type="b" direction="in" />
+    <arg type="b" direction="in" />
+    <arg type="s" direction="in" />
+    <arg type="i" direction="in" />
+</method>
 <method name="WaitWindows" />
 <method name="DestroyWindows" />
+<method name="SendNotifications">
+    <arg type="i" direction="in" />
+    <arg type="i" direction="in" />
+</method>
 </interface>;
 
 var PerfHelperProxy = Gio.DBusProxy.makeProxyWrapper(PerfHelperIface);
@@ -121,6 +135,45 @@ function createTestWindow(width, height, alpha, maximized) {
     };
 }
 
+/**
+ * createTestWindows:
+ * @count: number of windows to create
+ * @width: width of the windows, in pixels
+ * @height: height of the windows, in pixels
+ * @params: optional parameters:
+ *   alpha: whether the windows should be alpha transparent
+ *   maximized: whether the windows should be created maximized
+ *   type: 'normal', 'dialog', 'utility', 'toolbar' or 'mixed' to
+ *     cycle through these window types
+ *   nApplications: number of different applications to spread the
+ *     windows over, at most 16; 0 to make them all belong to the
+ *     helper
+ *
+ * Like createTestWindow(), but creates many windows with a single
+ * D-Bus call.
+ */
+function createTestWindows(count, width, height, params) {
+    params = Params.parse(params, { alpha: false,
+                                    maximized: false,
+                                    type: 'normal',
+                                    nApplications: 0 });
+
+    let cb;
+    let perfHelper = _getPerfHelper();
+
+    perfHelper.CreateWindowsRemote(count, width, height,
+                                   params.alpha, params.maximized,
+                                   params.type, params.nApplications,
+                                   function(result, excp) {
+                                       if (cb)
+                                           cb();
+                                   });
+
+    return function(callback) {
+        cb = callback;
+    };
+}
+
 /**
  * waitTestWindows:
  *
@@ -164,6 +217,31 @@ function destroyTestWindows() {
     };
 }
 
+/**
+ * sendTestNotifications:
+ * @count: number of notifications
+ * @imageSize: size of the image attached to each notification, in
+ *   pixels, or 0 for no image
+ *
+ * Makes gnome-shell-perf-helper send a burst of notifications over
+ * D-Bus, as a chat client would. When used with yield, the script
+ * resumes once the shell replied to all of them.
+ */
+function sendTestNotifications(count, imageSize) {
+    let cb;
+    let perfHelper = _getPerfHelper();
+
+    perfHelper.SendNotificationsRemote(count, imageSize,
+                                       function(result, excp) {
+                                           if (cb)
+                                               cb();
+                                       });
+
+    return function(callback) {
+        cb = callback;
+    };
+}
+
 /**
  * defineScriptEvent
  * @name: The event will be called script.<name>
@@ -372,7 +372,13 @@ const SearchSystem = new Lang.Class({
         let isSubSearch = terms.length == this._previousTerms.length;
         if (isSubSearch) {
             for (let i = 0; i < terms.length; i++) {
-                if (terms[i].indexOf(this._previousTerms[i]) != 0) {
+                let previousTerm = this._previousTerms[i];
+
+                // A term allowed more typos than the previous one can
+                // match results that were already filtered out
+                if (terms[i].indexOf(previousTerm) != 0 ||
+                    Shell.SearchMatcher.get_max_edits(terms[i]) >
+                    Shell.SearchMatcher.get_max_edits(previousTerm)) {
                     isSubSearch = false;
                     break;
                 }
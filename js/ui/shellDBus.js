@@ -10,6 +10,14 @@ const ExtensionSystem = imports.ui.extensionSystem;
 const ExtensionUtils = imports.misc.extensionUtils;
 const Flashspot = imports.ui.flashspot;
 const Main = imports.ui.main;
+const Mainloop = imports.mainloop;
+
+const ScreenshotFormats = {
+    'png': Shell.ScreenshotFormat.PNG,
+    'png-fast': Shell.ScreenshotFormat.PNG_FAST,
+    'png-uncompressed': Shell.ScreenshotFormat.PNG_UNCOMPRESSED,
+    'qoi': Shell.ScreenshotFormat.QOI
+};
 
 const GnomeShellIface = <interface name="org.gnome.Shell">
 <method name="Eval">
@@ -50,6 +58,11 @@ const GnomeShellIface = <interface name="org.gnome.Shell">
     <arg type="s" direction="in" name="filename"/>
     <arg type="b" direction="out" name="success"/>
 </method>
+<method name="ScreenshotToFd">
+    <arg type="a{sv}" direction="in" name="options"/>
+    <arg type="h" direction="in" name="fd"/>
+    <arg type="b" direction="out" name="success"/>
+</method>
 <method name="FlashArea">
     <arg type="i" direction="in" name="x"/>
     <arg type="i" direction="in" name="y"/>
@@ -83,6 +96,25 @@ const GnomeShellIface = <interface name="org.gnome.Shell">
 </signal>
 </interface>;
 
+const FrameTimingsIface = <interface name="org.gnome.Shell.FrameTimings">
+<method name="GetStats">
+    <arg type="a{sv}" direction="out" name="stats" />
+</method>
+<method name="GetRecentFrames">
+    <arg type="a(xxxxxx)" direction="out" name="frames" />
+</method>
+<method name="Subscribe">
+    <arg type="u" direction="in" name="interval" />
+</method>
+<method name="Unsubscribe" />
+<signal name="StatsUpdated">
+    <arg type="a{sv}" name="stats" />
+</signal>
+</interface>;
+
+// Shortest interval, in milliseconds, at which subscribers get the stats
+const FRAME_TIMINGS_MIN_INTERVAL = 250;
+
 const GnomeShell = new Lang.Class({
     Name: 'GnomeShellDBus',
 
@@ -91,6 +123,8 @@ const GnomeShell = new Lang.Class({
         this._dbusImpl.export(Gio.DBus.session, '/org/gnome/Shell');
         ExtensionSystem.connect('extension-state-changed',
                                 Lang.bind(this, this._extensionStateChanged));
+
+        this._frameTimings = new FrameTimings();
     },
 
     /**
@@ -197,6 +231,71 @@ const GnomeShell = new Lang.Class({
                                     flash, invocation));
     },
 
+    /**
+     * ScreenshotToFd:
+     * @options: a dictionary of options:
+     *   'area' (iiii): the area to take a screenshot of; defaults to
+     *     the whole screen
+     *   'window' (b): take a screenshot of the focused window instead
+     *   'include-frame' (b): whether to include the window frame
+     *   'include-cursor' (b): whether to include the cursor image
+     *   'flash' (b): whether to flash the screenshot area
+     *   'format' (s): one of 'png' (the default), 'png-fast',
+     *     'png-uncompressed' or 'qoi'
+     * @fd: a file descriptor to write the image to
+     *
+     * Takes a screenshot like the other Screenshot methods, but writes
+     * the image to @fd rather than to a file, so that callers don't need
+     * to go through the file system. @fd is closed once the image has
+     * been written. Returns a boolean indicating whether the operation
+     * was successful or not.
+     *
+     */
+    ScreenshotToFdAsync : function (params, invocation) {
+        let [options, fdIndex] = params;
+
+        let option = function(name, defaultValue) {
+            return name in options ? options[name].deep_unpack() : defaultValue;
+        };
+
+        let format = ScreenshotFormats[option('format', 'png')];
+        if (format === undefined) {
+            invocation.return_dbus_error('org.gnome.Shell.InvalidArgs',
+                                         'Unknown screenshot format');
+            return;
+        }
+
+        let fdList = invocation.get_message().get_unix_fd_list();
+        let fd;
+        try {
+            fd = fdList.get(fdIndex);
+        } catch (e) {
+            invocation.return_dbus_error('org.gnome.Shell.InvalidArgs',
+                                         'Invalid file descriptor');
+            return;
+        }
+
+        let screenshot = new Shell.Screenshot();
+        screenshot.set_format(format);
+        screenshot.set_stream(new Gio.UnixOutputStream({ fd: fd,
+                                                         close_fd: true }));
+
+        let flash = option('flash', false);
+        let includeCursor = option('include-cursor', false);
+        let onComplete = Lang.bind(this, this._onScreenshotComplete,
+                                   flash, invocation);
+
+        if (option('window', false)) {
+            screenshot.screenshot_window(option('include-frame', true),
+                                         includeCursor, null, onComplete);
+        } else if ('area' in options) {
+            let [x, y, width, height] = option('area');
+            screenshot.screenshot_area(x, y, width, height, null, onComplete);
+        } else {
+            screenshot.screenshot(includeCursor, null, onComplete);
+        }
+    },
+
     FlashArea: function(x, y, width, height) {
         let flashspot = new Flashspot.Flashspot({ x : x, y : y, width: width, height: height});
         flashspot.fire();
@@ -309,3 +408,110 @@ const GnomeShell = new Lang.Class({
                                    GLib.Variant.new('(sis)', [newState.uuid, newState.state, newState.error]));
     }
 });
+
+const FrameTimings = new Lang.Class({
+    Name: 'FrameTimingsDBus',
+
+    _init: function() {
+        this._dbusImpl = Gio.DBusExportedObject.wrapJSObject(FrameTimingsIface, this);
+        this._dbusImpl.export(Gio.DBus.session, '/org/gnome/Shell/FrameTimings');
+
+        // Subscribers by unique bus name, with their interval and
+        // name watch
+        this._subscribers = {};
+        this._timeoutId = 0;
+        this._interval = 0;
+    },
+
+    /**
+     * GetStats:
+     *
+     * Returns the counters and recent averages described in
+     * shell_frame_timings_get_stats().
+     */
+    GetStats: function() {
+        return global.frame_timings.get_stats().deep_unpack();
+    },
+
+    /**
+     * GetRecentFrames:
+     *
+     * Returns the timestamps of the most recent frames, see
+     * shell_frame_timings_get_recent_frames().
+     */
+    GetRecentFrames: function() {
+        return global.frame_timings.get_recent_frames().deep_unpack();
+    },
+
+    /**
+     * Subscribe:
+     * @interval: the interval in milliseconds
+     *
+     * Makes the shell emit StatsUpdated at least every @interval
+     * milliseconds, until the caller calls Unsubscribe or leaves
+     * the bus.
+     */
+    SubscribeAsync: function(params, invocation) {
+        let [interval] = params;
+        let sender = invocation.get_sender();
+
+        this._removeSubscriber(sender);
+        this._subscribers[sender] = {
+            interval: Math.max(interval, FRAME_TIMINGS_MIN_INTERVAL),
+            watchId: Gio.DBus.session.watch_name(sender,
+                                                 Gio.BusNameWatcherFlags.NONE,
+                                                 null,
+                                                 Lang.bind(this, function() {
+                                                     this._removeSubscriber(sender);
+                                                     this._updateTimeout();
+                                                 }))
+        };
+        this._updateTimeout();
+
+        invocation.return_value(null);
+    },
+
+    UnsubscribeAsync: function(params, invocation) {
+        this._removeSubscriber(invocation.get_sender());
+        this._updateTimeout();
+
+        invocation.return_value(null);
+    },
+
+    _removeSubscriber: function(sender) {
+        let subscriber = this._subscribers[sender];
+        if (!subscriber)
+            return;
+
+        Gio.DBus.session.unwatch_name(subscriber.watchId);
+        delete this._subscribers[sender];
+    },
+
+    _updateTimeout: function() {
+        let interval = 0;
+        for (let sender in this._subscribers) {
+            let subscriber = this._subscribers[sender];
+            if (interval == 0 || subscriber.interval < interval)
+                interval = subscriber.interval;
+        }
+
+        if (interval == this._interval)
+            return;
+
+        if (this._timeoutId) {
+            Mainloop.source_remove(this._timeoutId);
+            this._timeoutId = 0;
+        }
+
+        this._interval = interval;
+        if (interval > 0)
+            this._timeoutId = Mainloop.timeout_add(interval,
+                                                   Lang.bind(this, this._emitStats));
+    },
+
+    _emitStats: function() {
+        this._dbusImpl.emit_signal('StatsUpdated',
+                                   GLib.Variant.new('(a{sv})', [global.frame_timings.get_stats().deep_unpack()]));
+        return true;
+    }
+});
@@ -0,0 +1,174 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const GLib = imports.gi.GLib;
+const Lang = imports.lang;
+const Mainloop = imports.mainloop;
+const Shell = imports.gi.Shell;
+
+// The shell's startup work is split into named tasks, each belonging
+// to one of these phases; tasks of a phase run in the order they were
+// added, and all tasks of a phase run before those of the next one.
+const Phase = {
+    // Needed for the first frame; run synchronously by start()
+    FIRST_FRAME: 0,
+    // Run once the first frame was drawn, one per main loop
+    // iteration so that we keep drawing in between
+    AFTER_FIRST_FRAME: 1,
+    // Run at low priority when nothing else is going on
+    IDLE: 2,
+    // Only run when somebody needs them, see ensure()
+    FIRST_USE: 3,
+    // All other phases are done
+    DONE: 4
+};
+
+const PHASE_NAMES = ['first-frame', 'after-first-frame', 'idle', 'first-use'];
+
+const StartupScheduler = new Lang.Class({
+    Name: 'StartupScheduler',
+
+    _init: function() {
+        this._tasks = [];
+        this._tasksByName = {};
+        this._phase = Phase.FIRST_FRAME;
+
+        // Name, phase and duration in milliseconds of each task that
+        // ran, in order, for inspection from the looking glass
+        this.timings = [];
+
+        this._perfLog = Shell.PerfLog.get_default();
+        this._perfLog.define_event('startup.taskStart',
+                                   'Starting a startup task; argument is its name',
+                                   's');
+        this._perfLog.define_event('startup.taskDone',
+                                   'Done with a startup task; argument is its name',
+                                   's');
+        this._perfLog.define_event('startup.phaseDone',
+                                   'Done with all startup tasks of a phase; argument is its name',
+                                   's');
+    },
+
+    // add:
+    // @name: a name for the task, used by ensure() and in the trace
+    // @phase: a #Phase
+    // @callback: the function doing the work
+    //
+    // Adds a task to the scheduler. If its phase is already over, it
+    // runs right away.
+    add: function(name, phase, callback) {
+        let task = { name: name,
+                     phase: phase,
+                     callback: callback,
+                     done: false };
+
+        this._tasks.push(task);
+        this._tasksByName[name] = task;
+
+        if (phase < this._phase && phase != Phase.FIRST_USE)
+            this._runTask(task);
+    },
+
+    // ensure:
+    // @name: the name of a task
+    //
+    // Runs the task now if it hasn't run yet, for example because
+    // the user needs a component before we got to it. Tasks added
+    // before it in an earlier or the same phase are run first, since
+    // it may depend on them.
+    ensure: function(name) {
+        let task = this._tasksByName[name];
+        if (!task || task.done)
+            return;
+
+        if (task.phase != Phase.FIRST_USE) {
+            for (let i = 0; i < this._tasks.length && this._tasks[i] != task; i++) {
+                let other = this._tasks[i];
+                if (other.phase <= task.phase)
+                    this._runTask(other);
+            }
+        }
+
+        this._runTask(task);
+    },
+
+    // start:
+    //
+    // Runs the tasks needed for the first frame, and schedules the
+    // others to run once it has been drawn.
+    start: function() {
+        let task;
+        while ((task = this._nextTask(Phase.FIRST_FRAME)))
+            this._runTask(task);
+        this._phaseDone();
+
+        let paintId = global.stage.connect_after('paint', Lang.bind(this, function() {
+            global.stage.disconnect(paintId);
+            this._queueNextTask();
+        }));
+    },
+
+    _nextTask: function(phase) {
+        for (let i = 0; i < this._tasks.length; i++) {
+            let task = this._tasks[i];
+            if (task.phase == phase && !task.done)
+                return task;
+        }
+
+        return null;
+    },
+
+    _queueNextTask: function() {
+        let priority = this._phase == Phase.IDLE ? GLib.PRIORITY_LOW : GLib.PRIORITY_DEFAULT_IDLE;
+        Mainloop.idle_add(Lang.bind(this, this._runNextTask), priority);
+    },
+
+    _runNextTask: function() {
+        let task = this._nextTask(this._phase);
+        if (task) {
+            try {
+                this._runTask(task);
+            } catch (e) {
+                logError(e, 'Startup task ' + task.name + ' failed');
+            }
+        } else {
+            this._phaseDone();
+        }
+
+        if (this._phase < Phase.FIRST_USE)
+            this._queueNextTask();
+        else
+            this._finished();
+
+        return false;
+    },
+
+    _runTask: function(task) {
+        if (task.done)
+            return;
+
+        // Mark it first, so that an exception doesn't make us try
+        // again, and so that ensure() from within the task is a no-op
+        task.done = true;
+
+        let start = GLib.get_monotonic_time();
+        this._perfLog.event_s('startup.taskStart', task.name);
+
+        try {
+            task.callback();
+        } finally {
+            this._perfLog.event_s('startup.taskDone', task.name);
+            this.timings.push({ name: task.name,
+                                phase: PHASE_NAMES[task.phase],
+                                duration: (GLib.get_monotonic_time() - start) / 1000 });
+        }
+    },
+
+    _phaseDone: function() {
+        this._perfLog.event_s('startup.phaseDone', PHASE_NAMES[this._phase]);
+        this._phase++;
+    },
+
+    _finished: function() {
+        this._phase = Phase.DONE;
+    }
+});
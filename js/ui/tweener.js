@@ -44,9 +44,26 @@ const Tweener = imports.tweener.tweener;
 // calls any of these is almost certainly wrong anyway, because they
 // affect the entire application.)
 
+// Simple tweens of actors (only of the properties below, with no
+// onUpdate callback, no rounding, etc.) are handed to Shell.Animator,
+// which runs them without calling into JavaScript for every frame.
+// They can't be paused.
+const NATIVE_PROPERTIES = ['x', 'y', 'width', 'height', 'scale_x', 'scale_y', 'opacity'];
+const NATIVE_PARAMETERS = ['time', 'delay', 'transition',
+                           'onStart', 'onStartScope', 'onStartParams',
+                           'onComplete', 'onCompleteScope', 'onCompleteParams'];
+
+let _animator = null;
+// Native tweens by id, with their target and parameters
+let _nativeTweens = {};
+
 // Called from Main.start
 function init() {
     Tweener.setFrameTicker(new ClutterFrameTicker());
+
+    _animator = Shell.Animator.get_default();
+    _animator.connect('tween-started', _nativeTweenStarted);
+    _animator.connect('tween-finished', _nativeTweenFinished);
 }
 
 
@@ -56,10 +73,78 @@ function addCaller(target, tweeningParameters) {
 }
 
 function addTween(target, tweeningParameters) {
+    if (_addNativeTween(target, tweeningParameters))
+        return;
+
+    // A JS tween would be overwritten by a later native one, but not
+    // the other way around, so do it here
+    if (_animator && target instanceof Clutter.Actor) {
+        let properties = NATIVE_PROPERTIES.filter(function(name) {
+            return name in tweeningParameters;
+        });
+        if (properties.length > 0)
+            _animator.remove_tweens(target, properties);
+    }
+
     _wrapTweening(target, tweeningParameters);
     Tweener.addTween(target, tweeningParameters);
 }
 
+function _addNativeTween(target, params) {
+    if (!_animator || !(target instanceof Clutter.Actor))
+        return false;
+
+    // Mixing with JS tweens would break the overwriting rules
+    if (Tweener.getTweenCount(target) != 0)
+        return false;
+
+    let properties = [];
+    let values = [];
+    for (let name in params) {
+        if (NATIVE_PROPERTIES.indexOf(name) != -1) {
+            if (typeof(params[name]) != 'number')
+                return false;
+            properties.push(name);
+            values.push(params[name]);
+        } else if (NATIVE_PARAMETERS.indexOf(name) == -1) {
+            return false;
+        }
+    }
+
+    if (properties.length == 0)
+        return false;
+    if (params.transition && typeof(params.transition) != 'string')
+        return false;
+
+    let id = _animator.add_tween(target, properties, values,
+                                 params.transition || 'easeOutExpo',
+                                 params.delay || 0, params.time || 0);
+    if (id == 0)
+        return false;
+
+    _wrapTweening(target, params);
+    _nativeTweens[id] = { target: target, params: params };
+    return true;
+}
+
+// Like with the JS tweener, onStart can still set the values to
+// animate from; the animator reads them once this returns
+function _nativeTweenStarted(animator, id) {
+    let tween = _nativeTweens[id];
+    if (tween)
+        tween.params.onStart();
+}
+
+function _nativeTweenFinished(animator, id, completed) {
+    let tween = _nativeTweens[id];
+    if (!tween)
+        return;
+
+    delete _nativeTweens[id];
+    if (completed)
+        tween.params.onComplete();
+}
+
 function _wrapTweening(target, tweeningParameters) {
     let state = _getTweenState(target);
 
@@ -147,19 +232,30 @@ function _idleCompleted(target) {
 }
 
 function getTweenCount(scope) {
-    return Tweener.getTweenCount(scope);
+    let count = Tweener.getTweenCount(scope);
+    if (_animator && scope instanceof Clutter.Actor)
+        count += _animator.get_tween_count(scope);
+    return count;
 }
 
 // imports.tweener.tweener doesn't provide this method (which exists
 // in the ActionScript version) but it's easy to implement.
 function isTweening(scope) {
-    return Tweener.getTweenCount(scope) != 0;
+    return getTweenCount(scope) != 0;
 }
 
 function removeTweens(scope) {
-    if (Tweener.removeTweens.apply(null, arguments)) {
+    let removed = Tweener.removeTweens.apply(null, arguments);
+
+    if (_animator && scope instanceof Clutter.Actor) {
+        let properties = Array.prototype.slice.call(arguments, 1);
+        if (_animator.remove_tweens(scope, properties.length > 0 ? properties : null))
+            removed = true;
+    }
+
+    if (removed) {
         // If we just removed the last active tween, clean up
-        if (Tweener.getTweenCount(scope) == 0)
+        if (getTweenCount(scope) == 0)
             _tweenCompleted(scope);
         return true;
     } else
@@ -147,7 +147,10 @@ const IMStatusChooserItem = new Lang.Class({
         this._combo.connect('active-item-changed',
                             Lang.bind(this, this._changeIMStatus));
 
-        this._presence = new GnomeSession.Presence();
+        this._presence = new GnomeSession.Presence(Lang.bind(this, function(proxy, error) {
+            if (!error)
+                this._sessionStatusChanged(proxy.status);
+        }));
         this._presence.connectSignal('StatusChanged', Lang.bind(this, function(proxy, senderName, [status]) {
             this._sessionStatusChanged(status);
         }));
@@ -303,7 +306,9 @@ const IMStatusChooserItem = new Lang.Class({
         this._setComboboxPresence(presence);
 
         if (!this._sessionPresenceRestored) {
-            this._sessionStatusChanged(this._presence.status);
+            // Otherwise, we'll get to it once the proxy is ready
+            if (this._presence.status != null)
+                this._sessionStatusChanged(this._presence.status);
             return;
         }
 
@@ -447,7 +452,10 @@ const UserMenuButton = new Lang.Class({
         this._userManager = AccountsService.UserManager.get_default();
 
         this._user = this._userManager.get_user(GLib.get_user_name());
-        this._presence = new GnomeSession.Presence();
+        this._presence = new GnomeSession.Presence(Lang.bind(this, function(proxy, error) {
+            if (!error)
+                this._updateSwitch(proxy.status);
+        }));
         this._session = new GnomeSession.SessionManager();
         this._haveShutdown = true;
 
@@ -491,7 +499,6 @@ const UserMenuButton = new Lang.Class({
 
         this._createSubMenu();
 
-        this._updateSwitch(this._presence.status);
         this._presence.connectSignal('StatusChanged', Lang.bind(this, function (proxy, senderName, [status]) {
             this._updateSwitch(status);
         }));
@@ -103,9 +103,9 @@ const WindowClone = new Lang.Class({
         this._workspace = workspace;
 
         let [borderX, borderY] = this._getInvisibleBorderPadding();
-        this._windowClone = new Clutter.Clone({ source: realWindow.get_texture(),
-                                                x: -borderX,
-                                                y: -borderY });
+        this._windowClone = new Shell.WindowThumbnail({ source: realWindow.get_texture(),
+                                                        x: -borderX,
+                                                        y: -borderY });
         // We expect this.actor to be used for all interaction rather than
         // this._windowClone; as the former is reactive and the latter
         // is not, this just works for most cases. However, for DND all
@@ -31,8 +31,8 @@ const WindowClone = new Lang.Class({
     Name: 'WindowClone',
 
     _init : function(realWindow) {
-        this.actor = new Clutter.Clone({ source: realWindow.get_texture(),
-                                         reactive: true });
+        this.actor = new Shell.WindowThumbnail({ source: realWindow.get_texture(),
+                                                 reactive: true });
         this.actor._delegate = this;
         this.realWindow = realWindow;
         this.metaWindow = realWindow.meta_window;
@@ -392,9 +392,22 @@ const WorkspaceThumbnail = new Lang.Class({
                win.get_meta_window().showing_on_its_workspace();
     },
 
+    _isActive: function() {
+        return this.metaWorkspace == global.screen.get_active_workspace();
+    },
+
+    // Windows on other workspaces than the active one are less likely
+    // to be watched closely, so we update them less often
+    updateThrottling: function() {
+        let throttled = !this._isActive();
+        for (let i = 0; i < this._windows.length; i++)
+            this._windows[i].actor.throttled = throttled;
+    },
+
     // Create a clone of a (non-desktop) window and add it to the window list
     _addWindowClone : function(win) {
         let clone = new WindowClone(win);
+        clone.actor.throttled = !this._isActive();
 
         clone.connect('selected',
                       Lang.bind(this, function(clone, time) {
@@ -1128,10 +1141,9 @@ const ThumbnailsBox = new Lang.Class({
         let thumbnail;
         let activeWorkspace = global.screen.get_active_workspace();
         for (let i = 0; i < this._thumbnails.length; i++) {
-            if (this._thumbnails[i].metaWorkspace == activeWorkspace) {
+            if (this._thumbnails[i].metaWorkspace == activeWorkspace)
                 thumbnail = this._thumbnails[i];
-                break;
-            }
+            this._thumbnails[i].updateThrottling();
         }
 
         this._animatingIndicator = true;
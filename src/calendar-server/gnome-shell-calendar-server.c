@@ -60,6 +60,16 @@ static const gchar introspection_xml[] =
   "      <arg type='b' name='force_reload' direction='in'/>"
   "      <arg type='a(sssbxxa{sv})' name='events' direction='out'/>"
   "    </method>"
+  "    <method name='GetEventsInRange'>"
+  "      <arg type='x' name='since' direction='in'/>"
+  "      <arg type='x' name='until' direction='in'/>"
+  "      <arg type='b' name='force_reload' direction='in'/>"
+  "      <arg type='t' name='changed_since' direction='in'/>"
+  "      <arg type='a(sssbxxa{sv})' name='events' direction='out'/>"
+  "      <arg type='as' name='invalidated' direction='out'/>"
+  "      <arg type='b' name='complete' direction='out'/>"
+  "      <arg type='t' name='serial' direction='out'/>"
+  "    </method>"
   "    <signal name='Changed'/>"
   "    <property name='Since' type='x' access='read'/>"
   "    <property name='Until' type='x' access='read'/>"
@@ -100,6 +110,7 @@ typedef struct
 
   /* Only used internally */
   GSList *occurrences;
+  guint64 changed_serial;
 } CalendarAppointment;
 
 static time_t
@@ -353,6 +364,8 @@ calendar_appointment_free (CalendarAppointment *appointment)
 
   appointment->start_time = 0;
   appointment->is_all_day = FALSE;
+
+  g_free (appointment);
 }
 
 static void
@@ -455,6 +468,70 @@ calendar_appointment_new (icalcomponent        *ical,
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* If extending a source's cache to cover a new window would make it span
+ * more than this many windows, we throw it away and load just the window.
+ */
+#define CACHE_MAX_WINDOWS 4
+
+/* Number of removed appointments we remember for GetEventsInRange;
+ * clients asking for changes since before the oldest of them get
+ * a complete answer instead.
+ */
+#define MAX_TOMBSTONES 512
+
+typedef struct
+{
+  App        *app;
+  ECalClient *client;
+
+  GCancellable *cancellable;
+
+  gboolean opened;
+  gboolean loading;
+  gboolean needs_update;
+  gboolean invalid;
+
+  /* Bumped on every invalidation, so that a load started before
+   * one doesn't count as up to date */
+  guint n_invalidations;
+
+  /* hash from uid to CalendarAppointment objects, with all occurrences
+   * in [loaded_since, loaded_until) */
+  GHashTable *appointments;
+  time_t loaded_since;
+  time_t loaded_until;
+
+  ECalClientView *view;
+
+  /* All occurrences in appointments sorted by start time, and the
+   * longest occurrence, so we can find the ones overlapping a range
+   * with a binary search. Built lazily; NULL when out of date. */
+  GArray *index;
+  time_t max_duration;
+} CalendarSourceData;
+
+typedef struct
+{
+  time_t start_time;
+  time_t end_time;
+  CalendarAppointment *appointment;
+} IndexedOccurrence;
+
+typedef struct
+{
+  char    *uid;
+  guint64  serial;
+} CalendarTombstone;
+
+typedef struct
+{
+  CalendarSourceData *source;
+  time_t since;
+  time_t until;
+  gboolean replace;
+  guint n_invalidations;
+} CalendarLoadRequest;
+
 struct _App
 {
   GDBusConnection *connection;
@@ -470,19 +547,23 @@ struct _App
   guint                zone_listener;
   GConfClient         *gconf_client;
 
-  /* hash from uid to CalendarAppointment objects */
-  GHashTable *appointments;
+  /* hash from ECalClient to CalendarSourceData */
+  GHashTable *source_data;
 
   gchar *timezone_location;
 
   guint changed_timeout_id;
 
-  gboolean cache_invalid;
-
-  GList *live_views;
+  /* Bumped every time an appointment is added, changed or removed */
+  guint64 serial;
+  /* Removed appointments, oldest first */
+  GArray *tombstones;
+  guint64 oldest_serial;
 };
 
-static void
+static void calendar_source_data_update (CalendarSourceData *source);
+
+static gboolean
 app_update_timezone (App *app)
 {
   gchar *location;
@@ -497,7 +578,11 @@ app_update_timezone (App *app)
       g_free (app->timezone_location);
       app->timezone_location = location;
       print_debug ("Using timezone %s", app->timezone_location);
+      return TRUE;
     }
+
+  g_free (location);
+  return FALSE;
 }
 
 static gboolean
@@ -528,10 +613,204 @@ app_schedule_changed (App *app)
     }
 }
 
+/* Used when a background load finished; the shell is waiting for the
+ * data, so don't make it wait for the usual change coalescing.
+ */
+static void
+app_emit_changed_soon (App *app)
+{
+  print_debug ("Emitting changed on idle");
+  if (app->changed_timeout_id != 0)
+    g_source_remove (app->changed_timeout_id);
+
+  app->changed_timeout_id = g_idle_add (on_app_schedule_changed_cb, app);
+}
+
+static void
+app_add_tombstone (App        *app,
+                   const char *uid)
+{
+  CalendarTombstone tombstone;
+
+  tombstone.uid = g_strdup (uid);
+  tombstone.serial = ++app->serial;
+  g_array_append_val (app->tombstones, tombstone);
+
+  if (app->tombstones->len > MAX_TOMBSTONES)
+    {
+      CalendarTombstone *oldest = &g_array_index (app->tombstones, CalendarTombstone, 0);
+
+      app->oldest_serial = oldest->serial;
+      g_free (oldest->uid);
+      g_array_remove_index (app->tombstones, 0);
+    }
+}
+
+static void
+calendar_source_data_reset_index (CalendarSourceData *source)
+{
+  if (source->index != NULL)
+    {
+      g_array_free (source->index, TRUE);
+      source->index = NULL;
+    }
+}
+
+static gint
+indexed_occurrence_compare (gconstpointer a,
+                            gconstpointer b)
+{
+  const IndexedOccurrence *oa = a;
+  const IndexedOccurrence *ob = b;
+
+  if (oa->start_time != ob->start_time)
+    return oa->start_time < ob->start_time ? -1 : 1;
+  return 0;
+}
+
+static void
+calendar_source_data_ensure_index (CalendarSourceData *source)
+{
+  GHashTableIter iter;
+  CalendarAppointment *a;
+  GSList *l;
+
+  if (source->index != NULL)
+    return;
+
+  source->index = g_array_new (FALSE, FALSE, sizeof (IndexedOccurrence));
+  source->max_duration = 0;
+
+  g_hash_table_iter_init (&iter, source->appointments);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &a))
+    {
+      for (l = a->occurrences; l; l = l->next)
+        {
+          CalendarOccurrence *o = l->data;
+          IndexedOccurrence indexed;
+
+          indexed.start_time = o->start_time;
+          indexed.end_time = o->end_time;
+          indexed.appointment = a;
+          g_array_append_val (source->index, indexed);
+
+          source->max_duration = MAX (source->max_duration,
+                                      o->end_time - o->start_time);
+        }
+    }
+
+  g_array_sort (source->index, indexed_occurrence_compare);
+}
+
+static inline gboolean
+occurrence_in_range (time_t start_time,
+                     time_t end_time,
+                     time_t since,
+                     time_t until)
+{
+  return (start_time >= since &&
+          start_time < until) ||
+         (start_time <= since &&
+          (end_time - 1) > since);
+}
+
+static void
+add_occurrence_to_builder (GVariantBuilder     *builder,
+                           CalendarAppointment *a,
+                           time_t               start_time,
+                           time_t               end_time)
+{
+  GVariantBuilder extras_builder;
+
+  /* The a{sv} is used as an escape hatch in case we want to provide more
+   * information in the future without breaking ABI
+   */
+  g_variant_builder_init (&extras_builder, G_VARIANT_TYPE ("a{sv}"));
+  g_variant_builder_add (builder,
+                         "(sssbxxa{sv})",
+                         a->uid,
+                         a->summary != NULL ? a->summary : "",
+                         a->description != NULL ? a->description : "",
+                         (gboolean) a->is_all_day,
+                         (gint64) start_time,
+                         (gint64) end_time,
+                         &extras_builder);
+}
+
+/* Adds all occurrences of @source overlapping [@since, @until) to @builder */
+static void
+calendar_source_data_add_range (CalendarSourceData *source,
+                                time_t              since,
+                                time_t              until,
+                                GVariantBuilder    *builder)
+{
+  IndexedOccurrence *occurrences;
+  guint lo, hi, mid;
+
+  calendar_source_data_ensure_index (source);
+
+  occurrences = (IndexedOccurrence *) source->index->data;
+
+  /* Nothing starting before since - max_duration can reach since */
+  lo = 0;
+  hi = source->index->len;
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (occurrences[mid].start_time < since - source->max_duration)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  for (; lo < source->index->len && occurrences[lo].start_time < until; lo++)
+    {
+      IndexedOccurrence *o = &occurrences[lo];
+
+      if (occurrence_in_range (o->start_time, o->end_time, since, until))
+        add_occurrence_to_builder (builder, o->appointment,
+                                   o->start_time, o->end_time);
+    }
+}
+
+/* Adds occurrences overlapping [@since, @until) of the appointments
+ * changed after @changed_since to @builder, and their uids to
+ * @invalidated_builder */
 static void
-invalidate_cache (App *app)
+calendar_source_data_add_changes (CalendarSourceData *source,
+                                  time_t              since,
+                                  time_t              until,
+                                  guint64             changed_since,
+                                  GVariantBuilder    *builder,
+                                  GVariantBuilder    *invalidated_builder)
 {
-  app->cache_invalid = TRUE;
+  GHashTableIter iter;
+  CalendarAppointment *a;
+  GSList *l;
+
+  g_hash_table_iter_init (&iter, source->appointments);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &a))
+    {
+      if (a->changed_serial <= changed_since)
+        continue;
+
+      g_variant_builder_add (invalidated_builder, "s", a->uid);
+
+      for (l = a->occurrences; l; l = l->next)
+        {
+          CalendarOccurrence *o = l->data;
+
+          if (occurrence_in_range (o->start_time, o->end_time, since, until))
+            add_occurrence_to_builder (builder, a, o->start_time, o->end_time);
+        }
+    }
+}
+
+static void
+calendar_source_data_invalidate (CalendarSourceData *source)
+{
+  source->invalid = TRUE;
+  source->n_invalidations++;
 }
 
 static void
@@ -539,7 +818,7 @@ on_objects_added (ECalClientView *view,
                   GSList         *objects,
                   gpointer        user_data)
 {
-  App *app = user_data;
+  CalendarSourceData *source = user_data;
   GSList *l;
 
   print_debug ("%s for calendar", G_STRFUNC);
@@ -551,11 +830,11 @@ on_objects_added (ECalClientView *view,
 
       uid = icalcomponent_get_uid (ical);
 
-      if (g_hash_table_lookup (app->appointments, uid) == NULL)
+      if (g_hash_table_lookup (source->appointments, uid) == NULL)
         {
           /* new appointment we don't know about => changed signal */
-          invalidate_cache (app);
-          app_schedule_changed (app);
+          calendar_source_data_invalidate (source);
+          app_schedule_changed (source->app);
         }
     }
 }
@@ -565,10 +844,10 @@ on_objects_modified (ECalClientView *view,
                      GSList         *objects,
                      gpointer        user_data)
 {
-  App *app = user_data;
+  CalendarSourceData *source = user_data;
   print_debug ("%s for calendar", G_STRFUNC);
-  invalidate_cache (app);
-  app_schedule_changed (app);
+  calendar_source_data_invalidate (source);
+  app_schedule_changed (source->app);
 }
 
 static void
@@ -576,138 +855,499 @@ on_objects_removed (ECalClientView *view,
                     GSList         *uids,
                     gpointer        user_data)
 {
-  App *app = user_data;
+  CalendarSourceData *source = user_data;
   print_debug ("%s for calendar", G_STRFUNC);
-  invalidate_cache (app);
-  app_schedule_changed (app);
+  calendar_source_data_invalidate (source);
+  app_schedule_changed (source->app);
 }
 
-static void
-app_load_events (App *app)
+static gchar *
+build_time_range_query (time_t since,
+                        time_t until)
 {
-  GSList *sources;
-  GSList *l;
-  GList *ll;
   gchar *since_iso8601;
   gchar *until_iso8601;
+  gchar *query;
+
+  since_iso8601 = isodate_from_time_t (since);
+  until_iso8601 = isodate_from_time_t (until);
 
-  /* out with the old */
-  g_hash_table_remove_all (app->appointments);
-  /* nuke existing views */
-  for (ll = app->live_views; ll != NULL; ll = ll->next)
+  query = g_strdup_printf ("occur-in-time-range? (make-time \"%s\") "
+                           "(make-time \"%s\")",
+                           since_iso8601,
+                           until_iso8601);
+
+  g_free (since_iso8601);
+  g_free (until_iso8601);
+
+  return query;
+}
+
+static GHashTable *
+calendar_appointment_table_new (void)
+{
+  return g_hash_table_new_full (g_str_hash,
+                                g_str_equal,
+                                g_free,
+                                (GDestroyNotify) calendar_appointment_free);
+}
+
+static void
+calendar_source_data_stop_view (CalendarSourceData *source)
+{
+  if (source->view == NULL)
+    return;
+
+  g_signal_handlers_disconnect_by_func (source->view, on_objects_added, source);
+  g_signal_handlers_disconnect_by_func (source->view, on_objects_modified, source);
+  g_signal_handlers_disconnect_by_func (source->view, on_objects_removed, source);
+  e_cal_client_view_stop (source->view, NULL);
+  g_object_unref (source->view);
+  source->view = NULL;
+}
+
+static void
+calendar_source_data_free (CalendarSourceData *source)
+{
+  /* Pending operations will fail with G_IO_ERROR_CANCELLED
+   * and won't touch @source anymore */
+  g_cancellable_cancel (source->cancellable);
+  g_object_unref (source->cancellable);
+
+  calendar_source_data_stop_view (source);
+
+  calendar_source_data_reset_index (source);
+  g_hash_table_unref (source->appointments);
+  g_object_unref (source->client);
+
+  g_free (source);
+}
+
+static CalendarSourceData *
+calendar_source_data_new (App        *app,
+                          ECalClient *client)
+{
+  CalendarSourceData *source;
+
+  source = g_new0 (CalendarSourceData, 1);
+  source->app = app;
+  source->client = g_object_ref (client);
+  source->cancellable = g_cancellable_new ();
+  source->appointments = calendar_appointment_table_new ();
+
+  return source;
+}
+
+static void
+on_view_ready (GObject      *object,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+  CalendarSourceData *source;
+  ECalClientView *view;
+  GError *error;
+
+  error = NULL;
+  if (!e_cal_client_get_view_finish (E_CAL_CLIENT (object), result, &view, &error))
     {
-      ECalClientView *view = E_CAL_CLIENT_VIEW (ll->data);
-      g_signal_handlers_disconnect_by_func (view, on_objects_added, app);
-      g_signal_handlers_disconnect_by_func (view, on_objects_modified, app);
-      g_signal_handlers_disconnect_by_func (view, on_objects_removed, app);
-      e_cal_client_view_stop (view, NULL);
-      g_object_unref (view);
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Error setting up live-query on calendar: %s\n", error->message);
+      g_error_free (error);
+      return;
     }
-  g_list_free (app->live_views);
-  app->live_views = NULL;
 
-  /* timezone could have changed */
-  app_update_timezone (app);
+  source = user_data;
+
+  calendar_source_data_stop_view (source);
+  source->view = view;
+
+  g_signal_connect (view,
+                    "objects-added",
+                    G_CALLBACK (on_objects_added),
+                    source);
+  g_signal_connect (view,
+                    "objects-modified",
+                    G_CALLBACK (on_objects_modified),
+                    source);
+  g_signal_connect (view,
+                    "objects-removed",
+                    G_CALLBACK (on_objects_removed),
+                    source);
+  e_cal_client_view_start (view, NULL);
+}
 
-  since_iso8601 = isodate_from_time_t (app->since);
-  until_iso8601 = isodate_from_time_t (app->until);
+/* Watch the whole cached range, so we notice changes to anything
+ * we might hand out later without reloading. */
+static void
+calendar_source_data_watch_range (CalendarSourceData *source)
+{
+  gchar *query;
+
+  query = build_time_range_query (source->loaded_since, source->loaded_until);
+  e_cal_client_get_view (source->client,
+                         query,
+                         source->cancellable,
+                         on_view_ready,
+                         source);
+  g_free (query);
+}
 
-  print_debug ("Loading events since %s until %s",
-               since_iso8601,
-               until_iso8601);
+static gint
+calendar_occurrence_compare (gconstpointer a,
+                             gconstpointer b)
+{
+  const CalendarOccurrence *oa = a;
+  const CalendarOccurrence *ob = b;
+
+  if (oa->start_time != ob->start_time)
+    return oa->start_time < ob->start_time ? -1 : 1;
+  if (oa->end_time != ob->end_time)
+    return oa->end_time < ob->end_time ? -1 : 1;
+  return 0;
+}
 
-  sources = calendar_sources_get_appointment_sources (app->sources);
-  for (l = sources; l != NULL; l = l->next)
+/* Merges occurrences of @appointment into @appointments, taking
+ * ownership of @appointment; returns whether anything was added.
+ */
+static gboolean
+calendar_appointment_table_merge (App                 *app,
+                                  GHashTable          *appointments,
+                                  CalendarAppointment *appointment)
+{
+  CalendarAppointment *existing;
+  gboolean changed = FALSE;
+  GSList *l;
+
+  existing = g_hash_table_lookup (appointments, appointment->uid);
+  if (existing == NULL)
     {
-      ECalClient *cal = E_CAL_CLIENT (l->data);
-      GError *error;
-      gchar *query;
-      GSList *objects, *j;
-      ECalClientView *view;
+      changed = appointment->occurrences != NULL;
+      appointment->changed_serial = ++app->serial;
+      g_hash_table_insert (appointments, g_strdup (appointment->uid), appointment);
+      return changed;
+    }
+
+  /* Occurrences straddling the boundary of two loaded ranges are
+   * reported for both of them */
+  for (l = appointment->occurrences; l; l = l->next)
+    {
+      if (g_slist_find_custom (existing->occurrences, l->data,
+                               calendar_occurrence_compare) != NULL)
+        continue;
+
+      existing->occurrences = g_slist_prepend (existing->occurrences, l->data);
+      l->data = NULL;
+      changed = TRUE;
+    }
 
-      e_cal_client_set_default_timezone (cal, app->zone);
+  if (changed)
+    {
+      existing->occurrences = g_slist_sort (existing->occurrences,
+                                            calendar_occurrence_compare);
+      existing->changed_serial = ++app->serial;
+    }
+
+  calendar_appointment_free (appointment);
 
-      error = NULL;
-      if (!e_client_open_sync (E_CLIENT (cal), TRUE, NULL, &error))
+  return changed;
+}
+
+/* Replaces the appointments of @source by @appointments, carrying
+ * over the serial of unchanged appointments and recording removed
+ * ones; returns whether anything changed.
+ */
+static gboolean
+calendar_source_data_replace_appointments (CalendarSourceData *source,
+                                           GHashTable         *appointments)
+{
+  GHashTableIter iter;
+  CalendarAppointment *appointment;
+  CalendarAppointment *old;
+  gboolean changed = FALSE;
+
+  g_hash_table_iter_init (&iter, appointments);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &appointment))
+    {
+      old = g_hash_table_lookup (source->appointments, appointment->uid);
+      if (old != NULL && calendar_appointment_equal (appointment, old))
+        appointment->changed_serial = old->changed_serial;
+      else
+        changed = TRUE;
+    }
+
+  g_hash_table_iter_init (&iter, source->appointments);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &old))
+    {
+      if (g_hash_table_lookup (appointments, old->uid) == NULL)
         {
-          g_warning ("Error opening calendar %s: %s\n",
-		     e_client_get_uri (E_CLIENT (cal)), error->message);
-          g_error_free (error);
-          continue;
+          app_add_tombstone (source->app, old->uid);
+          changed = TRUE;
         }
+    }
+
+  g_hash_table_unref (source->appointments);
+  source->appointments = appointments;
 
-      query = g_strdup_printf ("occur-in-time-range? (make-time \"%s\") "
-                               "(make-time \"%s\")",
-                               since_iso8601,
-                               until_iso8601);
-      error = NULL;
-      objects = NULL;
-      if (!e_cal_client_get_object_list_sync (cal,
-					      query,
-					      &objects,
-					      NULL, /* cancellable */
-					      &error))
+  return changed;
+}
+
+static void
+on_object_list_ready (GObject      *object,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+  CalendarLoadRequest *request = user_data;
+  CalendarSourceData *source;
+  ECalClient *cal = E_CAL_CLIENT (object);
+  GHashTable *appointments;
+  GSList *objects, *j;
+  GError *error;
+  gboolean changed;
+
+  error = NULL;
+  objects = NULL;
+  if (!e_cal_client_get_object_list_finish (cal, result, &objects, &error))
+    {
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
         {
-          g_warning ("Error querying calendar %s: %s\n",
-		     e_client_get_uri (E_CLIENT (cal)), error->message);
           g_error_free (error);
-          g_free (query);
-          continue;
+          g_free (request);
+          return;
         }
 
-      for (j = objects; j != NULL; j = j->next)
+      g_warning ("Error querying calendar %s: %s\n",
+                 e_client_get_uri (E_CLIENT (cal)), error->message);
+      g_error_free (error);
+
+      source = request->source;
+      source->loading = FALSE;
+      g_free (request);
+
+      if (source->needs_update)
+        calendar_source_data_update (source);
+      return;
+    }
+
+  source = request->source;
+
+  if (request->replace)
+    appointments = calendar_appointment_table_new ();
+  else
+    appointments = g_hash_table_ref (source->appointments);
+
+  changed = FALSE;
+  for (j = objects; j != NULL; j = j->next)
+    {
+      icalcomponent *ical = j->data;
+      CalendarAppointment *appointment;
+
+      appointment = calendar_appointment_new (ical, cal, source->app->zone);
+      if (appointment == NULL)
+        continue;
+
+      calendar_appointment_generate_occurrences (appointment,
+                                                 ical,
+                                                 cal,
+                                                 request->since,
+                                                 request->until,
+                                                 source->app->zone);
+      if (calendar_appointment_table_merge (source->app, appointments, appointment))
+        changed = TRUE;
+    }
+
+  e_cal_client_free_icalcomp_slist (objects);
+
+  calendar_source_data_reset_index (source);
+
+  if (request->replace)
+    {
+      changed = calendar_source_data_replace_appointments (source, appointments);
+      source->loaded_since = request->since;
+      source->loaded_until = request->until;
+
+      if (request->n_invalidations == source->n_invalidations)
+        source->invalid = FALSE;
+    }
+  else
+    {
+      g_hash_table_unref (appointments);
+      source->loaded_since = MIN (source->loaded_since, request->since);
+      source->loaded_until = MAX (source->loaded_until, request->until);
+    }
+
+  print_debug ("Loaded %s for calendar %s (%d appointments)",
+               request->replace ? "range" : "extra range",
+               e_client_get_uri (E_CLIENT (cal)),
+               g_hash_table_size (source->appointments));
+
+  source->loading = FALSE;
+  g_free (request);
+
+  calendar_source_data_watch_range (source);
+
+  if (changed)
+    app_emit_changed_soon (source->app);
+
+  calendar_source_data_update (source);
+}
+
+static void
+calendar_source_data_load (CalendarSourceData *source,
+                           time_t              since,
+                           time_t              until,
+                           gboolean            replace)
+{
+  CalendarLoadRequest *request;
+  gchar *query;
+
+  request = g_new0 (CalendarLoadRequest, 1);
+  request->source = source;
+  request->since = since;
+  request->until = until;
+  request->replace = replace;
+  request->n_invalidations = source->n_invalidations;
+
+  source->loading = TRUE;
+  e_cal_client_set_default_timezone (source->client, source->app->zone);
+
+  query = build_time_range_query (since, until);
+  e_cal_client_get_object_list (source->client,
+                                query,
+                                source->cancellable,
+                                on_object_list_ready,
+                                request);
+  g_free (query);
+}
+
+static void
+on_client_opened (GObject      *object,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+  CalendarSourceData *source;
+  GError *error;
+
+  error = NULL;
+  if (!e_client_open_finish (E_CLIENT (object), result, &error))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
         {
-          icalcomponent *ical = j->data;
-          CalendarAppointment *appointment;
-
-          appointment = calendar_appointment_new (ical, cal, app->zone);
-          if (appointment == NULL)
-            continue;
-
-          calendar_appointment_generate_occurrences (appointment,
-                                                     ical,
-                                                     cal,
-                                                     app->since,
-                                                     app->until,
-                                                     app->zone);
-          g_hash_table_insert (app->appointments, g_strdup (appointment->uid), appointment);
+          source = user_data;
+          source->loading = FALSE;
+
+          g_warning ("Error opening calendar %s: %s\n",
+                     e_client_get_uri (E_CLIENT (object)), error->message);
         }
+      g_error_free (error);
+      return;
+    }
+
+  source = user_data;
+  source->loading = FALSE;
+  source->opened = TRUE;
 
-      e_cal_client_free_icalcomp_slist (objects);
+  calendar_source_data_update (source);
+}
+
+/* Brings the cached appointments of @source in line with the
+ * currently requested window, loading only what is missing.
+ * Only one operation per source is in flight at any time; if
+ * something is already going on we'll get back here when it's done.
+ */
+static void
+calendar_source_data_update (CalendarSourceData *source)
+{
+  App *app = source->app;
+  time_t window;
 
-      error = NULL;
-      if (!e_cal_client_get_view_sync (cal,
-				       query,
-				       &view,
-				       NULL, /* cancellable */
-				       &error))
+  if (source->loading)
+    {
+      source->needs_update = TRUE;
+      return;
+    }
+
+  source->needs_update = FALSE;
+
+  if (app->since == app->until)
+    return;
+
+  if (!source->opened)
+    {
+      source->loading = TRUE;
+      e_client_open (E_CLIENT (source->client),
+                     TRUE,
+                     source->cancellable,
+                     on_client_opened,
+                     source);
+      return;
+    }
+
+  window = app->until - app->since;
+
+  if (source->invalid ||
+      source->loaded_since == source->loaded_until ||
+      app->since > source->loaded_until ||
+      app->until < source->loaded_since ||
+      (MAX (app->until, source->loaded_until) -
+       MIN (app->since, source->loaded_since)) > CACHE_MAX_WINDOWS * window)
+    calendar_source_data_load (source, app->since, app->until, TRUE);
+  else if (app->since < source->loaded_since)
+    calendar_source_data_load (source, app->since, source->loaded_since, FALSE);
+  else if (app->until > source->loaded_until)
+    calendar_source_data_load (source, source->loaded_until, app->until, FALSE);
+}
+
+static void
+app_invalidate_sources (App *app)
+{
+  GHashTableIter iter;
+  CalendarSourceData *source;
+
+  g_hash_table_iter_init (&iter, app->source_data);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &source))
+    calendar_source_data_invalidate (source);
+}
+
+static void
+app_update_sources (App *app)
+{
+  GHashTableIter iter;
+  CalendarSourceData *source;
+  GSList *sources;
+  GSList *l;
+
+  sources = calendar_sources_get_appointment_sources (app->sources);
+
+  /* drop sources that went away */
+  g_hash_table_iter_init (&iter, app->source_data);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &source))
+    {
+      if (g_slist_find (sources, source->client) == NULL)
         {
-          g_warning ("Error setting up live-query on calendar: %s\n", error->message);
-          g_error_free (error);
+          GHashTableIter appointment_iter;
+          const char *uid;
+
+          g_hash_table_iter_init (&appointment_iter, source->appointments);
+          while (g_hash_table_iter_next (&appointment_iter, (gpointer) &uid, NULL))
+            app_add_tombstone (app, uid);
+
+          g_hash_table_iter_remove (&iter);
         }
-      else
+    }
+
+  for (l = sources; l != NULL; l = l->next)
+    {
+      ECalClient *cal = E_CAL_CLIENT (l->data);
+
+      source = g_hash_table_lookup (app->source_data, cal);
+      if (source == NULL)
         {
-          g_signal_connect (view,
-                            "objects-added",
-                            G_CALLBACK (on_objects_added),
-                            app);
-          g_signal_connect (view,
-                            "objects-modified",
-                            G_CALLBACK (on_objects_modified),
-                            app);
-          g_signal_connect (view,
-                            "objects-removed",
-                            G_CALLBACK (on_objects_removed),
-                            app);
-          e_cal_client_view_start (view, NULL);
-          app->live_views = g_list_prepend (app->live_views, view);
+          source = calendar_source_data_new (app, cal);
+          g_hash_table_insert (app->source_data, cal, source);
         }
 
-      g_free (query);
+      calendar_source_data_update (source);
     }
-  g_free (since_iso8601);
-  g_free (until_iso8601);
-  app->cache_invalid = FALSE;
 }
 
 static void
@@ -717,7 +1357,8 @@ on_appointment_sources_changed (CalendarSources *sources,
   App *app = user_data;
 
   print_debug ("Sources changed\n");
-  app_load_events (app);
+  app_update_sources (app);
+  app_schedule_changed (app);
 }
 
 static App *
@@ -733,10 +1374,12 @@ app_new (GDBusConnection *connection)
                                              G_CALLBACK (on_appointment_sources_changed),
                                              app);
 
-  app->appointments = g_hash_table_new_full (g_str_hash,
-                                             g_str_equal,
-                                             g_free,
-                                             (GDestroyNotify) calendar_appointment_free);
+  app->source_data = g_hash_table_new_full (g_direct_hash,
+                                            g_direct_equal,
+                                            NULL,
+                                            (GDestroyNotify) calendar_source_data_free);
+
+  app->tombstones = g_array_new (FALSE, FALSE, sizeof (CalendarTombstone));
 
   app_update_timezone (app);
 
@@ -746,21 +1389,15 @@ app_new (GDBusConnection *connection)
 static void
 app_free (App *app)
 {
-  GList *ll;
-  for (ll = app->live_views; ll != NULL; ll = ll->next)
-    {
-      ECalClientView *view = E_CAL_CLIENT_VIEW (ll->data);
-      g_signal_handlers_disconnect_by_func (view, on_objects_added, app);
-      g_signal_handlers_disconnect_by_func (view, on_objects_modified, app);
-      g_signal_handlers_disconnect_by_func (view, on_objects_removed, app);
-      e_cal_client_view_stop (view, NULL);
-      g_object_unref (view);
-    }
-  g_list_free (app->live_views);
+  guint i;
 
-  g_free (app->timezone_location);
+  g_hash_table_unref (app->source_data);
 
-  g_hash_table_unref (app->appointments);
+  for (i = 0; i < app->tombstones->len; i++)
+    g_free (g_array_index (app->tombstones, CalendarTombstone, i).uid);
+  g_array_free (app->tombstones, TRUE);
+
+  g_free (app->timezone_location);
 
   g_object_unref (app->connection);
   g_signal_handler_disconnect (app->sources,
@@ -775,6 +1412,49 @@ app_free (App *app)
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* Moves the window to [@since, @until) and starts loading whatever is
+ * missing or out of date in the background; callers answer with what
+ * we have right now and we emit Changed once the loads finish.
+ */
+static void
+app_set_window (App      *app,
+                time_t    since,
+                time_t    until,
+                gboolean  force_reload)
+{
+  if (!(app->until == until && app->since == since))
+    {
+      GVariantBuilder *builder;
+      GVariantBuilder *invalidated_builder;
+
+      app->until = until;
+      app->since = since;
+
+      builder = g_variant_builder_new (G_VARIANT_TYPE ("a{sv}"));
+      invalidated_builder = g_variant_builder_new (G_VARIANT_TYPE ("as"));
+      g_variant_builder_add (builder, "{sv}",
+                             "Until", g_variant_new_int64 (app->until));
+      g_variant_builder_add (builder, "{sv}",
+                             "Since", g_variant_new_int64 (app->since));
+      g_dbus_connection_emit_signal (app->connection,
+                                     NULL, /* destination_bus_name */
+                                     "/org/gnome/Shell/CalendarServer",
+                                     "org.freedesktop.DBus.Properties",
+                                     "PropertiesChanged",
+                                     g_variant_new ("(sa{sv}as)",
+                                                    "org.gnome.Shell.CalendarServer",
+                                                    builder,
+                                                    invalidated_builder),
+                                     NULL); /* GError** */
+    }
+
+  /* timezone could have changed */
+  if (app_update_timezone (app) || force_reload)
+    app_invalidate_sources (app);
+
+  app_update_sources (app);
+}
+
 static void
 handle_method_call (GDBusConnection       *connection,
                     const gchar           *sender,
@@ -790,12 +1470,11 @@ handle_method_call (GDBusConnection       *connection,
   if (g_strcmp0 (method_name, "GetEvents") == 0)
     {
       GVariantBuilder builder;
-      GHashTableIter hash_iter;
-      CalendarAppointment *a;
+      GHashTableIter source_iter;
+      CalendarSourceData *source;
       gint64 since;
       gint64 until;
       gboolean force_reload;
-      gboolean window_changed;
 
       g_variant_get (parameters,
                      "(xxb)",
@@ -816,76 +1495,85 @@ handle_method_call (GDBusConnection       *connection,
                    until,
                    force_reload ? "true" : "false");
 
-      window_changed = FALSE;
-      if (!(app->until == until && app->since == since))
-        {
-          GVariantBuilder *builder;
-          GVariantBuilder *invalidated_builder;
-
-          app->until = until;
-          app->since = since;
-          window_changed = TRUE;
-
-          builder = g_variant_builder_new (G_VARIANT_TYPE ("a{sv}"));
-          invalidated_builder = g_variant_builder_new (G_VARIANT_TYPE ("as"));
-          g_variant_builder_add (builder, "{sv}",
-                                 "Until", g_variant_new_int64 (app->until));
-          g_variant_builder_add (builder, "{sv}",
-                                 "Since", g_variant_new_int64 (app->since));
-          g_dbus_connection_emit_signal (app->connection,
-                                         NULL, /* destination_bus_name */
-                                         "/org/gnome/Shell/CalendarServer",
-                                         "org.freedesktop.DBus.Properties",
-                                         "PropertiesChanged",
-                                         g_variant_new ("(sa{sv}as)",
-                                                        "org.gnome.Shell.CalendarServer",
-                                                        builder,
-                                                        invalidated_builder),
-                                         NULL); /* GError** */
-        }
+      app_set_window (app, since, until, force_reload);
+
+      g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sssbxxa{sv})"));
+      g_hash_table_iter_init (&source_iter, app->source_data);
+      while (g_hash_table_iter_next (&source_iter, NULL, (gpointer) &source))
+        calendar_source_data_add_range (source, app->since, app->until, &builder);
+
+      g_dbus_method_invocation_return_value (invocation,
+                                             g_variant_new ("(a(sssbxxa{sv}))", &builder));
+    }
+  else if (g_strcmp0 (method_name, "GetEventsInRange") == 0)
+    {
+      GVariantBuilder builder;
+      GVariantBuilder invalidated_builder;
+      GHashTableIter source_iter;
+      CalendarSourceData *source;
+      gint64 since;
+      gint64 until;
+      gboolean force_reload;
+      guint64 changed_since;
+      gboolean complete;
+      guint i;
+
+      g_variant_get (parameters,
+                     "(xxbt)",
+                     &since,
+                     &until,
+                     &force_reload,
+                     &changed_since);
 
-      /* reload events if necessary */
-      if (window_changed || force_reload || app->cache_invalid)
+      if (until < since)
         {
-          app_load_events (app);
+          g_dbus_method_invocation_return_dbus_error (invocation,
+                                                      "org.gnome.Shell.CalendarServer.Error.Failed",
+                                                      "until cannot be before since");
+          goto out;
         }
 
-      /* The a{sv} is used as an escape hatch in case we want to provide more
-       * information in the future without breaking ABI
-       */
+      print_debug ("Handling GetEventsInRange (since=%" G_GINT64_FORMAT ", until=%" G_GINT64_FORMAT ", force_reload=%s, changed_since=%" G_GUINT64_FORMAT ")",
+                   since,
+                   until,
+                   force_reload ? "true" : "false",
+                   changed_since);
+
+      app_set_window (app, since, until, force_reload);
+
+      /* We can only hand out changes if we still know about
+       * everything that got removed since @changed_since */
+      complete = changed_since == 0 || changed_since < app->oldest_serial;
+
       g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sssbxxa{sv})"));
-      g_hash_table_iter_init (&hash_iter, app->appointments);
-      while (g_hash_table_iter_next (&hash_iter, NULL, (gpointer) &a))
+      g_variant_builder_init (&invalidated_builder, G_VARIANT_TYPE ("as"));
+      g_hash_table_iter_init (&source_iter, app->source_data);
+      while (g_hash_table_iter_next (&source_iter, NULL, (gpointer) &source))
         {
-          GVariantBuilder extras_builder;
-          GSList *l;
+          if (complete)
+            calendar_source_data_add_range (source, since, until, &builder);
+          else
+            calendar_source_data_add_changes (source, since, until, changed_since,
+                                              &builder, &invalidated_builder);
+        }
 
-          for (l = a->occurrences; l; l = l->next)
+      if (!complete)
+        {
+          for (i = 0; i < app->tombstones->len; i++)
             {
-              CalendarOccurrence *o = l->data;
-              time_t start_time = o->start_time;
-              time_t end_time   = o->end_time;
-
-              if ((start_time >= app->since &&
-                   start_time < app->until) ||
-                  (start_time <= app->since &&
-                  (end_time - 1) > app->since))
-                {
-                  g_variant_builder_init (&extras_builder, G_VARIANT_TYPE ("a{sv}"));
-                  g_variant_builder_add (&builder,
-                                         "(sssbxxa{sv})",
-                                         a->uid,
-                                         a->summary != NULL ? a->summary : "",
-                                         a->description != NULL ? a->description : "",
-                                         (gboolean) a->is_all_day,
-                                         (gint64) start_time,
-                                         (gint64) end_time,
-                                         extras_builder);
-                }
+              CalendarTombstone *tombstone = &g_array_index (app->tombstones, CalendarTombstone, i);
+
+              if (tombstone->serial > changed_since)
+                g_variant_builder_add (&invalidated_builder, "s", tombstone->uid);
             }
         }
+
       g_dbus_method_invocation_return_value (invocation,
-                                             g_variant_new ("(a(sssbxxa{sv}))", &builder));
+                                             g_variant_new ("(a(sssbxxa{sv})asbt)",
+                                                            &builder,
+                                                            &invalidated_builder,
+                                                            complete,
+                                                            app->serial));
     }
   else
     {
@@ -36,6 +36,7 @@
 #include <meta/display.h>
 #include <meta/meta-plugin.h>
 
+#include "shell-frame-timings-private.h"
 #include "shell-global-private.h"
 #include "shell-perf-log.h"
 #include "shell-wm-private.h"
@@ -318,9 +319,14 @@ gnome_shell_plugin_xevent_filter (MetaPlugin *plugin,
        * can send this with a ust of 0. Simplify life for consumers
        * by ignoring such events */
       if (swap_complete_event->ust != 0)
-        shell_perf_log_event_x (shell_perf_log_get_default (),
-                                "glx.swapComplete",
-                                swap_complete_event->ust);
+        {
+          shell_perf_log_event_x (shell_perf_log_get_default (),
+                                  "glx.swapComplete",
+                                  swap_complete_event->ust);
+          if (shell_plugin->global)
+            _shell_frame_timings_swap_complete (shell_global_get_frame_timings (shell_plugin->global),
+                                                swap_complete_event->ust);
+        }
     }
 #endif
 
@@ -32,19 +32,58 @@
 #include "shell-mime-sniffer.h"
 #include "hotplug-mimetypes.h"
 
+#include <stdlib.h>
+
 #include <glib/gi18n.h>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 
+/* We only ask for the name while crawling; the content type is guessed
+ * from it, and the (much more expensive) content sniffing is only done
+ * for files whose name is ambiguous. The modification time comes with
+ * the same stat() and lets us tell later whether a directory changed.
+ */
 #define LOADER_ATTRS                          \
   G_FILE_ATTRIBUTE_STANDARD_TYPE ","          \
   G_FILE_ATTRIBUTE_STANDARD_NAME ","          \
-  G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE ","
+  G_FILE_ATTRIBUTE_TIME_MODIFIED
+
+#define ROOT_ATTRS                            \
+  G_FILE_ATTRIBUTE_STANDARD_TYPE ","          \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED
+
+#define CONTENT_ATTRS                         \
+  G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE
 
 #define WATCHDOG_TIMEOUT 1500
 #define DIRECTORY_LOAD_ITEMS_PER_CALLBACK 100
 #define HIGH_SCORE_RATIO 0.10
 
+/* Number of directories we enumerate at the same time */
+#define MAX_PARALLEL_DIRECTORIES 4
+
+/* Maximum number of files per sniff we read content from */
+#define MAX_CONTENT_READS 32
+
+/* We stop crawling once we have seen at least this many matching
+ * files and every decision taken by prepare_async_result() is
+ * outside of the confidence interval given by SETTLED_Z_SCORE
+ * (2.58 is 99% for a normal distribution).
+ */
+#define MIN_SETTLED_ITEMS 100
+#define SETTLED_Z_SCORE 2.58
+
+/* Maximum number of directories whose modification time we remember
+ * with a cached result; since we crawl breadth-first, these are the
+ * topmost ones.
+ */
+#define MAX_CACHED_DIRECTORIES 64
+
+#define CACHE_KEY_MTIME "mtime"
+#define CACHE_KEY_DIRECTORIES "directories"
+#define CACHE_KEY_DIRECTORY_MTIMES "directory-mtimes"
+#define CACHE_KEY_CONTENT_TYPES "content-types"
+
 G_DEFINE_TYPE (ShellMimeSniffer, shell_mime_sniffer, G_TYPE_OBJECT);
 
 enum {
@@ -62,9 +101,13 @@ static GParamSpec *properties[NUM_PROPERTIES] = { NULL, };
 typedef struct {
   ShellMimeSniffer *self;
 
-  GFile *file;
-  GFileEnumerator *enumerator;
-  GList *deep_count_subdirectories;
+  /* Directories (GFile) waiting to be enumerated */
+  GQueue *pending_directories;
+  gint n_active_directories;
+
+  /* Enumerations and content reads currently in flight */
+  gint n_pending_ops;
+  gint n_content_reads;
 
   gint audio_count;
   gint image_count;
@@ -72,20 +115,42 @@ typedef struct {
   gint video_count;
 
   gint total_items;
+
+  /* Subdirectories found while crawling, relative to the root, and
+   * their modification times (as strings), for validating the cache */
+  GPtrArray *directories;
+  GPtrArray *directory_mtimes;
+
+  /* TRUE if some directory didn't tell us its modification time, so
+   * that we couldn't notice it changing */
+  gboolean mtime_unknown;
+
+  /* TRUE if the counts are worth remembering, i.e. we either walked
+   * the whole tree or stopped because the result settled. */
+  gboolean complete;
 } DeepCountState;
 
+typedef struct {
+  DeepCountState *state;
+
+  GFile *file;
+  GFileEnumerator *enumerator;
+} DirectoryLoad;
+
 struct _ShellMimeSnifferPrivate {
   GFile *file;
 
   GCancellable *cancellable;
   guint watchdog_id;
 
+  gchar *volume_uuid;
+  guint64 root_mtime;
+
   GSimpleAsyncResult *async_result;
   gchar **sniffed_mime;
 };
 
-static void deep_count_load (DeepCountState *state,
-                             GFile *file);
+static void deep_count_schedule (DeepCountState *state);
 
 static void
 init_mimetypes (void)
@@ -138,6 +203,9 @@ add_content_type_to_cache (DeepCountState *state,
 {
   gboolean matched = TRUE;
 
+  if (content_type == NULL)
+    return;
+
   if (g_hash_table_lookup (image_type_table, content_type))
     state->image_count++;
   else if (g_hash_table_lookup (video_type_table, content_type))
@@ -153,6 +221,77 @@ add_content_type_to_cache (DeepCountState *state,
     state->total_items++;
 }
 
+static gchar *
+get_cache_filename (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "gnome-shell",
+                           "hotplug-sniffer.ini",
+                           NULL);
+}
+
+static GKeyFile *
+load_cache (void)
+{
+  GKeyFile *cache;
+  gchar *filename;
+
+  cache = g_key_file_new ();
+  filename = get_cache_filename ();
+  g_key_file_load_from_file (cache, filename, G_KEY_FILE_NONE, NULL);
+  g_free (filename);
+
+  return cache;
+}
+
+/* Results are cached per volume UUID, together with the modification
+ * times of the root directory and of the subdirectories we found, and
+ * are only used as long as none of them changed; see cache_check_start().
+ * Without a modification time for the root there is nothing to check
+ * against, so such volumes are always crawled.
+ */
+static void
+save_cached_result (DeepCountState *state)
+{
+  ShellMimeSniffer *self = state->self;
+  GKeyFile *cache;
+  gchar *filename, *dirname, *data;
+  gsize length;
+
+  if (self->priv->volume_uuid == NULL ||
+      self->priv->root_mtime == 0 ||
+      state->mtime_unknown)
+    return;
+
+  cache = load_cache ();
+  g_key_file_set_uint64 (cache, self->priv->volume_uuid,
+                         CACHE_KEY_MTIME, self->priv->root_mtime);
+  g_key_file_set_string_list (cache, self->priv->volume_uuid,
+                              CACHE_KEY_DIRECTORIES,
+                              (const gchar * const *) state->directories->pdata,
+                              state->directories->len);
+  g_key_file_set_string_list (cache, self->priv->volume_uuid,
+                              CACHE_KEY_DIRECTORY_MTIMES,
+                              (const gchar * const *) state->directory_mtimes->pdata,
+                              state->directory_mtimes->len);
+  g_key_file_set_string_list (cache, self->priv->volume_uuid,
+                              CACHE_KEY_CONTENT_TYPES,
+                              (const gchar * const *) self->priv->sniffed_mime,
+                              g_strv_length (self->priv->sniffed_mime));
+
+  filename = get_cache_filename ();
+  dirname = g_path_get_dirname (filename);
+  data = g_key_file_to_data (cache, &length, NULL);
+
+  if (g_mkdir_with_parents (dirname, 0700) == 0)
+    g_file_set_contents (filename, data, length, NULL);
+
+  g_free (data);
+  g_free (dirname);
+  g_free (filename);
+  g_key_file_free (cache);
+}
+
 typedef struct {
   const gchar *type;
   gdouble ratio;
@@ -224,75 +363,210 @@ prepare_async_result (DeepCountState *state)
   g_ptr_array_add (sniffed_mime, NULL);
   self->priv->sniffed_mime = (gchar **) g_ptr_array_free (sniffed_mime, FALSE);
 
+  if (state->complete && state->total_items > 0)
+    save_cached_result (state);
+
   g_array_free (results, TRUE);
   g_simple_async_result_complete_in_idle (self->priv->async_result);
 }
 
-/* adapted from nautilus/libnautilus-private/nautilus-directory-async.c */
+static gint
+counts_cmp_func (gconstpointer a,
+                 gconstpointer b)
+{
+  return *(const gint *) b - *(const gint *) a;
+}
+
+/* Whether @ratio is further from @threshold than the confidence
+ * interval for a proportion measured over @n samples.
+ */
+static gboolean
+ratio_is_settled (gdouble ratio,
+                  gdouble threshold,
+                  gint    n)
+{
+  gdouble delta = ratio - threshold;
+  gdouble variance = ratio * (1.0 - ratio) / n;
+
+  return delta * delta > SETTLED_Z_SCORE * SETTLED_Z_SCORE * variance;
+}
+
+/* Checks whether more samples could still change the outcome of
+ * prepare_async_result(): the leading type must be clearly ahead
+ * of the second one, and the others clearly above or below
+ * HIGH_SCORE_RATIO.
+ */
+static gboolean
+deep_count_is_settled (DeepCountState *state)
+{
+  gint counts[4];
+  gdouble first, second, delta, variance;
+  guint idx;
+  gint n;
+
+  n = state->total_items;
+  if (n < MIN_SETTLED_ITEMS)
+    return FALSE;
+
+  counts[0] = state->video_count;
+  counts[1] = state->audio_count;
+  counts[2] = state->image_count;
+  counts[3] = state->document_count;
+  qsort (counts, G_N_ELEMENTS (counts), sizeof (gint), counts_cmp_func);
+
+  /* Variance of the difference of two multinomial proportions */
+  first = (gdouble) counts[0] / n;
+  second = (gdouble) counts[1] / n;
+  delta = first - second;
+  variance = (first + second - delta * delta) / n;
+
+  if (delta * delta <= SETTLED_Z_SCORE * SETTLED_Z_SCORE * variance)
+    return FALSE;
+
+  for (idx = 1; idx < G_N_ELEMENTS (counts); idx++)
+    if (!ratio_is_settled ((gdouble) counts[idx] / n, HIGH_SCORE_RATIO, n))
+      return FALSE;
+
+  return TRUE;
+}
+
 static void
-deep_count_one (DeepCountState *state,
-		GFileInfo *info)
+deep_count_finish (DeepCountState *state)
 {
-  GFile *subdir;
-  const char *content_type;
+  ShellMimeSniffer *self = state->self;
 
-  if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
-    {
-      /* record the fact that we have to descend into this directory */
-      subdir = g_file_get_child (state->file, g_file_info_get_name (info));
-      state->deep_count_subdirectories =
-        g_list_append (state->deep_count_subdirectories, subdir);
-    } 
-  else
+  if (self->priv->watchdog_id != 0)
     {
-      content_type = g_file_info_get_content_type (info);
-      add_content_type_to_cache (state, content_type);
+      g_source_remove (self->priv->watchdog_id);
+      self->priv->watchdog_id = 0;
     }
+
+  prepare_async_result (state);
+
+  g_cancellable_reset (self->priv->cancellable);
+
+  g_queue_foreach (state->pending_directories, (GFunc) g_object_unref, NULL);
+  g_queue_free (state->pending_directories);
+
+  g_ptr_array_unref (state->directories);
+  g_ptr_array_unref (state->directory_mtimes);
+
+  g_free (state);
 }
 
 static void
-deep_count_finish (DeepCountState *state)
+deep_count_op_done (DeepCountState *state)
 {
-  prepare_async_result (state);
+  state->n_pending_ops--;
 
-  if (state->enumerator)
+  if (!state->complete && deep_count_is_settled (state))
     {
-      if (!g_file_enumerator_is_closed (state->enumerator))
-        g_file_enumerator_close_async (state->enumerator,
-                                       0, NULL, NULL, NULL);
-
-      g_object_unref (state->enumerator);
+      /* Stop all the other enumerations; they'll report back
+       * and we finish once the last one did. */
+      state->complete = TRUE;
+      g_cancellable_cancel (state->self->priv->cancellable);
     }
 
-  g_cancellable_reset (state->self->priv->cancellable);
-  g_clear_object (&state->file);
+  deep_count_schedule (state);
+}
+
+static void
+content_query_callback (GObject *source_object,
+                        GAsyncResult *res,
+                        gpointer user_data)
+{
+  DeepCountState *state = user_data;
+  GFileInfo *info;
+
+  info = g_file_query_info_finish (G_FILE (source_object), res, NULL);
 
-  g_list_free_full (state->deep_count_subdirectories, g_object_unref);
+  if (info != NULL)
+    {
+      add_content_type_to_cache (state, g_file_info_get_content_type (info));
+      g_object_unref (info);
+    }
 
-  g_free (state);
+  deep_count_op_done (state);
 }
 
+/* adapted from nautilus/libnautilus-private/nautilus-directory-async.c */
 static void
-deep_count_next_dir (DeepCountState *state)
+deep_count_one (DirectoryLoad *load,
+		GFileInfo *info)
 {
-  GFile *new_file;
+  DeepCountState *state = load->state;
+  GFile *child;
+  gchar *content_type;
+  gboolean uncertain;
+  guint64 mtime;
 
-  g_clear_object (&state->file);
+  child = g_file_get_child (load->file, g_file_info_get_name (info));
 
-  if (state->deep_count_subdirectories != NULL)
+  if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
     {
-      /* Work on a new directory. */
-      new_file = state->deep_count_subdirectories->data;
-      state->deep_count_subdirectories =
-        g_list_remove (state->deep_count_subdirectories, new_file);
+      if (state->directories->len < MAX_CACHED_DIRECTORIES)
+        {
+          mtime = g_file_info_get_attribute_uint64 (info,
+                                                    G_FILE_ATTRIBUTE_TIME_MODIFIED);
+          if (mtime == 0)
+            state->mtime_unknown = TRUE;
+
+          g_ptr_array_add (state->directories,
+                           g_file_get_relative_path (state->self->priv->file, child));
+          g_ptr_array_add (state->directory_mtimes,
+                           g_strdup_printf ("%" G_GUINT64_FORMAT, mtime));
+        }
 
-      deep_count_load (state, new_file);
-      g_object_unref (new_file);
+      /* record the fact that we have to descend into this directory;
+       * crawling breadth-first gives us a better sample if we have
+       * to stop early. */
+      g_queue_push_tail (state->pending_directories, child);
+      return;
     }
-  else
+
+  content_type = g_content_type_guess (g_file_info_get_name (info),
+                                       NULL, 0, &uncertain);
+
+  if (!uncertain)
+    {
+      add_content_type_to_cache (state, content_type);
+    }
+  else if (state->n_content_reads < MAX_CONTENT_READS)
     {
-      deep_count_finish (state);
+      state->n_content_reads++;
+      state->n_pending_ops++;
+      g_file_query_info_async (child,
+                               CONTENT_ATTRS,
+                               G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                               G_PRIORITY_LOW,
+                               state->self->priv->cancellable,
+                               content_query_callback,
+                               state);
     }
+
+  g_free (content_type);
+  g_object_unref (child);
+}
+
+static void
+directory_load_done (DirectoryLoad *load)
+{
+  DeepCountState *state = load->state;
+
+  if (load->enumerator)
+    {
+      if (!g_file_enumerator_is_closed (load->enumerator))
+        g_file_enumerator_close_async (load->enumerator,
+                                       0, NULL, NULL, NULL);
+
+      g_object_unref (load->enumerator);
+    }
+
+  g_object_unref (load->file);
+  g_slice_free (DirectoryLoad, load);
+
+  state->n_active_directories--;
+  deep_count_op_done (state);
 }
 
 static void
@@ -300,47 +574,35 @@ deep_count_more_files_callback (GObject *source_object,
 				GAsyncResult *res,
 				gpointer user_data)
 {
-  DeepCountState *state;
+  DirectoryLoad *load = user_data;
+  DeepCountState *state = load->state;
   GList *files, *l;
-  GFileInfo *info;
 
-  state = user_data;
+  files = g_file_enumerator_next_files_finish (load->enumerator,
+                                               res, NULL);
 
-  if (g_cancellable_is_cancelled (state->self->priv->cancellable))
+  if (files == NULL ||
+      g_cancellable_is_cancelled (state->self->priv->cancellable))
     {
-      deep_count_finish (state);
+      g_list_free_full (files, g_object_unref);
+      directory_load_done (load);
       return;
     }
-	
-  files = g_file_enumerator_next_files_finish (state->enumerator,
-                                               res, NULL);
-  
+
   for (l = files; l != NULL; l = l->next)
-    {
-      info = l->data;
-      deep_count_one (state, info);
-      g_object_unref (info);
-    }
+    deep_count_one (load, l->data);
 
-  if (files == NULL)
-    {
-      g_file_enumerator_close_async (state->enumerator, 0, NULL, NULL, NULL);
-      g_object_unref (state->enumerator);
-      state->enumerator = NULL;
+  g_list_free_full (files, g_object_unref);
 
-      deep_count_next_dir (state);
-    }
-  else
-    {
-      g_file_enumerator_next_files_async (state->enumerator,
-                                          DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-                                          G_PRIORITY_LOW,
-                                          state->self->priv->cancellable,
-                                          deep_count_more_files_callback,
-                                          state);
-    }
+  /* Start on the subdirectories we found, if we have spare slots */
+  deep_count_schedule (state);
 
-  g_list_free (files);
+  g_file_enumerator_next_files_async (load->enumerator,
+                                      DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+                                      G_PRIORITY_LOW,
+                                      state->self->priv->cancellable,
+                                      deep_count_more_files_callback,
+                                      load);
 }
 
 static void
@@ -348,49 +610,68 @@ deep_count_callback (GObject *source_object,
 		     GAsyncResult *res,
 		     gpointer user_data)
 {
-  DeepCountState *state;
-  GFileEnumerator *enumerator;
+  DirectoryLoad *load = user_data;
+  DeepCountState *state = load->state;
 
-  state = user_data;
+  load->enumerator = g_file_enumerate_children_finish (G_FILE (source_object),
+                                                       res, NULL);
 
-  if (g_cancellable_is_cancelled (state->self->priv->cancellable))
+  if (load->enumerator == NULL ||
+      g_cancellable_is_cancelled (state->self->priv->cancellable))
     {
-      deep_count_finish (state);
+      directory_load_done (load);
       return;
     }
 
-  enumerator = g_file_enumerate_children_finish (G_FILE (source_object),
-                                                 res, NULL);
-	
-  if (enumerator == NULL)
-    {
-      deep_count_next_dir (state);
-    }
-  else
-    {
-      state->enumerator = enumerator;
-      g_file_enumerator_next_files_async (state->enumerator,
-                                          DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-                                          G_PRIORITY_LOW,
-                                          state->self->priv->cancellable,
-                                          deep_count_more_files_callback,
-                                          state);
-    }
+  g_file_enumerator_next_files_async (load->enumerator,
+                                      DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+                                      G_PRIORITY_LOW,
+                                      state->self->priv->cancellable,
+                                      deep_count_more_files_callback,
+                                      load);
 }
 
 static void
 deep_count_load (DeepCountState *state,
                  GFile *file)
 {
-  state->file = g_object_ref (file);
+  DirectoryLoad *load;
 
-  g_file_enumerate_children_async (state->file,
+  load = g_slice_new0 (DirectoryLoad);
+  load->state = state;
+  load->file = file;
+
+  state->n_active_directories++;
+  state->n_pending_ops++;
+
+  g_file_enumerate_children_async (load->file,
                                    LOADER_ATTRS,
                                    G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, /* flags */
                                    G_PRIORITY_LOW, /* prio */
                                    state->self->priv->cancellable,
                                    deep_count_callback,
-                                   state);
+                                   load);
+}
+
+/* Starts enumerating pending directories until we run out of
+ * parallel slots, and finishes the crawl once nothing is left
+ * in flight.
+ */
+static void
+deep_count_schedule (DeepCountState *state)
+{
+  if (!g_cancellable_is_cancelled (state->self->priv->cancellable))
+    {
+      while (state->n_active_directories < MAX_PARALLEL_DIRECTORIES &&
+             !g_queue_is_empty (state->pending_directories))
+        deep_count_load (state, g_queue_pop_head (state->pending_directories));
+
+      if (state->n_pending_ops == 0)
+        state->complete = TRUE;
+    }
+
+  if (state->n_pending_ops == 0)
+    deep_count_finish (state);
 }
 
 static void
@@ -400,8 +681,180 @@ deep_count_start (ShellMimeSniffer *self)
 
   state = g_new0 (DeepCountState, 1);
   state->self = self;
+  state->pending_directories = g_queue_new ();
+  state->directories = g_ptr_array_new_with_free_func (g_free);
+  state->directory_mtimes = g_ptr_array_new_with_free_func (g_free);
+
+  g_queue_push_tail (state->pending_directories,
+                     g_object_ref (self->priv->file));
+  deep_count_schedule (state);
+}
+
+typedef struct {
+  ShellMimeSniffer *self;
+
+  gchar **content_types;
+  gint n_pending_queries;
+  gboolean valid;
+} CacheCheck;
+
+typedef struct {
+  CacheCheck *check;
+  guint64 mtime;
+} CacheCheckDirectory;
+
+static void
+cache_check_finish (CacheCheck *check)
+{
+  ShellMimeSniffer *self = check->self;
+
+  if (!check->valid)
+    {
+      g_strfreev (check->content_types);
+      g_slice_free (CacheCheck, check);
+
+      deep_count_start (self);
+      return;
+    }
+
+  if (self->priv->watchdog_id != 0)
+    {
+      g_source_remove (self->priv->watchdog_id);
+      self->priv->watchdog_id = 0;
+    }
+
+  self->priv->sniffed_mime = check->content_types;
+  g_slice_free (CacheCheck, check);
+
+  g_simple_async_result_complete_in_idle (self->priv->async_result);
+}
+
+static void
+cache_check_directory_callback (GObject *source_object,
+                                GAsyncResult *res,
+                                gpointer user_data)
+{
+  CacheCheckDirectory *directory = user_data;
+  CacheCheck *check = directory->check;
+  GFileInfo *info;
+
+  info = g_file_query_info_finish (G_FILE (source_object), res, NULL);
+
+  if (info == NULL ||
+      g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) != directory->mtime)
+    check->valid = FALSE;
+
+  g_clear_object (&info);
+  g_slice_free (CacheCheckDirectory, directory);
+
+  if (--check->n_pending_queries == 0)
+    cache_check_finish (check);
+}
+
+/* Looks up the cached result for the volume, and checks that none of
+ * the directories it was computed from changed since; we crawl the
+ * volume if there is no such result.
+ */
+static void
+cache_check_start (ShellMimeSniffer *self)
+{
+  CacheCheck *check;
+  CacheCheckDirectory *directory;
+  GKeyFile *cache;
+  GFile *file;
+  gchar **directories, **mtimes;
+  gsize n_directories = 0, n_mtimes = 0, idx;
+
+  if (self->priv->volume_uuid == NULL || self->priv->root_mtime == 0)
+    {
+      deep_count_start (self);
+      return;
+    }
+
+  cache = load_cache ();
 
-  deep_count_load (state, self->priv->file);
+  if (!g_key_file_has_key (cache, self->priv->volume_uuid,
+                           CACHE_KEY_DIRECTORIES, NULL) ||
+      g_key_file_get_uint64 (cache, self->priv->volume_uuid,
+                             CACHE_KEY_MTIME, NULL) != self->priv->root_mtime)
+    {
+      g_key_file_free (cache);
+      deep_count_start (self);
+      return;
+    }
+
+  check = g_slice_new0 (CacheCheck);
+  check->self = self;
+  check->content_types = g_key_file_get_string_list (cache, self->priv->volume_uuid,
+                                                     CACHE_KEY_CONTENT_TYPES,
+                                                     NULL, NULL);
+  check->valid = check->content_types != NULL;
+
+  directories = g_key_file_get_string_list (cache, self->priv->volume_uuid,
+                                            CACHE_KEY_DIRECTORIES,
+                                            &n_directories, NULL);
+  mtimes = g_key_file_get_string_list (cache, self->priv->volume_uuid,
+                                       CACHE_KEY_DIRECTORY_MTIMES,
+                                       &n_mtimes, NULL);
+  g_key_file_free (cache);
+
+  if (n_directories != n_mtimes)
+    check->valid = FALSE;
+
+  if (check->valid)
+    {
+      check->n_pending_queries = n_directories;
+
+      for (idx = 0; idx < n_directories; idx++)
+        {
+          directory = g_slice_new0 (CacheCheckDirectory);
+          directory->check = check;
+          directory->mtime = g_ascii_strtoull (mtimes[idx], NULL, 10);
+
+          file = g_file_resolve_relative_path (self->priv->file,
+                                               directories[idx]);
+          g_file_query_info_async (file,
+                                   G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                   G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                   G_PRIORITY_DEFAULT,
+                                   self->priv->cancellable,
+                                   cache_check_directory_callback,
+                                   directory);
+          g_object_unref (file);
+        }
+    }
+
+  g_strfreev (directories);
+  g_strfreev (mtimes);
+
+  if (check->n_pending_queries == 0)
+    cache_check_finish (check);
+}
+
+static void
+find_mount_async_ready_cb (GObject *source,
+                           GAsyncResult *res,
+                           gpointer user_data)
+{
+  ShellMimeSniffer *self = user_data;
+  GMount *mount;
+  GVolume *volume;
+
+  mount = g_file_find_enclosing_mount_finish (G_FILE (source), res, NULL);
+
+  if (mount != NULL)
+    {
+      self->priv->volume_uuid = g_mount_get_uuid (mount);
+
+      volume = g_mount_get_volume (mount);
+      if (self->priv->volume_uuid == NULL && volume != NULL)
+        self->priv->volume_uuid = g_volume_get_uuid (volume);
+
+      g_clear_object (&volume);
+      g_object_unref (mount);
+    }
+
+  cache_check_start (self);
 }
 
 static void
@@ -432,11 +885,20 @@ query_info_async_ready_cb (GObject *source,
                                        G_IO_ERROR_NOT_DIRECTORY,
                                        "Not a directory");
       g_simple_async_result_complete_in_idle (self->priv->async_result);
+      g_object_unref (info);
 
       return;
     }
 
-  deep_count_start (self);
+  self->priv->root_mtime =
+    g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  g_object_unref (info);
+
+  g_file_find_enclosing_mount_async (self->priv->file,
+                                     G_PRIORITY_DEFAULT,
+                                     self->priv->cancellable,
+                                     find_mount_async_ready_cb,
+                                     self);
 }
 
 static gboolean
@@ -454,7 +916,7 @@ static void
 start_loading_file (ShellMimeSniffer *self)
 {
   g_file_query_info_async (self->priv->file,
-                           LOADER_ATTRS,
+                           ROOT_ATTRS,
                            G_FILE_QUERY_INFO_NONE,
                            G_PRIORITY_DEFAULT,
                            self->priv->cancellable,
@@ -494,6 +956,7 @@ shell_mime_sniffer_finalize (GObject *object)
   ShellMimeSniffer *self = SHELL_MIME_SNIFFER (object);
 
   g_strfreev (self->priv->sniffed_mime);
+  g_free (self->priv->volume_uuid);
 
   G_OBJECT_CLASS (shell_mime_sniffer_parent_class)->finalize (object);
 }
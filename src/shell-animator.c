@@ -0,0 +1,826 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "shell-animator.h"
+#include "shell-global.h"
+#include "st.h"
+
+typedef enum {
+  PROPERTY_X,
+  PROPERTY_Y,
+  PROPERTY_WIDTH,
+  PROPERTY_HEIGHT,
+  PROPERTY_SCALE_X,
+  PROPERTY_SCALE_Y,
+  PROPERTY_OPACITY
+} AnimatedProperty;
+
+static const struct {
+  const char *name;
+  AnimatedProperty property;
+} animated_properties[] = {
+  { "x", PROPERTY_X },
+  { "y", PROPERTY_Y },
+  { "width", PROPERTY_WIDTH },
+  { "height", PROPERTY_HEIGHT },
+  { "scale_x", PROPERTY_SCALE_X },
+  { "scale-x", PROPERTY_SCALE_X },
+  { "scale_y", PROPERTY_SCALE_Y },
+  { "scale-y", PROPERTY_SCALE_Y },
+  { "opacity", PROPERTY_OPACITY }
+};
+
+typedef enum {
+  EASE_IN,
+  EASE_OUT,
+  EASE_IN_OUT
+} EasingMode;
+
+typedef struct {
+  const char *name;
+  double (*func) (double t);
+  EasingMode mode;
+} Easing;
+
+/* The easing equations of the tweener module (Robert Penner's), for a
+ * progress @t between 0 and 1. The "out" and "in-out" variants are
+ * derived from the "in" ones, see ease().
+ */
+static double
+ease_linear (double t)
+{
+  return t;
+}
+
+static double
+ease_in_quad (double t)
+{
+  return t * t;
+}
+
+static double
+ease_in_cubic (double t)
+{
+  return t * t * t;
+}
+
+static double
+ease_in_quart (double t)
+{
+  return t * t * t * t;
+}
+
+static double
+ease_in_quint (double t)
+{
+  return t * t * t * t * t;
+}
+
+static double
+ease_in_sine (double t)
+{
+  return 1. - cos (t * G_PI / 2.);
+}
+
+static double
+ease_in_circ (double t)
+{
+  return 1. - sqrt (1. - t * t);
+}
+
+/* The exponential equations are offset a little so that they reach
+ * their end values, which makes them asymmetric; so they are written
+ * out, exactly as tweener has them.
+ */
+static double
+ease_in_expo (double t)
+{
+  return t == 0. ? 0. : pow (2., 10. * (t - 1.)) - 0.001;
+}
+
+static double
+ease_out_expo (double t)
+{
+  return t == 1. ? 1. : 1.001 * (1. - pow (2., -10. * t));
+}
+
+static double
+ease_in_out_expo (double t)
+{
+  if (t == 0. || t == 1.)
+    return t;
+  if (t < 0.5)
+    return pow (2., 10. * (2. * t - 1.)) / 2. - 0.0005;
+  return 1.0005 * (2. - pow (2., -10. * (2. * t - 1.))) / 2.;
+}
+
+#define EASING_FAMILY(name, func) \
+  { "easeIn" name, func, EASE_IN }, \
+  { "easeOut" name, func, EASE_OUT }, \
+  { "easeInOut" name, func, EASE_IN_OUT }
+
+static const Easing easings[] = {
+  { "linear", ease_linear, EASE_IN },
+  EASING_FAMILY ("Quad", ease_in_quad),
+  EASING_FAMILY ("Cubic", ease_in_cubic),
+  EASING_FAMILY ("Quart", ease_in_quart),
+  EASING_FAMILY ("Quint", ease_in_quint),
+  EASING_FAMILY ("Sine", ease_in_sine),
+  EASING_FAMILY ("Circ", ease_in_circ),
+  { "easeInExpo", ease_in_expo, EASE_IN },
+  { "easeOutExpo", ease_out_expo, EASE_IN },
+  { "easeInOutExpo", ease_in_out_expo, EASE_IN }
+};
+
+static double
+ease (const Easing *easing,
+      double        t)
+{
+  switch (easing->mode)
+    {
+    case EASE_IN:
+      return easing->func (t);
+    case EASE_OUT:
+      return 1. - easing->func (1. - t);
+    case EASE_IN_OUT:
+      if (t < 0.5)
+        return easing->func (2. * t) / 2.;
+      else
+        return 1. - easing->func (2. - 2. * t) / 2.;
+    }
+
+  g_assert_not_reached ();
+  return t;
+}
+
+typedef struct {
+  AnimatedProperty property;
+  double start_value;
+  double end_value;
+} TweenProperty;
+
+typedef struct {
+  guint id;
+  ClutterActor *actor;
+  gulong destroy_id;
+
+  GArray *properties;
+  const Easing *easing;
+  gint64 delay;
+  gint64 duration;
+
+  /* Until the first frame after the tween was added, the time it was
+   * added at; then the time its delay is over. This way, like with the
+   * JS tweener, a tween doesn't skip frames because of work done
+   * between adding it and the next frame.
+   */
+  gint64 start_time;
+  guint anchored : 1;
+  guint started : 1;
+
+  /* Removed while we were updating the tweens; still in the queue
+   * until update_tweens() is done with it */
+  guint dead : 1;
+} Tween;
+
+struct _ShellAnimator
+{
+  GObject parent;
+
+  /* Tweens, in the order they were added */
+  GQueue tweens;
+  ClutterTimeline *timeline;
+  guint next_id;
+
+  /* TRUE while update_tweens() walks the queue */
+  guint updating : 1;
+};
+
+struct _ShellAnimatorClass
+{
+  GObjectClass parent_class;
+};
+
+enum {
+  TWEEN_STARTED,
+  TWEEN_FINISHED,
+
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+G_DEFINE_TYPE (ShellAnimator, shell_animator, G_TYPE_OBJECT);
+
+static void on_new_frame (ClutterTimeline *timeline,
+                          gint             msecs,
+                          ShellAnimator   *animator);
+
+static void on_actor_destroy (ClutterActor  *actor,
+                              ShellAnimator *animator);
+
+static void
+shell_animator_init (ShellAnimator *animator)
+{
+  g_queue_init (&animator->tweens);
+  animator->next_id = 1;
+
+  /* We don't know how long we'll run, so loop a timeline with a very
+   * long duration; we only use it to be called once per frame */
+  animator->timeline = clutter_timeline_new (1000 * 1000);
+  clutter_timeline_set_loop (animator->timeline, TRUE);
+  g_signal_connect (animator->timeline, "new-frame",
+                    G_CALLBACK (on_new_frame), animator);
+}
+
+static void
+shell_animator_class_init (ShellAnimatorClass *klass)
+{
+  /**
+   * ShellAnimator::tween-started:
+   * @animator: the #ShellAnimator
+   * @id: the id of the tween, as returned by shell_animator_add_tween()
+   *
+   * Emitted once the delay of the tween is over, before its start
+   * values are read, so that handlers can still set them.
+   */
+  signals[TWEEN_STARTED] =
+    g_signal_new ("tween-started",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 1, G_TYPE_UINT);
+
+  /**
+   * ShellAnimator::tween-finished:
+   * @animator: the #ShellAnimator
+   * @id: the id of the tween, as returned by shell_animator_add_tween()
+   * @completed: %TRUE if the tween ran to its end; %FALSE if it was
+   *   removed, overwritten by another tween of the same properties, or
+   *   its actor was destroyed
+   *
+   * Emitted when a tween is done. Its id won't be used anymore.
+   */
+  signals[TWEEN_FINISHED] =
+    g_signal_new ("tween-finished",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_BOOLEAN);
+}
+
+/**
+ * shell_animator_get_default:
+ *
+ * Return value: (transfer none): the global #ShellAnimator
+ */
+ShellAnimator *
+shell_animator_get_default (void)
+{
+  static ShellAnimator *animator;
+
+  if (animator == NULL)
+    animator = g_object_new (SHELL_TYPE_ANIMATOR, NULL);
+
+  return animator;
+}
+
+static gboolean
+lookup_property (const char       *name,
+                 AnimatedProperty *property)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (animated_properties); i++)
+    {
+      if (strcmp (animated_properties[i].name, name) == 0)
+        {
+          *property = animated_properties[i].property;
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+static const Easing *
+lookup_easing (const char *name)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (easings); i++)
+    {
+      if (strcmp (easings[i].name, name) == 0)
+        return &easings[i];
+    }
+
+  return NULL;
+}
+
+static double
+get_property_value (ClutterActor     *actor,
+                    AnimatedProperty  property)
+{
+  gdouble scale_x, scale_y;
+
+  switch (property)
+    {
+    case PROPERTY_X:
+      return clutter_actor_get_x (actor);
+    case PROPERTY_Y:
+      return clutter_actor_get_y (actor);
+    case PROPERTY_WIDTH:
+      return clutter_actor_get_width (actor);
+    case PROPERTY_HEIGHT:
+      return clutter_actor_get_height (actor);
+    case PROPERTY_SCALE_X:
+    case PROPERTY_SCALE_Y:
+      clutter_actor_get_scale (actor, &scale_x, &scale_y);
+      return property == PROPERTY_SCALE_X ? scale_x : scale_y;
+    case PROPERTY_OPACITY:
+      return clutter_actor_get_opacity (actor);
+    }
+
+  g_assert_not_reached ();
+  return 0.;
+}
+
+static void
+set_property_value (ClutterActor     *actor,
+                    AnimatedProperty  property,
+                    double            value)
+{
+  gdouble scale_x, scale_y;
+
+  switch (property)
+    {
+    case PROPERTY_X:
+      clutter_actor_set_x (actor, value);
+      break;
+    case PROPERTY_Y:
+      clutter_actor_set_y (actor, value);
+      break;
+    case PROPERTY_WIDTH:
+      clutter_actor_set_width (actor, value);
+      break;
+    case PROPERTY_HEIGHT:
+      clutter_actor_set_height (actor, value);
+      break;
+    case PROPERTY_SCALE_X:
+      clutter_actor_get_scale (actor, NULL, &scale_y);
+      clutter_actor_set_scale (actor, value, scale_y);
+      break;
+    case PROPERTY_SCALE_Y:
+      clutter_actor_get_scale (actor, &scale_x, NULL);
+      clutter_actor_set_scale (actor, scale_x, value);
+      break;
+    case PROPERTY_OPACITY:
+      clutter_actor_set_opacity (actor, (guint8) CLAMP (value, 0., 255.));
+      break;
+    }
+}
+
+static void
+tween_free (Tween *tween)
+{
+  g_signal_handler_disconnect (tween->actor, tween->destroy_id);
+  g_object_unref (tween->actor);
+  g_array_free (tween->properties, TRUE);
+  g_slice_free (Tween, tween);
+}
+
+/* Returns the number of properties removed */
+static guint
+tween_remove_properties (Tween *tween,
+                         guint  property_mask)
+{
+  guint n_removed = 0;
+  guint i = 0;
+
+  while (i < tween->properties->len)
+    {
+      TweenProperty *property = &g_array_index (tween->properties, TweenProperty, i);
+
+      if (property_mask & (1 << property->property))
+        {
+          g_array_remove_index (tween->properties, i);
+          n_removed++;
+        }
+      else
+        {
+          i++;
+        }
+    }
+
+  return n_removed;
+}
+
+static void
+tween_get_times (Tween  *tween,
+                 gint64  now,
+                 gint64 *start,
+                 gint64 *end)
+{
+  if (tween->anchored)
+    *start = tween->start_time;
+  else
+    *start = now + tween->delay;
+
+  *end = *start + tween->duration;
+}
+
+static void
+start_running (ShellAnimator *animator)
+{
+  if (clutter_timeline_is_playing (animator->timeline))
+    return;
+
+  clutter_timeline_start (animator->timeline);
+  shell_global_begin_work (shell_global_get ());
+}
+
+static void
+maybe_stop_running (ShellAnimator *animator)
+{
+  if (!g_queue_is_empty (&animator->tweens) ||
+      !clutter_timeline_is_playing (animator->timeline))
+    return;
+
+  clutter_timeline_stop (animator->timeline);
+  shell_global_end_work (shell_global_get ());
+}
+
+/* Emits ::tween-finished for, and frees, a list of tweens that were
+ * already taken out of the queue; dead tweens are left for
+ * update_tweens() to free */
+static void
+finish_tweens (ShellAnimator *animator,
+               GSList        *tweens,
+               gboolean       completed)
+{
+  GSList *l;
+
+  for (l = tweens; l; l = l->next)
+    {
+      Tween *tween = l->data;
+
+      g_signal_emit (animator, signals[TWEEN_FINISHED], 0, tween->id, completed);
+      if (!tween->dead)
+        tween_free (tween);
+    }
+
+  g_slist_free (tweens);
+}
+
+/* Removes the given properties from the tweens of @actor that run
+ * between @start and @end (or all of them if @end is less than @start),
+ * and returns the tweens that have no properties left, after taking
+ * them out of the queue. While update_tweens() walks the queue, they
+ * are only marked dead instead, since it may be holding on to them.
+ */
+static GSList *
+remove_properties (ShellAnimator *animator,
+                   ClutterActor  *actor,
+                   guint          property_mask,
+                   gint64         start,
+                   gint64         end,
+                   gboolean      *removed)
+{
+  GSList *emptied = NULL;
+  gint64 now = g_get_monotonic_time ();
+  GList *l, *next;
+
+  for (l = animator->tweens.head; l; l = next)
+    {
+      Tween *tween = l->data;
+
+      next = l->next;
+
+      if (tween->actor != actor || tween->dead)
+        continue;
+
+      if (end >= start)
+        {
+          gint64 tween_start, tween_end;
+
+          tween_get_times (tween, now, &tween_start, &tween_end);
+          if (tween_end <= start || tween_start >= end)
+            continue;
+        }
+
+      if (tween_remove_properties (tween, property_mask) > 0)
+        *removed = TRUE;
+
+      if (tween->properties->len == 0)
+        {
+          if (animator->updating)
+            tween->dead = TRUE;
+          else
+            g_queue_delete_link (&animator->tweens, l);
+
+          emptied = g_slist_prepend (emptied, tween);
+        }
+    }
+
+  return g_slist_reverse (emptied);
+}
+
+static void
+update_tweens (ShellAnimator *animator)
+{
+  gint64 now = g_get_monotonic_time ();
+  GSList *completed = NULL;
+  GList *l, *next;
+  guint i;
+
+  /* Handlers of ::tween-started and of the notifications emitted when
+   * setting the properties may add or remove tweens or destroy actors;
+   * until we are done, removed tweens stay in the queue, marked dead,
+   * so that neither the current tween nor the next link go away under
+   * us. */
+  animator->updating = TRUE;
+
+  for (l = animator->tweens.head; l; l = next)
+    {
+      Tween *tween = l->data;
+      double t, progress;
+
+      next = l->next;
+
+      if (tween->dead)
+        continue;
+
+      if (!tween->anchored)
+        {
+          tween->start_time = now + tween->delay;
+          tween->anchored = TRUE;
+        }
+
+      if (now < tween->start_time)
+        continue;
+
+      if (!tween->started)
+        {
+          tween->started = TRUE;
+          g_signal_emit (animator, signals[TWEEN_STARTED], 0, tween->id);
+          if (tween->dead)
+            continue;
+
+          for (i = 0; i < tween->properties->len; i++)
+            {
+              TweenProperty *property = &g_array_index (tween->properties, TweenProperty, i);
+
+              property->start_value = get_property_value (tween->actor, property->property);
+            }
+        }
+
+      if (tween->duration > 0 && now < tween->start_time + tween->duration)
+        {
+          t = (double) (now - tween->start_time) / tween->duration;
+          progress = ease (tween->easing, t);
+        }
+      else
+        {
+          t = 1.;
+          progress = 1.;
+        }
+
+      g_object_freeze_notify (G_OBJECT (tween->actor));
+      for (i = 0; i < tween->properties->len; i++)
+        {
+          TweenProperty *property = &g_array_index (tween->properties, TweenProperty, i);
+
+          set_property_value (tween->actor, property->property,
+                              property->start_value +
+                              (property->end_value - property->start_value) * progress);
+        }
+      g_object_thaw_notify (G_OBJECT (tween->actor));
+
+      if (t >= 1. && !tween->dead)
+        {
+          g_queue_delete_link (&animator->tweens, l);
+          completed = g_slist_prepend (completed, tween);
+        }
+    }
+
+  for (l = animator->tweens.head; l; l = next)
+    {
+      Tween *tween = l->data;
+
+      next = l->next;
+
+      if (tween->dead)
+        {
+          g_queue_delete_link (&animator->tweens, l);
+          tween_free (tween);
+        }
+    }
+
+  animator->updating = FALSE;
+
+  /* Only emit these once we are done with the queue, so that the
+   * tweens can be freed right away */
+  finish_tweens (animator, g_slist_reverse (completed), TRUE);
+
+  maybe_stop_running (animator);
+}
+
+static void
+on_new_frame (ClutterTimeline *timeline,
+              gint             msecs,
+              ShellAnimator   *animator)
+{
+  update_tweens (animator);
+}
+
+static void
+on_actor_destroy (ClutterActor  *actor,
+                  ShellAnimator *animator)
+{
+  shell_animator_remove_tweens (animator, actor, NULL);
+}
+
+/**
+ * shell_animator_add_tween:
+ * @animator: the #ShellAnimator
+ * @actor: the #ClutterActor to animate
+ * @properties: (array zero-terminated=1): the names of the properties
+ *   to animate; "x", "y", "width", "height", "scale_x", "scale_y" and
+ *   "opacity" are supported
+ * @values: (array length=n_values): the values to animate
+ *   @properties to
+ * @n_values: the number of @values, which must be the same as that of
+ *   @properties
+ * @transition: the name of a tweener easing equation, like "linear" or
+ *   "easeOutQuad". The Quad, Cubic, Quart, Quint, Sine, Expo and Circ
+ *   equations are supported, in their In, Out and InOut variants.
+ * @delay: the time, in seconds, to wait before starting the tween
+ * @time: the duration of the tween, in seconds
+ *
+ * Animates @properties of @actor from their values when the tween
+ * starts to @values, the same way as the tweener module. Any tween
+ * of the same properties of @actor running at the same time is
+ * overwritten; the tweens of @actor are removed when it is destroyed.
+ * Times are scaled by the St slow-down factor.
+ *
+ * Return value: the id of the new tween, or 0 if @transition or one of
+ *   @properties is not supported, in which case nothing was done
+ */
+guint
+shell_animator_add_tween (ShellAnimator       *animator,
+                          ClutterActor        *actor,
+                          const char * const  *properties,
+                          const double        *values,
+                          guint                n_values,
+                          const char          *transition,
+                          double               delay,
+                          double               time)
+{
+  const Easing *easing;
+  Tween *tween;
+  GSList *overwritten;
+  gboolean removed = FALSE;
+  guint property_mask = 0;
+  gint64 now, start, end;
+  double slow_down_factor;
+  guint i;
+
+  g_return_val_if_fail (SHELL_IS_ANIMATOR (animator), 0);
+  g_return_val_if_fail (CLUTTER_IS_ACTOR (actor), 0);
+  g_return_val_if_fail (properties != NULL, 0);
+  g_return_val_if_fail (g_strv_length ((char **) properties) == n_values, 0);
+
+  easing = lookup_easing (transition);
+  if (easing == NULL)
+    return 0;
+
+  tween = g_slice_new0 (Tween);
+  tween->properties = g_array_sized_new (FALSE, FALSE, sizeof (TweenProperty), n_values);
+
+  for (i = 0; i < n_values; i++)
+    {
+      TweenProperty property;
+
+      if (!lookup_property (properties[i], &property.property))
+        {
+          g_array_free (tween->properties, TRUE);
+          g_slice_free (Tween, tween);
+          return 0;
+        }
+
+      property.start_value = 0.;
+      property.end_value = values[i];
+      g_array_append_val (tween->properties, property);
+
+      property_mask |= 1 << property.property;
+    }
+
+  slow_down_factor = st_get_slow_down_factor ();
+  if (slow_down_factor <= 0)
+    slow_down_factor = 1.;
+
+  now = g_get_monotonic_time ();
+
+  tween->id = animator->next_id++;
+  if (animator->next_id == 0)
+    animator->next_id = 1;
+  tween->actor = g_object_ref (actor);
+  tween->destroy_id = g_signal_connect (actor, "destroy",
+                                        G_CALLBACK (on_actor_destroy), animator);
+  tween->easing = easing;
+  tween->delay = delay * slow_down_factor * G_USEC_PER_SEC;
+  tween->duration = time * slow_down_factor * G_USEC_PER_SEC;
+  tween->start_time = now;
+
+  tween_get_times (tween, now, &start, &end);
+  overwritten = remove_properties (animator, actor, property_mask, start, end, &removed);
+
+  g_queue_push_tail (&animator->tweens, tween);
+  start_running (animator);
+
+  finish_tweens (animator, overwritten, FALSE);
+
+  return tween->id;
+}
+
+/**
+ * shell_animator_remove_tweens:
+ * @animator: the #ShellAnimator
+ * @actor: a #ClutterActor
+ * @properties: (array zero-terminated=1) (allow-none): names of
+ *   properties, or %NULL
+ *
+ * Stops animating @properties of @actor, or all of them if
+ * @properties is %NULL. Properties are left at their current values.
+ *
+ * Return value: %TRUE if something was being animated
+ */
+gboolean
+shell_animator_remove_tweens (ShellAnimator      *animator,
+                              ClutterActor       *actor,
+                              const char * const *properties)
+{
+  GSList *emptied;
+  gboolean removed = FALSE;
+  guint property_mask = 0;
+
+  g_return_val_if_fail (SHELL_IS_ANIMATOR (animator), FALSE);
+  g_return_val_if_fail (CLUTTER_IS_ACTOR (actor), FALSE);
+
+  if (properties == NULL)
+    {
+      property_mask = ~0;
+    }
+  else
+    {
+      guint i;
+
+      for (i = 0; properties[i]; i++)
+        {
+          AnimatedProperty property;
+
+          if (lookup_property (properties[i], &property))
+            property_mask |= 1 << property;
+        }
+    }
+
+  emptied = remove_properties (animator, actor, property_mask, 0, -1, &removed);
+  finish_tweens (animator, emptied, FALSE);
+  maybe_stop_running (animator);
+
+  return removed;
+}
+
+/**
+ * shell_animator_get_tween_count:
+ * @animator: the #ShellAnimator
+ * @actor: a #ClutterActor
+ *
+ * Return value: the number of properties of @actor being animated,
+ *   counted the same way as by the tweener module
+ */
+guint
+shell_animator_get_tween_count (ShellAnimator *animator,
+                                ClutterActor  *actor)
+{
+  guint count = 0;
+  GList *l;
+
+  g_return_val_if_fail (SHELL_IS_ANIMATOR (animator), 0);
+
+  for (l = animator->tweens.head; l; l = l->next)
+    {
+      Tween *tween = l->data;
+
+      if (tween->actor == actor)
+        count += tween->properties->len;
+    }
+
+  return count;
+}
@@ -0,0 +1,53 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_ANIMATOR_H__
+#define __SHELL_ANIMATOR_H__
+
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+/**
+ * SECTION:shell-animator
+ * @short_description: Native animation of common actor properties
+ *
+ * #ShellAnimator animates the position, size, scale and opacity of
+ * actors. All its tweens are evaluated in C, once per frame, so that
+ * the JavaScript interpreter is not involved while they run; only
+ * their start and end are reported, with the #ShellAnimator::tween-started
+ * and #ShellAnimator::tween-finished signals. The tweener module uses
+ * it for the tweens it can handle.
+ */
+
+typedef struct _ShellAnimator ShellAnimator;
+typedef struct _ShellAnimatorClass ShellAnimatorClass;
+
+#define SHELL_TYPE_ANIMATOR              (shell_animator_get_type ())
+#define SHELL_ANIMATOR(object)           (G_TYPE_CHECK_INSTANCE_CAST ((object), SHELL_TYPE_ANIMATOR, ShellAnimator))
+#define SHELL_ANIMATOR_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST ((klass), SHELL_TYPE_ANIMATOR, ShellAnimatorClass))
+#define SHELL_IS_ANIMATOR(object)        (G_TYPE_CHECK_INSTANCE_TYPE ((object), SHELL_TYPE_ANIMATOR))
+#define SHELL_IS_ANIMATOR_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE ((klass), SHELL_TYPE_ANIMATOR))
+#define SHELL_ANIMATOR_GET_CLASS(obj)    (G_TYPE_INSTANCE_GET_CLASS ((obj), SHELL_TYPE_ANIMATOR, ShellAnimatorClass))
+
+GType shell_animator_get_type (void) G_GNUC_CONST;
+
+ShellAnimator *shell_animator_get_default     (void);
+
+guint          shell_animator_add_tween       (ShellAnimator       *animator,
+                                               ClutterActor        *actor,
+                                               const char * const  *properties,
+                                               const double        *values,
+                                               guint                n_values,
+                                               const char          *transition,
+                                               double               delay,
+                                               double               time);
+
+gboolean       shell_animator_remove_tweens   (ShellAnimator       *animator,
+                                               ClutterActor        *actor,
+                                               const char * const  *properties);
+
+guint          shell_animator_get_tween_count (ShellAnimator       *animator,
+                                               ClutterActor        *actor);
+
+G_END_DECLS
+
+#endif /* __SHELL_ANIMATOR_H__ */
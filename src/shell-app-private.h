@@ -4,6 +4,7 @@
 
 #include "shell-app.h"
 #include "shell-app-system.h"
+#include "shell-search-matcher.h"
 
 #define SN_API_NOT_YET_FROZEN 1
 #include <libsn/sn.h>
@@ -22,10 +23,8 @@ void _shell_app_add_window (ShellApp *app, MetaWindow *window);
 
 void _shell_app_remove_window (ShellApp *app, MetaWindow *window);
 
-void _shell_app_do_match (ShellApp         *app,
-                          GSList           *terms,
-                          GSList          **prefix_results,
-                          GSList          **substring_results);
+guint _shell_app_match (ShellApp           *app,
+                        ShellSearchMatcher *matcher);
 
 G_END_DECLS
 
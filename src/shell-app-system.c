@@ -698,37 +698,56 @@ compare_apps_by_usage (gconstpointer a,
   return shell_app_usage_compare (usage, "", app_a, app_b);
 }
 
-static GSList *
-sort_and_concat_results (ShellAppSystem *system,
-                         GSList         *prefix_matches,
-                         GSList         *substring_matches)
+typedef struct {
+  ShellApp *app;
+  guint score;
+} AppSearchResult;
+
+static gint
+compare_results (gconstpointer a,
+                 gconstpointer b,
+                 gpointer      data)
 {
-  prefix_matches = g_slist_sort_with_data (prefix_matches,
-                                           compare_apps_by_usage,
-                                           system);
-  substring_matches = g_slist_sort_with_data (substring_matches,
-                                              compare_apps_by_usage,
-                                              system);
-  return g_slist_concat (prefix_matches, substring_matches);
+  const AppSearchResult *result_a = a;
+  const AppSearchResult *result_b = b;
+
+  if (result_a->score != result_b->score)
+    return result_a->score > result_b->score ? -1 : 1;
+
+  return compare_apps_by_usage (result_a->app, result_b->app, data);
 }
 
-/**
- * normalize_terms:
- * @terms: (element-type utf8): Input search terms
- *
- * Returns: (element-type utf8) (transfer full): Unicode-normalized and lowercased terms
- */
+/* Frees @results */
 static GSList *
-normalize_terms (GSList *terms)
+sort_results (ShellAppSystem *system,
+              GArray         *results)
 {
-  GSList *normalized_terms = NULL;
-  GSList *iter;
-  for (iter = terms; iter; iter = iter->next)
-    {
-      const char *term = iter->data;
-      normalized_terms = g_slist_prepend (normalized_terms, shell_util_normalize_and_casefold (term));
-    }
-  return normalized_terms;
+  GSList *sorted = NULL;
+  int i;
+
+  g_array_sort_with_data (results, compare_results, system);
+
+  for (i = results->len - 1; i >= 0; i--)
+    sorted = g_slist_prepend (sorted, g_array_index (results, AppSearchResult, i).app);
+
+  g_array_free (results, TRUE);
+
+  return sorted;
+}
+
+static void
+match_app (ShellApp           *app,
+           ShellSearchMatcher *matcher,
+           GArray             *results)
+{
+  AppSearchResult result;
+
+  result.score = _shell_app_match (app, matcher);
+  if (result.score == 0)
+    return;
+
+  result.app = app;
+  g_array_append_val (results, result);
 }
 
 static GSList *
@@ -736,29 +755,21 @@ search_tree (ShellAppSystem *self,
              GSList         *terms,
              GHashTable     *apps)
 {
-  GSList *prefix_results = NULL;
-  GSList *substring_results = NULL;
-  GSList *normalized_terms;
+  ShellSearchMatcher *matcher;
+  GArray *results;
   GHashTableIter iter;
-  gpointer key, value;
+  gpointer value;
 
-  normalized_terms = normalize_terms (terms);
+  matcher = shell_search_matcher_new (terms);
+  results = g_array_new (FALSE, FALSE, sizeof (AppSearchResult));
 
   g_hash_table_iter_init (&iter, apps);
-  while (g_hash_table_iter_next (&iter, &key, &value))
-    {
-      const char *id = key;
-      ShellApp *app = value;
-      (void)id;
-      _shell_app_do_match (app, normalized_terms,
-                           &prefix_results,
-                           &substring_results);
-    }
-  g_slist_foreach (normalized_terms, (GFunc)g_free, NULL);
-  g_slist_free (normalized_terms);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    match_app (value, matcher, results);
 
-  return sort_and_concat_results (self, prefix_results, substring_results);
+  g_object_unref (matcher);
 
+  return sort_results (self, results);
 }
 
 /**
@@ -795,26 +806,22 @@ shell_app_system_subsearch (ShellAppSystem   *system,
                             GSList           *previous_results,
                             GSList           *terms)
 {
+  ShellSearchMatcher *matcher;
+  GArray *results;
   GSList *iter;
-  GSList *prefix_results = NULL;
-  GSList *substring_results = NULL;
-  GSList *normalized_terms = normalize_terms (terms);
+
+  matcher = shell_search_matcher_new (terms);
+  results = g_array_new (FALSE, FALSE, sizeof (AppSearchResult));
 
   for (iter = previous_results; iter; iter = iter->next)
-    {
-      ShellApp *app = iter->data;
-      
-      _shell_app_do_match (app, normalized_terms,
-                           &prefix_results,
-                           &substring_results);
-    }
-  g_slist_foreach (normalized_terms, (GFunc)g_free, NULL);
-  g_slist_free (normalized_terms);
+    match_app (iter->data, matcher, results);
+
+  g_object_unref (matcher);
 
   /* Note that a shorter term might have matched as a prefix, but
      when extended only as a substring, so we have to redo the
      sort rather than reusing the existing ordering */
-  return sort_and_concat_results (system, prefix_results, substring_results);
+  return sort_results (system, results);
 }
 
 /**
@@ -17,12 +17,6 @@
 #include "st.h"
 #include "gactionmuxer.h"
 
-typedef enum {
-  MATCH_NONE,
-  MATCH_SUBSTRING, /* Not prefix, substring */
-  MATCH_PREFIX, /* Strict prefix */
-} ShellAppSearchMatch;
-
 /* This is mainly a memory usage optimization - the user is going to
  * be running far fewer of the applications at one time than they have
  * installed.  But it also just helps keep the code more logically
@@ -1354,89 +1348,24 @@ shell_app_compare_by_name (ShellApp *app, ShellApp *other)
   return strcmp (app->name_collation_key, other->name_collation_key);
 }
 
-static ShellAppSearchMatch
-_shell_app_match_search_terms (ShellApp  *app,
-                               GSList    *terms)
-{
-  GSList *iter;
-  ShellAppSearchMatch match;
-
-  if (G_UNLIKELY (!app->casefolded_name))
-    shell_app_init_search_data (app);
-
-  match = MATCH_NONE;
-  for (iter = terms; iter; iter = iter->next)
-    {
-      ShellAppSearchMatch current_match;
-      const char *term = iter->data;
-      const char *p;
-
-      current_match = MATCH_NONE;
-
-      p = strstr (app->casefolded_name, term);
-      if (p != NULL)
-        {
-          if (p == app->casefolded_name || *(p - 1) == ' ')
-            current_match = MATCH_PREFIX;
-          else
-            current_match = MATCH_SUBSTRING;
-        }
-
-      if (app->casefolded_exec)
-        {
-          p = strstr (app->casefolded_exec, term);
-          if (p != NULL)
-            {
-              if (p == app->casefolded_exec || *(p - 1) == '-')
-                current_match = MATCH_PREFIX;
-              else if (current_match < MATCH_PREFIX)
-                current_match = MATCH_SUBSTRING;
-            }
-        }
-
-      if (app->casefolded_description && current_match < MATCH_PREFIX)
-        {
-          /* Only do substring matches, as prefix matches are not meaningful
-           * enough for descriptions
-           */
-          p = strstr (app->casefolded_description, term);
-          if (p != NULL)
-            current_match = MATCH_SUBSTRING;
-        }
-
-      if (app->casefolded_keywords)
-        {
-          int i = 0;
-          while (app->casefolded_keywords[i] && current_match < MATCH_PREFIX)
-            {
-              p = strstr (app->casefolded_keywords[i], term);
-              if (p != NULL)
-                {
-                  if (p == app->casefolded_keywords[i])
-                    current_match = MATCH_PREFIX;
-                  else
-                    current_match = MATCH_SUBSTRING;
-                }
-              ++i;
-            }
-        }
-
-      if (current_match == MATCH_NONE)
-        return current_match;
+/* Relative weights of the fields we search, in percent */
+#define NAME_MATCH_WEIGHT        100
+#define EXEC_MATCH_WEIGHT        100
+#define KEYWORD_MATCH_WEIGHT     90
+#define DESCRIPTION_MATCH_WEIGHT 100
 
-      if (current_match > match)
-        match = current_match;
-    }
-  return match;
-}
-
-void
-_shell_app_do_match (ShellApp         *app,
-                     GSList           *terms,
-                     GSList          **prefix_results,
-                     GSList          **substring_results)
+/*
+ * _shell_app_match:
+ * @app: a #ShellApp
+ * @matcher: the #ShellSearchMatcher for the current search
+ *
+ * Returns: the score of @app for the search, 0 if it doesn't match
+ * or shouldn't be shown in search results at all
+ */
+guint
+_shell_app_match (ShellApp           *app,
+                  ShellSearchMatcher *matcher)
 {
-  ShellAppSearchMatch match;
   GAppInfo *appinfo;
 
   g_assert (app != NULL);
@@ -1444,25 +1373,43 @@ _shell_app_do_match (ShellApp         *app,
   /* Skip window-backed apps */ 
   appinfo = (GAppInfo*)shell_app_get_app_info (app);
   if (appinfo == NULL)
-    return;
+    return 0;
   /* Skip not-visible apps */ 
   if (!g_app_info_should_show (appinfo))
-    return;
+    return 0;
+
+  if (G_UNLIKELY (!app->casefolded_name))
+    shell_app_init_search_data (app);
+
+  shell_search_matcher_begin (matcher);
+
+  shell_search_matcher_add_field (matcher, app->casefolded_name,
+                                  NAME_MATCH_WEIGHT,
+                                  SHELL_SEARCH_FIELD_NONE);
+  shell_search_matcher_add_field (matcher, app->casefolded_exec,
+                                  EXEC_MATCH_WEIGHT,
+                                  SHELL_SEARCH_FIELD_NO_FUZZY);
 
-  match = _shell_app_match_search_terms (app, terms);
-  switch (match)
+  if (app->casefolded_keywords)
     {
-      case MATCH_NONE:
-        break;
-      case MATCH_PREFIX:
-        *prefix_results = g_slist_prepend (*prefix_results, app);
-        break;
-      case MATCH_SUBSTRING:
-        *substring_results = g_slist_prepend (*substring_results, app);
-        break;
+      int i;
+
+      for (i = 0; app->casefolded_keywords[i]; i++)
+        shell_search_matcher_add_field (matcher, app->casefolded_keywords[i],
+                                        KEYWORD_MATCH_WEIGHT,
+                                        SHELL_SEARCH_FIELD_NONE);
     }
-}
 
+  /* Only do substring matches, as prefix matches are not meaningful
+   * enough for descriptions
+   */
+  shell_search_matcher_add_field (matcher, app->casefolded_description,
+                                  DESCRIPTION_MATCH_WEIGHT,
+                                  SHELL_SEARCH_FIELD_NO_PREFIX |
+                                  SHELL_SEARCH_FIELD_NO_FUZZY);
+
+  return shell_search_matcher_end (matcher);
+}
 
 static void
 shell_app_init (ShellApp *self)
@@ -12,15 +12,15 @@
 #include <folks/folks.h>
 
 #include "shell-global.h"
+#include "shell-search-matcher.h"
 #include "shell-util.h"
 #include "st.h"
 
 G_DEFINE_TYPE (ShellContactSystem, shell_contact_system, G_TYPE_OBJECT);
 
-#define NAME_PREFIX_MATCH_WEIGHT 100
-#define NAME_SUBSTRING_MATCH_WEIGHT 90
-#define ADDR_PREFIX_MATCH_WEIGHT 10
-#define ADDR_SUBSTRING_MATCH_WEIGHT 5
+/* Relative weights of the fields we search, in percent */
+#define NAME_MATCH_WEIGHT 100
+#define ADDR_MATCH_WEIGHT 10
 
 
 /* Callbacks */
@@ -90,173 +90,61 @@ shell_contact_system_class_init (ShellContactSystemClass *klass)
   g_type_class_add_private (object_class, sizeof (ShellContactSystemPrivate));
 }
 
-/*
- * normalize_terms:
- * @terms: (element-type utf8): Input search terms
- *
- * Returns: (element-type utf8) (transfer full): Unicode-normalized and lowercased terms
- */
-static GSList *
-normalize_terms (GSList *terms)
+static void
+add_address_fields (ShellSearchMatcher *matcher,
+                    GeeIterable        *addrs)
 {
-  GSList *normalized_terms = NULL;
-  GSList *iter;
-  for (iter = terms; iter; iter = iter->next)
+  GeeIterator *addrs_iter;
+
+  addrs_iter = gee_iterable_iterator (addrs);
+  while (gee_iterator_next (addrs_iter))
     {
-      const char *term = iter->data;
-      normalized_terms = g_slist_prepend (normalized_terms, shell_util_normalize_and_casefold (term));
+      FolksAbstractFieldDetails *field = gee_iterator_get (addrs_iter);
+
+      shell_search_matcher_add_field (matcher,
+                                      folks_abstract_field_details_get_value (field),
+                                      ADDR_MATCH_WEIGHT,
+                                      SHELL_SEARCH_FIELD_NORMALIZE |
+                                      SHELL_SEARCH_FIELD_NO_FUZZY);
+
+      g_object_unref (field);
     }
-  return normalized_terms;
+
+  g_object_unref (addrs_iter);
 }
 
 static guint
 do_match (ShellContactSystem  *self,
           FolksIndividual     *individual,
-          GSList              *terms)
+          ShellSearchMatcher  *matcher)
 {
-  GSList *term_iter;
-  guint weight = 0;
-
-  char *alias = shell_util_normalize_and_casefold (folks_alias_details_get_alias (FOLKS_ALIAS_DETAILS (individual)));
-  char *name = shell_util_normalize_and_casefold (folks_name_details_get_full_name (FOLKS_NAME_DETAILS (individual)));
-  char *nick = shell_util_normalize_and_casefold (folks_name_details_get_nickname (FOLKS_NAME_DETAILS (individual)));
-
   GeeMultiMap *im_addr_map = folks_im_details_get_im_addresses (FOLKS_IM_DETAILS (individual));
   GeeCollection *im_addrs = gee_multi_map_get_values (im_addr_map);
   GeeSet *email_addrs = folks_email_details_get_email_addresses (FOLKS_EMAIL_DETAILS (individual));
-  GeeIterator *addrs_iter;
 
-  gboolean have_name_prefix = FALSE;
-  gboolean have_name_substring = FALSE;
-  
-  gboolean have_addr_prefix = FALSE;
-  gboolean have_addr_substring = FALSE;
+  shell_search_matcher_begin (matcher);
+
+  /* Match on alias, name, nickname */
+  shell_search_matcher_add_field (matcher,
+                                  folks_alias_details_get_alias (FOLKS_ALIAS_DETAILS (individual)),
+                                  NAME_MATCH_WEIGHT,
+                                  SHELL_SEARCH_FIELD_NORMALIZE);
+  shell_search_matcher_add_field (matcher,
+                                  folks_name_details_get_full_name (FOLKS_NAME_DETAILS (individual)),
+                                  NAME_MATCH_WEIGHT,
+                                  SHELL_SEARCH_FIELD_NORMALIZE);
+  shell_search_matcher_add_field (matcher,
+                                  folks_name_details_get_nickname (FOLKS_NAME_DETAILS (individual)),
+                                  NAME_MATCH_WEIGHT,
+                                  SHELL_SEARCH_FIELD_NORMALIZE);
+
+  /* Match on one or more IM or email addresses */
+  add_address_fields (matcher, GEE_ITERABLE (im_addrs));
+  add_address_fields (matcher, GEE_ITERABLE (email_addrs));
 
-  for (term_iter = terms; term_iter; term_iter = term_iter->next)
-    {
-      const char *term = term_iter->data;
-      const char *p;
-      gboolean matched;
-
-      matched = FALSE;
-
-      /* Match on alias, name, nickname */
-      if (alias != NULL)
-	{
-	  p = strstr (alias, term);
-	  if (p == alias)
-            {
-	      have_name_prefix = TRUE;
-              matched = TRUE;
-            }
-	  else if (p != NULL)
-            {
-	      have_name_substring = TRUE;
-              matched = TRUE;
-            }
-	}
-      if (name != NULL)
-	{
-	  p = strstr (name, term);
-	  if (p == name)
-            {
-	      have_name_prefix = TRUE;
-              matched = TRUE;
-            }
-	  else if (p != NULL)
-            {
-	      have_name_substring = TRUE;
-              matched = TRUE;
-            }
-	}
-      if (nick != NULL)
-	{
-	  p = strstr (nick, term);
-	  if (p == nick)
-            {
-	      have_name_prefix = TRUE;
-              matched = TRUE;
-            }
-	  else if (p != NULL)
-            {
-	      have_name_substring = TRUE;
-              matched = TRUE;
-            }
-	}
-
-      /* Match on one or more IM or email addresses */
-      addrs_iter = gee_iterable_iterator (GEE_ITERABLE (im_addrs));
-
-      while (gee_iterator_next (addrs_iter))
-        {
-          FolksImFieldDetails *field = gee_iterator_get (addrs_iter);
-          const gchar *addr = folks_abstract_field_details_get_value ((FolksAbstractFieldDetails*)field);
-
-          p = strstr (addr, term);
-          if (p == addr)
-            {
-              have_addr_prefix = TRUE;
-              matched = TRUE;
-            }
-          else if (p != NULL)
-            {
-              have_addr_substring = TRUE;
-              matched = TRUE;
-            }
-
-          g_object_unref (field);
-        }
-
-      g_object_unref (addrs_iter);
-      addrs_iter = gee_iterable_iterator (GEE_ITERABLE (email_addrs));
-      while (gee_iterator_next (addrs_iter))
-        {
-          FolksEmailFieldDetails *field = gee_iterator_get (addrs_iter);
-          const gchar *addr = folks_abstract_field_details_get_value ((FolksAbstractFieldDetails*)field);
-
-          p = strstr (addr, term);
-          if (p == addr)
-            {
-              have_addr_prefix = TRUE;
-              matched = TRUE;
-            }
-          else if (p != NULL)
-            {
-              have_addr_substring = TRUE;
-              matched = TRUE;
-            }
-
-          g_object_unref (field);
-        }
-
-      g_object_unref (addrs_iter);
-
-      if (!matched)
-        {
-          have_name_prefix = FALSE;
-          have_name_substring = FALSE;
-          have_addr_prefix = FALSE;
-          have_addr_substring = FALSE;
-          break;
-        }
-    }
-
-    if (have_name_prefix)
-      weight += NAME_PREFIX_MATCH_WEIGHT;
-    else if (have_name_substring)
-      weight += NAME_SUBSTRING_MATCH_WEIGHT;
-
-    if (have_addr_prefix)
-      weight += ADDR_PREFIX_MATCH_WEIGHT;
-    else if (have_addr_substring)
-      weight += ADDR_SUBSTRING_MATCH_WEIGHT;
-
-  g_free (alias);
-  g_free (name);
-  g_free (nick);
   g_object_unref (im_addrs);
 
-  return weight;
+  return shell_search_matcher_end (matcher);
 }
 
 static gint
@@ -436,10 +324,11 @@ shell_contact_system_initial_search (ShellContactSystem *self,
   GeeMapIterator *iter;
   gpointer key;
   guint weight;
-  GSList *normalized_terms = normalize_terms (terms);
+  ShellSearchMatcher *matcher;
 
   g_return_val_if_fail (SHELL_IS_CONTACT_SYSTEM (self), NULL);
 
+  matcher = shell_search_matcher_new (terms);
   individuals = folks_individual_aggregator_get_individuals (self->priv->aggregator);
 
   iter = gee_map_map_iterator (individuals);
@@ -447,7 +336,7 @@ shell_contact_system_initial_search (ShellContactSystem *self,
   while (gee_map_iterator_next (iter))
     {
       individual = gee_map_iterator_get_value (iter);
-      weight = do_match (self, individual, normalized_terms);
+      weight = do_match (self, individual, matcher);
 
       if (weight != 0)
         {
@@ -463,6 +352,9 @@ shell_contact_system_initial_search (ShellContactSystem *self,
       g_object_unref (individual);
     }
 
+  g_object_unref (iter);
+  g_object_unref (matcher);
+
   return sort_and_prepare_results (results);
 }
 
@@ -0,0 +1,14 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_FRAME_TIMINGS_PRIVATE_H__
+#define __SHELL_FRAME_TIMINGS_PRIVATE_H__
+
+#include <clutter/clutter.h>
+
+#include "shell-frame-timings.h"
+
+ShellFrameTimings *_shell_frame_timings_new           (ClutterStage      *stage);
+
+void               _shell_frame_timings_swap_complete (ShellFrameTimings *timings,
+                                                       gint64             ust);
+
+#endif /* __SHELL_FRAME_TIMINGS_PRIVATE_H__ */
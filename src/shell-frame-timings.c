@@ -0,0 +1,400 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "shell-frame-timings-private.h"
+
+/* Number of frames we keep the detailed timings of */
+#define N_RECENT_FRAMES 120
+
+/* Swap completion timestamps further away than this from when we
+ * finished the frame are assumed to come from a different clock */
+#define MAX_PRESENTATION_DELAY_USEC G_USEC_PER_SEC
+
+/* All times are from g_get_monotonic_time(), in microseconds. Clutter
+ * processes the queued events, runs the pre-paint repaint functions,
+ * relayouts, paints and swaps the buffers in that order within one
+ * master clock dispatch; we can't hook the relayout directly, so it is
+ * measured as the time between the pre-paint functions and the start
+ * of the paint.
+ */
+typedef struct {
+  gint64 dispatch_start;  /* first event dispatched for the frame */
+  gint64 layout_start;    /* pre-paint repaint functions */
+  gint64 paint_start;
+  gint64 paint_end;
+  gint64 frame_end;       /* buffer swap returned */
+  gint64 presented;       /* swap completion event, or 0 */
+
+  gint64 input_time;      /* oldest key or button press shown by the frame, or 0 */
+} FrameRecord;
+
+struct _ShellFrameTimingsClass
+{
+  GObjectClass parent_class;
+};
+
+struct _ShellFrameTimings
+{
+  GObject parent_instance;
+
+  ClutterStage *stage;
+  guint pre_paint_id;
+  guint post_paint_id;
+
+  FrameRecord frames[N_RECENT_FRAMES];
+  guint next_frame;
+  guint n_recent_frames;
+  guint n_unpresented;
+  gboolean have_swap_events;
+
+  FrameRecord current;
+  gboolean in_frame;
+  gboolean painted;
+
+  gint64 first_event_time;
+  gint64 first_input_time;
+  gint64 refresh_interval;
+
+  guint64 n_frames;
+  guint64 n_dropped_frames;
+  guint64 n_input_events;
+  gint64 input_latency_total;
+  gint64 input_latency_max;
+  gint64 input_latency_last;
+};
+
+G_DEFINE_TYPE(ShellFrameTimings, shell_frame_timings, G_TYPE_OBJECT);
+
+static void
+shell_frame_timings_init (ShellFrameTimings *timings)
+{
+  timings->refresh_interval = G_USEC_PER_SEC / MAX (clutter_get_default_frame_rate (), 1);
+}
+
+static void
+shell_frame_timings_finalize (GObject *object)
+{
+  ShellFrameTimings *timings = SHELL_FRAME_TIMINGS (object);
+
+  clutter_threads_remove_repaint_func (timings->pre_paint_id);
+  clutter_threads_remove_repaint_func (timings->post_paint_id);
+
+  g_signal_handlers_disconnect_matched (timings->stage, G_SIGNAL_MATCH_DATA,
+                                        0, 0, NULL, NULL, timings);
+  g_object_unref (timings->stage);
+
+  G_OBJECT_CLASS (shell_frame_timings_parent_class)->finalize (object);
+}
+
+static void
+shell_frame_timings_class_init (ShellFrameTimingsClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = shell_frame_timings_finalize;
+}
+
+static void
+record_input_latency (ShellFrameTimings *timings,
+                      gint64             input_time,
+                      gint64             shown_time)
+{
+  gint64 latency = shown_time - input_time;
+
+  timings->n_input_events++;
+  timings->input_latency_total += latency;
+  timings->input_latency_max = MAX (timings->input_latency_max, latency);
+  timings->input_latency_last = latency;
+}
+
+static gboolean
+on_stage_captured_event (ClutterActor      *stage,
+                         ClutterEvent      *event,
+                         ShellFrameTimings *timings)
+{
+  ClutterEventType type = clutter_event_type (event);
+  gint64 now = g_get_monotonic_time ();
+
+  if (timings->first_event_time == 0)
+    timings->first_event_time = now;
+
+  if ((type == CLUTTER_KEY_PRESS || type == CLUTTER_BUTTON_PRESS) &&
+      timings->first_input_time == 0)
+    timings->first_input_time = now;
+
+  return FALSE;
+}
+
+static gboolean
+frame_pre_paint (gpointer data)
+{
+  ShellFrameTimings *timings = data;
+  gint64 now = g_get_monotonic_time ();
+
+  memset (&timings->current, 0, sizeof (FrameRecord));
+  timings->current.layout_start = now;
+  timings->current.dispatch_start = timings->first_event_time ? timings->first_event_time : now;
+  timings->current.input_time = timings->first_input_time;
+
+  timings->first_event_time = 0;
+  timings->first_input_time = 0;
+
+  timings->in_frame = TRUE;
+  timings->painted = FALSE;
+
+  return TRUE;
+}
+
+static void
+on_stage_paint (ClutterActor      *stage,
+                ShellFrameTimings *timings)
+{
+  /* The stage can also be painted outside of the master clock, for
+   * example to pick; those aren't frames */
+  if (timings->in_frame && timings->current.paint_start == 0)
+    timings->current.paint_start = g_get_monotonic_time ();
+}
+
+static void
+on_stage_paint_after (ClutterActor      *stage,
+                      ShellFrameTimings *timings)
+{
+  if (timings->in_frame && timings->current.paint_start != 0)
+    {
+      timings->current.paint_end = g_get_monotonic_time ();
+      timings->painted = TRUE;
+    }
+}
+
+static FrameRecord *
+get_recent_frame (ShellFrameTimings *timings,
+                  guint              age)
+{
+  return &timings->frames[(timings->next_frame + N_RECENT_FRAMES - 1 - age) % N_RECENT_FRAMES];
+}
+
+static gboolean
+frame_post_paint (gpointer data)
+{
+  ShellFrameTimings *timings = data;
+  FrameRecord *frame;
+
+  if (!timings->in_frame)
+    return TRUE;
+
+  timings->in_frame = FALSE;
+
+  /* Events that didn't lead to a redraw don't count toward the input
+   * latency; there were no pixels to wait for */
+  if (!timings->painted)
+    return TRUE;
+
+  timings->current.frame_end = g_get_monotonic_time ();
+
+  /* If this frame was started right after the previous one, we were
+   * drawing continuously and it should have come one refresh interval
+   * later; anything beyond that are frames we missed */
+  if (timings->n_recent_frames > 0)
+    {
+      FrameRecord *previous = get_recent_frame (timings, 0);
+
+      if (timings->current.dispatch_start - previous->frame_end < timings->refresh_interval)
+        {
+          gint64 interval = timings->current.frame_end - previous->frame_end;
+          gint64 n_intervals = (interval + timings->refresh_interval / 2) / timings->refresh_interval;
+
+          if (n_intervals > 1)
+            timings->n_dropped_frames += n_intervals - 1;
+        }
+    }
+
+  frame = &timings->frames[timings->next_frame];
+  *frame = timings->current;
+  timings->next_frame = (timings->next_frame + 1) % N_RECENT_FRAMES;
+  timings->n_recent_frames = MIN (timings->n_recent_frames + 1, N_RECENT_FRAMES);
+  timings->n_frames++;
+
+  /* Without swap events, the end of the frame is the best guess we
+   * have of when it reached the screen */
+  if (timings->have_swap_events)
+    timings->n_unpresented = MIN (timings->n_unpresented + 1, N_RECENT_FRAMES);
+  else if (frame->input_time != 0)
+    record_input_latency (timings, frame->input_time, frame->frame_end);
+
+  return TRUE;
+}
+
+ShellFrameTimings *
+_shell_frame_timings_new (ClutterStage *stage)
+{
+  ShellFrameTimings *timings = g_object_new (SHELL_TYPE_FRAME_TIMINGS, NULL);
+
+  timings->stage = g_object_ref (stage);
+
+  timings->pre_paint_id =
+    clutter_threads_add_repaint_func_full (CLUTTER_REPAINT_FLAGS_PRE_PAINT,
+                                           frame_pre_paint, timings, NULL);
+  timings->post_paint_id =
+    clutter_threads_add_repaint_func_full (CLUTTER_REPAINT_FLAGS_POST_PAINT,
+                                           frame_post_paint, timings, NULL);
+
+  g_signal_connect (stage, "captured-event",
+                    G_CALLBACK (on_stage_captured_event), timings);
+  g_signal_connect (stage, "paint",
+                    G_CALLBACK (on_stage_paint), timings);
+  g_signal_connect_after (stage, "paint",
+                          G_CALLBACK (on_stage_paint_after), timings);
+
+  return timings;
+}
+
+/* Called from gnome-shell-plugin.c when a GLX_INTEL_swap_event arrives;
+ * @ust is the time the swap completed, in microseconds */
+void
+_shell_frame_timings_swap_complete (ShellFrameTimings *timings,
+                                    gint64             ust)
+{
+  FrameRecord *frame;
+
+  if (!timings->have_swap_events)
+    {
+      /* Frames finished until now were already accounted for */
+      timings->have_swap_events = TRUE;
+      return;
+    }
+
+  if (timings->n_unpresented == 0)
+    return;
+
+  frame = get_recent_frame (timings, timings->n_unpresented - 1);
+  timings->n_unpresented--;
+
+  if (ABS (ust - frame->frame_end) > MAX_PRESENTATION_DELAY_USEC)
+    return;
+
+  frame->presented = ust;
+
+  if (frame->input_time != 0)
+    record_input_latency (timings, frame->input_time, frame->presented);
+}
+
+/**
+ * shell_frame_timings_get_stats:
+ * @timings: a #ShellFrameTimings
+ *
+ * Gets a summary of the frame timings. The dictionary contains the
+ * counters since the shell started:
+ *
+ * "frames" (t), "dropped-frames" (t) and "input-events" (t), the
+ * number of key and button presses the latency was measured for.
+ *
+ * And, in microseconds, as int64 (x):
+ *
+ * "input-latency-mean", "input-latency-max", "input-latency-last":
+ * time from dispatching a key or button press to the next frame
+ * being shown.
+ *
+ * "dispatch-mean", "layout-mean", "paint-mean", "swap-mean" and
+ * "frame-time-mean", "frame-time-max": durations of the phases of
+ * the recent frames, and of the recent frames as a whole.
+ *
+ * "refresh-interval": the expected time between two frames.
+ *
+ * Return value: (transfer full): a #GVariant of type a{sv}
+ */
+GVariant *
+shell_frame_timings_get_stats (ShellFrameTimings *timings)
+{
+  GVariantBuilder builder;
+  gint64 dispatch = 0, layout = 0, paint = 0, swap = 0, total = 0, total_max = 0;
+  guint n = timings->n_recent_frames;
+  guint i;
+
+  g_return_val_if_fail (SHELL_IS_FRAME_TIMINGS (timings), NULL);
+
+  for (i = 0; i < n; i++)
+    {
+      FrameRecord *frame = get_recent_frame (timings, i);
+      gint64 end = frame->presented ? frame->presented : frame->frame_end;
+
+      dispatch += frame->layout_start - frame->dispatch_start;
+      layout += frame->paint_start - frame->layout_start;
+      paint += frame->paint_end - frame->paint_start;
+      swap += end - frame->paint_end;
+      total += end - frame->dispatch_start;
+      total_max = MAX (total_max, end - frame->dispatch_start);
+    }
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+
+  g_variant_builder_add (&builder, "{sv}", "frames",
+                         g_variant_new_uint64 (timings->n_frames));
+  g_variant_builder_add (&builder, "{sv}", "dropped-frames",
+                         g_variant_new_uint64 (timings->n_dropped_frames));
+  g_variant_builder_add (&builder, "{sv}", "input-events",
+                         g_variant_new_uint64 (timings->n_input_events));
+  g_variant_builder_add (&builder, "{sv}", "input-latency-mean",
+                         g_variant_new_int64 (timings->n_input_events > 0 ?
+                                              timings->input_latency_total / (gint64) timings->n_input_events : 0));
+  g_variant_builder_add (&builder, "{sv}", "input-latency-max",
+                         g_variant_new_int64 (timings->input_latency_max));
+  g_variant_builder_add (&builder, "{sv}", "input-latency-last",
+                         g_variant_new_int64 (timings->input_latency_last));
+  g_variant_builder_add (&builder, "{sv}", "dispatch-mean",
+                         g_variant_new_int64 (n > 0 ? dispatch / n : 0));
+  g_variant_builder_add (&builder, "{sv}", "layout-mean",
+                         g_variant_new_int64 (n > 0 ? layout / n : 0));
+  g_variant_builder_add (&builder, "{sv}", "paint-mean",
+                         g_variant_new_int64 (n > 0 ? paint / n : 0));
+  g_variant_builder_add (&builder, "{sv}", "swap-mean",
+                         g_variant_new_int64 (n > 0 ? swap / n : 0));
+  g_variant_builder_add (&builder, "{sv}", "frame-time-mean",
+                         g_variant_new_int64 (n > 0 ? total / n : 0));
+  g_variant_builder_add (&builder, "{sv}", "frame-time-max",
+                         g_variant_new_int64 (total_max));
+  g_variant_builder_add (&builder, "{sv}", "refresh-interval",
+                         g_variant_new_int64 (timings->refresh_interval));
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+/**
+ * shell_frame_timings_get_recent_frames:
+ * @timings: a #ShellFrameTimings
+ *
+ * Gets the timestamps of the most recent frames, oldest first. Each
+ * frame is a tuple of monotonic times in microseconds: the start of
+ * event dispatch, the start of relayout, the start and end of the
+ * paint, the end of the buffer swap, and the time the frame was shown
+ * on screen (0 if the driver doesn't tell us).
+ *
+ * Return value: (transfer full): a #GVariant of type a(xxxxxx)
+ */
+GVariant *
+shell_frame_timings_get_recent_frames (ShellFrameTimings *timings)
+{
+  GVariantBuilder builder;
+  int i;
+
+  g_return_val_if_fail (SHELL_IS_FRAME_TIMINGS (timings), NULL);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(xxxxxx)"));
+
+  for (i = timings->n_recent_frames - 1; i >= 0; i--)
+    {
+      FrameRecord *frame = get_recent_frame (timings, i);
+
+      g_variant_builder_add (&builder, "(xxxxxx)",
+                             frame->dispatch_start,
+                             frame->layout_start,
+                             frame->paint_start,
+                             frame->paint_end,
+                             frame->frame_end,
+                             frame->presented);
+    }
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
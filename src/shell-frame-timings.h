@@ -0,0 +1,39 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_FRAME_TIMINGS_H__
+#define __SHELL_FRAME_TIMINGS_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/**
+ * SECTION:shell-frame-timings
+ * @short_description: Always-on frame health statistics
+ *
+ * #ShellFrameTimings records, for every frame drawn by the stage, when
+ * event dispatch, relayout, painting and the buffer swap happened. It
+ * also keeps counters of dropped frames and of the latency between a
+ * key or button press being dispatched and the next frame reaching the
+ * screen. Unlike #ShellPerfLog, it is always enabled and cheap enough
+ * to leave running; the instance is available as the
+ * #ShellGlobal:frame-timings property.
+ */
+
+typedef struct _ShellFrameTimings ShellFrameTimings;
+typedef struct _ShellFrameTimingsClass ShellFrameTimingsClass;
+
+#define SHELL_TYPE_FRAME_TIMINGS              (shell_frame_timings_get_type ())
+#define SHELL_FRAME_TIMINGS(object)           (G_TYPE_CHECK_INSTANCE_CAST ((object), SHELL_TYPE_FRAME_TIMINGS, ShellFrameTimings))
+#define SHELL_FRAME_TIMINGS_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST ((klass), SHELL_TYPE_FRAME_TIMINGS, ShellFrameTimingsClass))
+#define SHELL_IS_FRAME_TIMINGS(object)        (G_TYPE_CHECK_INSTANCE_TYPE ((object), SHELL_TYPE_FRAME_TIMINGS))
+#define SHELL_IS_FRAME_TIMINGS_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE ((klass), SHELL_TYPE_FRAME_TIMINGS))
+#define SHELL_FRAME_TIMINGS_GET_CLASS(obj)    (G_TYPE_INSTANCE_GET_CLASS ((obj), SHELL_TYPE_FRAME_TIMINGS, ShellFrameTimingsClass))
+
+GType shell_frame_timings_get_type (void) G_GNUC_CONST;
+
+GVariant *shell_frame_timings_get_stats         (ShellFrameTimings *timings);
+GVariant *shell_frame_timings_get_recent_frames (ShellFrameTimings *timings);
+
+G_END_DECLS
+
+#endif /* __SHELL_FRAME_TIMINGS_H__ */
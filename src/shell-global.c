@@ -35,6 +35,7 @@
 #include "shell-enum-types.h"
 #include "shell-global-private.h"
 #include "shell-jsapi-compat-private.h"
+#include "shell-frame-timings-private.h"
 #include "shell-perf-log.h"
 #include "shell-window-tracker.h"
 #include "shell-wm.h"
@@ -45,6 +46,23 @@ static ShellGlobal *the_object = NULL;
 static void grab_notify (GtkWidget *widget, gboolean is_grab, gpointer user_data);
 static void shell_global_on_gc (GjsContext   *context,
                                 ShellGlobal  *global);
+static void shell_global_gc_after_frame (ShellGlobal *global);
+static void shell_global_gc_queue_idle (ShellGlobal *global);
+
+/* Garbage collection scheduling; see shell_global_gc_after_frame().
+ *
+ * We collect while frames are being drawn only if the collection is
+ * expected to fit in this budget...
+ */
+#define GC_FRAME_BUDGET_USEC 4000
+/* ... and only if the heap will have grown this much (or by half of
+ * what was live after the last collection, if that's more) within
+ * the idle delay below at the current allocation rate. */
+#define GC_FRAME_MIN_GROWTH (8 * 1024 * 1024)
+/* Otherwise we wait for this long without any frames... */
+#define GC_IDLE_DELAY_MSEC 1500
+/* ... and then collect, if the heap grew at least this much */
+#define GC_IDLE_MIN_GROWTH (256 * 1024)
 
 struct _ShellGlobal {
   GObject parent;
@@ -72,6 +90,9 @@ struct _ShellGlobal {
 
   ShellStageInputMode input_mode;
   XserverRegion input_region;
+  /* The rectangles input_region was last set to */
+  XRectangle *input_rects;
+  int n_input_rects;
 
   GjsContext *js_context;
   MetaPlugin *plugin;
@@ -81,6 +102,7 @@ struct _ShellGlobal {
   const char *imagedir;
   const char *userdatadir;
   StFocusManager *focus_manager;
+  ShellFrameTimings *frame_timings;
 
   guint work_count;
   GSList *leisure_closures;
@@ -92,6 +114,16 @@ struct _ShellGlobal {
   guint32 xdnd_timestamp;
 
   gint64 last_gc_end_time;
+
+  /* Garbage collection scheduling */
+  gint64 last_frame_time;
+  gint64 last_js_bytes_time;
+  gsize last_js_bytes;
+  gsize js_bytes_after_gc;
+  double js_alloc_rate; /* bytes per second */
+  double gc_usec_per_byte; /* < 0 if we don't know yet */
+  guint frame_gc_id;
+  guint idle_gc_id;
 };
 
 enum {
@@ -114,6 +146,7 @@ enum {
   PROP_IMAGEDIR,
   PROP_USERDATADIR,
   PROP_FOCUS_MANAGER,
+  PROP_FRAME_TIMINGS,
 };
 
 /* Signals */
@@ -223,6 +256,9 @@ shell_global_get_property(GObject         *object,
     case PROP_FOCUS_MANAGER:
       g_value_set_object (value, global->focus_manager);
       break;
+    case PROP_FRAME_TIMINGS:
+      g_value_set_object (value, global->frame_timings);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -279,6 +315,8 @@ shell_global_init (ShellGlobal *global)
                                      NULL);
   g_signal_connect (global->js_context, "gc", G_CALLBACK (shell_global_on_gc), global);
 
+  global->gc_usec_per_byte = -1;
+
   g_strfreev (search_path);
 }
 
@@ -287,8 +325,14 @@ shell_global_finalize (GObject *object)
 {
   ShellGlobal *global = SHELL_GLOBAL (object);
 
+  if (global->frame_gc_id)
+    g_source_remove (global->frame_gc_id);
+  if (global->idle_gc_id)
+    g_source_remove (global->idle_gc_id);
+
   g_object_unref (global->js_context);
   gtk_widget_destroy (GTK_WIDGET (global->grab_notifier));
+  g_free (global->input_rects);
   g_object_unref (global->settings);
 
   the_object = NULL;
@@ -467,6 +511,13 @@ shell_global_class_init (ShellGlobalClass *klass)
                                                         "The shell's StFocusManager",
                                                         ST_TYPE_FOCUS_MANAGER,
                                                         G_PARAM_READABLE));
+  g_object_class_install_property (gobject_class,
+                                   PROP_FRAME_TIMINGS,
+                                   g_param_spec_object ("frame-timings",
+                                                        "Frame timings",
+                                                        "Timing statistics of the frames drawn by the stage",
+                                                        SHELL_TYPE_FRAME_TIMINGS,
+                                                        G_PARAM_READABLE));
 }
 
 /**•
@@ -672,7 +723,8 @@ shell_global_unset_cursor (ShellGlobal  *global)
  *
  * Sets the area of the stage that is responsive to mouse clicks when
  * the stage mode is %SHELL_STAGE_INPUT_MODE_NORMAL (but does not change the
- * current stage mode).
+ * current stage mode). Setting the same rectangles again is cheap and
+ * doesn't cause any X requests.
  */
 void
 shell_global_set_stage_input_region (ShellGlobal *global,
@@ -696,11 +748,23 @@ shell_global_set_stage_input_region (ShellGlobal *global,
       rects[i].height = rect->height;
     }
 
+  if (global->input_region &&
+      nrects == global->n_input_rects &&
+      (nrects == 0 ||
+       memcmp (rects, global->input_rects, nrects * sizeof (XRectangle)) == 0))
+    {
+      g_free (rects);
+      return;
+    }
+
   if (global->input_region)
-    XFixesDestroyRegion (global->xdisplay, global->input_region);
+    XFixesSetRegion (global->xdisplay, global->input_region, rects, nrects);
+  else
+    global->input_region = XFixesCreateRegion (global->xdisplay, rects, nrects);
 
-  global->input_region = XFixesCreateRegion (global->xdisplay, rects, nrects);
-  g_free (rects);
+  g_free (global->input_rects);
+  global->input_rects = rects;
+  global->n_input_rects = nrects;
 
   /* set_stage_input_mode() will figure out whether or not we
    * should actually change the input region right now.
@@ -803,6 +867,8 @@ global_stage_after_paint (ClutterStage *stage,
 {
   shell_perf_log_event (shell_perf_log_get_default (),
                         "clutter.stagePaintDone");
+
+  shell_global_gc_after_frame (global);
 }
 
 static void
@@ -1034,6 +1100,8 @@ _shell_global_set_plugin (ShellGlobal *global,
   g_signal_connect (global->stage, "notify::height",
                     G_CALLBACK (global_stage_notify_height), global);
 
+  global->frame_timings = _shell_frame_timings_new (global->stage);
+
   g_signal_connect (global->stage, "paint",
                     G_CALLBACK (global_stage_before_paint), global);
   g_signal_connect_after (global->stage, "paint",
@@ -1047,6 +1115,10 @@ _shell_global_set_plugin (ShellGlobal *global,
                                "clutter.stagePaintDone",
                                "End of stage page repaint",
                                "");
+  shell_perf_log_define_event (shell_perf_log_get_default(),
+                               "gjs.gcPause",
+                               "Garbage collection started by the shell; argument is its duration in microseconds",
+                               "x");
 
   g_signal_connect (global->meta_display, "notify::focus-window",
                     G_CALLBACK (focus_window_changed), global);
@@ -1285,6 +1357,42 @@ shell_global_reexec_self (ShellGlobal *global)
   g_ptr_array_free (arr, TRUE);
 }
 
+static gsize
+get_js_bytes (ShellGlobal *global)
+{
+  JSContext *context = gjs_context_get_native_context (global->js_context);
+
+  return JS_GetGCParameter (JS_GetRuntime (context), JSGC_BYTES);
+}
+
+/* Runs a full collection, keeping track of how long it takes */
+static void
+run_gc (ShellGlobal *global)
+{
+  gint64 start, pause;
+  gsize js_bytes;
+  double usec_per_byte;
+
+  js_bytes = get_js_bytes (global);
+  start = g_get_monotonic_time ();
+
+  gjs_context_gc (global->js_context);
+
+  pause = g_get_monotonic_time () - start;
+  shell_perf_log_event_x (shell_perf_log_get_default (),
+                          "gjs.gcPause", pause);
+
+  /* The time to collect mostly depends on the size of the heap */
+  if (js_bytes > 0)
+    {
+      usec_per_byte = (double) pause / js_bytes;
+      if (global->gc_usec_per_byte < 0)
+        global->gc_usec_per_byte = usec_per_byte;
+      else
+        global->gc_usec_per_byte = 0.75 * global->gc_usec_per_byte + 0.25 * usec_per_byte;
+    }
+}
+
 /**
  * shell_global_gc:
  * @global: A #ShellGlobal
@@ -1295,9 +1403,7 @@ shell_global_reexec_self (ShellGlobal *global)
 void
 shell_global_gc (ShellGlobal *global)
 {
-  JSContext *context = gjs_context_get_native_context (global->js_context);
-
-  JS_GC (context);
+  run_gc (global);
 }
 
 /**
@@ -1319,6 +1425,116 @@ shell_global_on_gc (GjsContext   *context,
                     ShellGlobal  *global)
 {
   global->last_gc_end_time = g_get_monotonic_time ();
+
+  /* This is called for collections SpiderMonkey starts by itself, too */
+  global->js_bytes_after_gc = get_js_bytes (global);
+  global->last_js_bytes = global->js_bytes_after_gc;
+  global->last_js_bytes_time = global->last_gc_end_time;
+}
+
+static gboolean
+run_frame_gc (gpointer data)
+{
+  ShellGlobal *global = data;
+
+  global->frame_gc_id = 0;
+  run_gc (global);
+
+  return FALSE;
+}
+
+static gboolean
+run_idle_gc (gpointer data)
+{
+  ShellGlobal *global = data;
+  gint64 idle_time;
+
+  global->idle_gc_id = 0;
+
+  /* Wait until there were no frames for the whole delay */
+  idle_time = (g_get_monotonic_time () - global->last_frame_time) / 1000;
+  if (idle_time < GC_IDLE_DELAY_MSEC)
+    {
+      global->idle_gc_id = g_timeout_add (GC_IDLE_DELAY_MSEC - idle_time,
+                                          run_idle_gc, global);
+      return FALSE;
+    }
+
+  if (global->work_count > 0)
+    return FALSE;
+
+  if (get_js_bytes (global) >= global->js_bytes_after_gc + GC_IDLE_MIN_GROWTH)
+    run_gc (global);
+
+  return FALSE;
+}
+
+/* Makes sure a collection happens once we are idle for a while */
+static void
+shell_global_gc_queue_idle (ShellGlobal *global)
+{
+  if (global->idle_gc_id == 0)
+    global->idle_gc_id = g_timeout_add (GC_IDLE_DELAY_MSEC,
+                                        run_idle_gc, global);
+}
+
+/*
+ * shell_global_gc_after_frame:
+ *
+ * We used to do a full collection every time the shell went idle,
+ * which is often right when the user starts doing something again;
+ * with a large heap that's a noticeable pause. SpiderMonkey can't
+ * collect incrementally, so instead we track how fast the heap grows
+ * and how long collections take relative to its size. During
+ * animations we only collect after a frame, and only when the heap
+ * is about to grow a lot and the collection is expected to fit in a
+ * small part of a frame; everything else waits until no frames have
+ * been drawn for a while.
+ */
+static void
+shell_global_gc_after_frame (ShellGlobal *global)
+{
+  gint64 now;
+  gsize js_bytes, growth, max_growth;
+  double expected_growth, expected_pause, rate;
+
+  now = g_get_monotonic_time ();
+  global->last_frame_time = now;
+
+  js_bytes = get_js_bytes (global);
+
+  if (global->last_js_bytes_time > 0 && now > global->last_js_bytes_time &&
+      js_bytes >= global->last_js_bytes)
+    {
+      rate = (double) (js_bytes - global->last_js_bytes) * G_USEC_PER_SEC /
+             (now - global->last_js_bytes_time);
+      global->js_alloc_rate = 0.9 * global->js_alloc_rate + 0.1 * rate;
+    }
+  global->last_js_bytes = js_bytes;
+  global->last_js_bytes_time = now;
+
+  if (js_bytes <= global->js_bytes_after_gc)
+    return;
+
+  growth = js_bytes - global->js_bytes_after_gc;
+  if (growth >= GC_IDLE_MIN_GROWTH)
+    shell_global_gc_queue_idle (global);
+
+  if (global->frame_gc_id != 0 || global->gc_usec_per_byte < 0)
+    return;
+
+  max_growth = MAX (GC_FRAME_MIN_GROWTH, global->js_bytes_after_gc / 2);
+  expected_growth = growth + global->js_alloc_rate * GC_IDLE_DELAY_MSEC / 1000;
+  if (expected_growth < max_growth)
+    return;
+
+  expected_pause = global->gc_usec_per_byte * js_bytes;
+  if (expected_pause > GC_FRAME_BUDGET_USEC)
+    return;
+
+  /* Collect right after the frame is done, rather than delaying it */
+  global->frame_gc_id = g_idle_add_full (G_PRIORITY_DEFAULT,
+                                         run_frame_gc, global, NULL);
 }
 
 /**
@@ -1514,6 +1730,20 @@ shell_global_get_settings (ShellGlobal *global)
   return global->settings;
 }
 
+/**
+ * shell_global_get_frame_timings:
+ * @global: A #ShellGlobal
+ *
+ * Get the object recording the timings of the frames drawn by the stage.
+ *
+ * Return value: (transfer none): The #ShellFrameTimings object
+ */
+ShellFrameTimings *
+shell_global_get_frame_timings (ShellGlobal *global)
+{
+  return global->frame_timings;
+}
+
 /**
  * shell_global_get_current_time:
  * @global: A #ShellGlobal
@@ -1605,12 +1835,11 @@ run_leisure_functions (gpointer data)
   if (global->work_count > 0)
     return FALSE;
 
-  /* Previously we called gjs_maybe_gc().  However, it simply doesn't
-   * trigger often enough.  Garbage collection is very fast here, so
-   * let's just aggressively GC.  This will help avoid both heap
-   * fragmentation, and the GC kicking in when we don't want it to.
+  /* We used to collect garbage here, but going idle by our own
+   * accounting doesn't mean the user isn't about to do something;
+   * collect once nothing has been drawn for a while instead.
    */
-  gjs_context_gc (global->js_context);
+  shell_global_gc_queue_idle (global);
 
   /* No leisure closures, so we are done */
   if (global->leisure_closures == NULL)
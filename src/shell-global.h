@@ -8,6 +8,8 @@
 #include <gtk/gtk.h>
 #include <meta/meta-plugin.h>
 
+#include "shell-frame-timings.h"
+
 G_BEGIN_DECLS
 
 typedef struct _ShellGlobal      ShellGlobal;
@@ -35,6 +37,7 @@ GdkScreen     *shell_global_get_gdk_screen            (ShellGlobal *global);
 MetaDisplay   *shell_global_get_display               (ShellGlobal *global);
 GList         *shell_global_get_window_actors         (ShellGlobal *global);
 GSettings     *shell_global_get_settings              (ShellGlobal *global);
+ShellFrameTimings *shell_global_get_frame_timings     (ShellGlobal *global);
 guint32        shell_global_get_current_time          (ShellGlobal *global);
 
 
@@ -0,0 +1,574 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "shell-image-encoder.h"
+
+/* The image is split into strips of this many rows; each strip is
+ * compressed independently on the thread pool and the results are
+ * written out in order.
+ *
+ * For PNG, each strip becomes an independent raw deflate stream
+ * terminated with a sync flush, which can be concatenated into a
+ * single zlib stream (this is the same trick pigz uses); the
+ * checksums of the strips are combined with adler32_combine().
+ *
+ * For QOI, each strip starts with a full RGBA pixel and only uses
+ * color index entries that it wrote itself, so the strips can be
+ * decoded as one continuous stream by any decoder.
+ */
+#define STRIP_HEIGHT 128
+#define MAX_THREADS 8
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xc0
+#define QOI_OP_RGB   0xfe
+#define QOI_OP_RGBA  0xff
+#define QOI_HASH(p)  (((p)[0] * 3 + (p)[1] * 5 + (p)[2] * 7 + (p)[3] * 11) % 64)
+
+typedef struct _EncodeJob EncodeJob;
+
+typedef struct {
+  EncodeJob *job;
+
+  int first_row;
+  int n_rows;
+
+  GByteArray *output;
+  /* PNG only: checksum and size of the uncompressed strip */
+  guint32 adler;
+  gsize input_len;
+
+  gboolean done;
+  gboolean failed;
+} EncodeStrip;
+
+struct _EncodeJob {
+  ShellImageEncoding encoding;
+  int compression_level;
+
+  const guchar *data;
+  int width;
+  int height;
+  int stride;
+  gboolean has_alpha;
+
+  EncodeStrip *strips;
+  int n_strips;
+
+  GMutex lock;
+  GCond cond;
+};
+
+static inline void
+get_pixel (const EncodeJob *job,
+           const guchar    *row,
+           int              x,
+           guchar          *px)
+{
+  guint32 pixel = ((const guint32 *) row)[x];
+  guint r = (pixel >> 16) & 0xff;
+  guint g = (pixel >> 8) & 0xff;
+  guint b = pixel & 0xff;
+  guint a = job->has_alpha ? pixel >> 24 : 0xff;
+
+  /* Cairo uses premultiplied alpha, PNG and QOI don't */
+  if (a != 0xff && a != 0)
+    {
+      r = (r * 255 + a / 2) / a;
+      g = (g * 255 + a / 2) / a;
+      b = (b * 255 + a / 2) / a;
+    }
+
+  px[0] = r;
+  px[1] = g;
+  px[2] = b;
+  px[3] = a;
+}
+
+static void
+convert_row (const EncodeJob *job,
+             int              y,
+             guchar          *out)
+{
+  const guchar *row = job->data + y * job->stride;
+  guchar px[4];
+  int x;
+
+  for (x = 0; x < job->width; x++)
+    {
+      get_pixel (job, row, x, px);
+      *out++ = px[0];
+      *out++ = px[1];
+      *out++ = px[2];
+      if (job->has_alpha)
+        *out++ = px[3];
+    }
+}
+
+static gboolean
+run_deflate (z_stream   *zs,
+             int         flush,
+             GByteArray *output)
+{
+  guchar buffer[16384];
+
+  do
+    {
+      zs->next_out = buffer;
+      zs->avail_out = sizeof (buffer);
+
+      if (deflate (zs, flush) == Z_STREAM_ERROR)
+        return FALSE;
+
+      g_byte_array_append (output, buffer, sizeof (buffer) - zs->avail_out);
+    }
+  while (zs->avail_out == 0);
+
+  return TRUE;
+}
+
+static gboolean
+encode_png_strip (EncodeStrip *strip)
+{
+  EncodeJob *job = strip->job;
+  gsize row_len = job->width * (job->has_alpha ? 4 : 3);
+  gboolean use_filter = job->compression_level != 0;
+  gboolean last = strip->first_row + strip->n_rows == job->height;
+  z_stream zs;
+  guchar *prev, *cur, *filtered, *tmp;
+  gboolean success = TRUE;
+  gsize i;
+  int y;
+
+  memset (&zs, 0, sizeof (zs));
+  if (deflateInit2 (&zs, job->compression_level, Z_DEFLATED,
+                    -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    return FALSE;
+
+  prev = g_malloc0 (row_len);
+  cur = g_malloc (row_len);
+  filtered = g_malloc (row_len + 1);
+
+  /* The "Up" filter refers to the row above, even when that row
+   * belongs to the previous strip */
+  if (use_filter && strip->first_row > 0)
+    convert_row (job, strip->first_row - 1, prev);
+
+  strip->output = g_byte_array_new ();
+  strip->adler = adler32 (0L, Z_NULL, 0);
+  strip->input_len = 0;
+
+  for (y = strip->first_row; success && y < strip->first_row + strip->n_rows; y++)
+    {
+      convert_row (job, y, cur);
+
+      if (use_filter)
+        {
+          filtered[0] = 2; /* Up */
+          for (i = 0; i < row_len; i++)
+            filtered[i + 1] = cur[i] - prev[i];
+        }
+      else
+        {
+          filtered[0] = 0; /* None */
+          memcpy (filtered + 1, cur, row_len);
+        }
+
+      strip->adler = adler32 (strip->adler, filtered, row_len + 1);
+      strip->input_len += row_len + 1;
+
+      zs.next_in = filtered;
+      zs.avail_in = row_len + 1;
+      success = run_deflate (&zs, Z_NO_FLUSH, strip->output);
+
+      tmp = prev;
+      prev = cur;
+      cur = tmp;
+    }
+
+  if (success)
+    success = run_deflate (&zs, last ? Z_FINISH : Z_SYNC_FLUSH, strip->output);
+
+  deflateEnd (&zs);
+  g_free (prev);
+  g_free (cur);
+  g_free (filtered);
+
+  return success;
+}
+
+static gboolean
+encode_qoi_strip (EncodeStrip *strip)
+{
+  EncodeJob *job = strip->job;
+  guchar index[64][4];
+  gboolean index_valid[64] = { FALSE, };
+  guchar prev[4], px[4];
+  gboolean have_prev = FALSE;
+  int run = 0;
+  int x, y;
+
+  strip->output = g_byte_array_new ();
+
+  for (y = strip->first_row; y < strip->first_row + strip->n_rows; y++)
+    {
+      const guchar *row = job->data + y * job->stride;
+      guint start = strip->output->len;
+      guchar *p;
+
+      /* The worst case is 5 bytes per pixel */
+      g_byte_array_set_size (strip->output, start + job->width * 5 + 1);
+      p = strip->output->data + start;
+
+      for (x = 0; x < job->width; x++)
+        {
+          int hash;
+
+          get_pixel (job, row, x, px);
+
+          if (have_prev && memcmp (px, prev, 4) == 0)
+            {
+              run++;
+              if (run == 62)
+                {
+                  *p++ = QOI_OP_RUN | (run - 1);
+                  run = 0;
+                }
+              continue;
+            }
+
+          if (run > 0)
+            {
+              *p++ = QOI_OP_RUN | (run - 1);
+              run = 0;
+            }
+
+          hash = QOI_HASH (px);
+
+          if (index_valid[hash] && memcmp (index[hash], px, 4) == 0)
+            {
+              *p++ = QOI_OP_INDEX | hash;
+            }
+          else
+            {
+              memcpy (index[hash], px, 4);
+              index_valid[hash] = TRUE;
+
+              /* The first pixel of a strip doesn't know what the
+               * decoder's previous pixel is, so always write it in full */
+              if (have_prev && px[3] == prev[3])
+                {
+                  signed char vr = px[0] - prev[0];
+                  signed char vg = px[1] - prev[1];
+                  signed char vb = px[2] - prev[2];
+                  signed char vg_r = vr - vg;
+                  signed char vg_b = vb - vg;
+
+                  if (vr > -3 && vr < 2 &&
+                      vg > -3 && vg < 2 &&
+                      vb > -3 && vb < 2)
+                    {
+                      *p++ = QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+                    }
+                  else if (vg_r > -9 && vg_r < 8 &&
+                           vg > -33 && vg < 32 &&
+                           vg_b > -9 && vg_b < 8)
+                    {
+                      *p++ = QOI_OP_LUMA | (vg + 32);
+                      *p++ = (vg_r + 8) << 4 | (vg_b + 8);
+                    }
+                  else
+                    {
+                      *p++ = QOI_OP_RGB;
+                      *p++ = px[0];
+                      *p++ = px[1];
+                      *p++ = px[2];
+                    }
+                }
+              else
+                {
+                  *p++ = QOI_OP_RGBA;
+                  *p++ = px[0];
+                  *p++ = px[1];
+                  *p++ = px[2];
+                  *p++ = px[3];
+                }
+            }
+
+          memcpy (prev, px, 4);
+          have_prev = TRUE;
+        }
+
+      if (y == strip->first_row + strip->n_rows - 1 && run > 0)
+        *p++ = QOI_OP_RUN | (run - 1);
+
+      g_byte_array_set_size (strip->output, p - strip->output->data);
+    }
+
+  return TRUE;
+}
+
+static void
+encode_strip_func (gpointer data,
+                   gpointer user_data)
+{
+  EncodeStrip *strip = data;
+  EncodeJob *job = strip->job;
+  gboolean success;
+
+  if (job->encoding == SHELL_IMAGE_ENCODING_PNG)
+    success = encode_png_strip (strip);
+  else
+    success = encode_qoi_strip (strip);
+
+  g_mutex_lock (&job->lock);
+  strip->failed = !success;
+  strip->done = TRUE;
+  g_cond_broadcast (&job->cond);
+  g_mutex_unlock (&job->lock);
+}
+
+static inline void
+put_uint32 (guchar  *p,
+            guint32  value)
+{
+  p[0] = (value >> 24) & 0xff;
+  p[1] = (value >> 16) & 0xff;
+  p[2] = (value >> 8) & 0xff;
+  p[3] = value & 0xff;
+}
+
+static gboolean
+write_png_chunk (GOutputStream  *stream,
+                 const char     *type,
+                 const guchar   *data,
+                 gsize           len,
+                 GCancellable   *cancellable,
+                 GError        **error)
+{
+  guchar header[8];
+  guchar footer[4];
+  uLong crc;
+
+  put_uint32 (header, len);
+  memcpy (header + 4, type, 4);
+
+  crc = crc32 (0L, Z_NULL, 0);
+  crc = crc32 (crc, (const guchar *) type, 4);
+  crc = crc32 (crc, data, len);
+  put_uint32 (footer, crc);
+
+  return (g_output_stream_write_all (stream, header, sizeof (header), NULL, cancellable, error) &&
+          g_output_stream_write_all (stream, data, len, NULL, cancellable, error) &&
+          g_output_stream_write_all (stream, footer, sizeof (footer), NULL, cancellable, error));
+}
+
+static gboolean
+write_header (EncodeJob      *job,
+              GOutputStream  *stream,
+              GCancellable   *cancellable,
+              GError        **error)
+{
+  if (job->encoding == SHELL_IMAGE_ENCODING_PNG)
+    {
+      static const guchar signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+      guchar ihdr[13];
+      guchar zlib_header[2];
+      int level = job->compression_level;
+
+      put_uint32 (ihdr, job->width);
+      put_uint32 (ihdr + 4, job->height);
+      ihdr[8] = 8;                          /* bit depth */
+      ihdr[9] = job->has_alpha ? 6 : 2;     /* RGBA or RGB */
+      ihdr[10] = 0;                         /* deflate */
+      ihdr[11] = 0;                         /* adaptive filtering */
+      ihdr[12] = 0;                         /* no interlacing */
+
+      /* 32K window; the second byte only carries the (informative)
+       * compression level and the header check bits */
+      zlib_header[0] = 0x78;
+      if (level >= 0 && level <= 1)
+        zlib_header[1] = 0x01;
+      else if (level >= 2 && level <= 5)
+        zlib_header[1] = 0x5e;
+      else if (level >= 7)
+        zlib_header[1] = 0xda;
+      else
+        zlib_header[1] = 0x9c;
+
+      return (g_output_stream_write_all (stream, signature, sizeof (signature), NULL, cancellable, error) &&
+              write_png_chunk (stream, "IHDR", ihdr, sizeof (ihdr), cancellable, error) &&
+              write_png_chunk (stream, "IDAT", zlib_header, sizeof (zlib_header), cancellable, error));
+    }
+  else
+    {
+      guchar header[14];
+
+      memcpy (header, "qoif", 4);
+      put_uint32 (header + 4, job->width);
+      put_uint32 (header + 8, job->height);
+      header[12] = job->has_alpha ? 4 : 3;
+      header[13] = 0; /* sRGB with linear alpha */
+
+      return g_output_stream_write_all (stream, header, sizeof (header), NULL, cancellable, error);
+    }
+}
+
+static gboolean
+write_strip (EncodeJob      *job,
+             EncodeStrip    *strip,
+             GOutputStream  *stream,
+             GCancellable   *cancellable,
+             GError        **error)
+{
+  if (job->encoding == SHELL_IMAGE_ENCODING_PNG)
+    return write_png_chunk (stream, "IDAT",
+                            strip->output->data, strip->output->len,
+                            cancellable, error);
+  else
+    return g_output_stream_write_all (stream,
+                                      strip->output->data, strip->output->len,
+                                      NULL, cancellable, error);
+}
+
+static gboolean
+write_trailer (EncodeJob      *job,
+               GOutputStream  *stream,
+               GCancellable   *cancellable,
+               GError        **error)
+{
+  if (job->encoding == SHELL_IMAGE_ENCODING_PNG)
+    {
+      guchar adler_bytes[4];
+      uLong adler = adler32 (0L, Z_NULL, 0);
+      int i;
+
+      for (i = 0; i < job->n_strips; i++)
+        adler = adler32_combine (adler, job->strips[i].adler, job->strips[i].input_len);
+
+      put_uint32 (adler_bytes, adler);
+
+      return (write_png_chunk (stream, "IDAT", adler_bytes, sizeof (adler_bytes), cancellable, error) &&
+              write_png_chunk (stream, "IEND", NULL, 0, cancellable, error));
+    }
+  else
+    {
+      static const guchar end_marker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+      return g_output_stream_write_all (stream, end_marker, sizeof (end_marker), NULL, cancellable, error);
+    }
+}
+
+/*
+ * shell_image_encoder_write:
+ * @image: a cairo image surface in CAIRO_FORMAT_RGB24 or CAIRO_FORMAT_ARGB32
+ * @encoding: the file format to write
+ * @compression_level: zlib compression level for PNG, 0-9 or -1 for the default
+ * @stream: stream to write the encoded image to
+ * @cancellable: a #GCancellable
+ * @error: return location for a #GError
+ *
+ * Encodes @image on a pool of threads and writes it to @stream. This
+ * blocks until the whole image was written, so it must be called from
+ * a worker thread. @stream is not closed.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+shell_image_encoder_write (cairo_surface_t    *image,
+                           ShellImageEncoding  encoding,
+                           int                 compression_level,
+                           GOutputStream      *stream,
+                           GCancellable       *cancellable,
+                           GError            **error)
+{
+  EncodeJob job;
+  GThreadPool *pool;
+  int n_threads;
+  gboolean success;
+  int i;
+
+  g_return_val_if_fail (cairo_surface_get_type (image) == CAIRO_SURFACE_TYPE_IMAGE, FALSE);
+
+  cairo_surface_flush (image);
+
+  job.encoding = encoding;
+  job.compression_level = compression_level;
+  job.data = cairo_image_surface_get_data (image);
+  job.width = cairo_image_surface_get_width (image);
+  job.height = cairo_image_surface_get_height (image);
+  job.stride = cairo_image_surface_get_stride (image);
+  job.has_alpha = cairo_image_surface_get_format (image) == CAIRO_FORMAT_ARGB32;
+
+  if (job.width <= 0 || job.height <= 0)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                   "Cannot encode an empty image");
+      return FALSE;
+    }
+
+  job.n_strips = (job.height + STRIP_HEIGHT - 1) / STRIP_HEIGHT;
+  job.strips = g_new0 (EncodeStrip, job.n_strips);
+  g_mutex_init (&job.lock);
+  g_cond_init (&job.cond);
+
+  n_threads = CLAMP (sysconf (_SC_NPROCESSORS_ONLN), 1, MAX_THREADS);
+  pool = g_thread_pool_new (encode_strip_func, NULL,
+                            MIN (n_threads, job.n_strips), TRUE, NULL);
+
+  for (i = 0; i < job.n_strips; i++)
+    {
+      job.strips[i].job = &job;
+      job.strips[i].first_row = i * STRIP_HEIGHT;
+      job.strips[i].n_rows = MIN (STRIP_HEIGHT, job.height - i * STRIP_HEIGHT);
+      g_thread_pool_push (pool, &job.strips[i], NULL);
+    }
+
+  /* Write the strips out as they become ready, in order; the pool
+   * keeps compressing the following ones in the meantime */
+  success = write_header (&job, stream, cancellable, error);
+
+  for (i = 0; success && i < job.n_strips; i++)
+    {
+      EncodeStrip *strip = &job.strips[i];
+
+      g_mutex_lock (&job.lock);
+      while (!strip->done)
+        g_cond_wait (&job.cond, &job.lock);
+      g_mutex_unlock (&job.lock);
+
+      if (strip->failed)
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                       "Failed to compress image");
+          success = FALSE;
+          break;
+        }
+
+      success = write_strip (&job, strip, stream, cancellable, error);
+
+      g_byte_array_free (strip->output, TRUE);
+      strip->output = NULL;
+    }
+
+  if (success)
+    success = write_trailer (&job, stream, cancellable, error);
+
+  /* On failure, drop the strips that haven't been started yet */
+  g_thread_pool_free (pool, !success, TRUE);
+
+  for (i = 0; i < job.n_strips; i++)
+    if (job.strips[i].output)
+      g_byte_array_free (job.strips[i].output, TRUE);
+
+  g_free (job.strips);
+  g_mutex_clear (&job.lock);
+  g_cond_clear (&job.cond);
+
+  return success;
+}
@@ -0,0 +1,29 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_IMAGE_ENCODER_H__
+#define __SHELL_IMAGE_ENCODER_H__
+
+#include <cairo.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* Private helper used by ShellScreenshot to write out images; the
+ * image is cut into horizontal strips which are compressed in
+ * parallel and then written to the stream in order.
+ */
+
+typedef enum {
+  SHELL_IMAGE_ENCODING_PNG,
+  SHELL_IMAGE_ENCODING_QOI
+} ShellImageEncoding;
+
+gboolean shell_image_encoder_write (cairo_surface_t    *image,
+                                    ShellImageEncoding  encoding,
+                                    int                 compression_level,
+                                    GOutputStream      *stream,
+                                    GCancellable       *cancellable,
+                                    GError            **error);
+
+G_END_DECLS
+
+#endif /* __SHELL_IMAGE_ENCODER_H__ */
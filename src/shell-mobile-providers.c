@@ -28,6 +28,7 @@
 #include <stdlib.h>
 
 #include <glib/gi18n.h>
+#include <gio/gio.h>
 
 #include "shell-mobile-providers.h"
 
@@ -814,3 +815,390 @@ shell_mobile_provider_get_cdma_sid (ShellMobileProvider *provider)
 {
     return provider->cdma_sid;
 }
+
+/* Provider index
+ *
+ * All the shell needs from the database is the name of the provider
+ * for a GSM MCC/MNC or a CDMA SID, but building the full tables means
+ * parsing the whole XML file and keeping it all in memory. So the
+ * first time a name is looked up, we extract sorted (MCC, MNC, name)
+ * and (SID, name) arrays into a GVariant, and store it in the user's
+ * cache directory. Later lookups, including in later sessions, map
+ * that file and binary search it, which only pages in and decodes the
+ * records they look at. The index is rebuilt when the modification
+ * time or the size of the XML file changes.
+ */
+
+/* Bump whenever the layout below changes */
+#define INDEX_FORMAT_VERSION 1
+
+/* format version, source mtime in microseconds, source size */
+#define INDEX_HEADER_TYPE "(uxt)"
+/* (MCC, MNC, name), sorted by MCC then MNC */
+#define INDEX_GSM_TYPE    "a(sss)"
+/* (SID, name), sorted by SID */
+#define INDEX_CDMA_TYPE   "a(us)"
+#define INDEX_TYPE        "(" INDEX_HEADER_TYPE INDEX_GSM_TYPE INDEX_CDMA_TYPE ")"
+
+typedef struct {
+    const char *mcc;
+    const char *mnc;
+    const char *name;
+} GsmIndexEntry;
+
+typedef struct {
+    guint32 sid;
+    const char *name;
+} CdmaIndexEntry;
+
+static GVariant *provider_index;
+
+static char *
+get_index_filename (void)
+{
+    return g_build_filename (g_get_user_cache_dir (), "gnome-shell",
+                             "mobile-providers", NULL);
+}
+
+static gboolean
+get_source_info (gint64 *mtime, guint64 *size)
+{
+    GFile *file;
+    GFileInfo *info;
+
+    file = g_file_new_for_path (MOBILE_BROADBAND_PROVIDER_INFO);
+    info = g_file_query_info (file,
+                              G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                              G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC ","
+                              G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                              G_FILE_QUERY_INFO_NONE, NULL, NULL);
+    g_object_unref (file);
+
+    if (!info)
+        return FALSE;
+
+    *mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+             g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+    *size = g_file_info_get_size (info);
+    g_object_unref (info);
+
+    return TRUE;
+}
+
+static int
+compare_gsm_entries (gconstpointer a, gconstpointer b)
+{
+    const GsmIndexEntry *entry_a = a;
+    const GsmIndexEntry *entry_b = b;
+    int result;
+
+    result = strcmp (entry_a->mcc, entry_b->mcc);
+    if (result == 0)
+        result = strcmp (entry_a->mnc, entry_b->mnc);
+
+    return result;
+}
+
+static int
+compare_cdma_entries (gconstpointer a, gconstpointer b)
+{
+    const CdmaIndexEntry *entry_a = a;
+    const CdmaIndexEntry *entry_b = b;
+
+    if (entry_a->sid < entry_b->sid)
+        return -1;
+    return entry_a->sid > entry_b->sid ? 1 : 0;
+}
+
+static GVariant *
+load_index (gint64 mtime, guint64 size)
+{
+    GMappedFile *mapped;
+    GVariant *index;
+    char *filename;
+    guint32 version;
+    gint64 cached_mtime;
+    guint64 cached_size;
+
+    filename = get_index_filename ();
+    mapped = g_mapped_file_new (filename, FALSE, NULL);
+    g_free (filename);
+
+    if (!mapped)
+        return NULL;
+
+    if (g_mapped_file_get_length (mapped) == 0) {
+        g_mapped_file_unref (mapped);
+        return NULL;
+    }
+
+    /* The file is not trusted; a corrupt index gives wrong names, but
+     * doesn't crash us */
+    index = g_variant_new_from_data (G_VARIANT_TYPE (INDEX_TYPE),
+                                     g_mapped_file_get_contents (mapped),
+                                     g_mapped_file_get_length (mapped),
+                                     FALSE,
+                                     (GDestroyNotify) g_mapped_file_unref, mapped);
+    g_variant_ref_sink (index);
+
+    g_variant_get_child (index, 0, INDEX_HEADER_TYPE,
+                         &version, &cached_mtime, &cached_size);
+    if (version != INDEX_FORMAT_VERSION ||
+        cached_mtime != mtime ||
+        cached_size != size) {
+        g_variant_unref (index);
+        return NULL;
+    }
+
+    return index;
+}
+
+static GVariant *
+build_index (gint64 mtime, guint64 size)
+{
+    GHashTable *providers;
+    GHashTableIter iter;
+    gpointer value;
+    GArray *gsm_entries, *cdma_entries;
+    GVariantBuilder gsm_builder, cdma_builder;
+    GVariant *index;
+    char *filename, *dirname;
+    guint i;
+
+    providers = shell_mobile_providers_parse (NULL);
+    if (!providers)
+        return NULL;
+
+    gsm_entries = g_array_new (FALSE, FALSE, sizeof (GsmIndexEntry));
+    cdma_entries = g_array_new (FALSE, FALSE, sizeof (CdmaIndexEntry));
+
+    g_hash_table_iter_init (&iter, providers);
+    while (g_hash_table_iter_next (&iter, NULL, &value)) {
+        GSList *piter, *liter;
+
+        for (piter = value; piter; piter = g_slist_next (piter)) {
+            ShellMobileProvider *provider = piter->data;
+
+            if (!provider->name)
+                continue;
+
+            for (liter = provider->gsm_mcc_mnc; liter; liter = g_slist_next (liter)) {
+                ShellGsmMccMnc *mcc_mnc = liter->data;
+                GsmIndexEntry entry = { mcc_mnc->mcc, mcc_mnc->mnc, provider->name };
+
+                if (mcc_mnc->mcc && mcc_mnc->mnc)
+                    g_array_append_val (gsm_entries, entry);
+            }
+
+            for (liter = provider->cdma_sid; liter; liter = g_slist_next (liter)) {
+                CdmaIndexEntry entry = { GPOINTER_TO_UINT (liter->data), provider->name };
+
+                g_array_append_val (cdma_entries, entry);
+            }
+        }
+    }
+
+    g_array_sort (gsm_entries, compare_gsm_entries);
+    g_array_sort (cdma_entries, compare_cdma_entries);
+
+    g_variant_builder_init (&gsm_builder, G_VARIANT_TYPE (INDEX_GSM_TYPE));
+    for (i = 0; i < gsm_entries->len; i++) {
+        GsmIndexEntry *entry = &g_array_index (gsm_entries, GsmIndexEntry, i);
+
+        g_variant_builder_add (&gsm_builder, "(sss)", entry->mcc, entry->mnc, entry->name);
+    }
+
+    g_variant_builder_init (&cdma_builder, G_VARIANT_TYPE (INDEX_CDMA_TYPE));
+    for (i = 0; i < cdma_entries->len; i++) {
+        CdmaIndexEntry *entry = &g_array_index (cdma_entries, CdmaIndexEntry, i);
+
+        g_variant_builder_add (&cdma_builder, "(us)", entry->sid, entry->name);
+    }
+
+    index = g_variant_new ("(" INDEX_HEADER_TYPE "@" INDEX_GSM_TYPE "@" INDEX_CDMA_TYPE ")",
+                           INDEX_FORMAT_VERSION, mtime, size,
+                           g_variant_builder_end (&gsm_builder),
+                           g_variant_builder_end (&cdma_builder));
+    g_variant_ref_sink (index);
+
+    g_array_free (gsm_entries, TRUE);
+    g_array_free (cdma_entries, TRUE);
+    g_hash_table_destroy (providers);
+
+    /* The index is only an optimization, so failing to write it isn't
+     * worth a warning */
+    filename = get_index_filename ();
+    dirname = g_path_get_dirname (filename);
+    if (g_mkdir_with_parents (dirname, 0755) == 0)
+        g_file_set_contents (filename,
+                             g_variant_get_data (index), g_variant_get_size (index),
+                             NULL);
+    g_free (filename);
+    g_free (dirname);
+
+    return index;
+}
+
+static GVariant *
+get_index (void)
+{
+    static gboolean failed = FALSE;
+    gint64 mtime;
+    guint64 size;
+
+    if (provider_index || failed)
+        return provider_index;
+
+    if (get_source_info (&mtime, &size)) {
+        provider_index = load_index (mtime, size);
+        if (!provider_index)
+            provider_index = build_index (mtime, size);
+    }
+
+    /* Don't try again for every lookup if the database is missing */
+    if (!provider_index)
+        failed = TRUE;
+
+    return provider_index;
+}
+
+/* Returns the index of the first GSM entry that is not less than
+ * (@mcc, @mnc) */
+static gsize
+gsm_lower_bound (GVariant *entries, const char *mcc, const char *mnc)
+{
+    gsize low = 0, high = g_variant_n_children (entries);
+
+    while (low < high) {
+        gsize middle = low + (high - low) / 2;
+        GsmIndexEntry entry;
+
+        g_variant_get_child (entries, middle, "(&s&s&s)",
+                             &entry.mcc, &entry.mnc, &entry.name);
+
+        if (strcmp (entry.mcc, mcc) < 0 ||
+            (strcmp (entry.mcc, mcc) == 0 && strcmp (entry.mnc, mnc) < 0))
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+/**
+ * shell_mobile_providers_find_for_mcc_mnc:
+ * @mcc_mnc: a MCC/MNC, as reported by a GSM modem: the 3 digits of the
+ *   MCC followed by the 2 or 3 digits of the MNC
+ *
+ * Looks up the provider with the given MCC/MNC. Since some modems
+ * report a 2-digit MNC for a 3-digit one and vice versa, a 3-digit
+ * match is preferred, but any provider whose MNC starts with the
+ * first two digits of the given one will do.
+ *
+ * Returns: (transfer full): the name of the provider, or %NULL
+ */
+char *
+shell_mobile_providers_find_for_mcc_mnc (const char *mcc_mnc)
+{
+    GVariant *index, *entries;
+    char *mcc, *mnc2;
+    const char *mnc;
+    char *result = NULL;
+    gsize n_entries, i;
+
+    g_return_val_if_fail (mcc_mnc != NULL, NULL);
+
+    if (strlen (mcc_mnc) < 5)
+        return NULL;
+
+    index = get_index ();
+    if (!index)
+        return NULL;
+
+    mcc = g_strndup (mcc_mnc, 3);
+    mnc = mcc_mnc + 3;
+    mnc2 = g_strndup (mnc, 2);
+
+    entries = g_variant_get_child_value (index, 1);
+    n_entries = g_variant_n_children (entries);
+
+    if (strlen (mnc) == 3) {
+        i = gsm_lower_bound (entries, mcc, mnc);
+        if (i < n_entries) {
+            GsmIndexEntry entry;
+
+            g_variant_get_child (entries, i, "(&s&s&s)",
+                                 &entry.mcc, &entry.mnc, &entry.name);
+            if (strcmp (entry.mcc, mcc) == 0 && strcmp (entry.mnc, mnc) == 0)
+                result = g_strdup (entry.name);
+        }
+    }
+
+    /* All the MNCs starting with the same two digits come right after
+     * the 2-digit one */
+    if (!result) {
+        i = gsm_lower_bound (entries, mcc, mnc2);
+        if (i < n_entries) {
+            GsmIndexEntry entry;
+
+            g_variant_get_child (entries, i, "(&s&s&s)",
+                                 &entry.mcc, &entry.mnc, &entry.name);
+            if (strcmp (entry.mcc, mcc) == 0 && strncmp (entry.mnc, mnc2, 2) == 0)
+                result = g_strdup (entry.name);
+        }
+    }
+
+    g_variant_unref (entries);
+    g_free (mcc);
+    g_free (mnc2);
+
+    return result;
+}
+
+/**
+ * shell_mobile_providers_find_for_sid:
+ * @sid: a CDMA system identifier
+ *
+ * Looks up the provider with the given CDMA SID.
+ *
+ * Returns: (transfer full): the name of the provider, or %NULL
+ */
+char *
+shell_mobile_providers_find_for_sid (guint32 sid)
+{
+    GVariant *index, *entries;
+    char *result = NULL;
+    gsize low, high;
+
+    if (sid == 0)
+        return NULL;
+
+    index = get_index ();
+    if (!index)
+        return NULL;
+
+    entries = g_variant_get_child_value (index, 2);
+
+    low = 0;
+    high = g_variant_n_children (entries);
+    while (low < high) {
+        gsize middle = low + (high - low) / 2;
+        CdmaIndexEntry entry;
+
+        g_variant_get_child (entries, middle, "(u&s)", &entry.sid, &entry.name);
+
+        if (entry.sid < sid) {
+            low = middle + 1;
+        } else if (entry.sid > sid) {
+            high = middle;
+        } else {
+            result = g_strdup (entry.name);
+            break;
+        }
+    }
+
+    g_variant_unref (entries);
+
+    return result;
+}
@@ -91,6 +91,9 @@ void                     shell_mobile_access_method_unref (ShellMobileAccessMeth
 
 GHashTable *shell_mobile_providers_parse (GHashTable **out_ccs);
 
+char *shell_mobile_providers_find_for_mcc_mnc (const char *mcc_mnc);
+char *shell_mobile_providers_find_for_sid     (guint32     sid);
+
 void shell_mobile_providers_dump (GHashTable *providers);
 
 #endif /* SHELL_MOBILE_PROVIDERS_H */
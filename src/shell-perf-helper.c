@@ -9,11 +9,18 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gtk/gtk.h>
 #include <gdk/gdkx.h>
 
 #define BUS_NAME "org.gnome.Shell.PerfHelper"
 
+/* Windows can be spread over this many WM_CLASS values, so that they
+ * show up as different applications; gnome-shell-perf-tool has to
+ * let all of them through MUTTER_WM_CLASS_FILTER. */
+#define MAX_WINDOW_CLASSES 16
+
 static void destroy_windows           (void);
 static void finish_wait_windows       (void);
 static void check_finish_wait_windows (void);
@@ -28,8 +35,21 @@ static const gchar introspection_xml[] =
 	  "      <arg type='b' name='alpha' direction='in'/>"
 	  "      <arg type='b' name='maximized' direction='in'/>"
 	  "    </method>"
+	  "    <method name='CreateWindows'>"
+	  "      <arg type='i' name='count' direction='in'/>"
+	  "      <arg type='i' name='width' direction='in'/>"
+	  "      <arg type='i' name='height' direction='in'/>"
+	  "      <arg type='b' name='alpha' direction='in'/>"
+	  "      <arg type='b' name='maximized' direction='in'/>"
+	  "      <arg type='s' name='type' direction='in'/>"
+	  "      <arg type='i' name='n_classes' direction='in'/>"
+	  "    </method>"
 	  "    <method name='WaitWindows'/>"
 	  "    <method name='DestroyWindows'/>"
+	  "    <method name='SendNotifications'>"
+	  "      <arg type='i' name='count' direction='in'/>"
+	  "      <arg type='i' name='image_size' direction='in'/>"
+	  "    </method>"
 	  "  </interface>"
 	"</node>";
 
@@ -45,6 +65,23 @@ typedef struct {
   guint pending : 1;
 } WindowInfo;
 
+/* The types of windows CreateWindows can create; 'mixed' cycles
+ * through the list */
+static const struct {
+  const char *name;
+  GdkWindowTypeHint hint;
+} window_types[] = {
+  { "normal", GDK_WINDOW_TYPE_HINT_NORMAL },
+  { "dialog", GDK_WINDOW_TYPE_HINT_DIALOG },
+  { "utility", GDK_WINDOW_TYPE_HINT_UTILITY },
+  { "toolbar", GDK_WINDOW_TYPE_HINT_TOOLBAR },
+};
+
+typedef struct {
+  GDBusMethodInvocation *invocation;
+  int remaining;
+} SendNotificationsData;
+
 static int opt_idle_timeout = 30;
 
 static GOptionEntry opt_entries[] =
@@ -61,6 +98,7 @@ static Atom atom_utf8_string;
 
 static guint timeout_id;
 static GList *our_windows;
+static int n_created_windows;
 static GList *wait_windows_invocations;
 
 static gboolean
@@ -159,12 +197,15 @@ on_window_draw (GtkWidget  *window,
 }
 
 static void
-create_window (int      width,
-	       int      height,
-               gboolean alpha,
-               gboolean maximized)
+create_window (int               width,
+	       int               height,
+               gboolean          alpha,
+               gboolean          maximized,
+               GdkWindowTypeHint type_hint,
+               int               class_index)
 {
   WindowInfo *info;
+  char *title;
 
   info = g_new0 (WindowInfo, 1);
   info->width = width;
@@ -172,6 +213,21 @@ create_window (int      width,
   info->alpha = alpha;
   info->maximized = maximized;
   info->window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+
+  title = g_strdup_printf ("Test Window %d", ++n_created_windows);
+  gtk_window_set_title (GTK_WINDOW (info->window), title);
+  g_free (title);
+
+  gtk_window_set_type_hint (GTK_WINDOW (info->window), type_hint);
+
+  if (class_index >= 0)
+    {
+      char *wm_class = g_strdup_printf ("Gnome-shell-perf-helper-%d", class_index);
+      gtk_window_set_wmclass (GTK_WINDOW (info->window),
+                              "gnome-shell-perf-helper", wm_class);
+      g_free (wm_class);
+    }
+
   if (alpha)
     gtk_widget_set_visual (info->window, gdk_screen_get_rgba_visual (gdk_screen_get_default ()));
   if (maximized)
@@ -187,6 +243,148 @@ create_window (int      width,
   our_windows = g_list_prepend (our_windows, info);
 }
 
+static void
+create_windows (int         count,
+                int         width,
+                int         height,
+                gboolean    alpha,
+                gboolean    maximized,
+                const char *type,
+                int         n_classes)
+{
+  gboolean mixed;
+  guint type_index = 0;
+  int i;
+
+  mixed = strcmp (type, "mixed") == 0;
+  if (!mixed)
+    {
+      for (type_index = 0; type_index < G_N_ELEMENTS (window_types); type_index++)
+        if (strcmp (type, window_types[type_index].name) == 0)
+          break;
+
+      if (type_index == G_N_ELEMENTS (window_types))
+        type_index = 0;
+    }
+
+  n_classes = MIN (n_classes, MAX_WINDOW_CLASSES);
+
+  for (i = 0; i < count; i++)
+    {
+      GdkWindowTypeHint hint;
+
+      if (mixed)
+        hint = window_types[i % G_N_ELEMENTS (window_types)].hint;
+      else
+        hint = window_types[type_index].hint;
+
+      create_window (width, height, alpha, maximized, hint,
+                     n_classes > 0 ? i % n_classes : -1);
+    }
+}
+
+static void
+on_notify_done (GObject      *source,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+  SendNotificationsData *data = user_data;
+  GVariant *reply;
+  GError *error = NULL;
+
+  reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), result, &error);
+  if (reply)
+    g_variant_unref (reply);
+  else
+    {
+      g_printerr ("Failed to send notification: %s\n", error->message);
+      g_error_free (error);
+    }
+
+  if (--data->remaining == 0)
+    {
+      g_dbus_method_invocation_return_value (data->invocation, NULL);
+      g_free (data);
+    }
+}
+
+/* Creates an image-data hint; there are a few different images, like
+ * a chat where different people send messages */
+static GVariant *
+create_notification_image (int size,
+                           int index)
+{
+  guchar *pixels, *p;
+  int x, y;
+
+  pixels = g_malloc (size * size * 4);
+  for (y = 0, p = pixels; y < size; y++)
+    for (x = 0; x < size; x++, p += 4)
+      {
+        p[0] = (x * 255) / size;
+        p[1] = (y * 255) / size;
+        p[2] = (index % 4) * 64;
+        p[3] = 255;
+      }
+
+  return g_variant_new ("(iiibii@ay)", size, size, size * 4, TRUE, 8, 4,
+                        g_variant_new_from_data (G_VARIANT_TYPE ("ay"),
+                                                 pixels, size * size * 4,
+                                                 TRUE, g_free, pixels));
+}
+
+static void
+send_notifications (GDBusConnection       *connection,
+                    GDBusMethodInvocation *invocation,
+                    int                    count,
+                    int                    image_size)
+{
+  static const char *no_actions[] = { NULL };
+  SendNotificationsData *data;
+  int i;
+
+  if (count <= 0)
+    {
+      g_dbus_method_invocation_return_value (invocation, NULL);
+      return;
+    }
+
+  data = g_new0 (SendNotificationsData, 1);
+  data->invocation = invocation;
+  data->remaining = count;
+
+  for (i = 0; i < count; i++)
+    {
+      GVariantBuilder hints;
+      char *summary, *body;
+
+      g_variant_builder_init (&hints, G_VARIANT_TYPE ("a{sv}"));
+      if (image_size > 0)
+        g_variant_builder_add (&hints, "{sv}", "image-data",
+                               create_notification_image (image_size, i));
+
+      summary = g_strdup_printf ("Test Notification %d", i + 1);
+      body = g_strdup_printf ("This is the body of test notification %d", i + 1);
+
+      g_dbus_connection_call (connection,
+                              "org.freedesktop.Notifications",
+                              "/org/freedesktop/Notifications",
+                              "org.freedesktop.Notifications",
+                              "Notify",
+                              g_variant_new ("(susss^asa{sv}i)",
+                                             "gnome-shell-perf-helper", 0, "",
+                                             summary, body, no_actions,
+                                             &hints, -1),
+                              G_VARIANT_TYPE ("(u)"),
+                              G_DBUS_CALL_FLAGS_NONE,
+                              -1, NULL,
+                              on_notify_done, data);
+
+      g_free (summary);
+      g_free (body);
+    }
+}
+
 static void
 finish_wait_windows (void)
 {
@@ -245,7 +443,20 @@ handle_method_call (GDBusConnection       *connection,
 
       g_variant_get (parameters, "(iibb)", &width, &height, &alpha, &maximized);
 
-      create_window (width, height, alpha, maximized);
+      create_window (width, height, alpha, maximized,
+                     GDK_WINDOW_TYPE_HINT_NORMAL, -1);
+      g_dbus_method_invocation_return_value (invocation, NULL);
+    }
+  else if (g_strcmp0 (method_name, "CreateWindows") == 0)
+    {
+      int count, width, height, n_classes;
+      gboolean alpha, maximized;
+      const char *type;
+
+      g_variant_get (parameters, "(iiibb&si)",
+                     &count, &width, &height, &alpha, &maximized, &type, &n_classes);
+
+      create_windows (count, width, height, alpha, maximized, type, n_classes);
       g_dbus_method_invocation_return_value (invocation, NULL);
     }
   else if (g_strcmp0 (method_name, "WaitWindows") == 0)
@@ -258,6 +469,14 @@ handle_method_call (GDBusConnection       *connection,
       destroy_windows ();
       g_dbus_method_invocation_return_value (invocation, NULL);
     }
+  else if (g_strcmp0 (method_name, "SendNotifications") == 0)
+    {
+      int count, image_size;
+
+      g_variant_get (parameters, "(ii)", &count, &image_size);
+
+      send_notifications (connection, invocation, count, image_size);
+    }
 }
 
 static const GDBusInterfaceVTable interface_vtable =
@@ -63,6 +63,10 @@ struct _ShellRecorder {
   int cursor_hot_x;
   int cursor_hot_y;
 
+  /* Previously fetched cursor images, keyed by cursor serial */
+  GHashTable *cursor_cache;
+  GQueue *cursor_lru;
+
   gboolean only_paint; /* Used to temporarily suppress recording */
 
   int framerate;
@@ -88,6 +92,13 @@ struct _ShellRecorder {
   guint repaint_hook_id;
 };
 
+typedef struct {
+  gulong serial;
+  cairo_surface_t *image;
+  int hot_x;
+  int hot_y;
+} RecorderCursor;
+
 struct _RecorderPipeline
 {
   ShellRecorder *recorder;
@@ -130,6 +141,11 @@ G_DEFINE_TYPE(ShellRecorder, shell_recorder, G_TYPE_OBJECT);
  */
 #define UPDATE_POINTER_TIME 100
 
+/* Number of cursor images we keep around so that switching back to a
+ * recently used cursor doesn't require a round-trip to the server.
+ */
+#define MAX_CACHED_CURSORS 8
+
 /* The time we wait (in milliseconds) before redrawing when the memory used
  * changes.
  */
@@ -271,6 +287,16 @@ shell_recorder_init (ShellRecorder *recorder)
 
   recorder->state = RECORDER_STATE_CLOSED;
   recorder->framerate = DEFAULT_FRAMES_PER_SECOND;
+
+  recorder->cursor_cache = g_hash_table_new (g_direct_hash, g_direct_equal);
+  recorder->cursor_lru = g_queue_new ();
+}
+
+static void
+recorder_cursor_free (RecorderCursor *cursor)
+{
+  cairo_surface_destroy (cursor->image);
+  g_slice_free (RecorderCursor, cursor);
 }
 
 static void
@@ -296,6 +322,10 @@ shell_recorder_finalize (GObject  *object)
   if (recorder->cursor_image)
     cairo_surface_destroy (recorder->cursor_image);
 
+  g_hash_table_destroy (recorder->cursor_cache);
+  g_queue_foreach (recorder->cursor_lru, (GFunc) recorder_cursor_free, NULL);
+  g_queue_free (recorder->cursor_lru);
+
   recorder_set_stage (recorder, NULL);
   recorder_set_pipeline (recorder, NULL);
   recorder_set_filename (recorder, NULL);
@@ -387,10 +417,55 @@ recorder_remove_redraw_timeout (ShellRecorder *recorder)
     }
 }
 
+static void
+recorder_set_cursor (ShellRecorder  *recorder,
+                     RecorderCursor *cursor)
+{
+  if (recorder->cursor_image)
+    cairo_surface_destroy (recorder->cursor_image);
+
+  recorder->cursor_image = cairo_surface_reference (cursor->image);
+  recorder->cursor_hot_x = cursor->hot_x;
+  recorder->cursor_hot_y = cursor->hot_y;
+}
+
+static RecorderCursor *
+recorder_lookup_cursor (ShellRecorder *recorder,
+                        gulong         serial)
+{
+  RecorderCursor *cursor;
+
+  cursor = g_hash_table_lookup (recorder->cursor_cache, GUINT_TO_POINTER (serial));
+  if (cursor)
+    {
+      g_queue_remove (recorder->cursor_lru, cursor);
+      g_queue_push_head (recorder->cursor_lru, cursor);
+    }
+
+  return cursor;
+}
+
+static void
+recorder_cache_cursor (ShellRecorder  *recorder,
+                       RecorderCursor *cursor)
+{
+  g_hash_table_insert (recorder->cursor_cache, GUINT_TO_POINTER (cursor->serial), cursor);
+  g_queue_push_head (recorder->cursor_lru, cursor);
+
+  while (g_queue_get_length (recorder->cursor_lru) > MAX_CACHED_CURSORS)
+    {
+      RecorderCursor *old = g_queue_pop_tail (recorder->cursor_lru);
+
+      g_hash_table_remove (recorder->cursor_cache, GUINT_TO_POINTER (old->serial));
+      recorder_cursor_free (old);
+    }
+}
+
 static void
 recorder_fetch_cursor_image (ShellRecorder *recorder)
 {
   XFixesCursorImage *cursor_image;
+  RecorderCursor *cursor;
   guchar *data;
   int stride;
   int i, j;
@@ -402,24 +477,36 @@ recorder_fetch_cursor_image (ShellRecorder *recorder)
   if (!cursor_image)
     return;
 
-  recorder->cursor_hot_x = cursor_image->xhot;
-  recorder->cursor_hot_y = cursor_image->yhot;
+  cursor = recorder_lookup_cursor (recorder, cursor_image->cursor_serial);
+  if (cursor)
+    {
+      recorder_set_cursor (recorder, cursor);
+      XFree (cursor_image);
+      return;
+    }
 
-  recorder->cursor_image = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-                                                       cursor_image->width,
-                                                       cursor_image->height);
+  cursor = g_slice_new (RecorderCursor);
+  cursor->serial = cursor_image->cursor_serial;
+  cursor->hot_x = cursor_image->xhot;
+  cursor->hot_y = cursor_image->yhot;
+  cursor->image = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                              cursor_image->width,
+                                              cursor_image->height);
 
   /* The pixel data (in typical Xlib breakage) is longs even on
    * 64-bit platforms, so we have to data-convert there. For simplicity,
    * just do it always
    */
-  data = cairo_image_surface_get_data (recorder->cursor_image);
-  stride = cairo_image_surface_get_stride (recorder->cursor_image);
+  data = cairo_image_surface_get_data (cursor->image);
+  stride = cairo_image_surface_get_stride (cursor->image);
   for (i = 0; i < cursor_image->height; i++)
     for (j = 0; j < cursor_image->width; j++)
       *(guint32 *)(data + i * stride + 4 * j) = cursor_image->pixels[i * cursor_image->width + j];
 
-  cairo_surface_mark_dirty (recorder->cursor_image);
+  cairo_surface_mark_dirty (cursor->image);
+
+  recorder_cache_cursor (recorder, cursor);
+  recorder_set_cursor (recorder, cursor);
 
   XFree (cursor_image);
 }
@@ -655,12 +742,20 @@ recorder_event_filter (XEvent        *xev,
 
       if (notify_event->subtype == XFixesDisplayCursorNotify)
         {
+          RecorderCursor *cursor;
+
           if (recorder->cursor_image)
             {
               cairo_surface_destroy (recorder->cursor_image);
               recorder->cursor_image = NULL;
             }
 
+          /* If we've seen this cursor before, reuse the image; otherwise
+           * it will be fetched when we next draw the cursor. */
+          cursor = recorder_lookup_cursor (recorder, notify_event->cursor_serial);
+          if (cursor)
+            recorder_set_cursor (recorder, cursor);
+
           recorder_queue_redraw (recorder);
         }
     }
@@ -66,6 +66,173 @@ shell_screen_grabber_new  (void)
   return g_object_new (SHELL_TYPE_SCREEN_GRABBER, NULL);
 }
 
+static void
+ensure_extensions (ShellScreenGrabber *grabber)
+{
+  if (grabber->have_pixel_buffers == -1)
+    {
+      const GLubyte* extensions = glGetString (GL_EXTENSIONS);
+      grabber->have_pixel_buffers = strstr ((const char *)extensions, "GL_EXT_pixel_buffer_object") != NULL;
+      grabber->have_pack_invert = strstr ((const char *)extensions, "GL_MESA_pack_invert") != NULL;
+    }
+
+  if (grabber->have_pixel_buffers && pf_glBindBufferARB == NULL)
+    {
+      pf_glBindBufferARB = (PFNGLBINDBUFFERARBPROC) cogl_get_proc_address ("glBindBufferARB");
+      pf_glBufferDataARB = (PFNGLBUFFERDATAARBPROC) cogl_get_proc_address ("glBufferDataARB");
+      pf_glDeleteBuffersARB = (PFNGLDELETEBUFFERSARBPROC) cogl_get_proc_address ("glDeleteBuffersARB");
+      pf_glGenBuffersARB = (PFNGLGENBUFFERSARBPROC) cogl_get_proc_address ("glGenBuffersARB");
+      pf_glMapBufferARB = (PFNGLMAPBUFFERARBPROC) cogl_get_proc_address ("glMapBufferARB");
+      pf_glUnmapBufferARB = (PFNGLUNMAPBUFFERARBPROC) cogl_get_proc_address ("glUnmapBufferARB");
+    }
+}
+
+/**
+ * shell_screen_grabber_begin_grab: (skip)
+ * x: X coordinate of the rectangle to grab
+ * y: Y coordinate of the rectangle to grab
+ * width: width of the rectangle to grab
+ * height: heigth of the rectangle to grab
+ *
+ * Starts reading back a portion of the screen into a pixel-buffer
+ * object, without waiting for the data to arrive. Use
+ * shell_screen_grabber_map() to access the data.
+ *
+ * Return value: %TRUE if the read-back was started, %FALSE if pixel-buffer
+ *  objects aren't supported, in which case shell_screen_grabber_grab()
+ *  must be used instead.
+ **/
+gboolean
+shell_screen_grabber_begin_grab (ShellScreenGrabber *grabber,
+                                 int                 x,
+                                 int                 y,
+                                 int                 width,
+                                 int                 height)
+{
+  GLint old_swap_bytes, old_lsb_first, old_row_length, old_skip_pixels, old_skip_rows, old_alignment;
+  GLint old_pack_invert = GL_FALSE;
+  GLint vp_size[4];
+
+  ensure_extensions (grabber);
+
+  if (!grabber->have_pixel_buffers)
+    return FALSE;
+
+  cogl_flush ();
+
+  glGetIntegerv (GL_PACK_SWAP_BYTES, &old_swap_bytes);
+  glGetIntegerv (GL_PACK_LSB_FIRST, &old_lsb_first);
+  glGetIntegerv (GL_PACK_ROW_LENGTH, &old_row_length);
+  glGetIntegerv (GL_PACK_SKIP_PIXELS, &old_skip_pixels);
+  glGetIntegerv (GL_PACK_SKIP_ROWS, &old_skip_rows);
+  glGetIntegerv (GL_PACK_ALIGNMENT, &old_alignment);
+
+  glPixelStorei (GL_PACK_SWAP_BYTES, GL_FALSE);
+  glPixelStorei (GL_PACK_LSB_FIRST, GL_FALSE);
+  glPixelStorei (GL_PACK_ROW_LENGTH, 0);
+  glPixelStorei (GL_PACK_SKIP_PIXELS, 0);
+  glPixelStorei (GL_PACK_SKIP_ROWS, 0);
+  glPixelStorei (GL_PACK_ALIGNMENT, 1);
+
+  if (grabber->have_pack_invert)
+    {
+      glGetIntegerv (GL_PACK_INVERT_MESA, &old_pack_invert);
+      glPixelStorei (GL_PACK_INVERT_MESA, GL_FALSE);
+    }
+
+  if (grabber->pixel_buffer != 0 &&
+      (grabber->width != width ||
+       grabber->height != height))
+    {
+      pf_glDeleteBuffersARB (1, &grabber->pixel_buffer);
+      grabber->pixel_buffer = 0;
+    }
+
+  if (grabber->pixel_buffer == 0)
+    {
+      pf_glGenBuffersARB (1, &grabber->pixel_buffer);
+
+      pf_glBindBufferARB (GL_PIXEL_PACK_BUFFER_ARB, grabber->pixel_buffer);
+      pf_glBufferDataARB (GL_PIXEL_PACK_BUFFER_ARB, width * height * 4, 0, GL_STREAM_READ_ARB);
+
+      grabber->width = width;
+      grabber->height = height;
+    }
+  else
+    {
+      pf_glBindBufferARB (GL_PIXEL_PACK_BUFFER_ARB, grabber->pixel_buffer);
+    }
+
+  /* In OpenGL, (x,y) specifies the bottom-left corner rather than the
+   * top-left */
+  glGetIntegerv (GL_VIEWPORT, vp_size);
+  y = vp_size[3] - (y + height);
+  glReadPixels (x, y, width, height, GL_BGRA, GL_UNSIGNED_BYTE, 0);
+
+  pf_glBindBufferARB (GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+  glPixelStorei (GL_PACK_SWAP_BYTES, old_swap_bytes);
+  glPixelStorei (GL_PACK_LSB_FIRST, old_lsb_first);
+  glPixelStorei (GL_PACK_ROW_LENGTH, old_row_length);
+  glPixelStorei (GL_PACK_SKIP_PIXELS, old_skip_pixels);
+  glPixelStorei (GL_PACK_SKIP_ROWS, old_skip_rows);
+  glPixelStorei (GL_PACK_ALIGNMENT, old_alignment);
+
+  if (grabber->have_pack_invert)
+    glPixelStorei (GL_PACK_INVERT_MESA, old_pack_invert);
+
+  return TRUE;
+}
+
+/**
+ * shell_screen_grabber_map: (skip)
+ * stride: (out): location to store the distance in bytes between the
+ *  starts of two consecutive rows; this is negative, since OpenGL
+ *  returns the rows bottom to top.
+ *
+ * Maps the data read back by shell_screen_grabber_begin_grab(), waiting
+ * for the transfer to finish if needed. This must be called from the
+ * main thread, but the returned data can then be read from any thread
+ * until shell_screen_grabber_unmap() is called.
+ *
+ * Return value: pointer to the top row of the grabbed data, in the same
+ *  format as shell_screen_grabber_grab(), or %NULL on failure.
+ **/
+const guchar *
+shell_screen_grabber_map (ShellScreenGrabber *grabber,
+                          int                *stride)
+{
+  GLubyte *mapped_data;
+  int row_bytes = grabber->width * 4;
+
+  g_return_val_if_fail (grabber->pixel_buffer != 0, NULL);
+
+  pf_glBindBufferARB (GL_PIXEL_PACK_BUFFER_ARB, grabber->pixel_buffer);
+  mapped_data = pf_glMapBufferARB (GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+  pf_glBindBufferARB (GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+  if (mapped_data == NULL)
+    return NULL;
+
+  *stride = - row_bytes;
+  return mapped_data + (grabber->height - 1) * row_bytes;
+}
+
+/**
+ * shell_screen_grabber_unmap: (skip)
+ *
+ * Releases the data returned by shell_screen_grabber_map().
+ **/
+void
+shell_screen_grabber_unmap (ShellScreenGrabber *grabber)
+{
+  g_return_if_fail (grabber->pixel_buffer != 0);
+
+  pf_glBindBufferARB (GL_PIXEL_PACK_BUFFER_ARB, grabber->pixel_buffer);
+  pf_glUnmapBufferARB (GL_PIXEL_PACK_BUFFER_ARB);
+  pf_glBindBufferARB (GL_PIXEL_PACK_BUFFER_ARB, 0);
+}
+
 /**
  * shell_screen_grabber_grab:
  * x: X coordinate of the rectangle to grab
@@ -95,107 +262,30 @@ shell_screen_grabber_grab (ShellScreenGrabber *grabber,
   data_size = row_bytes * height;
   data = g_malloc (data_size);
 
-  if (grabber->have_pixel_buffers == -1)
+  if (shell_screen_grabber_begin_grab (grabber, x, y, width, height))
     {
-      const GLubyte* extensions = glGetString (GL_EXTENSIONS);
-      grabber->have_pixel_buffers = strstr ((const char *)extensions, "GL_EXT_pixel_buffer_object") != NULL;
-      grabber->have_pack_invert = strstr ((const char *)extensions, "GL_MESA_pack_invert") != NULL;
-    }
-
-  if (grabber->have_pixel_buffers)
-    {
-      GLubyte *mapped_data;
-      GLint old_swap_bytes, old_lsb_first, old_row_length, old_skip_pixels, old_skip_rows, old_alignment;
-      GLint old_pack_invert = GL_FALSE;
-      GLint vp_size[4];
-      guchar *src_row, *dest_row;
+      const guchar *src_row;
+      guchar *dest_row;
+      int stride;
       int i;
 
-      cogl_flush ();
-
-      if (pf_glBindBufferARB == NULL)
-        {
-          pf_glBindBufferARB = (PFNGLBINDBUFFERARBPROC) cogl_get_proc_address ("glBindBufferARB");
-          pf_glBufferDataARB = (PFNGLBUFFERDATAARBPROC) cogl_get_proc_address ("glBufferDataARB");
-          pf_glDeleteBuffersARB = (PFNGLDELETEBUFFERSARBPROC) cogl_get_proc_address ("glDeleteBuffersARB");
-          pf_glGenBuffersARB = (PFNGLGENBUFFERSARBPROC) cogl_get_proc_address ("glGenBuffersARB");
-          pf_glMapBufferARB = (PFNGLMAPBUFFERARBPROC) cogl_get_proc_address ("glMapBufferARB");
-          pf_glUnmapBufferARB = (PFNGLUNMAPBUFFERARBPROC) cogl_get_proc_address ("glUnmapBufferARB");
-        }
-
-      glGetIntegerv (GL_PACK_SWAP_BYTES, &old_swap_bytes);
-      glGetIntegerv (GL_PACK_LSB_FIRST, &old_lsb_first);
-      glGetIntegerv (GL_PACK_ROW_LENGTH, &old_row_length);
-      glGetIntegerv (GL_PACK_SKIP_PIXELS, &old_skip_pixels);
-      glGetIntegerv (GL_PACK_SKIP_ROWS, &old_skip_rows);
-      glGetIntegerv (GL_PACK_ALIGNMENT, &old_alignment);
-
-      glPixelStorei (GL_PACK_SWAP_BYTES, GL_FALSE);
-      glPixelStorei (GL_PACK_LSB_FIRST, GL_FALSE);
-      glPixelStorei (GL_PACK_ROW_LENGTH, 0);
-      glPixelStorei (GL_PACK_SKIP_PIXELS, 0);
-      glPixelStorei (GL_PACK_SKIP_ROWS, 0);
-      glPixelStorei (GL_PACK_ALIGNMENT, 1);
-
-      if (grabber->have_pack_invert)
-        {
-          glGetIntegerv (GL_PACK_INVERT_MESA, &old_pack_invert);
-          glPixelStorei (GL_PACK_INVERT_MESA, GL_FALSE);
-        }
-
-      if (grabber->pixel_buffer != 0 &&
-          (grabber->width != width ||
-           grabber->height != height))
+      src_row = shell_screen_grabber_map (grabber, &stride);
+      if (src_row == NULL)
         {
-          pf_glDeleteBuffersARB (1, &grabber->pixel_buffer);
-          grabber->pixel_buffer = 0;
+          memset (data, 0, data_size);
+          return data;
         }
 
-      if (grabber->pixel_buffer == 0)
-        {
-          pf_glGenBuffersARB (1, &grabber->pixel_buffer);
-
-          pf_glBindBufferARB (GL_PIXEL_PACK_BUFFER_ARB, grabber->pixel_buffer);
-          pf_glBufferDataARB (GL_PIXEL_PACK_BUFFER_ARB, data_size, 0, GL_STREAM_READ_ARB);
-
-          grabber->width = width;
-          grabber->height = height;
-        }
-      else
-        {
-          pf_glBindBufferARB (GL_PIXEL_PACK_BUFFER_ARB, grabber->pixel_buffer);
-        }
-
-      /* In OpenGL, (x,y) specifies the bottom-left corner rather than the
-       * top-left */
-      glGetIntegerv (GL_VIEWPORT, vp_size);
-      y = vp_size[3] - (y + height);
-      glReadPixels (x, y, width, height, GL_BGRA, GL_UNSIGNED_BYTE, 0);
-
-      mapped_data = pf_glMapBufferARB (GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
-
-      src_row = mapped_data + (height - 1) * row_bytes;
       dest_row = data;
 
       for (i = 0; i < height; i++)
         {
           memcpy (dest_row, src_row, row_bytes);
-          src_row -= row_bytes;
+          src_row += stride;
           dest_row += row_bytes;
         }
 
-      pf_glUnmapBufferARB (GL_PIXEL_PACK_BUFFER_ARB);
-      pf_glBindBufferARB (GL_PIXEL_PACK_BUFFER_ARB, 0);
-
-      glPixelStorei (GL_PACK_SWAP_BYTES, old_swap_bytes);
-      glPixelStorei (GL_PACK_LSB_FIRST, old_lsb_first);
-      glPixelStorei (GL_PACK_ROW_LENGTH, old_row_length);
-      glPixelStorei (GL_PACK_SKIP_PIXELS, old_skip_pixels);
-      glPixelStorei (GL_PACK_SKIP_ROWS, old_skip_rows);
-      glPixelStorei (GL_PACK_ALIGNMENT, old_alignment);
-
-      if (grabber->have_pack_invert)
-        glPixelStorei (GL_PACK_INVERT_MESA, old_pack_invert);
+      shell_screen_grabber_unmap (grabber);
     }
   else
     {
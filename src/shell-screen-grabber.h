@@ -18,6 +18,11 @@ G_BEGIN_DECLS
  * screen, it makes sense to create one #ShellScreenGrabber and keep
  * it around. Otherwise, it's fine to simply create one as needed and
  * then get rid of it.
+ *
+ * shell_screen_grabber_begin_grab() together with
+ * shell_screen_grabber_map() allows to start the transfer while
+ * painting, and only access the data a bit later, once the GPU is
+ * done with it; the mapped data can be read from any thread.
  */
 
 typedef struct _ShellScreenGrabber      ShellScreenGrabber;
@@ -39,6 +44,15 @@ guchar *            shell_screen_grabber_grab (ShellScreenGrabber *grabber,
                                                int                 width,
                                                int                 height);
 
+gboolean            shell_screen_grabber_begin_grab (ShellScreenGrabber *grabber,
+                                                     int                 x,
+                                                     int                 y,
+                                                     int                 width,
+                                                     int                 height);
+const guchar *      shell_screen_grabber_map        (ShellScreenGrabber *grabber,
+                                                     int                *stride);
+void                shell_screen_grabber_unmap      (ShellScreenGrabber *grabber);
+
 G_END_DECLS
 
 #endif /* __SHELL_SCREEN_GRABBER_H__ */
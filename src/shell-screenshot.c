@@ -1,5 +1,7 @@
 /* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
 
+#include <string.h>
+
 #include <X11/extensions/Xfixes.h>
 #include <clutter/x11/clutter-x11.h>
 #include <clutter/clutter.h>
@@ -10,6 +12,7 @@
 #include <meta/meta-shaped-texture.h>
 
 #include "shell-global.h"
+#include "shell-image-encoder.h"
 #include "shell-screen-grabber.h"
 #include "shell-screenshot.h"
 
@@ -23,6 +26,9 @@ struct _ShellScreenshot
   GObject parent_instance;
 
   ShellGlobal *global;
+
+  ShellScreenshotFormat format;
+  GOutputStream *stream;
 };
 
 /* Used for async screenshot grabbing */
@@ -30,27 +36,69 @@ typedef struct _screenshot_data {
   ShellScreenshot  *screenshot;
 
   char *filename;
+  GOutputStream *stream;
+  ShellScreenshotFormat format;
 
   cairo_surface_t *image;
   cairo_rectangle_int_t screenshot_area;
 
+  /* When reading back through a pixel buffer, the image is only
+   * created from the mapped buffer in the writing thread */
+  ShellScreenGrabber *grabber;
+  const guchar *mapped_data;
+  int mapped_stride;
+
+  /* Parts of the screen that aren't covered by any monitor */
+  cairo_region_t *blank_region;
+
   gboolean include_cursor;
+  XFixesCursorImage *cursor_image;
 
   ShellScreenshotCallback callback;
 } _screenshot_data;
 
 G_DEFINE_TYPE(ShellScreenshot, shell_screenshot, G_TYPE_OBJECT);
 
+static void
+shell_screenshot_finalize (GObject *object)
+{
+  ShellScreenshot *screenshot = SHELL_SCREENSHOT (object);
+
+  g_clear_object (&screenshot->stream);
+
+  G_OBJECT_CLASS (shell_screenshot_parent_class)->finalize (object);
+}
+
 static void
 shell_screenshot_class_init (ShellScreenshotClass *screenshot_class)
 {
-  (void) screenshot_class;
+  GObjectClass *gobject_class = G_OBJECT_CLASS (screenshot_class);
+
+  gobject_class->finalize = shell_screenshot_finalize;
 }
 
 static void
 shell_screenshot_init (ShellScreenshot *screenshot)
 {
   screenshot->global = shell_global_get ();
+  screenshot->format = SHELL_SCREENSHOT_FORMAT_PNG;
+}
+
+static _screenshot_data *
+screenshot_data_new (ShellScreenshot         *screenshot,
+                     const char              *filename,
+                     ShellScreenshotCallback  callback)
+{
+  _screenshot_data *screenshot_data = g_new0 (_screenshot_data, 1);
+
+  screenshot_data->screenshot = g_object_ref (screenshot);
+  screenshot_data->filename = g_strdup (filename);
+  screenshot_data->format = screenshot->format;
+  if (screenshot->stream)
+    screenshot_data->stream = g_object_ref (screenshot->stream);
+  screenshot_data->callback = callback;
+
+  return screenshot_data;
 }
 
 static void
@@ -64,52 +112,31 @@ on_screenshot_written (GObject *source,
                                g_simple_async_result_get_op_res_gboolean (G_SIMPLE_ASYNC_RESULT (result)),
                                &screenshot_data->screenshot_area);
 
-  cairo_surface_destroy (screenshot_data->image);
+  if (screenshot_data->grabber)
+    {
+      if (screenshot_data->mapped_data)
+        shell_screen_grabber_unmap (screenshot_data->grabber);
+      g_object_unref (screenshot_data->grabber);
+    }
+
+  if (screenshot_data->image)
+    cairo_surface_destroy (screenshot_data->image);
+  if (screenshot_data->blank_region)
+    cairo_region_destroy (screenshot_data->blank_region);
+  if (screenshot_data->cursor_image)
+    XFree (screenshot_data->cursor_image);
+  if (screenshot_data->stream)
+    g_object_unref (screenshot_data->stream);
   g_object_unref (screenshot_data->screenshot);
   g_free (screenshot_data->filename);
   g_free (screenshot_data);
 }
 
-static void
-write_screenshot_thread (GSimpleAsyncResult *result,
-                         GObject *object,
-                         GCancellable *cancellable)
-{
-  cairo_status_t status;
-  _screenshot_data *screenshot_data = g_async_result_get_user_data (G_ASYNC_RESULT (result));
-  g_assert (screenshot_data != NULL);
-
-  status = cairo_surface_write_to_png (screenshot_data->image, screenshot_data->filename);
-  g_simple_async_result_set_op_res_gboolean (result, status == CAIRO_STATUS_SUCCESS);
-}
-
-static void
-do_grab_screenshot (_screenshot_data *screenshot_data,
-                    int               x,
-                    int               y,
-                    int               width,
-                    int               height)
-{
-  ShellScreenGrabber *grabber;
-  static const cairo_user_data_key_t key;
-  guchar *data;
-
-  grabber = shell_screen_grabber_new ();
-  data = shell_screen_grabber_grab (grabber, x, y, width, height);
-  g_object_unref (grabber);
-
-  screenshot_data->image = cairo_image_surface_create_for_data (data, CAIRO_FORMAT_RGB24,
-                                                               width, height, width * 4);
-  cairo_surface_set_user_data (screenshot_data->image, &key,
-                               data, (cairo_destroy_func_t)g_free);
-}
-
 static void
 _draw_cursor_image (cairo_surface_t *surface,
+                    XFixesCursorImage *cursor_image,
                     cairo_rectangle_int_t area)
 {
-  XFixesCursorImage *cursor_image;
-
   cairo_surface_t *cursor_surface;
   cairo_region_t *screenshot_region;
   cairo_t *cr;
@@ -118,16 +145,10 @@ _draw_cursor_image (cairo_surface_t *surface,
   int stride;
   int i, j;
 
-  cursor_image = XFixesGetCursorImage (clutter_x11_get_default_display ());
-
-  if (!cursor_image)
-    return;
-
   screenshot_region = cairo_region_create_rectangle (&area);
 
   if (!cairo_region_contains_point (screenshot_region, cursor_image->x, cursor_image->y))
     {
-       XFree (cursor_image);
        cairo_region_destroy (screenshot_region);
        return;
     }
@@ -156,7 +177,205 @@ _draw_cursor_image (cairo_surface_t *surface,
   cairo_destroy (cr);
   cairo_surface_destroy (cursor_surface);
   cairo_region_destroy (screenshot_region);
-  XFree (cursor_image);
+}
+
+static void
+copy_mapped_data (_screenshot_data *screenshot_data)
+{
+  int width = screenshot_data->screenshot_area.width;
+  int height = screenshot_data->screenshot_area.height;
+  const guchar *src_row = screenshot_data->mapped_data;
+  guchar *dest_row;
+  int dest_stride;
+  int i;
+
+  screenshot_data->image = cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, height);
+  dest_row = cairo_image_surface_get_data (screenshot_data->image);
+  dest_stride = cairo_image_surface_get_stride (screenshot_data->image);
+
+  for (i = 0; i < height; i++)
+    {
+      memcpy (dest_row, src_row, width * 4);
+      src_row += screenshot_data->mapped_stride;
+      dest_row += dest_stride;
+    }
+
+  cairo_surface_mark_dirty (screenshot_data->image);
+}
+
+static void
+fill_blank_region (cairo_surface_t *image,
+                   cairo_region_t  *region)
+{
+  cairo_t *cr;
+  int i;
+
+  cr = cairo_create (image);
+
+  for (i = 0; i < cairo_region_num_rectangles (region); i++)
+    {
+      cairo_rectangle_int_t rect;
+      cairo_region_get_rectangle (region, i, &rect);
+      cairo_rectangle (cr, (double) rect.x, (double) rect.y, (double) rect.width, (double) rect.height);
+      cairo_fill (cr);
+    }
+
+  cairo_destroy (cr);
+}
+
+static gboolean
+write_image (_screenshot_data *screenshot_data,
+             GError          **error)
+{
+  GOutputStream *stream;
+  ShellImageEncoding encoding;
+  int compression_level;
+  gboolean success;
+
+  switch (screenshot_data->format)
+    {
+    case SHELL_SCREENSHOT_FORMAT_PNG_FAST:
+      encoding = SHELL_IMAGE_ENCODING_PNG;
+      compression_level = 1;
+      break;
+    case SHELL_SCREENSHOT_FORMAT_PNG_UNCOMPRESSED:
+      encoding = SHELL_IMAGE_ENCODING_PNG;
+      compression_level = 0;
+      break;
+    case SHELL_SCREENSHOT_FORMAT_QOI:
+      encoding = SHELL_IMAGE_ENCODING_QOI;
+      compression_level = 0;
+      break;
+    case SHELL_SCREENSHOT_FORMAT_PNG:
+    default:
+      encoding = SHELL_IMAGE_ENCODING_PNG;
+      compression_level = 6;
+      break;
+    }
+
+  if (screenshot_data->stream)
+    {
+      stream = g_object_ref (screenshot_data->stream);
+    }
+  else
+    {
+      GFile *file = g_file_new_for_path (screenshot_data->filename);
+      stream = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error));
+      g_object_unref (file);
+
+      if (stream == NULL)
+        return FALSE;
+    }
+
+  success = shell_image_encoder_write (screenshot_data->image, encoding, compression_level,
+                                       stream, NULL, error);
+  if (success)
+    success = g_output_stream_close (stream, NULL, error);
+
+  g_object_unref (stream);
+
+  return success;
+}
+
+static void
+write_screenshot_thread (GSimpleAsyncResult *result,
+                         GObject *object,
+                         GCancellable *cancellable)
+{
+  _screenshot_data *screenshot_data = g_async_result_get_user_data (G_ASYNC_RESULT (result));
+  GError *error = NULL;
+  gboolean success;
+  g_assert (screenshot_data != NULL);
+
+  if (screenshot_data->mapped_data)
+    copy_mapped_data (screenshot_data);
+
+  if (screenshot_data->image == NULL)
+    {
+      g_simple_async_result_set_op_res_gboolean (result, FALSE);
+      return;
+    }
+
+  if (screenshot_data->blank_region)
+    fill_blank_region (screenshot_data->image, screenshot_data->blank_region);
+
+  if (screenshot_data->cursor_image)
+    _draw_cursor_image (screenshot_data->image,
+                        screenshot_data->cursor_image,
+                        screenshot_data->screenshot_area);
+
+  success = write_image (screenshot_data, &error);
+  if (!success)
+    {
+      g_warning ("Failed to write screenshot: %s", error->message);
+      g_error_free (error);
+    }
+
+  g_simple_async_result_set_op_res_gboolean (result, success);
+}
+
+static void
+run_write_screenshot_thread (_screenshot_data *screenshot_data)
+{
+  GSimpleAsyncResult *result;
+
+  result = g_simple_async_result_new (NULL, on_screenshot_written, (gpointer)screenshot_data, run_write_screenshot_thread);
+  g_simple_async_result_run_in_thread (result, write_screenshot_thread, G_PRIORITY_DEFAULT, NULL);
+  g_object_unref (result);
+}
+
+static gboolean
+map_screenshot_idle (gpointer user_data)
+{
+  _screenshot_data *screenshot_data = user_data;
+
+  screenshot_data->mapped_data = shell_screen_grabber_map (screenshot_data->grabber,
+                                                           &screenshot_data->mapped_stride);
+  run_write_screenshot_thread (screenshot_data);
+
+  return FALSE;
+}
+
+static void
+write_screenshot (_screenshot_data *screenshot_data)
+{
+  /* When the pixels are read back into a pixel buffer, let the GPU
+   * finish the transfer while the main loop goes on, and only map
+   * the buffer once we are idle; everything after that, including
+   * the copy out of the buffer, happens in the writing thread.
+   */
+  if (screenshot_data->grabber)
+    g_idle_add (map_screenshot_idle, screenshot_data);
+  else
+    run_write_screenshot_thread (screenshot_data);
+}
+
+static void
+do_grab_screenshot (_screenshot_data *screenshot_data,
+                    int               x,
+                    int               y,
+                    int               width,
+                    int               height)
+{
+  ShellScreenGrabber *grabber;
+  static const cairo_user_data_key_t key;
+  guchar *data;
+
+  grabber = shell_screen_grabber_new ();
+
+  if (shell_screen_grabber_begin_grab (grabber, x, y, width, height))
+    {
+      screenshot_data->grabber = grabber;
+      return;
+    }
+
+  data = shell_screen_grabber_grab (grabber, x, y, width, height);
+  g_object_unref (grabber);
+
+  screenshot_data->image = cairo_image_surface_create_for_data (data, CAIRO_FORMAT_RGB24,
+                                                               width, height, width * 4);
+  cairo_surface_set_user_data (screenshot_data->image, &key,
+                               data, (cairo_destroy_func_t)g_free);
 }
 
 static void
@@ -165,7 +384,6 @@ grab_screenshot (ClutterActor *stage,
 {
   MetaScreen *screen = shell_global_get_screen (screenshot_data->screenshot->global);
   int width, height;
-  GSimpleAsyncResult *result;
 
   meta_screen_get_size (screen, &width, &height);
 
@@ -178,7 +396,6 @@ grab_screenshot (ClutterActor *stage,
       MetaRectangle monitor_rect;
       cairo_rectangle_int_t stage_rect;
       int i;
-      cairo_t *cr;
 
       for (i = meta_screen_get_n_monitors (screen) - 1; i >= 0; i--)
         {
@@ -195,18 +412,8 @@ grab_screenshot (ClutterActor *stage,
       cairo_region_xor (stage_region, screen_region);
       cairo_region_destroy (screen_region);
 
-      cr = cairo_create (screenshot_data->image);
-
-      for (i = 0; i < cairo_region_num_rectangles (stage_region); i++)
-        {
-          cairo_rectangle_int_t rect;
-          cairo_region_get_rectangle (stage_region, i, &rect);
-          cairo_rectangle (cr, (double) rect.x, (double) rect.y, (double) rect.width, (double) rect.height);
-          cairo_fill (cr);
-        }
-
-      cairo_destroy (cr);
-      cairo_region_destroy (stage_region);
+      /* Filled in black by the writing thread */
+      screenshot_data->blank_region = stage_region;
     }
 
   screenshot_data->screenshot_area.x = 0;
@@ -215,21 +422,17 @@ grab_screenshot (ClutterActor *stage,
   screenshot_data->screenshot_area.height = height;
 
   if (screenshot_data->include_cursor)
-    _draw_cursor_image (screenshot_data->image, screenshot_data->screenshot_area);
+    screenshot_data->cursor_image = XFixesGetCursorImage (clutter_x11_get_default_display ());
 
   g_signal_handlers_disconnect_by_func (stage, (void *)grab_screenshot, (gpointer)screenshot_data);
 
-  result = g_simple_async_result_new (NULL, on_screenshot_written, (gpointer)screenshot_data, grab_screenshot);
-  g_simple_async_result_run_in_thread (result, write_screenshot_thread, G_PRIORITY_DEFAULT, NULL);
-  g_object_unref (result);
+  write_screenshot (screenshot_data);
 }
 
 static void
 grab_area_screenshot (ClutterActor *stage,
                       _screenshot_data *screenshot_data)
 {
-  GSimpleAsyncResult *result;
-
   do_grab_screenshot (screenshot_data,
                       screenshot_data->screenshot_area.x,
                       screenshot_data->screenshot_area.y,
@@ -237,21 +440,22 @@ grab_area_screenshot (ClutterActor *stage,
                       screenshot_data->screenshot_area.height);
 
   g_signal_handlers_disconnect_by_func (stage, (void *)grab_area_screenshot, (gpointer)screenshot_data);
-  result = g_simple_async_result_new (NULL, on_screenshot_written, (gpointer)screenshot_data, grab_area_screenshot);
-  g_simple_async_result_run_in_thread (result, write_screenshot_thread, G_PRIORITY_DEFAULT, NULL);
-  g_object_unref (result);
+
+  write_screenshot (screenshot_data);
 }
 
 /**
  * shell_screenshot_screenshot:
  * @screenshot: the #ShellScreenshot
  * @include_cursor: Whether to include the cursor or not
- * @filename: The filename for the screenshot
+ * @filename: (allow-none): The filename for the screenshot, or %NULL
+ * if a stream was set with shell_screenshot_set_stream()
  * @callback: (scope async): function to call returning success or failure
  * of the async grabbing
  *
  * Takes a screenshot of the whole screen
- * in @filename as png image.
+ * in @filename as png image, or in the format set with
+ * shell_screenshot_set_format().
  *
  */
 void
@@ -261,11 +465,8 @@ shell_screenshot_screenshot (ShellScreenshot *screenshot,
                              ShellScreenshotCallback callback)
 {
   ClutterActor *stage;
-  _screenshot_data *data = g_new0 (_screenshot_data, 1);
+  _screenshot_data *data = screenshot_data_new (screenshot, filename, callback);
 
-  data->screenshot = g_object_ref (screenshot);
-  data->filename = g_strdup (filename);
-  data->callback = callback;
   data->include_cursor = include_cursor;
 
   stage = CLUTTER_ACTOR (shell_global_get_stage (screenshot->global));
@@ -282,12 +483,14 @@ shell_screenshot_screenshot (ShellScreenshot *screenshot,
  * @y: The Y coordinate of the area
  * @width: The width of the area
  * @height: The height of the area
- * @filename: The filename for the screenshot
+ * @filename: (allow-none): The filename for the screenshot, or %NULL
+ * if a stream was set with shell_screenshot_set_stream()
  * @callback: (scope async): function to call returning success or failure
  * of the async grabbing
  *
  * Takes a screenshot of the passed in area and saves it
- * in @filename as png image.
+ * in @filename as png image, or in the format set with
+ * shell_screenshot_set_format().
  *
  */
 void
@@ -300,15 +503,12 @@ shell_screenshot_screenshot_area (ShellScreenshot *screenshot,
                                   ShellScreenshotCallback callback)
 {
   ClutterActor *stage;
-  _screenshot_data *data = g_new0 (_screenshot_data, 1);
+  _screenshot_data *data = screenshot_data_new (screenshot, filename, callback);
 
-  data->screenshot = g_object_ref (screenshot);
-  data->filename = g_strdup (filename);
   data->screenshot_area.x = x;
   data->screenshot_area.y = y;
   data->screenshot_area.width = width;
   data->screenshot_area.height = height;
-  data->callback = callback;
 
   stage = CLUTTER_ACTOR (shell_global_get_stage (screenshot->global));
 
@@ -322,12 +522,14 @@ shell_screenshot_screenshot_area (ShellScreenshot *screenshot,
  * @screenshot: the #ShellScreenshot
  * @include_frame: Whether to include the frame or not
  * @include_cursor: Whether to include the cursor or not
- * @filename: The filename for the screenshot
+ * @filename: (allow-none): The filename for the screenshot, or %NULL
+ * if a stream was set with shell_screenshot_set_stream()
  * @callback: (scope async): function to call returning success or failure
  * of the async grabbing
  *
  * Takes a screenshot of the focused window (optionally omitting the frame)
- * in @filename as png image.
+ * in @filename as png image, or in the format set with
+ * shell_screenshot_set_format().
  *
  */
 void
@@ -337,9 +539,7 @@ shell_screenshot_screenshot_window (ShellScreenshot *screenshot,
                                     const char *filename,
                                     ShellScreenshotCallback callback)
 {
-  GSimpleAsyncResult *result;
-
-  _screenshot_data *screenshot_data = g_new0 (_screenshot_data, 1);
+  _screenshot_data *screenshot_data = screenshot_data_new (screenshot, filename, callback);
 
   MetaScreen *screen = shell_global_get_screen (screenshot->global);
   MetaDisplay *display = meta_screen_get_display (screen);
@@ -350,10 +550,6 @@ shell_screenshot_screenshot_window (ShellScreenshot *screenshot,
   MetaRectangle rect;
   cairo_rectangle_int_t clip;
 
-  screenshot_data->screenshot = g_object_ref (screenshot);
-  screenshot_data->filename = g_strdup (filename);
-  screenshot_data->callback = callback;
-
   window_actor = CLUTTER_ACTOR (meta_window_get_compositor_private (window));
   clutter_actor_get_position (window_actor, &actor_x, &actor_y);
 
@@ -385,11 +581,61 @@ shell_screenshot_screenshot_window (ShellScreenshot *screenshot,
   screenshot_data->image = meta_shaped_texture_get_image (stex, &clip);
 
   if (include_cursor)
-    _draw_cursor_image (screenshot_data->image, screenshot_data->screenshot_area);
+    screenshot_data->cursor_image = XFixesGetCursorImage (clutter_x11_get_default_display ());
 
-  result = g_simple_async_result_new (NULL, on_screenshot_written, (gpointer)screenshot_data, shell_screenshot_screenshot_window);
-  g_simple_async_result_run_in_thread (result, write_screenshot_thread, G_PRIORITY_DEFAULT, NULL);
-  g_object_unref (result);
+  write_screenshot (screenshot_data);
+}
+
+/**
+ * shell_screenshot_set_format:
+ * @screenshot: the #ShellScreenshot
+ * @format: a #ShellScreenshotFormat
+ *
+ * Sets the file format used for the following screenshots.
+ */
+void
+shell_screenshot_set_format (ShellScreenshot       *screenshot,
+                             ShellScreenshotFormat  format)
+{
+  g_return_if_fail (SHELL_IS_SCREENSHOT (screenshot));
+
+  screenshot->format = format;
+}
+
+/**
+ * shell_screenshot_get_format:
+ * @screenshot: the #ShellScreenshot
+ *
+ * Return value: the file format used for screenshots
+ */
+ShellScreenshotFormat
+shell_screenshot_get_format (ShellScreenshot *screenshot)
+{
+  g_return_val_if_fail (SHELL_IS_SCREENSHOT (screenshot), SHELL_SCREENSHOT_FORMAT_PNG);
+
+  return screenshot->format;
+}
+
+/**
+ * shell_screenshot_set_stream:
+ * @screenshot: the #ShellScreenshot
+ * @stream: (allow-none): a #GOutputStream, or %NULL
+ *
+ * Makes the following screenshots be written to @stream instead of
+ * the passed in filename; the stream is closed once the image has
+ * been written. Setting %NULL goes back to writing files.
+ */
+void
+shell_screenshot_set_stream (ShellScreenshot *screenshot,
+                             GOutputStream   *stream)
+{
+  g_return_if_fail (SHELL_IS_SCREENSHOT (screenshot));
+
+  if (stream)
+    g_object_ref (stream);
+  if (screenshot->stream)
+    g_object_unref (screenshot->stream);
+  screenshot->stream = stream;
 }
 
 ShellScreenshot *
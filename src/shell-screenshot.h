@@ -9,8 +9,16 @@
  * The #ShellScreenshot object is used to take screenshots of screen
  * areas or windows and write them out as png files.
  *
+ * Reading back the pixels, drawing the cursor and encoding the image
+ * all happen off the main loop; the encoding is split in strips that
+ * are compressed in parallel. The output format can be picked with
+ * shell_screenshot_set_format(), and the image can be written to a
+ * #GOutputStream rather than a file with shell_screenshot_set_stream().
+ *
  */
 
+#include <gio/gio.h>
+
 typedef struct _ShellScreenshot      ShellScreenshot;
 typedef struct _ShellScreenshotClass ShellScreenshotClass;
 
@@ -25,6 +33,31 @@ GType shell_screenshot_get_type (void) G_GNUC_CONST;
 
 ShellScreenshot *shell_screenshot_new (void);
 
+/**
+ * ShellScreenshotFormat:
+ * @SHELL_SCREENSHOT_FORMAT_PNG: PNG with the default compression
+ * @SHELL_SCREENSHOT_FORMAT_PNG_FAST: PNG with the fastest compression level
+ * @SHELL_SCREENSHOT_FORMAT_PNG_UNCOMPRESSED: PNG with uncompressed data;
+ *  largest files, but nearly no CPU cost
+ * @SHELL_SCREENSHOT_FORMAT_QOI: the "Quite OK Image" format, which
+ *  compresses almost as well as fast PNG at a fraction of the cost
+ *
+ * File formats that screenshots can be written in.
+ */
+typedef enum {
+  SHELL_SCREENSHOT_FORMAT_PNG,
+  SHELL_SCREENSHOT_FORMAT_PNG_FAST,
+  SHELL_SCREENSHOT_FORMAT_PNG_UNCOMPRESSED,
+  SHELL_SCREENSHOT_FORMAT_QOI
+} ShellScreenshotFormat;
+
+void                  shell_screenshot_set_format (ShellScreenshot       *screenshot,
+                                                   ShellScreenshotFormat  format);
+ShellScreenshotFormat shell_screenshot_get_format (ShellScreenshot       *screenshot);
+
+void                  shell_screenshot_set_stream (ShellScreenshot       *screenshot,
+                                                   GOutputStream         *stream);
+
 typedef void (*ShellScreenshotCallback)  (ShellScreenshot *screenshot,
                                            gboolean success,
                                            cairo_rectangle_int_t *screenshot_area);
@@ -0,0 +1,418 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "shell-search-matcher.h"
+#include "shell-util.h"
+
+/**
+ * SECTION:shell-search-matcher
+ * @short_description: Match and rank search results
+ *
+ * #ShellSearchMatcher is shared by the local search providers so that
+ * their results are matched and ranked consistently. A matcher is
+ * created once per search with the search terms; each candidate is
+ * then matched by adding its fields between shell_search_matcher_begin()
+ * and shell_search_matcher_end(), which returns the candidate's score.
+ *
+ * Each term is matched against each field, and the best match of
+ * the term over all fields counts. A term matches the start of a
+ * field, the start of a word in it, any substring, or - for longer
+ * terms - a word starting with something within a small edit distance
+ * of the term, in decreasing order of relevance. The score of a
+ * candidate is the sum of the scores of its terms, or 0 if any of
+ * the terms doesn't match at all.
+ */
+
+/* Terms need to be this long (in bytes) to be matched approximately,
+ * and from twice that length we allow two edits instead of one. */
+#define MIN_FUZZY_TERM_LENGTH 4
+#define MAX_FUZZY_TERM_LENGTH 32
+
+struct _ShellSearchMatcher
+{
+  GObject parent;
+
+  guint n_terms;
+  char **terms;
+  gsize *term_lengths;
+
+  /* Best score of each term in the current candidate */
+  guint *scores;
+};
+
+struct _ShellSearchMatcherClass
+{
+  GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE (ShellSearchMatcher, shell_search_matcher, G_TYPE_OBJECT);
+
+static void
+shell_search_matcher_init (ShellSearchMatcher *matcher)
+{
+}
+
+static void
+shell_search_matcher_finalize (GObject *object)
+{
+  ShellSearchMatcher *matcher = SHELL_SEARCH_MATCHER (object);
+
+  g_strfreev (matcher->terms);
+  g_free (matcher->term_lengths);
+  g_free (matcher->scores);
+
+  G_OBJECT_CLASS (shell_search_matcher_parent_class)->finalize (object);
+}
+
+static void
+shell_search_matcher_class_init (ShellSearchMatcherClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = shell_search_matcher_finalize;
+}
+
+/**
+ * shell_search_matcher_new:
+ * @terms: (element-type utf8): List of terms, logical AND
+ *
+ * Returns: (transfer full): a new #ShellSearchMatcher for @terms
+ */
+ShellSearchMatcher *
+shell_search_matcher_new (GSList *terms)
+{
+  ShellSearchMatcher *matcher;
+  GSList *iter;
+  guint i;
+
+  matcher = g_object_new (SHELL_TYPE_SEARCH_MATCHER, NULL);
+
+  matcher->n_terms = g_slist_length (terms);
+  matcher->terms = g_new0 (char *, matcher->n_terms + 1);
+  matcher->term_lengths = g_new0 (gsize, matcher->n_terms);
+  matcher->scores = g_new0 (guint, matcher->n_terms);
+
+  for (iter = terms, i = 0; iter; iter = iter->next, i++)
+    {
+      matcher->terms[i] = shell_util_normalize_and_casefold (iter->data);
+      matcher->term_lengths[i] = strlen (matcher->terms[i]);
+    }
+
+  return matcher;
+}
+
+/**
+ * shell_search_matcher_get_n_terms:
+ * @matcher: a #ShellSearchMatcher
+ *
+ * Returns: the number of search terms
+ */
+guint
+shell_search_matcher_get_n_terms (ShellSearchMatcher *matcher)
+{
+  g_return_val_if_fail (SHELL_IS_SEARCH_MATCHER (matcher), 0);
+
+  return matcher->n_terms;
+}
+
+static inline gboolean
+is_word_separator (char c)
+{
+  return c == ' ' || c == '-' || c == '_' || c == '.' ||
+         c == '/' || c == '@' || c == '(' || c == ',';
+}
+
+/* Finds the best exact occurrence of @term in @text. We look for the
+ * first byte with memchr(), which the C library vectorizes, and only
+ * compare the rest of the term at the candidate positions; unlike
+ * strstr() this also lets us look past the first occurrence for one
+ * at a word boundary.
+ */
+static guint
+match_exact (const char            *text,
+             gsize                  text_length,
+             const char            *term,
+             gsize                  term_length,
+             ShellSearchFieldFlags  flags)
+{
+  const char *p, *last;
+  guint score = 0;
+
+  if (term_length == 0 || term_length > text_length)
+    return 0;
+
+  p = text;
+  last = text + text_length - term_length;
+
+  while (p <= last)
+    {
+      p = memchr (p, term[0], last - p + 1);
+      if (p == NULL)
+        break;
+
+      if (memcmp (p + 1, term + 1, term_length - 1) == 0)
+        {
+          if (flags & SHELL_SEARCH_FIELD_NO_PREFIX)
+            return SHELL_SEARCH_SCORE_SUBSTRING;
+
+          if (p == text)
+            return SHELL_SEARCH_SCORE_PREFIX;
+
+          if (is_word_separator (p[-1]))
+            score = SHELL_SEARCH_SCORE_WORD_PREFIX;
+          else if (score == 0)
+            score = SHELL_SEARCH_SCORE_SUBSTRING;
+        }
+
+      p++;
+    }
+
+  return score;
+}
+
+/* Computes the smallest optimal string alignment distance between
+ * @term and any prefix of @word, giving up once it exceeds
+ * @max_distance; in that case max_distance + 1 is returned.
+ */
+static guint
+prefix_edit_distance (const char *term,
+                      gsize       term_length,
+                      const char *word,
+                      gsize       word_length,
+                      guint       max_distance)
+{
+  guint rows[3][MAX_FUZZY_TERM_LENGTH + 1];
+  guint *prev2 = rows[0], *prev = rows[1], *cur = rows[2], *tmp;
+  guint best, row_min, value;
+  gsize i, j;
+
+  for (i = 0; i <= term_length; i++)
+    prev[i] = i;
+  best = prev[term_length];
+
+  word_length = MIN (word_length, term_length + max_distance);
+
+  for (j = 1; j <= word_length; j++)
+    {
+      cur[0] = j;
+      row_min = cur[0];
+
+      for (i = 1; i <= term_length; i++)
+        {
+          value = prev[i - 1] + (word[j - 1] != term[i - 1]);
+          value = MIN (value, prev[i] + 1);
+          value = MIN (value, cur[i - 1] + 1);
+
+          if (i > 1 && j > 1 &&
+              word[j - 1] == term[i - 2] && word[j - 2] == term[i - 1])
+            value = MIN (value, prev2[i - 2] + 1);
+
+          cur[i] = value;
+          row_min = MIN (row_min, value);
+        }
+
+      best = MIN (best, cur[term_length]);
+      if (row_min > max_distance)
+        break;
+
+      tmp = prev2;
+      prev2 = prev;
+      prev = cur;
+      cur = tmp;
+    }
+
+  return MIN (best, max_distance + 1);
+}
+
+static guint
+get_max_distance (gsize term_length)
+{
+  if (term_length < MIN_FUZZY_TERM_LENGTH ||
+      term_length > MAX_FUZZY_TERM_LENGTH)
+    return 0;
+
+  return term_length >= 2 * MIN_FUZZY_TERM_LENGTH ? 2 : 1;
+}
+
+static guint
+match_fuzzy (const char *text,
+             gsize       text_length,
+             const char *term,
+             gsize       term_length)
+{
+  const char *p, *end, *word_end;
+  guint max_distance, distance, best;
+
+  max_distance = get_max_distance (term_length);
+  if (max_distance == 0)
+    return 0;
+
+  best = max_distance + 1;
+
+  p = text;
+  end = text + text_length;
+  while (p < end && best > 0)
+    {
+      word_end = p;
+      while (word_end < end && !is_word_separator (*word_end))
+        word_end++;
+
+      if (word_end > p)
+        {
+          distance = prefix_edit_distance (term, term_length,
+                                           p, word_end - p,
+                                           max_distance);
+          best = MIN (best, distance);
+        }
+
+      p = word_end + 1;
+    }
+
+  if (best > max_distance)
+    return 0;
+
+  return best <= 1 ? SHELL_SEARCH_SCORE_FUZZY : SHELL_SEARCH_SCORE_FUZZY / 2;
+}
+
+/**
+ * shell_search_matcher_get_max_edits:
+ * @term: a search term
+ *
+ * Extending a term normally only makes it match fewer candidates, so
+ * that the results for the longer term can be found among those for
+ * the shorter one. That is not the case when the longer term is
+ * allowed more edits, for instance when it becomes long enough to be
+ * matched approximately at all; callers narrowing down previous
+ * results must then start over.
+ *
+ * Returns: the number of edits with which @term can still match a
+ *   word, or 0 if it only matches exactly
+ */
+guint
+shell_search_matcher_get_max_edits (const char *term)
+{
+  char *normalized;
+  guint result;
+
+  g_return_val_if_fail (term != NULL, 0);
+
+  normalized = shell_util_normalize_and_casefold (term);
+  result = get_max_distance (strlen (normalized));
+  g_free (normalized);
+
+  return result;
+}
+
+/**
+ * shell_search_matcher_begin:
+ * @matcher: a #ShellSearchMatcher
+ *
+ * Starts matching a new candidate; add its fields with
+ * shell_search_matcher_add_field().
+ */
+void
+shell_search_matcher_begin (ShellSearchMatcher *matcher)
+{
+  g_return_if_fail (SHELL_IS_SEARCH_MATCHER (matcher));
+
+  memset (matcher->scores, 0, matcher->n_terms * sizeof (guint));
+}
+
+/**
+ * shell_search_matcher_add_field:
+ * @matcher: a #ShellSearchMatcher
+ * @text: (allow-none): the contents of the field, normalized and
+ *   casefolded with shell_util_normalize_and_casefold() unless @flags
+ *   contains %SHELL_SEARCH_FIELD_NORMALIZE
+ * @weight: relevance of the field, in percent
+ * @flags: how to match the field
+ *
+ * Matches all terms against a field of the current candidate.
+ */
+void
+shell_search_matcher_add_field (ShellSearchMatcher    *matcher,
+                                const char            *text,
+                                guint                  weight,
+                                ShellSearchFieldFlags  flags)
+{
+  char *normalized = NULL;
+  gsize text_length;
+  guint i, score;
+
+  g_return_if_fail (SHELL_IS_SEARCH_MATCHER (matcher));
+
+  if (text == NULL)
+    return;
+
+  if (flags & SHELL_SEARCH_FIELD_NORMALIZE)
+    text = normalized = shell_util_normalize_and_casefold (text);
+
+  text_length = strlen (text);
+
+  for (i = 0; i < matcher->n_terms; i++)
+    {
+      /* Nothing in this field can beat what we have */
+      if (matcher->scores[i] >= SHELL_SEARCH_SCORE_PREFIX * weight / 100)
+        continue;
+
+      score = match_exact (text, text_length,
+                           matcher->terms[i], matcher->term_lengths[i],
+                           flags);
+
+      if (score == 0 && !(flags & SHELL_SEARCH_FIELD_NO_FUZZY) &&
+          matcher->scores[i] < SHELL_SEARCH_SCORE_FUZZY * weight / 100)
+        score = match_fuzzy (text, text_length,
+                             matcher->terms[i], matcher->term_lengths[i]);
+
+      score = score * weight / 100;
+      matcher->scores[i] = MAX (matcher->scores[i], score);
+    }
+
+  g_free (normalized);
+}
+
+/**
+ * shell_search_matcher_end:
+ * @matcher: a #ShellSearchMatcher
+ *
+ * Returns: the score of the current candidate; 0 if it doesn't match
+ */
+guint
+shell_search_matcher_end (ShellSearchMatcher *matcher)
+{
+  guint i, score = 0;
+
+  g_return_val_if_fail (SHELL_IS_SEARCH_MATCHER (matcher), 0);
+
+  for (i = 0; i < matcher->n_terms; i++)
+    {
+      if (matcher->scores[i] == 0)
+        return 0;
+
+      score += matcher->scores[i];
+    }
+
+  return score;
+}
+
+/**
+ * shell_search_matcher_match:
+ * @matcher: a #ShellSearchMatcher
+ * @text: (allow-none): text to match, not normalized
+ *
+ * Convenience function to match a candidate with a single field.
+ *
+ * Returns: the score of @text; 0 if it doesn't match
+ */
+guint
+shell_search_matcher_match (ShellSearchMatcher *matcher,
+                            const char         *text)
+{
+  shell_search_matcher_begin (matcher);
+  shell_search_matcher_add_field (matcher, text, 100,
+                                  SHELL_SEARCH_FIELD_NORMALIZE);
+  return shell_search_matcher_end (matcher);
+}
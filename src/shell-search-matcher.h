@@ -0,0 +1,63 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_SEARCH_MATCHER_H__
+#define __SHELL_SEARCH_MATCHER_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/**
+ * ShellSearchFieldFlags:
+ * @SHELL_SEARCH_FIELD_NONE: default matching
+ * @SHELL_SEARCH_FIELD_NORMALIZE: the text is not normalized and
+ *   casefolded yet; the matcher will do it
+ * @SHELL_SEARCH_FIELD_NO_PREFIX: matches at the start of the field or
+ *   of a word in it are not more relevant than other substrings, e.g.
+ *   for descriptions
+ * @SHELL_SEARCH_FIELD_NO_FUZZY: only exact matches are allowed, e.g.
+ *   for addresses or command lines
+ */
+typedef enum {
+  SHELL_SEARCH_FIELD_NONE      = 0,
+  SHELL_SEARCH_FIELD_NORMALIZE = 1 << 0,
+  SHELL_SEARCH_FIELD_NO_PREFIX = 1 << 1,
+  SHELL_SEARCH_FIELD_NO_FUZZY  = 1 << 2
+} ShellSearchFieldFlags;
+
+/* Score of a single term matching a field of weight 100 */
+#define SHELL_SEARCH_SCORE_PREFIX      100
+#define SHELL_SEARCH_SCORE_WORD_PREFIX 90
+#define SHELL_SEARCH_SCORE_SUBSTRING   50
+#define SHELL_SEARCH_SCORE_FUZZY       30
+
+typedef struct _ShellSearchMatcher      ShellSearchMatcher;
+typedef struct _ShellSearchMatcherClass ShellSearchMatcherClass;
+
+#define SHELL_TYPE_SEARCH_MATCHER              (shell_search_matcher_get_type ())
+#define SHELL_SEARCH_MATCHER(object)           (G_TYPE_CHECK_INSTANCE_CAST ((object), SHELL_TYPE_SEARCH_MATCHER, ShellSearchMatcher))
+#define SHELL_SEARCH_MATCHER_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST ((klass), SHELL_TYPE_SEARCH_MATCHER, ShellSearchMatcherClass))
+#define SHELL_IS_SEARCH_MATCHER(object)        (G_TYPE_CHECK_INSTANCE_TYPE ((object), SHELL_TYPE_SEARCH_MATCHER))
+#define SHELL_IS_SEARCH_MATCHER_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE ((klass), SHELL_TYPE_SEARCH_MATCHER))
+#define SHELL_SEARCH_MATCHER_GET_CLASS(obj)    (G_TYPE_INSTANCE_GET_CLASS ((obj), SHELL_TYPE_SEARCH_MATCHER, ShellSearchMatcherClass))
+
+GType shell_search_matcher_get_type (void) G_GNUC_CONST;
+
+ShellSearchMatcher *shell_search_matcher_new (GSList *terms);
+
+guint shell_search_matcher_get_n_terms (ShellSearchMatcher *matcher);
+
+guint shell_search_matcher_get_max_edits (const char *term);
+
+void  shell_search_matcher_begin     (ShellSearchMatcher    *matcher);
+void  shell_search_matcher_add_field (ShellSearchMatcher    *matcher,
+                                      const char            *text,
+                                      guint                  weight,
+                                      ShellSearchFieldFlags  flags);
+guint shell_search_matcher_end       (ShellSearchMatcher    *matcher);
+
+guint shell_search_matcher_match     (ShellSearchMatcher    *matcher,
+                                      const char            *text);
+
+G_END_DECLS
+
+#endif /* __SHELL_SEARCH_MATCHER_H__ */
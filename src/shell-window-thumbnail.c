@@ -0,0 +1,543 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * SECTION:shell-window-thumbnail
+ * @short_description: Reduced-resolution clone of a window
+ *
+ * #ShellWindowThumbnail is used like a #ClutterClone of a window
+ * texture, but is meant for showing the window much smaller than its
+ * actual size, as in the overview and the workspace thumbnails.
+ *
+ * Sampling a full-size window texture for every frame of a tiny
+ * thumbnail wastes a lot of texture bandwidth, so the thumbnail
+ * renders its source into a texture at a reduced resolution instead:
+ * the size of the window halved as often as possible without getting
+ * smaller than the size the thumbnail is displayed at. Like the levels
+ * of a mipmap, this only changes when the displayed size crosses a
+ * power of two, so we don't need to re-render while the thumbnail is
+ * scaled in an animation. The texture is only updated when the window
+ * is damaged; if #ShellWindowThumbnail:throttled is set, at most once
+ * per second.
+ */
+
+#include "config.h"
+
+#include <math.h>
+
+#include "shell-window-thumbnail.h"
+
+/* Minimum time between updates of a throttled thumbnail */
+#define THROTTLE_INTERVAL_MSEC 1000
+
+/* Don't halve the size of the window more often than this */
+#define MAX_LEVEL 8
+
+struct _ShellWindowThumbnailPrivate {
+  ClutterActor *source;
+  ClutterActor *clone;
+
+  guint throttled : 1;
+  guint dirty : 1;
+
+  CoglHandle texture;
+  CoglHandle offscreen;
+  CoglHandle material;
+  guint8 texture_opacity;
+
+  gint64 last_update_time;
+  guint throttle_timeout_id;
+};
+
+G_DEFINE_TYPE (ShellWindowThumbnail, shell_window_thumbnail, CLUTTER_TYPE_ACTOR);
+
+enum {
+  PROP_0,
+
+  PROP_SOURCE,
+  PROP_THROTTLED
+};
+
+static void
+shell_window_thumbnail_clear_texture (ShellWindowThumbnail *self)
+{
+  ShellWindowThumbnailPrivate *priv = self->priv;
+
+  if (priv->material != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (priv->material);
+      priv->material = COGL_INVALID_HANDLE;
+    }
+  if (priv->offscreen != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (priv->offscreen);
+      priv->offscreen = COGL_INVALID_HANDLE;
+    }
+  if (priv->texture != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (priv->texture);
+      priv->texture = COGL_INVALID_HANDLE;
+    }
+}
+
+static void
+on_source_queue_redraw (ClutterActor         *source,
+                        ClutterActor         *origin,
+                        ShellWindowThumbnail *self)
+{
+  /* The clone propagates the redraw to us; we only need to remember
+   * that our texture is out of date */
+  self->priv->dirty = TRUE;
+}
+
+static void
+on_source_destroy (ClutterActor         *source,
+                   ShellWindowThumbnail *self)
+{
+  ShellWindowThumbnailPrivate *priv = self->priv;
+
+  g_signal_handlers_disconnect_by_func (priv->source,
+                                        (gpointer)on_source_queue_redraw,
+                                        self);
+  g_signal_handlers_disconnect_by_func (priv->source,
+                                        (gpointer)on_source_destroy,
+                                        self);
+  g_object_unref (priv->source);
+  priv->source = NULL;
+}
+
+static void
+shell_window_thumbnail_set_source (ShellWindowThumbnail *self,
+                                   ClutterActor         *source)
+{
+  ShellWindowThumbnailPrivate *priv = self->priv;
+
+  if (priv->source)
+    on_source_destroy (priv->source, self);
+
+  if (source)
+    {
+      priv->source = g_object_ref (source);
+      g_signal_connect (source, "queue-redraw",
+                        G_CALLBACK (on_source_queue_redraw), self);
+      g_signal_connect (source, "destroy",
+                        G_CALLBACK (on_source_destroy), self);
+    }
+
+  clutter_clone_set_source (CLUTTER_CLONE (priv->clone), source);
+  priv->dirty = TRUE;
+}
+
+static void
+shell_window_thumbnail_get_preferred_width (ClutterActor *actor,
+                                            gfloat        for_height,
+                                            gfloat       *min_width_p,
+                                            gfloat       *natural_width_p)
+{
+  ShellWindowThumbnail *self = SHELL_WINDOW_THUMBNAIL (actor);
+
+  clutter_actor_get_preferred_width (self->priv->clone, for_height,
+                                     min_width_p, natural_width_p);
+}
+
+static void
+shell_window_thumbnail_get_preferred_height (ClutterActor *actor,
+                                             gfloat        for_width,
+                                             gfloat       *min_height_p,
+                                             gfloat       *natural_height_p)
+{
+  ShellWindowThumbnail *self = SHELL_WINDOW_THUMBNAIL (actor);
+
+  clutter_actor_get_preferred_height (self->priv->clone, for_width,
+                                      min_height_p, natural_height_p);
+}
+
+static void
+shell_window_thumbnail_allocate (ClutterActor           *actor,
+                                 const ClutterActorBox  *box,
+                                 ClutterAllocationFlags  flags)
+{
+  ShellWindowThumbnail *self = SHELL_WINDOW_THUMBNAIL (actor);
+
+  clutter_actor_set_allocation (actor, box, flags);
+
+  /* The clone is always at the natural size of the window, and we
+   * scale it when painting */
+  clutter_actor_allocate_preferred_size (self->priv->clone, flags);
+}
+
+/* Paints the clone of the window scaled to @width x @height */
+static void
+shell_window_thumbnail_paint_clone (ShellWindowThumbnail *self,
+                                    float                 width,
+                                    float                 height)
+{
+  ClutterActor *clone = self->priv->clone;
+  float clone_width, clone_height;
+
+  clutter_actor_get_size (clone, &clone_width, &clone_height);
+  if (clone_width == 0 || clone_height == 0)
+    return;
+
+  cogl_push_matrix ();
+  cogl_scale (width / clone_width, height / clone_height, 1.0);
+  clutter_actor_paint (clone);
+  cogl_pop_matrix ();
+}
+
+static gboolean
+on_throttle_timeout (gpointer data)
+{
+  ShellWindowThumbnail *self = data;
+
+  self->priv->throttle_timeout_id = 0;
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (self));
+
+  return FALSE;
+}
+
+/* Returns whether the texture can be painted; that is also the case
+ * if it is out of date, but we aren't allowed to update it yet. */
+static gboolean
+shell_window_thumbnail_update_texture (ShellWindowThumbnail *self,
+                                       int                   texture_width,
+                                       int                   texture_height,
+                                       guint8                paint_opacity)
+{
+  ShellWindowThumbnailPrivate *priv = self->priv;
+  CoglColor clear_color;
+  gint64 now;
+
+  if (priv->texture != COGL_INVALID_HANDLE &&
+      (cogl_texture_get_width (priv->texture) != texture_width ||
+       cogl_texture_get_height (priv->texture) != texture_height))
+    shell_window_thumbnail_clear_texture (self);
+
+  now = g_get_monotonic_time ();
+
+  if (priv->texture != COGL_INVALID_HANDLE &&
+      priv->texture_opacity == paint_opacity)
+    {
+      if (!priv->dirty)
+        return TRUE;
+
+      if (priv->throttled &&
+          now - priv->last_update_time < THROTTLE_INTERVAL_MSEC * 1000)
+        {
+          if (priv->throttle_timeout_id == 0)
+            priv->throttle_timeout_id =
+              g_timeout_add (THROTTLE_INTERVAL_MSEC - (now - priv->last_update_time) / 1000,
+                             on_throttle_timeout, self);
+          return TRUE;
+        }
+    }
+
+  if (priv->texture == COGL_INVALID_HANDLE)
+    {
+      priv->texture = cogl_texture_new_with_size (texture_width, texture_height,
+                                                  COGL_TEXTURE_NO_SLICING,
+                                                  COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+      if (priv->texture == COGL_INVALID_HANDLE)
+        return FALSE;
+
+      priv->offscreen = cogl_offscreen_new_to_texture (priv->texture);
+      if (priv->offscreen == COGL_INVALID_HANDLE)
+        {
+          shell_window_thumbnail_clear_texture (self);
+          return FALSE;
+        }
+
+      priv->material = cogl_material_new ();
+      cogl_material_set_layer (priv->material, 0, priv->texture);
+    }
+
+  cogl_push_framebuffer (priv->offscreen);
+  cogl_ortho (0, texture_width, texture_height, 0, 0, 1.0);
+
+  cogl_color_set_from_4ub (&clear_color, 0, 0, 0, 0);
+  cogl_clear (&clear_color, COGL_BUFFER_BIT_COLOR);
+
+  /* The paint opacity of the clone ends up in the texture */
+  shell_window_thumbnail_paint_clone (self, texture_width, texture_height);
+  cogl_pop_framebuffer ();
+
+  priv->texture_opacity = paint_opacity;
+  priv->last_update_time = now;
+  priv->dirty = FALSE;
+
+  return TRUE;
+}
+
+static void
+shell_window_thumbnail_paint (ClutterActor *actor)
+{
+  ShellWindowThumbnail *self = SHELL_WINDOW_THUMBNAIL (actor);
+  ShellWindowThumbnailPrivate *priv = self->priv;
+  ClutterActorBox box;
+  float width, height, paint_width, paint_height;
+  int level;
+
+  if (priv->source == NULL)
+    return;
+
+  clutter_actor_get_allocation_box (actor, &box);
+  clutter_actor_box_get_size (&box, &width, &height);
+  clutter_actor_get_transformed_size (actor, &paint_width, &paint_height);
+
+  level = 0;
+  while (level < MAX_LEVEL &&
+         width / (2 << level) >= MAX (paint_width, 1) &&
+         height / (2 << level) >= MAX (paint_height, 1))
+    level++;
+
+  if (level > 0 &&
+      shell_window_thumbnail_update_texture (self,
+                                             ceilf (width / (1 << level)),
+                                             ceilf (height / (1 << level)),
+                                             clutter_actor_get_paint_opacity (actor)))
+    {
+      cogl_set_source (priv->material);
+      cogl_rectangle (0, 0, width, height);
+      return;
+    }
+
+  /* We are shown about as large as the window; nothing to gain */
+  shell_window_thumbnail_clear_texture (self);
+  shell_window_thumbnail_paint_clone (self, width, height);
+}
+
+static void
+shell_window_thumbnail_pick (ClutterActor       *actor,
+                             const ClutterColor *pick_color)
+{
+  ClutterActorBox box;
+
+  /* Only pick ourselves, never the clone */
+  if (!clutter_actor_should_pick_paint (actor))
+    return;
+
+  clutter_actor_get_allocation_box (actor, &box);
+
+  cogl_set_source_color4ub (pick_color->red,
+                            pick_color->green,
+                            pick_color->blue,
+                            pick_color->alpha);
+  cogl_rectangle (0, 0, box.x2 - box.x1, box.y2 - box.y1);
+}
+
+static gboolean
+shell_window_thumbnail_get_paint_volume (ClutterActor       *actor,
+                                         ClutterPaintVolume *volume)
+{
+  return clutter_paint_volume_set_from_allocation (volume, actor);
+}
+
+static void
+shell_window_thumbnail_unmap (ClutterActor *actor)
+{
+  ShellWindowThumbnail *self = SHELL_WINDOW_THUMBNAIL (actor);
+
+  /* Don't hold on to texture memory for thumbnails nobody sees */
+  shell_window_thumbnail_clear_texture (self);
+  self->priv->dirty = TRUE;
+
+  CLUTTER_ACTOR_CLASS (shell_window_thumbnail_parent_class)->unmap (actor);
+}
+
+static void
+shell_window_thumbnail_set_property (GObject      *object,
+                                     guint         prop_id,
+                                     const GValue *value,
+                                     GParamSpec   *pspec)
+{
+  ShellWindowThumbnail *self = SHELL_WINDOW_THUMBNAIL (object);
+
+  switch (prop_id)
+    {
+    case PROP_SOURCE:
+      shell_window_thumbnail_set_source (self, g_value_get_object (value));
+      break;
+    case PROP_THROTTLED:
+      shell_window_thumbnail_set_throttled (self, g_value_get_boolean (value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+shell_window_thumbnail_get_property (GObject    *object,
+                                     guint       prop_id,
+                                     GValue     *value,
+                                     GParamSpec *pspec)
+{
+  ShellWindowThumbnail *self = SHELL_WINDOW_THUMBNAIL (object);
+
+  switch (prop_id)
+    {
+    case PROP_SOURCE:
+      g_value_set_object (value, self->priv->source);
+      break;
+    case PROP_THROTTLED:
+      g_value_set_boolean (value, self->priv->throttled);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+shell_window_thumbnail_dispose (GObject *object)
+{
+  ShellWindowThumbnail *self = SHELL_WINDOW_THUMBNAIL (object);
+  ShellWindowThumbnailPrivate *priv = self->priv;
+
+  if (priv->source)
+    on_source_destroy (priv->source, self);
+
+  if (priv->throttle_timeout_id)
+    {
+      g_source_remove (priv->throttle_timeout_id);
+      priv->throttle_timeout_id = 0;
+    }
+
+  shell_window_thumbnail_clear_texture (self);
+
+  G_OBJECT_CLASS (shell_window_thumbnail_parent_class)->dispose (object);
+}
+
+static void
+shell_window_thumbnail_class_init (ShellWindowThumbnailClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  ClutterActorClass *actor_class = CLUTTER_ACTOR_CLASS (klass);
+
+  gobject_class->set_property = shell_window_thumbnail_set_property;
+  gobject_class->get_property = shell_window_thumbnail_get_property;
+  gobject_class->dispose = shell_window_thumbnail_dispose;
+
+  actor_class->get_preferred_width = shell_window_thumbnail_get_preferred_width;
+  actor_class->get_preferred_height = shell_window_thumbnail_get_preferred_height;
+  actor_class->allocate = shell_window_thumbnail_allocate;
+  actor_class->paint = shell_window_thumbnail_paint;
+  actor_class->pick = shell_window_thumbnail_pick;
+  actor_class->get_paint_volume = shell_window_thumbnail_get_paint_volume;
+  actor_class->unmap = shell_window_thumbnail_unmap;
+
+  g_type_class_add_private (gobject_class, sizeof (ShellWindowThumbnailPrivate));
+
+  /**
+   * ShellWindowThumbnail:source:
+   *
+   * The window texture to show.
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_SOURCE,
+                                   g_param_spec_object ("source",
+                                                        "Source",
+                                                        "The window texture to show",
+                                                        CLUTTER_TYPE_ACTOR,
+                                                        G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  /**
+   * ShellWindowThumbnail:throttled:
+   *
+   * Whether to update the thumbnail at most once per second, for
+   * thumbnails of windows the user isn't looking at closely.
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_THROTTLED,
+                                   g_param_spec_boolean ("throttled",
+                                                         "Throttled",
+                                                         "Whether to update the thumbnail at most once per second",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE));
+}
+
+static void
+shell_window_thumbnail_init (ShellWindowThumbnail *self)
+{
+  self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, SHELL_TYPE_WINDOW_THUMBNAIL,
+                                            ShellWindowThumbnailPrivate);
+
+  self->priv->texture = COGL_INVALID_HANDLE;
+  self->priv->offscreen = COGL_INVALID_HANDLE;
+  self->priv->material = COGL_INVALID_HANDLE;
+  self->priv->dirty = TRUE;
+
+  self->priv->clone = clutter_clone_new (NULL);
+  clutter_actor_add_child (CLUTTER_ACTOR (self), self->priv->clone);
+}
+
+/**
+ * shell_window_thumbnail_new:
+ * @source: the window texture to show
+ *
+ * Returns: a new #ShellWindowThumbnail
+ */
+ClutterActor *
+shell_window_thumbnail_new (ClutterActor *source)
+{
+  return g_object_new (SHELL_TYPE_WINDOW_THUMBNAIL,
+                       "source", source,
+                       NULL);
+}
+
+/**
+ * shell_window_thumbnail_get_source:
+ * @thumbnail: a #ShellWindowThumbnail
+ *
+ * Returns: (transfer none): the window texture shown by @thumbnail
+ */
+ClutterActor *
+shell_window_thumbnail_get_source (ShellWindowThumbnail *thumbnail)
+{
+  g_return_val_if_fail (SHELL_IS_WINDOW_THUMBNAIL (thumbnail), NULL);
+
+  return thumbnail->priv->source;
+}
+
+/**
+ * shell_window_thumbnail_set_throttled:
+ * @thumbnail: a #ShellWindowThumbnail
+ * @throttled: whether to limit how often @thumbnail is updated
+ *
+ * Sets #ShellWindowThumbnail:throttled.
+ */
+void
+shell_window_thumbnail_set_throttled (ShellWindowThumbnail *thumbnail,
+                                      gboolean              throttled)
+{
+  ShellWindowThumbnailPrivate *priv;
+
+  g_return_if_fail (SHELL_IS_WINDOW_THUMBNAIL (thumbnail));
+
+  priv = thumbnail->priv;
+
+  throttled = throttled != FALSE;
+  if (priv->throttled == throttled)
+    return;
+
+  priv->throttled = throttled;
+
+  /* Catch up with damage we skipped */
+  if (!throttled && priv->dirty)
+    clutter_actor_queue_redraw (CLUTTER_ACTOR (thumbnail));
+
+  g_object_notify (G_OBJECT (thumbnail), "throttled");
+}
+
+/**
+ * shell_window_thumbnail_get_throttled:
+ * @thumbnail: a #ShellWindowThumbnail
+ *
+ * Returns: the value of #ShellWindowThumbnail:throttled
+ */
+gboolean
+shell_window_thumbnail_get_throttled (ShellWindowThumbnail *thumbnail)
+{
+  g_return_val_if_fail (SHELL_IS_WINDOW_THUMBNAIL (thumbnail), FALSE);
+
+  return thumbnail->priv->throttled;
+}
@@ -34,15 +34,36 @@ struct _ShellXFixesCursor {
   CoglHandle *cursor_sprite;
   int cursor_hot_x;
   int cursor_hot_y;
+
+  /* Recently seen sprites, keyed by the X server's cursor serial;
+   * the queue holds the same entries, most recently used first. */
+  GHashTable *sprite_cache;
+  GQueue *sprite_lru;
 };
 
+/* Applications tend to flip between a handful of cursors (arrow,
+ * I-beam, hand, ...), so keep that many uploaded textures around and
+ * only go back to the server for cursors we haven't seen recently.
+ */
+#define MAX_CACHED_SPRITES 8
+
+typedef struct {
+  gulong serial;
+  Atom name;
+  CoglHandle sprite;
+  int hot_x;
+  int hot_y;
+} CachedSprite;
+
 static void xfixes_cursor_show        (ShellXFixesCursor *xfixes_cursor);
 static void xfixes_cursor_hide        (ShellXFixesCursor *xfixes_cursor);
 
 static void xfixes_cursor_set_stage   (ShellXFixesCursor *xfixes_cursor,
                                        ClutterStage  *stage);
 
-static void xfixes_cursor_reset_image (ShellXFixesCursor *xfixes_cursor);
+static void xfixes_cursor_reset_image (ShellXFixesCursor *xfixes_cursor,
+                                       gulong             serial,
+                                       Atom               name);
 
 enum {
   PROP_0,
@@ -64,6 +85,26 @@ shell_xfixes_cursor_init (ShellXFixesCursor *xfixes_cursor)
   // (JS) Best (?) that can be assumed since XFixes doesn't provide a way of
   // detecting if the system mouse cursor is showing or not.
   xfixes_cursor->is_showing = TRUE;
+
+  xfixes_cursor->sprite_cache = g_hash_table_new (g_direct_hash, g_direct_equal);
+  xfixes_cursor->sprite_lru = g_queue_new ();
+}
+
+static void
+cached_sprite_free (CachedSprite *cached)
+{
+  cogl_handle_unref (cached->sprite);
+  g_slice_free (CachedSprite, cached);
+}
+
+static void
+xfixes_cursor_clear_sprite_cache (ShellXFixesCursor *xfixes_cursor)
+{
+  CachedSprite *cached;
+
+  g_hash_table_remove_all (xfixes_cursor->sprite_cache);
+  while ((cached = g_queue_pop_head (xfixes_cursor->sprite_lru)) != NULL)
+    cached_sprite_free (cached);
 }
 
 static void
@@ -77,6 +118,10 @@ shell_xfixes_cursor_finalize (GObject  *object)
   if (xfixes_cursor->cursor_sprite != NULL)
     cogl_handle_unref (xfixes_cursor->cursor_sprite);
 
+  xfixes_cursor_clear_sprite_cache (xfixes_cursor);
+  g_hash_table_destroy (xfixes_cursor->sprite_cache);
+  g_queue_free (xfixes_cursor->sprite_lru);
+
   G_OBJECT_CLASS (shell_xfixes_cursor_parent_class)->finalize (object);
 }
 
@@ -101,7 +146,9 @@ xfixes_cursor_event_filter (XEvent        *xev,
     {
       XFixesCursorNotifyEvent *notify_event = (XFixesCursorNotifyEvent *)xev;
       if (notify_event->subtype == XFixesDisplayCursorNotify)
-        xfixes_cursor_reset_image (xfixes_cursor);
+        xfixes_cursor_reset_image (xfixes_cursor,
+                                   notify_event->cursor_serial,
+                                   notify_event->cursor_name);
     }
     return CLUTTER_X11_FILTER_CONTINUE;
 }
@@ -120,6 +167,9 @@ xfixes_cursor_set_stage (ShellXFixesCursor *xfixes_cursor,
                                             xfixes_cursor);
 
       clutter_x11_remove_filter (xfixes_cursor_event_filter, xfixes_cursor);
+
+      /* Cursor serials are only meaningful for the display we got them from */
+      xfixes_cursor_clear_sprite_cache (xfixes_cursor);
     }
   xfixes_cursor->stage = stage;
   if (xfixes_cursor->stage)
@@ -140,7 +190,7 @@ xfixes_cursor_set_stage (ShellXFixesCursor *xfixes_cursor,
                                  clutter_x11_get_stage_window (stage),
                                  XFixesDisplayCursorNotifyMask);
 
-      xfixes_cursor_reset_image (xfixes_cursor);
+      xfixes_cursor_reset_image (xfixes_cursor, 0, None);
     }
 }
 
@@ -191,9 +241,80 @@ xfixes_cursor_hide (ShellXFixesCursor *xfixes_cursor)
 }
 
 static void
-xfixes_cursor_reset_image (ShellXFixesCursor *xfixes_cursor)
+xfixes_cursor_set_sprite (ShellXFixesCursor *xfixes_cursor,
+                          CachedSprite      *cached)
+{
+  cogl_handle_ref (cached->sprite);
+  if (xfixes_cursor->cursor_sprite != NULL)
+    cogl_handle_unref (xfixes_cursor->cursor_sprite);
+
+  xfixes_cursor->cursor_sprite = cached->sprite;
+  xfixes_cursor->cursor_hot_x = cached->hot_x;
+  xfixes_cursor->cursor_hot_y = cached->hot_y;
+  g_signal_emit (xfixes_cursor, signals[CURSOR_CHANGED], 0);
+}
+
+static CachedSprite *
+xfixes_cursor_lookup_sprite (ShellXFixesCursor *xfixes_cursor,
+                             gulong             serial,
+                             Atom               name)
+{
+  CachedSprite *cached;
+
+  cached = g_hash_table_lookup (xfixes_cursor->sprite_cache,
+                                GUINT_TO_POINTER (serial));
+  if (cached == NULL)
+    return NULL;
+
+  /* A serial is never reused by the server, but be paranoid about
+   * a named cursor showing up under a serial we've seen before. */
+  if (name != None && cached->name != None && cached->name != name)
+    return NULL;
+
+  g_queue_remove (xfixes_cursor->sprite_lru, cached);
+  g_queue_push_head (xfixes_cursor->sprite_lru, cached);
+
+  return cached;
+}
+
+static void
+xfixes_cursor_cache_sprite (ShellXFixesCursor *xfixes_cursor,
+                            CachedSprite      *cached)
+{
+  CachedSprite *old;
+
+  old = g_hash_table_lookup (xfixes_cursor->sprite_cache,
+                             GUINT_TO_POINTER (cached->serial));
+  if (old != NULL)
+    {
+      g_queue_remove (xfixes_cursor->sprite_lru, old);
+      cached_sprite_free (old);
+    }
+
+  g_hash_table_insert (xfixes_cursor->sprite_cache,
+                       GUINT_TO_POINTER (cached->serial), cached);
+  g_queue_push_head (xfixes_cursor->sprite_lru, cached);
+
+  while (g_queue_get_length (xfixes_cursor->sprite_lru) > MAX_CACHED_SPRITES)
+    {
+      old = g_queue_pop_tail (xfixes_cursor->sprite_lru);
+      g_hash_table_remove (xfixes_cursor->sprite_cache,
+                           GUINT_TO_POINTER (old->serial));
+      cached_sprite_free (old);
+    }
+}
+
+/* Updates the current sprite; @serial and @name come from the
+ * XFixesCursorNotify event, or are 0/None if we don't know which
+ * cursor is being displayed yet.
+ */
+static void
+xfixes_cursor_reset_image (ShellXFixesCursor *xfixes_cursor,
+                           gulong             serial,
+                           Atom               name)
 {
   XFixesCursorImage *cursor_image;
+  CachedSprite *cached;
   CoglHandle sprite = COGL_INVALID_HANDLE;
   guint8 *cursor_data;
   gboolean free_cursor_data;
@@ -201,10 +322,34 @@ xfixes_cursor_reset_image (ShellXFixesCursor *xfixes_cursor)
   if (!xfixes_cursor->have_xfixes)
     return;
 
+  if (serial != 0)
+    {
+      cached = xfixes_cursor_lookup_sprite (xfixes_cursor, serial, name);
+      if (cached != NULL)
+        {
+          if (cached->sprite != xfixes_cursor->cursor_sprite)
+            xfixes_cursor_set_sprite (xfixes_cursor, cached);
+          return;
+        }
+    }
+
   cursor_image = XFixesGetCursorImage (clutter_x11_get_default_display ());
   if (!cursor_image)
     return;
 
+  /* The cursor may have changed again since the notify event was
+   * generated; what we got is identified by the image's own serial. */
+  cached = xfixes_cursor_lookup_sprite (xfixes_cursor,
+                                        cursor_image->cursor_serial,
+                                        cursor_image->atom);
+  if (cached != NULL)
+    {
+      if (cached->sprite != xfixes_cursor->cursor_sprite)
+        xfixes_cursor_set_sprite (xfixes_cursor, cached);
+      XFree (cursor_image);
+      return;
+    }
+
   /* Like all X APIs, XFixesGetCursorImage() returns arrays of 32-bit
    * quantities as arrays of long; we need to convert on 64 bit */
   if (sizeof(long) == 4)
@@ -214,19 +359,17 @@ xfixes_cursor_reset_image (ShellXFixesCursor *xfixes_cursor)
     }
   else
     {
-      int i, j;
+      int i, n_pixels;
       guint32 *cursor_words;
       gulong *p;
-      guint32 *q;
 
-      cursor_words = g_new (guint32, cursor_image->width * cursor_image->height);
+      n_pixels = cursor_image->width * cursor_image->height;
+      cursor_words = g_new (guint32, n_pixels);
       cursor_data = (guint8 *)cursor_words;
 
       p = cursor_image->pixels;
-      q = cursor_words;
-      for (j = 0; j < cursor_image->height; j++)
-        for (i = 0; i < cursor_image->width; i++)
-          *(q++) = *(p++);
+      for (i = 0; i < n_pixels; i++)
+        cursor_words[i] = p[i];
 
       free_cursor_data = TRUE;
     }
@@ -244,13 +387,15 @@ xfixes_cursor_reset_image (ShellXFixesCursor *xfixes_cursor)
 
   if (sprite != COGL_INVALID_HANDLE)
     {
-      if (xfixes_cursor->cursor_sprite != NULL)
-        cogl_handle_unref (xfixes_cursor->cursor_sprite);
-
-      xfixes_cursor->cursor_sprite = sprite;
-      xfixes_cursor->cursor_hot_x = cursor_image->xhot;
-      xfixes_cursor->cursor_hot_y = cursor_image->yhot;
-      g_signal_emit (xfixes_cursor, signals[CURSOR_CHANGED], 0);
+      cached = g_slice_new (CachedSprite);
+      cached->serial = cursor_image->cursor_serial;
+      cached->name = cursor_image->atom;
+      cached->sprite = sprite;
+      cached->hot_x = cursor_image->xhot;
+      cached->hot_y = cursor_image->yhot;
+
+      xfixes_cursor_cache_sprite (xfixes_cursor, cached);
+      xfixes_cursor_set_sprite (xfixes_cursor, cached);
     }
   XFree (cursor_image);
 }
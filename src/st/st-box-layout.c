@@ -47,7 +47,7 @@
  *
  */
 
-#include <stdlib.h>
+#include <string.h>
 
 #include "st-box-layout.h"
 
@@ -277,6 +277,13 @@ st_box_layout_dispose (GObject *object)
   G_OBJECT_CLASS (st_box_layout_parent_class)->dispose (object);
 }
 
+static StBoxLayoutChild *
+get_child_meta (StBoxLayout  *self,
+                ClutterActor *child)
+{
+  return (StBoxLayoutChild *) clutter_container_get_child_meta (CLUTTER_CONTAINER (self), child);
+}
+
 static void
 get_content_preferred_width (StBoxLayout *self,
                              gfloat       for_height,
@@ -297,7 +304,6 @@ get_content_preferred_width (StBoxLayout *self,
        child = clutter_actor_get_next_sibling (child))
     {
       gfloat child_min = 0, child_nat = 0;
-      gboolean child_fill;
 
       if (!CLUTTER_ACTOR_IS_VISIBLE (child))
         continue;
@@ -319,10 +325,8 @@ get_content_preferred_width (StBoxLayout *self,
         }
       else
         {
-          clutter_container_child_get (CLUTTER_CONTAINER (self), child,
-                                       "y-fill", &child_fill,
-                                       NULL);
-          _st_actor_get_preferred_width (child, for_height, child_fill,
+          _st_actor_get_preferred_width (child, for_height,
+                                         get_child_meta (self, child)->y_fill,
                                          &child_min, &child_nat);
           min_width += child_min;
           natural_width += child_nat;
@@ -393,11 +397,8 @@ get_content_preferred_height (StBoxLayout *self,
         }
 
       if (priv->is_vertical)
-        {
-          clutter_container_child_get ((ClutterContainer*) self, child,
-                                       "x-fill", &child_fill,
-                                       NULL);
-        }
+        child_fill = get_child_meta (self, child)->x_fill;
+
       _st_actor_get_preferred_height (child,
                                       (priv->is_vertical) ? for_width : -1,
                                       child_fill,
@@ -460,99 +461,78 @@ st_box_layout_get_preferred_height (ClutterActor *actor,
                                          min_height_p, natural_height_p);
 }
 
+/* A visible, non-fixed child, with its size requests along the axis of
+ * the box, for the size it gets across it */
 typedef struct {
-  int child_index;
+  ClutterActor *actor;
+  StBoxLayoutChild *meta;
+  gfloat min_size;
+  gfloat nat_size;
   gfloat shrink_amount;
-} BoxChildShrink;
+} BoxChild;
 
-/* Sort with the greatest shrink amount first */
-static int
-compare_by_shrink_amount (const void *a,
-                          const void *b)
+static void
+get_box_child_sizes (StBoxLayout *self,
+                     BoxChild    *box_children,
+                     gint         n_box_children,
+                     gfloat       for_size,
+                     gfloat      *min_size_p,
+                     gfloat      *nat_size_p)
 {
-  float diff = ((const BoxChildShrink *)a)->shrink_amount - ((const BoxChildShrink *)b)->shrink_amount;
-  return diff < 0 ? 1 : (diff == 0 ? 0 : -1);
-}
+  StBoxLayoutPrivate *priv = self->priv;
+  gfloat min_size = 0, nat_size = 0;
+  gint i;
 
-/* Sort in ascending order by child index */
-static int
-compare_by_child_index (const void *a,
-                        const void *b)
-{
-  return ((const BoxChildShrink *)a)->child_index - ((const BoxChildShrink *)b)->child_index;
+  for (i = 0; i < n_box_children; i++)
+    {
+      BoxChild *box_child = &box_children[i];
+
+      if (priv->is_vertical)
+        _st_actor_get_preferred_height (box_child->actor, for_size,
+                                        box_child->meta->x_fill,
+                                        &box_child->min_size,
+                                        &box_child->nat_size);
+      else
+        _st_actor_get_preferred_width (box_child->actor, for_size,
+                                       box_child->meta->y_fill,
+                                       &box_child->min_size,
+                                       &box_child->nat_size);
+
+      min_size += box_child->min_size;
+      nat_size += box_child->nat_size;
+    }
+
+  if (n_box_children > 1)
+    {
+      min_size += priv->spacing * (n_box_children - 1);
+      nat_size += priv->spacing * (n_box_children - 1);
+    }
+
+  *min_size_p = min_size;
+  *nat_size_p = nat_size;
 }
 
-static BoxChildShrink *
-compute_shrinks (StBoxLayout *self,
-                 gfloat       for_length,
-                 gfloat       total_shrink)
+/* Sets the shrink amount of each child, so that they add up to
+ * @total_shrink and no child goes below its minimum size.
+ */
+static void
+compute_shrinks (BoxChild *box_children,
+                 gint      n_box_children,
+                 gfloat    total_shrink)
 {
-  StBoxLayoutPrivate *priv = self->priv;
-  int n_children = clutter_actor_get_n_children (CLUTTER_ACTOR (self));
-  BoxChildShrink *shrinks = g_new0 (BoxChildShrink, n_children);
-  gfloat shrink_so_far;
-  gfloat base_shrink = 0; /* the "= 0" is just to make gcc happy */
-  int n_shrink_children;
-  ClutterActor *child;
-  int i = 0;
+  gfloat *amounts;
+  gint n_amounts, i;
+  gfloat above_sum = 0;
+  gint n_above = 0;
+  gfloat base_shrink;
 
   /* The effect that we want is that all the children get an equal chance
    * to expand from their minimum size up to the natural size. Or to put
    * it a different way, we want to start by shrinking only the child that
    * can shrink most, then shrink that and the next most shrinkable child,
    * to the point where we are shrinking everything.
-   */
-
-  /* Find the amount of possible shrink for each child */
-  int n_possible_shrink_children = 0;
-  for (child = clutter_actor_get_first_child (CLUTTER_ACTOR (self));
-       child != NULL;
-       child = clutter_actor_get_next_sibling (child))
-    {
-      gfloat child_min, child_nat;
-      gboolean child_fill;
-      gboolean fixed;
-
-      fixed = clutter_actor_get_fixed_position_set (child);
-
-      shrinks[i].child_index = i;
-      if (CLUTTER_ACTOR_IS_VISIBLE (child) && !fixed)
-        {
-          if (priv->is_vertical)
-            {
-              clutter_container_child_get ((ClutterContainer*) self, child,
-                                           "x-fill", &child_fill,
-                                           NULL);
-              _st_actor_get_preferred_height (child,
-                                              for_length, child_fill,
-                                              &child_min, &child_nat);
-            }
-          else
-            {
-              clutter_container_child_get ((ClutterContainer*) self, child,
-                                           "y-fill", &child_fill,
-                                           NULL);
-              _st_actor_get_preferred_width (child,
-                                             for_length, child_fill,
-                                             &child_min, &child_nat);
-            }
-
-          shrinks[i].shrink_amount = MAX (0., child_nat - child_min);
-          n_possible_shrink_children++;
-        }
-      else
-        {
-          shrinks[i].shrink_amount = -1.;
-        }
-
-      i++;
-    }
-
-  /* We want to process children starting from the child with the maximum available
-   * shrink, so sort in this order; !visible children end up at the end */
-  qsort (shrinks, n_children, sizeof (BoxChildShrink), compare_by_shrink_amount);
-
-  /*   +--+
+   *
+   *   +--+
    *   |  |
    *   |  | +--
    *   |  | | |
@@ -565,37 +545,91 @@ compute_shrinks (StBoxLayout *self,
    * We are trying to find the correct position for the upper line the "water mark"
    * so that total of the portion of the bars above the line is equal to the total
    * amount we want to shrink.
+   *
+   * Rather than sorting the bars, we find the line the way quickselect
+   * finds a median: we pick one bar and see whether the line is above or
+   * below its top, which tells us where the line is with regard to
+   * the tops of the other bars as well. Either the bars that are lower,
+   * or those that are at least as high, are then settled; for the latter
+   * we only need to keep how many they are and their total height. Each
+   * pass settles part of the bars, so this takes expected linear time.
    */
 
-  /* Start by moving the line downward, top-of-bar by top-of-bar */
-  shrink_so_far = 0;
-  for (n_shrink_children = 1; n_shrink_children <= n_possible_shrink_children; n_shrink_children++)
+  amounts = g_new (gfloat, n_box_children);
+  for (i = 0; i < n_box_children; i++)
+    amounts[i] = MAX (0., box_children[i].nat_size - box_children[i].min_size);
+
+  n_amounts = n_box_children;
+  while (n_amounts > 0)
     {
-      if (n_shrink_children < n_possible_shrink_children)
-        base_shrink = shrinks[n_shrink_children].shrink_amount;
+      gfloat pivot = amounts[n_amounts / 2];
+      gfloat higher_sum = 0, equal_sum = 0;
+      gint n_higher = 0, n_equal = 0, n_lower;
+
+      /* Partition into [higher | lower | equal] */
+      i = 0;
+      n_lower = 0;
+      while (i < n_amounts - n_equal)
+        {
+          gfloat amount = amounts[i];
+
+          if (amount > pivot)
+            {
+              amounts[i] = amounts[n_higher];
+              amounts[n_higher] = amount;
+              n_higher++;
+              higher_sum += amount;
+              i++;
+            }
+          else if (amount < pivot)
+            {
+              n_lower++;
+              i++;
+            }
+          else
+            {
+              n_equal++;
+              amounts[i] = amounts[n_amounts - n_equal];
+              amounts[n_amounts - n_equal] = amount;
+              equal_sum += amount;
+            }
+        }
+
+      /* How much we would shrink with the line at the top of the pivot */
+      if (above_sum + higher_sum - (n_above + n_higher) * pivot >= total_shrink)
+        {
+          /* The line is at or above the pivot; the bars that aren't higher
+           * than it don't shrink */
+          n_amounts = n_higher;
+        }
       else
-        base_shrink = 0;
-      shrink_so_far += n_shrink_children * (shrinks[n_shrink_children - 1].shrink_amount - base_shrink);
+        {
+          /* The line is below the pivot; the bars that are at least as
+           * high as it all shrink */
+          above_sum += higher_sum + equal_sum;
+          n_above += n_higher + n_equal;
 
-      if (shrink_so_far >= total_shrink || n_shrink_children == n_possible_shrink_children)
-        break;
+          memmove (amounts, amounts + n_higher, n_lower * sizeof (gfloat));
+          n_amounts = n_lower;
+        }
     }
 
-  /* OK, we found enough shrinkage, move it back upwards to the right position */
-  base_shrink += (shrink_so_far - total_shrink) / n_shrink_children;
+  g_free (amounts);
+
+  if (n_above > 0)
+    base_shrink = (above_sum - total_shrink) / n_above;
+  else
+    base_shrink = 0;
   if (base_shrink < 0) /* can't shrink that much, probably round-off error */
     base_shrink = 0;
 
   /* Assign the portion above the base shrink line to the shrink_amount */
-  for (i = 0; i < n_shrink_children; i++)
-    shrinks[i].shrink_amount -= base_shrink;
-  for (; i < n_children; i++)
-    shrinks[i].shrink_amount = 0;
-
-  /* And sort back to their original order */
-  qsort (shrinks, n_children, sizeof (BoxChildShrink), compare_by_child_index);
+  for (i = 0; i < n_box_children; i++)
+    {
+      BoxChild *box_child = &box_children[i];
 
-  return shrinks;
+      box_child->shrink_amount = MAX (0., box_child->nat_size - box_child->min_size - base_shrink);
+    }
 }
 
 static void
@@ -603,14 +637,15 @@ st_box_layout_allocate (ClutterActor          *actor,
                         const ClutterActorBox *box,
                         ClutterAllocationFlags flags)
 {
-  StBoxLayoutPrivate *priv = ST_BOX_LAYOUT (actor)->priv;
+  StBoxLayout *self = ST_BOX_LAYOUT (actor);
+  StBoxLayoutPrivate *priv = self->priv;
   StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (actor));
   ClutterActorBox content_box;
   gfloat avail_width, avail_height, min_width, natural_width, min_height, natural_height;
   gfloat position, next_position;
-  gint n_expand_children = 0, i;
+  gint n_expand_children = 0, n_box_children = 0, i;
   gfloat expand_amount, shrink_amount;
-  BoxChildShrink *shrinks = NULL;
+  BoxChild *box_children;
   gboolean flip = (clutter_actor_get_text_direction (actor) == CLUTTER_TEXT_DIRECTION_RTL)
                    && (!priv->is_vertical);
   ClutterActor *child;
@@ -622,11 +657,70 @@ st_box_layout_allocate (ClutterActor          *actor,
   avail_width  = content_box.x2 - content_box.x1;
   avail_height = content_box.y2 - content_box.y1;
 
-  get_content_preferred_width (ST_BOX_LAYOUT (actor), avail_height,
-                               &min_width, &natural_width);
-  get_content_preferred_height (ST_BOX_LAYOUT (actor), MAX (avail_width, min_width),
-                                &min_height, &natural_height);
+  /* Gather the children we lay out, and their child properties, once;
+   * fixed position children just get their preferred size. */
+  box_children = g_new (BoxChild, clutter_actor_get_n_children (actor));
+
+  for (child = clutter_actor_get_first_child (actor);
+       child != NULL;
+       child = clutter_actor_get_next_sibling (child))
+    {
+      BoxChild *box_child;
+
+      if (!CLUTTER_ACTOR_IS_VISIBLE (child))
+        continue;
+
+      if (clutter_actor_get_fixed_position_set (child))
+        {
+          clutter_actor_allocate_preferred_size (child, flags);
+          continue;
+        }
+
+      box_child = &box_children[n_box_children++];
+      box_child->actor = child;
+      box_child->meta = get_child_meta (self, child);
+      box_child->shrink_amount = 0;
+
+      if (box_child->meta->expand)
+        n_expand_children++;
+    }
+
+  /* Compute our content size the same way as get_content_preferred_width()
+   * and get_content_preferred_height(), keeping the requests of the
+   * children along our axis */
+  if (priv->is_vertical)
+    {
+      min_width = natural_width = 0;
+      for (i = 0; i < n_box_children; i++)
+        {
+          gfloat child_min, child_nat;
+
+          _st_actor_get_preferred_width (box_children[i].actor, -1, FALSE,
+                                         &child_min, &child_nat);
+          min_width = MAX (child_min, min_width);
+          natural_width = MAX (child_nat, natural_width);
+        }
 
+      get_box_child_sizes (self, box_children, n_box_children,
+                           MAX (avail_width, min_width),
+                           &min_height, &natural_height);
+    }
+  else
+    {
+      get_box_child_sizes (self, box_children, n_box_children, avail_height,
+                           &min_width, &natural_width);
+
+      min_height = natural_height = 0;
+      for (i = 0; i < n_box_children; i++)
+        {
+          gfloat child_min, child_nat;
+
+          _st_actor_get_preferred_height (box_children[i].actor, -1, FALSE,
+                                          &child_min, &child_nat);
+          min_height = MAX (child_min, min_height);
+          natural_height = MAX (child_nat, natural_height);
+        }
+    }
 
   /* update adjustments for scrolling */
   if (priv->vadjustment)
@@ -665,6 +759,15 @@ st_box_layout_allocate (ClutterActor          *actor,
     {
       avail_height = min_height;
       content_box.y2 = content_box.y1 + avail_height;
+
+      /* The children get more height than we asked them about */
+      if (!priv->is_vertical)
+        {
+          gfloat unused_min, unused_nat;
+
+          get_box_child_sizes (self, box_children, n_box_children, avail_height,
+                               &unused_min, &unused_nat);
+        }
     }
 
   if (avail_width < min_width)
@@ -684,37 +787,11 @@ st_box_layout_allocate (ClutterActor          *actor,
       shrink_amount = MAX (0, natural_width - avail_width);
     }
 
-  if (expand_amount > 0)
-    {
-      /* count the number of children with expand set to TRUE */
-      n_expand_children = 0;
-      for (child = clutter_actor_get_first_child (actor);
-           child != NULL;
-           child = clutter_actor_get_next_sibling (child))
-        {
-          gboolean expand;
-
-          if (!CLUTTER_ACTOR_IS_VISIBLE (child) ||
-              clutter_actor_get_fixed_position_set (child))
-            continue;
-
-          clutter_container_child_get ((ClutterContainer *) actor,
-                                       child,
-                                       "expand", &expand,
-                                       NULL);
-          if (expand)
-            n_expand_children++;
-        }
+  if (n_expand_children == 0)
+    expand_amount = 0;
 
-      if (n_expand_children == 0)
-        expand_amount = 0;
-    }
-  else if (shrink_amount > 0)
-    {
-      shrinks = compute_shrinks (ST_BOX_LAYOUT (actor),
-                                 priv->is_vertical ? avail_width : avail_height,
-                                 shrink_amount);
-     }
+  if (shrink_amount > 0)
+    compute_shrinks (box_children, n_box_children, shrink_amount);
 
   if (priv->is_vertical)
     position = content_box.y1;
@@ -723,61 +800,26 @@ st_box_layout_allocate (ClutterActor          *actor,
   else
     position = content_box.x1;
 
-  if (priv->is_pack_start)
-    {
-      child = clutter_actor_get_last_child (actor);
-      i = clutter_actor_get_n_children (actor);
-    }
-  else
-    {
-      child = clutter_actor_get_first_child (actor);
-      i = 0;
-    }
-
-  while (child != NULL)
+  for (i = 0; i < n_box_children; i++)
     {
+      BoxChild *box_child;
       ClutterActorBox child_box;
-      gfloat child_min, child_nat, child_allocated;
-      gboolean xfill, yfill, expand, fixed;
-      StAlign xalign, yalign;
+      gfloat child_allocated;
       gdouble xalign_f, yalign_f;
 
-      if (!CLUTTER_ACTOR_IS_VISIBLE (child))
-        goto next_child;
-
-      fixed = clutter_actor_get_fixed_position_set (child);
-      if (fixed)
-        {
-          clutter_actor_allocate_preferred_size (child, flags);
-          goto next_child;
-        }
-
-      clutter_container_child_get ((ClutterContainer*) actor, child,
-                                   "x-fill", &xfill,
-                                   "y-fill", &yfill,
-                                   "x-align", &xalign,
-                                   "y-align", &yalign,
-                                   "expand", &expand,
-                                   NULL);
-
-      _st_get_align_factors (xalign, yalign, &xalign_f, &yalign_f);
-
-      if (priv->is_vertical)
-        {
-          _st_actor_get_preferred_height (child, avail_width, xfill,
-                                          &child_min, &child_nat);
-        }
+      if (priv->is_pack_start)
+        box_child = &box_children[n_box_children - 1 - i];
       else
-        {
-          _st_actor_get_preferred_width (child, avail_height, yfill,
-                                         &child_min, &child_nat);
-        }
+        box_child = &box_children[i];
+
+      _st_get_align_factors (box_child->meta->x_align, box_child->meta->y_align,
+                             &xalign_f, &yalign_f);
 
-      child_allocated = child_nat;
-      if (expand_amount > 0 && expand)
+      child_allocated = box_child->nat_size;
+      if (expand_amount > 0 && box_child->meta->expand)
         child_allocated +=  expand_amount / n_expand_children;
       else if (shrink_amount > 0)
-        child_allocated -= shrinks[i].shrink_amount;
+        child_allocated -= box_child->shrink_amount;
 
       if (flip)
         next_position = position - child_allocated;
@@ -790,10 +832,6 @@ st_box_layout_allocate (ClutterActor          *actor,
           child_box.y2 = (int)(0.5 + next_position);
           child_box.x1 = content_box.x1;
           child_box.x2 = content_box.x2;
-
-          clutter_actor_allocate_align_fill (child, &child_box,
-                                             xalign_f, yalign_f,
-                                             xfill, yfill, flags);
         }
       else
         {
@@ -810,32 +848,21 @@ st_box_layout_allocate (ClutterActor          *actor,
 
           child_box.y1 = content_box.y1;
           child_box.y2 = content_box.y2;
-
-          clutter_actor_allocate_align_fill (child, &child_box,
-                                             xalign_f, yalign_f,
-                                             xfill, yfill, flags);
         }
 
+      clutter_actor_allocate_align_fill (box_child->actor, &child_box,
+                                         xalign_f, yalign_f,
+                                         box_child->meta->x_fill,
+                                         box_child->meta->y_fill,
+                                         flags);
+
       if (flip)
         position = next_position - priv->spacing;
       else
         position = next_position + priv->spacing;
-
-    next_child:
-      if (priv->is_pack_start)
-        {
-          child = clutter_actor_get_previous_sibling (child);
-          i--;
-        }
-      else
-        {
-          child = clutter_actor_get_next_sibling (child);
-          i++;
-        }
     }
 
-  if (shrinks)
-    g_free (shrinks);
+  g_free (box_children);
 }
 
 static void
@@ -935,6 +962,48 @@ st_box_layout_paint (ClutterActor *actor)
     cogl_clip_pop ();
 }
 
+/* Whether a child of a scrolled box, drawn at its allocation, can show
+ * up within @view_box, given in the same coordinates. Like Clutter's
+ * culling, this goes by the child's paint volume, which includes what
+ * its descendants draw outside of its allocation. Children that are
+ * transformed may be drawn elsewhere, and children without a paint
+ * volume anywhere, so they are always considered visible. */
+static gboolean
+child_may_be_in_view (ClutterActor    *child,
+                      ClutterActorBox *view_box)
+{
+  const ClutterPaintVolume *volume;
+  ClutterActorBox child_box;
+  ClutterVertex origin;
+  gfloat anchor_x, anchor_y;
+  gfloat x1, y1, x2, y2;
+
+  if (clutter_actor_is_scaled (child) ||
+      clutter_actor_is_rotated (child) ||
+      clutter_actor_get_depth (child) != 0)
+    return TRUE;
+
+  clutter_actor_get_anchor_point (child, &anchor_x, &anchor_y);
+  if (anchor_x != 0 || anchor_y != 0)
+    return TRUE;
+
+  volume = clutter_actor_get_paint_volume (child);
+  if (volume == NULL)
+    return TRUE;
+
+  /* The paint volume is relative to the child's allocation */
+  clutter_actor_get_allocation_box (child, &child_box);
+  clutter_paint_volume_get_origin (volume, &origin);
+
+  x1 = child_box.x1 + origin.x;
+  y1 = child_box.y1 + origin.y;
+  x2 = x1 + clutter_paint_volume_get_width (volume);
+  y2 = y1 + clutter_paint_volume_get_height (volume);
+
+  return (x2 > view_box->x1 && x1 < view_box->x2 &&
+          y2 > view_box->y1 && y1 < view_box->y2);
+}
+
 static void
 st_box_layout_pick (ClutterActor       *actor,
                     const ClutterColor *color)
@@ -978,10 +1047,19 @@ st_box_layout_pick (ClutterActor       *actor,
                               (int)content_box.x2,
                               (int)content_box.y2);
 
+  /* Clutter doesn't cull actors when picking, so in a scrolled box
+   * every child would be traversed and painted, only to be clipped
+   * away; skip those that are scrolled out of view ourselves. */
   for (child = clutter_actor_get_first_child (actor);
        child != NULL;
        child = clutter_actor_get_next_sibling (child))
-    clutter_actor_paint (child);
+    {
+      if ((priv->hadjustment || priv->vadjustment) &&
+          !child_may_be_in_view (child, &content_box))
+        continue;
+
+      clutter_actor_paint (child);
+    }
 
   if (priv->hadjustment || priv->vadjustment)
     cogl_clip_pop ();
@@ -103,6 +103,10 @@ struct _StScrollViewFade
   CoglHandle shader;
   CoglHandle program;
 
+  /* Material to paint the part of the offscreen texture that isn't
+   * faded with, without running the shader */
+  CoglHandle plain_material;
+
   gint tex_uniform;
   gint height_uniform;
   gint width_uniform;
@@ -200,12 +204,37 @@ st_scroll_view_fade_create_texture (ClutterOffscreenEffect *effect,
                                      COGL_PIXEL_FORMAT_RGBA_8888_PRE);
 }
 
+/* Paints the part of the offscreen texture between the texture
+ * coordinates (@s1, @t1) and (@s2, @t2) with @material */
+static void
+paint_region (CoglHandle material,
+              float      target_width,
+              float      target_height,
+              float      s1,
+              float      t1,
+              float      s2,
+              float      t2)
+{
+  if (s2 <= s1 || t2 <= t1)
+    return;
+
+  cogl_set_source (material);
+  cogl_rectangle_with_texture_coords (s1 * target_width, t1 * target_height,
+                                      s2 * target_width, t2 * target_height,
+                                      s1, t1, s2, t2);
+}
+
 static void
 st_scroll_view_fade_paint_target (ClutterOffscreenEffect *effect)
 {
   StScrollViewFade *self = ST_SCROLL_VIEW_FADE (effect);
   ClutterOffscreenEffectClass *parent;
   CoglHandle material;
+  guint8 paint_opacity;
+  float width, height, target_width, target_height;
+  float offset_top = 0.f, offset_bottom = 0.f;
+  float offset_left = 0.f, offset_right = 0.f;
+  float top, bottom, left, right;
 
   gdouble value, lower, upper, page_size;
   ClutterActor *vscroll = st_scroll_view_get_vscroll_bar (ST_SCROLL_VIEW (self->actor));
@@ -263,48 +292,76 @@ st_scroll_view_fade_paint_target (ClutterOffscreenEffect *effect)
 
   st_adjustment_get_values (self->vadjustment, &value, &lower, &upper, NULL, NULL, &page_size);
 
-  if (self->offset_top_uniform > -1) {
-    if (value > lower + 0.1)
-      cogl_program_set_uniform_1f (self->program, self->offset_top_uniform, self->vfade_offset);
-    else
-      cogl_program_set_uniform_1f (self->program, self->offset_top_uniform, 0.0f);
-  }
-
-  if (self->offset_bottom_uniform > -1) {
-    if (value < upper - page_size - 0.1)
-      cogl_program_set_uniform_1f (self->program, self->offset_bottom_uniform, self->vfade_offset);
-    else
-      cogl_program_set_uniform_1f (self->program, self->offset_bottom_uniform, 0.0f);
-  }
+  if (value > lower + 0.1)
+    offset_top = self->vfade_offset;
+  if (value < upper - page_size - 0.1)
+    offset_bottom = self->vfade_offset;
 
   st_adjustment_get_values (self->hadjustment, &value, &lower, &upper, NULL, NULL, &page_size);
 
-  if (self->offset_left_uniform > -1) {
-    if (value > lower + 0.1)
-      cogl_program_set_uniform_1f (self->program, self->offset_left_uniform, self->hfade_offset);
-    else
-      cogl_program_set_uniform_1f (self->program, self->offset_left_uniform, 0.0f);
-  }
+  if (value > lower + 0.1)
+    offset_left = self->hfade_offset;
+  if (value < upper - page_size - 0.1)
+    offset_right = self->hfade_offset;
 
-  if (self->offset_right_uniform > -1) {
-    if (value < upper - page_size - 0.1)
-      cogl_program_set_uniform_1f (self->program, self->offset_right_uniform, self->hfade_offset);
-    else
-      cogl_program_set_uniform_1f (self->program, self->offset_right_uniform, 0.0f);
-  }
+  width = clutter_actor_get_width (self->actor);
+  height = clutter_actor_get_height (self->actor);
+
+  if (self->offset_top_uniform > -1)
+    cogl_program_set_uniform_1f (self->program, self->offset_top_uniform, offset_top);
+  if (self->offset_bottom_uniform > -1)
+    cogl_program_set_uniform_1f (self->program, self->offset_bottom_uniform, offset_bottom);
+  if (self->offset_left_uniform > -1)
+    cogl_program_set_uniform_1f (self->program, self->offset_left_uniform, offset_left);
+  if (self->offset_right_uniform > -1)
+    cogl_program_set_uniform_1f (self->program, self->offset_right_uniform, offset_right);
 
   if (self->tex_uniform > -1)
     cogl_program_set_uniform_1i (self->program, self->tex_uniform, 0);
   if (self->height_uniform > -1)
-    cogl_program_set_uniform_1f (self->program, self->height_uniform, clutter_actor_get_height (self->actor));
+    cogl_program_set_uniform_1f (self->program, self->height_uniform, height);
   if (self->width_uniform > -1)
-    cogl_program_set_uniform_1f (self->program, self->width_uniform, clutter_actor_get_width (self->actor));
+    cogl_program_set_uniform_1f (self->program, self->width_uniform, width);
   if (self->fade_area_uniform > -1)
     cogl_program_set_uniform_matrix (self->program, self->fade_area_uniform, 2, 1, FALSE, (const float *)fade_area);
 
   material = clutter_offscreen_effect_get_target (effect);
   cogl_material_set_user_program (material, self->program);
 
+  if (self->plain_material == COGL_INVALID_HANDLE)
+    self->plain_material = cogl_material_new ();
+  cogl_material_set_layer (self->plain_material, 0,
+                           clutter_offscreen_effect_get_texture (effect));
+
+  paint_opacity = clutter_actor_get_paint_opacity (self->actor);
+  cogl_material_set_color4ub (material,
+                              paint_opacity, paint_opacity,
+                              paint_opacity, paint_opacity);
+  cogl_material_set_color4ub (self->plain_material,
+                              paint_opacity, paint_opacity,
+                              paint_opacity, paint_opacity);
+
+  clutter_offscreen_effect_get_target_size (effect, &target_width, &target_height);
+
+  /* The shader only changes the pixels within the fade offsets from the
+   * edges; everything in between is copied as-is, without the cost of
+   * running the shader for every pixel of a mostly unfaded scroll view.
+   * Like the shader, we work in texture coordinates scaled to the
+   * actor's size here.
+   */
+  top = CLAMP (offset_top / height, 0., 1.);
+  bottom = CLAMP ((fade_area[1][1] - offset_bottom) / height, top, 1.);
+  left = CLAMP (offset_left / width, 0., 1.);
+  right = CLAMP ((fade_area[1][0] - offset_right) / width, left, 1.);
+
+  paint_region (material, target_width, target_height, 0, 0, 1, top);
+  paint_region (material, target_width, target_height, 0, bottom, 1, 1);
+  paint_region (material, target_width, target_height, 0, top, left, bottom);
+  paint_region (material, target_width, target_height, right, top, 1, bottom);
+  paint_region (self->plain_material, target_width, target_height, left, top, right, bottom);
+
+  return;
+
 out:
   parent = CLUTTER_OFFSCREEN_EFFECT_CLASS (st_scroll_view_fade_parent_class);
   parent->paint_target (effect);
@@ -401,6 +458,12 @@ st_scroll_view_fade_dispose (GObject *gobject)
       self->shader = COGL_INVALID_HANDLE;
     }
 
+  if (self->plain_material != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (self->plain_material);
+      self->plain_material = COGL_INVALID_HANDLE;
+    }
+
   if (self->vadjustment)
     {
       g_signal_handlers_disconnect_by_func (self->vadjustment,
@@ -433,8 +496,9 @@ st_scroll_view_vfade_set_offset (StScrollViewFade *self,
 
   self->vfade_offset = fade_offset;
 
+  /* The contents didn't change, so repaint from the offscreen texture */
   if (self->actor != NULL)
-    clutter_actor_queue_redraw (self->actor);
+    clutter_effect_queue_repaint (CLUTTER_EFFECT (self));
 
   g_object_notify (G_OBJECT (self), "vfade-offset");
   g_object_thaw_notify (G_OBJECT (self));
@@ -451,8 +515,9 @@ st_scroll_view_hfade_set_offset (StScrollViewFade *self,
 
   self->hfade_offset = fade_offset;
 
+  /* The contents didn't change, so repaint from the offscreen texture */
   if (self->actor != NULL)
-    clutter_actor_queue_redraw (self->actor);
+    clutter_effect_queue_repaint (CLUTTER_EFFECT (self));
 
   g_object_notify (G_OBJECT (self), "hfade-offset");
   g_object_thaw_notify (G_OBJECT (self));
@@ -566,6 +631,7 @@ st_scroll_view_fade_init (StScrollViewFade *self)
     }
 
   self->shader = shader;
+  self->plain_material = COGL_INVALID_HANDLE;
   self->is_attached = FALSE;
   self->tex_uniform = -1;
   self->height_uniform = -1;
@@ -0,0 +1,774 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-stylesheet-cache.c: On-disk cache of parsed stylesheets
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Parsing our stylesheets with libcroco is one of the most expensive
+ * things we do at startup, and it gives the same result every time.
+ * So once a stylesheet is parsed, we store the parts of it that the
+ * selector matcher and StThemeNode look at in a GVariant in the user's
+ * cache directory, and on the next start we map that file and build the
+ * libcroco objects directly from it, bypassing the tokenizer and the
+ * parser. Strings are stored once in a table and referenced by index.
+ *
+ * The cache of a stylesheet is only used if it was written by the same
+ * version of the shell for a source file with the same modification
+ * time and size. Stylesheets using constructs that we don't store,
+ * like @media rules or attribute selectors, are simply not cached.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gio/gio.h>
+
+#include "st-stylesheet-cache.h"
+
+/* Bump whenever the layout below changes */
+#define CACHE_FORMAT_VERSION 1
+
+#define NO_STRING G_MAXUINT32
+
+/* For read_terms(), to read up to the end of the array */
+#define ALL_TERMS G_MAXSIZE
+
+/* type mask, combinator, name, additional selectors:
+ * (type, pseudo-class type, name, pseudo-class function argument) */
+#define SIMPLE_SEL_TYPE "(yyua(yyuu))"
+/* type, unary operator, operator, number type, number value, string,
+ * (red, green, blue, RGB_* flags), number of function parameters; the
+ * parameters of a function follow it directly */
+#define TERM_TYPE       "(yyyydu(iiiy)u)"
+/* property, important, value */
+#define DECL_TYPE       "(uba" TERM_TYPE ")"
+/* CACHED_* kind, import URL, selectors, declarations */
+#define STATEMENT_TYPE  "(yuaa" SIMPLE_SEL_TYPE "a" DECL_TYPE ")"
+/* format version, shell version, source filename, source mtime in
+ * microseconds, source size */
+#define HEADER_TYPE     "(ussxt)"
+#define CACHE_TYPE      "(" HEADER_TYPE "asa" STATEMENT_TYPE ")"
+
+enum {
+  CACHED_RULESET,
+  CACHED_IMPORT
+};
+
+enum {
+  RGB_IS_PERCENTAGE = 1 << 0,
+  RGB_INHERIT       = 1 << 1
+};
+
+typedef struct {
+  GHashTable *string_indices;
+  GPtrArray  *strings;
+  /* Set when the stylesheet has something we can't store */
+  gboolean    failed;
+} CacheWriter;
+
+typedef struct {
+  const gchar **strings;
+  gsize         n_strings;
+  /* Set when the cache turns out to be corrupt */
+  gboolean      failed;
+} CacheReader;
+
+static char *
+get_cache_filename (const char *filename)
+{
+  char *checksum;
+  char *result;
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, filename, -1);
+  result = g_build_filename (g_get_user_cache_dir (), "gnome-shell", "stylesheets",
+                             checksum, NULL);
+  g_free (checksum);
+
+  return result;
+}
+
+static gboolean
+get_source_info (const char *filename,
+                 gint64     *mtime,
+                 guint64    *size)
+{
+  GFile *file;
+  GFileInfo *info;
+
+  file = g_file_new_for_path (filename);
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC ","
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  g_object_unref (file);
+
+  if (info == NULL)
+    return FALSE;
+
+  *mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+           g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+  *size = g_file_info_get_size (info);
+  g_object_unref (info);
+
+  return TRUE;
+}
+
+static guint32
+intern_string (CacheWriter *writer,
+               CRString    *string)
+{
+  const char *str;
+  gpointer index;
+
+  if (string == NULL || string->stryng == NULL)
+    return NO_STRING;
+
+  str = string->stryng->str;
+  if (g_hash_table_lookup_extended (writer->string_indices, str, NULL, &index))
+    return GPOINTER_TO_UINT (index);
+
+  index = GUINT_TO_POINTER (writer->strings->len);
+  g_ptr_array_add (writer->strings, (char *) str);
+  g_hash_table_insert (writer->string_indices, (char *) str, index);
+
+  return GPOINTER_TO_UINT (index);
+}
+
+static void
+write_terms (CacheWriter     *writer,
+             CRTerm          *term,
+             GVariantBuilder *builder)
+{
+  for (; term; term = term->next)
+    {
+      guint32 str = NO_STRING;
+      guint8 num_type = 0;
+      gdouble num_val = 0.;
+      gint32 red = 0, green = 0, blue = 0;
+      guint8 rgb_flags = 0;
+      guint32 n_params = 0;
+      CRTerm *param;
+
+      switch (term->type)
+        {
+        case TERM_NUMBER:
+          num_type = term->content.num->type;
+          num_val = term->content.num->val;
+          break;
+        case TERM_FUNCTION:
+          for (param = term->ext_content.func_param; param; param = param->next)
+            n_params++;
+          /* fall through */
+        case TERM_STRING:
+        case TERM_IDENT:
+        case TERM_URI:
+        case TERM_HASH:
+          str = intern_string (writer, term->content.str);
+          break;
+        case TERM_RGB:
+          red = term->content.rgb->red;
+          green = term->content.rgb->green;
+          blue = term->content.rgb->blue;
+          if (term->content.rgb->is_percentage)
+            rgb_flags |= RGB_IS_PERCENTAGE;
+          if (term->content.rgb->inherit)
+            rgb_flags |= RGB_INHERIT;
+          break;
+        default:
+          writer->failed = TRUE;
+          break;
+        }
+
+      g_variant_builder_add (builder, TERM_TYPE,
+                             term->type, term->unary_op, term->the_operator,
+                             num_type, num_val, str,
+                             red, green, blue, rgb_flags,
+                             n_params);
+
+      if (n_params > 0)
+        write_terms (writer, term->ext_content.func_param, builder);
+    }
+}
+
+static GVariant *
+write_simple_sels (CacheWriter *writer,
+                   CRSimpleSel *simple_sel)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" SIMPLE_SEL_TYPE));
+
+  for (; simple_sel; simple_sel = simple_sel->next)
+    {
+      GVariantBuilder add_sel_builder;
+      CRAdditionalSel *add_sel;
+
+      g_variant_builder_init (&add_sel_builder, G_VARIANT_TYPE ("a(yyuu)"));
+
+      for (add_sel = simple_sel->add_sel; add_sel; add_sel = add_sel->next)
+        {
+          guint8 pseudo_type = 0;
+          guint32 name = NO_STRING;
+          guint32 extra = NO_STRING;
+
+          switch (add_sel->type)
+            {
+            case CLASS_ADD_SELECTOR:
+              name = intern_string (writer, add_sel->content.class_name);
+              break;
+            case ID_ADD_SELECTOR:
+              name = intern_string (writer, add_sel->content.id_name);
+              break;
+            case PSEUDO_CLASS_ADD_SELECTOR:
+              pseudo_type = add_sel->content.pseudo->type;
+              name = intern_string (writer, add_sel->content.pseudo->name);
+              extra = intern_string (writer, add_sel->content.pseudo->extra);
+              break;
+            default:
+              writer->failed = TRUE;
+              break;
+            }
+
+          g_variant_builder_add (&add_sel_builder, "(yyuu)",
+                                 add_sel->type, pseudo_type, name, extra);
+        }
+
+      g_variant_builder_add (&builder, SIMPLE_SEL_TYPE,
+                             simple_sel->type_mask, simple_sel->combinator,
+                             intern_string (writer, simple_sel->name),
+                             &add_sel_builder);
+    }
+
+  return g_variant_builder_end (&builder);
+}
+
+static void
+write_statement (CacheWriter     *writer,
+                 CRStatement     *stmt,
+                 GVariantBuilder *builder)
+{
+  GVariantBuilder sel_builder;
+  GVariantBuilder decl_builder;
+  CRSelector *sel;
+  CRDeclaration *decl;
+
+  g_variant_builder_init (&sel_builder, G_VARIANT_TYPE ("aa" SIMPLE_SEL_TYPE));
+  g_variant_builder_init (&decl_builder, G_VARIANT_TYPE ("a" DECL_TYPE));
+
+  switch (stmt->type)
+    {
+    case RULESET_STMT:
+      if (stmt->kind.ruleset == NULL)
+        break;
+
+      for (sel = stmt->kind.ruleset->sel_list; sel; sel = sel->next)
+        if (sel->simple_sel)
+          g_variant_builder_add_value (&sel_builder,
+                                       write_simple_sels (writer, sel->simple_sel));
+
+      for (decl = stmt->kind.ruleset->decl_list; decl; decl = decl->next)
+        {
+          GVariantBuilder term_builder;
+
+          g_variant_builder_init (&term_builder, G_VARIANT_TYPE ("a" TERM_TYPE));
+          write_terms (writer, decl->value, &term_builder);
+
+          g_variant_builder_add (&decl_builder, DECL_TYPE,
+                                 intern_string (writer, decl->property),
+                                 decl->important,
+                                 &term_builder);
+        }
+
+      g_variant_builder_add (builder, STATEMENT_TYPE,
+                             CACHED_RULESET, NO_STRING,
+                             &sel_builder, &decl_builder);
+      return;
+
+    case AT_IMPORT_RULE_STMT:
+      /* The imported stylesheet is loaded, and cached, separately
+       * when first needed */
+      g_variant_builder_add (builder, STATEMENT_TYPE,
+                             CACHED_IMPORT,
+                             intern_string (writer, stmt->kind.import_rule->url),
+                             &sel_builder, &decl_builder);
+      return;
+
+    case AT_MEDIA_RULE_STMT:
+      writer->failed = TRUE;
+      break;
+
+    default:
+      /* Other @-rules are ignored when matching */
+      break;
+    }
+
+  g_variant_builder_clear (&sel_builder);
+  g_variant_builder_clear (&decl_builder);
+}
+
+void
+_st_stylesheet_cache_save (const char   *filename,
+                           CRStyleSheet *stylesheet)
+{
+  CacheWriter writer;
+  GVariantBuilder builder;
+  CRStatement *stmt;
+  GVariant *cache = NULL;
+  char *cache_filename = NULL;
+  char *cache_dir = NULL;
+  gint64 mtime;
+  guint64 size;
+
+  if (!get_source_info (filename, &mtime, &size))
+    return;
+
+  writer.string_indices = g_hash_table_new (g_str_hash, g_str_equal);
+  writer.strings = g_ptr_array_new ();
+  writer.failed = FALSE;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" STATEMENT_TYPE));
+  for (stmt = stylesheet->statements; stmt; stmt = stmt->next)
+    write_statement (&writer, stmt, &builder);
+
+  cache = g_variant_new ("(" HEADER_TYPE "@as@a" STATEMENT_TYPE ")",
+                         CACHE_FORMAT_VERSION, PACKAGE_VERSION, filename, mtime, size,
+                         g_variant_new_strv ((const gchar * const *) writer.strings->pdata,
+                                             writer.strings->len),
+                         g_variant_builder_end (&builder));
+  g_variant_ref_sink (cache);
+
+  if (writer.failed)
+    goto out;
+
+  cache_filename = get_cache_filename (filename);
+  cache_dir = g_path_get_dirname (cache_filename);
+
+  /* The cache is only an optimization, so failing to write it isn't
+   * worth a warning */
+  if (g_mkdir_with_parents (cache_dir, 0755) == 0)
+    g_file_set_contents (cache_filename,
+                         g_variant_get_data (cache), g_variant_get_size (cache),
+                         NULL);
+
+ out:
+  g_variant_unref (cache);
+  g_free (cache_filename);
+  g_free (cache_dir);
+  g_hash_table_destroy (writer.string_indices);
+  g_ptr_array_free (writer.strings, TRUE);
+}
+
+static CRString *
+read_string (CacheReader *reader,
+             guint32      index)
+{
+  if (index == NO_STRING)
+    return NULL;
+
+  if (index >= reader->n_strings)
+    {
+      reader->failed = TRUE;
+      return NULL;
+    }
+
+  return cr_string_new_from_string (reader->strings[index]);
+}
+
+/* For places where libcroco never leaves the string unset, and so
+ * neither we nor StThemeNode check for NULL */
+static CRString *
+read_required_string (CacheReader *reader,
+                      guint32      index)
+{
+  if (index == NO_STRING)
+    reader->failed = TRUE;
+
+  return read_string (reader, index);
+}
+
+static CRTerm *
+read_terms (CacheReader *reader,
+            GVariant    *terms,
+            gsize       *pos,
+            gsize        n_terms)
+{
+  CRTerm *first = NULL;
+  CRTerm *last = NULL;
+  gsize n_children = g_variant_n_children (terms);
+  gsize i;
+
+  for (i = 0; i < n_terms && *pos < n_children && !reader->failed; i++)
+    {
+      guint8 type, unary_op, the_operator, num_type, rgb_flags;
+      gdouble num_val;
+      guint32 str, n_params;
+      gint32 red, green, blue;
+      CRTerm *term;
+
+      g_variant_get_child (terms, (*pos)++, TERM_TYPE,
+                           &type, &unary_op, &the_operator,
+                           &num_type, &num_val, &str,
+                           &red, &green, &blue, &rgb_flags,
+                           &n_params);
+
+      term = cr_term_new ();
+
+      switch (type)
+        {
+        case TERM_NUMBER:
+          cr_term_set_number (term, cr_num_new_with_val (num_val, num_type));
+          break;
+        case TERM_FUNCTION:
+          {
+            CRString *name = read_required_string (reader, str);
+            CRTerm *params = read_terms (reader, terms, pos, n_params);
+
+            cr_term_set_function (term, name, params);
+          }
+          break;
+        case TERM_STRING:
+          cr_term_set_string (term, read_required_string (reader, str));
+          break;
+        case TERM_IDENT:
+          cr_term_set_ident (term, read_required_string (reader, str));
+          break;
+        case TERM_URI:
+          cr_term_set_uri (term, read_required_string (reader, str));
+          break;
+        case TERM_HASH:
+          cr_term_set_hash (term, read_required_string (reader, str));
+          break;
+        case TERM_RGB:
+          {
+            CRRgb *rgb = cr_rgb_new_with_vals (red, green, blue,
+                                               (rgb_flags & RGB_IS_PERCENTAGE) != 0);
+
+            rgb->inherit = (rgb_flags & RGB_INHERIT) != 0;
+            cr_term_set_rgb (term, rgb);
+          }
+          break;
+        default:
+          reader->failed = TRUE;
+          break;
+        }
+
+      term->unary_op = unary_op;
+      term->the_operator = the_operator;
+
+      if (last)
+        {
+          last->next = term;
+          term->prev = last;
+        }
+      else
+        {
+          first = term;
+        }
+      last = term;
+    }
+
+  if (i < n_terms && n_terms != ALL_TERMS)
+    reader->failed = TRUE;
+
+  return first;
+}
+
+static CRSimpleSel *
+read_simple_sels (CacheReader *reader,
+                  GVariant    *simple_sels)
+{
+  CRSimpleSel *first = NULL;
+  CRSimpleSel *last = NULL;
+  GVariantIter iter;
+  guint8 type_mask, combinator;
+  guint32 name;
+  GVariantIter *add_sel_iter;
+
+  g_variant_iter_init (&iter, simple_sels);
+  while (g_variant_iter_next (&iter, SIMPLE_SEL_TYPE,
+                              &type_mask, &combinator, &name, &add_sel_iter))
+    {
+      CRSimpleSel *simple_sel = cr_simple_sel_new ();
+      CRAdditionalSel *last_add_sel = NULL;
+      guint8 add_sel_type, pseudo_type;
+      guint32 add_sel_name, extra;
+
+      simple_sel->type_mask = type_mask;
+      simple_sel->combinator = combinator;
+      simple_sel->name = read_string (reader, name);
+
+      while (g_variant_iter_next (add_sel_iter, "(yyuu)",
+                                  &add_sel_type, &pseudo_type, &add_sel_name, &extra))
+        {
+          CRAdditionalSel *add_sel = cr_additional_sel_new_with_type (add_sel_type);
+
+          switch (add_sel_type)
+            {
+            case CLASS_ADD_SELECTOR:
+              cr_additional_sel_set_class_name (add_sel,
+                                                read_required_string (reader, add_sel_name));
+              break;
+            case ID_ADD_SELECTOR:
+              cr_additional_sel_set_id_name (add_sel,
+                                             read_required_string (reader, add_sel_name));
+              break;
+            case PSEUDO_CLASS_ADD_SELECTOR:
+              {
+                CRPseudo *pseudo = cr_pseudo_new ();
+
+                pseudo->type = pseudo_type;
+                pseudo->name = read_required_string (reader, add_sel_name);
+                pseudo->extra = read_string (reader, extra);
+                cr_additional_sel_set_pseudo (add_sel, pseudo);
+              }
+              break;
+            default:
+              reader->failed = TRUE;
+              break;
+            }
+
+          if (last_add_sel)
+            {
+              last_add_sel->next = add_sel;
+              add_sel->prev = last_add_sel;
+            }
+          else
+            {
+              simple_sel->add_sel = add_sel;
+            }
+          last_add_sel = add_sel;
+        }
+      g_variant_iter_free (add_sel_iter);
+
+      if (last)
+        {
+          last->next = simple_sel;
+          simple_sel->prev = last;
+        }
+      else
+        {
+          first = simple_sel;
+        }
+      last = simple_sel;
+    }
+
+  return first;
+}
+
+static CRStatement *
+read_ruleset (CacheReader  *reader,
+              CRStyleSheet *stylesheet,
+              GVariant     *selectors,
+              GVariant     *decls)
+{
+  CRStatement *stmt;
+  CRSelector *sel_list = NULL;
+  CRSelector *last_sel = NULL;
+  CRDeclaration *decl_list = NULL;
+  CRDeclaration *last_decl = NULL;
+  CRDeclaration *decl;
+  GVariantIter iter;
+  GVariant *child;
+
+  g_variant_iter_init (&iter, selectors);
+  while ((child = g_variant_iter_next_value (&iter)))
+    {
+      CRSelector *sel = cr_selector_new (read_simple_sels (reader, child));
+
+      if (last_sel)
+        {
+          last_sel->next = sel;
+          sel->prev = last_sel;
+        }
+      else
+        {
+          sel_list = sel;
+        }
+      last_sel = sel;
+
+      g_variant_unref (child);
+    }
+
+  g_variant_iter_init (&iter, decls);
+  while ((child = g_variant_iter_next_value (&iter)))
+    {
+      guint32 property;
+      gboolean important;
+      GVariant *terms;
+      CRString *property_string;
+      gsize pos = 0;
+
+      g_variant_get (child, DECL_TYPE, &property, &important, NULL);
+      terms = g_variant_get_child_value (child, 2);
+      g_variant_unref (child);
+
+      property_string = read_required_string (reader, property);
+      if (property_string == NULL)
+        {
+          g_variant_unref (terms);
+          continue;
+        }
+
+      decl = cr_declaration_new (NULL, property_string,
+                                 read_terms (reader, terms, &pos, ALL_TERMS));
+      decl->important = important;
+      g_variant_unref (terms);
+
+      if (last_decl)
+        {
+          last_decl->next = decl;
+          decl->prev = last_decl;
+        }
+      else
+        {
+          decl_list = decl;
+        }
+      last_decl = decl;
+    }
+
+  stmt = cr_statement_new_ruleset (stylesheet, sel_list, decl_list, NULL);
+  for (decl = decl_list; decl; decl = decl->next)
+    decl->parent_statement = stmt;
+
+  return stmt;
+}
+
+CRStyleSheet *
+_st_stylesheet_cache_load (const char *filename)
+{
+  CRStyleSheet *stylesheet = NULL;
+  CRStatement *last_stmt = NULL;
+  CacheReader reader = { NULL, 0, FALSE };
+  GMappedFile *mapped;
+  GVariant *cache = NULL;
+  GVariant *strings = NULL;
+  GVariant *statements = NULL;
+  GVariantIter iter;
+  GVariant *child;
+  char *cache_filename;
+  guint32 version;
+  const char *shell_version;
+  const char *cached_filename;
+  gint64 cached_mtime, mtime;
+  guint64 cached_size, size;
+
+  if (!get_source_info (filename, &mtime, &size))
+    return NULL;
+
+  cache_filename = get_cache_filename (filename);
+  mapped = g_mapped_file_new (cache_filename, FALSE, NULL);
+  g_free (cache_filename);
+
+  if (mapped == NULL)
+    return NULL;
+
+  if (g_mapped_file_get_length (mapped) == 0)
+    {
+      g_mapped_file_unref (mapped);
+      return NULL;
+    }
+
+  /* The file is not trusted, so reading a corrupt cache gives us
+   * default values rather than crashing */
+  cache = g_variant_new_from_data (G_VARIANT_TYPE (CACHE_TYPE),
+                                   g_mapped_file_get_contents (mapped),
+                                   g_mapped_file_get_length (mapped),
+                                   FALSE,
+                                   (GDestroyNotify) g_mapped_file_unref, mapped);
+  g_variant_ref_sink (cache);
+
+  g_variant_get_child (cache, 0, "(u&s&sxt)",
+                       &version, &shell_version, &cached_filename,
+                       &cached_mtime, &cached_size);
+  if (version != CACHE_FORMAT_VERSION ||
+      strcmp (shell_version, PACKAGE_VERSION) != 0 ||
+      strcmp (cached_filename, filename) != 0 ||
+      cached_mtime != mtime ||
+      cached_size != size)
+    goto out;
+
+  strings = g_variant_get_child_value (cache, 1);
+  reader.strings = g_variant_get_strv (strings, &reader.n_strings);
+
+  stylesheet = cr_stylesheet_new (NULL);
+
+  statements = g_variant_get_child_value (cache, 2);
+  g_variant_iter_init (&iter, statements);
+  while (!reader.failed && (child = g_variant_iter_next_value (&iter)))
+    {
+      CRStatement *stmt = NULL;
+      guint8 kind;
+      guint32 url;
+      GVariant *selectors = g_variant_get_child_value (child, 2);
+      GVariant *decls = g_variant_get_child_value (child, 3);
+
+      g_variant_get_child (child, 0, "y", &kind);
+      g_variant_get_child (child, 1, "u", &url);
+
+      switch (kind)
+        {
+        case CACHED_RULESET:
+          stmt = read_ruleset (&reader, stylesheet, selectors, decls);
+          break;
+        case CACHED_IMPORT:
+          {
+            CRString *url_string = read_required_string (&reader, url);
+
+            if (url_string)
+              stmt = cr_statement_new_at_import_rule (stylesheet, url_string, NULL, NULL);
+          }
+          break;
+        default:
+          reader.failed = TRUE;
+          break;
+        }
+
+      g_variant_unref (selectors);
+      g_variant_unref (decls);
+      g_variant_unref (child);
+
+      if (stmt == NULL)
+        continue;
+
+      if (last_stmt)
+        {
+          last_stmt->next = stmt;
+          stmt->prev = last_stmt;
+        }
+      else
+        {
+          stylesheet->statements = stmt;
+        }
+      last_stmt = stmt;
+    }
+
+  if (reader.failed)
+    {
+      cr_stylesheet_destroy (stylesheet);
+      stylesheet = NULL;
+    }
+
+ out:
+  g_free (reader.strings);
+  if (strings)
+    g_variant_unref (strings);
+  if (statements)
+    g_variant_unref (statements);
+  g_variant_unref (cache);
+
+  return stylesheet;
+}
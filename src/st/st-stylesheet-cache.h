@@ -0,0 +1,32 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-stylesheet-cache.h: On-disk cache of parsed stylesheets
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __ST_STYLESHEET_CACHE_H__
+#define __ST_STYLESHEET_CACHE_H__
+
+#include <libcroco/libcroco.h>
+
+G_BEGIN_DECLS
+
+CRStyleSheet *_st_stylesheet_cache_load (const char   *filename);
+void          _st_stylesheet_cache_save (const char   *filename,
+                                         CRStyleSheet *stylesheet);
+
+G_END_DECLS
+
+#endif /* __ST_STYLESHEET_CACHE_H__ */
@@ -69,18 +69,29 @@ struct _StTablePrivate
   gint    active_row;
   gint    active_col;
 
+  /* The size requests of the columns, from their children, and
+   * whether they expand; valid while col_requests_valid is set */
   GArray *min_widths;
   GArray *pref_widths;
+  GArray *is_expand_col;
+
   GArray *min_heights;
   GArray *pref_heights;
-
-  GArray *is_expand_col;
   GArray *is_expand_row;
 
+  /* The last solutions of st_table_calculate_col_widths() and
+   * st_table_calculate_row_heights(), for the given sizes */
   GArray *col_widths;
   GArray *row_heights;
+  gint    col_widths_for_width;
+  gint    row_heights_for_width;
+  gint    row_heights_for_height;
 
   guint   homogeneous : 1;
+
+  guint   col_requests_valid : 1;
+  guint   col_widths_valid : 1;
+  guint   row_heights_valid : 1;
 };
 
 static void st_table_container_iface_init (ClutterContainerIface *iface);
@@ -89,6 +100,20 @@ G_DEFINE_TYPE_WITH_CODE (StTable, st_table, ST_TYPE_WIDGET,
                          G_IMPLEMENT_INTERFACE (CLUTTER_TYPE_CONTAINER,
                                                 st_table_container_iface_init));
 
+/* Any change to the size requests of our children, to their child
+ * properties, or to our spacing, queues a relayout on us, so that's
+ * when the cached requests and solutions are dropped.
+ */
+static void
+st_table_invalidate_size_cache (StTable *table)
+{
+  StTablePrivate *priv = table->priv;
+
+  priv->col_requests_valid = FALSE;
+  priv->col_widths_valid = FALSE;
+  priv->row_heights_valid = FALSE;
+}
+
 
 
 /*
@@ -118,6 +143,8 @@ st_table_actor_removed (ClutterContainer *container,
       n_cols = MAX (n_cols, meta->col + 1);
     }
 
+  st_table_invalidate_size_cache (ST_TABLE (container));
+
   g_object_freeze_notify (G_OBJECT (container));
 
   if (priv->n_rows != n_rows)
@@ -283,17 +310,22 @@ st_table_homogeneous_allocate (ClutterActor          *self,
 }
 
 
-static gint *
-st_table_calculate_col_widths (StTable *table,
-                               gint     for_width)
+/* Collects the minimum and preferred widths of the columns, and
+ * whether they expand, from the children spanning a single column */
+static void
+st_table_update_col_requests (StTable *table)
 {
-  gint total_min_width, i;
   StTablePrivate *priv = table->priv;
   gboolean *is_expand_col;
-  gint extra_col_width, n_expanded_cols = 0, expanded_cols = 0;
   gint *pref_widths, *min_widths;
   ClutterActor *child;
 
+  if (priv->col_requests_valid)
+    return;
+
+  /* Setting size to zero and then what we want it to be causes a clear if
+   * clear flag is set (which it should be.)
+   */
   g_array_set_size (priv->is_expand_col, 0);
   g_array_set_size (priv->is_expand_col, priv->n_cols);
   is_expand_col = (gboolean *) priv->is_expand_col->data;
@@ -341,6 +373,35 @@ st_table_calculate_col_widths (StTable *table,
 
     }
 
+  priv->col_requests_valid = TRUE;
+}
+
+static gint *
+st_table_calculate_col_widths (StTable *table,
+                               gint     for_width)
+{
+  gint total_min_width, i;
+  StTablePrivate *priv = table->priv;
+  gboolean *is_expand_col;
+  gint extra_col_width, n_expanded_cols = 0, expanded_cols = 0;
+  gint *pref_widths, *min_widths;
+
+  if (priv->col_widths_valid && priv->col_widths_for_width == for_width)
+    return (gint *) priv->col_widths->data;
+
+  st_table_update_col_requests (table);
+
+  /* The distribution below modifies the widths and expand flags it
+   * starts from, so work on copies of the requests */
+  g_array_set_size (priv->col_widths, priv->n_cols);
+  pref_widths = (gint *) priv->col_widths->data;
+  memcpy (pref_widths, priv->pref_widths->data, sizeof (gint) * priv->n_cols);
+
+  min_widths = (gint *) priv->min_widths->data;
+
+  is_expand_col = g_slice_copy (sizeof (gboolean) * priv->n_cols,
+                                priv->is_expand_col->data);
+
   total_min_width = priv->col_spacing * (priv->n_cols - 1);
   for (i = 0; i < priv->n_cols; i++)
     total_min_width += pref_widths[i];
@@ -382,9 +443,17 @@ st_table_calculate_col_widths (StTable *table,
             pref_widths[i] += extra_col_width / n_expanded_cols;
         }
 
+  g_slice_free1 (sizeof (gboolean) * priv->n_cols, is_expand_col);
+
+  priv->col_widths_valid = TRUE;
+  priv->col_widths_for_width = for_width;
+  /* Row heights depend on the column widths */
+  priv->row_heights_valid = FALSE;
+
   return pref_widths;
 }
 
+/* @col_widths must be the result of st_table_calculate_col_widths() */
 static gint *
 st_table_calculate_row_heights (StTable *table,
                                 gint     for_height,
@@ -397,6 +466,11 @@ st_table_calculate_row_heights (StTable *table,
   gint n_expanded_rows = 0;
   ClutterActor *child;
 
+  if (priv->row_heights_valid &&
+      priv->row_heights_for_width == priv->col_widths_for_width &&
+      priv->row_heights_for_height == for_height)
+    return (gint *) priv->row_heights->data;
+
   g_array_set_size (priv->row_heights, 0);
   g_array_set_size (priv->row_heights, priv->n_rows);
   row_heights = (gboolean *) priv->row_heights->data;
@@ -477,8 +551,8 @@ st_table_calculate_row_heights (StTable *table,
       }
 
   /* extra row height = for height - row spacings - total_min_height */
-  for_height -= (priv->row_spacing * (priv->n_rows - 1));
-  extra_row_height = for_height - total_min_height;
+  extra_row_height = for_height - (priv->row_spacing * (priv->n_rows - 1))
+                     - total_min_height;
 
 
   if (extra_row_height < 0)
@@ -553,6 +627,9 @@ st_table_calculate_row_heights (StTable *table,
         }
     }
 
+  priv->row_heights_valid = TRUE;
+  priv->row_heights_for_width = priv->col_widths_for_width;
+  priv->row_heights_for_height = for_height;
 
   return row_heights;
 }
@@ -727,7 +804,6 @@ st_table_get_preferred_width (ClutterActor *self,
   StTablePrivate *priv = ST_TABLE (self)->priv;
   StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (self));
   gint i;
-  ClutterActor *child;
 
   if (priv->n_cols < 1)
     {
@@ -736,43 +812,11 @@ st_table_get_preferred_width (ClutterActor *self,
       return;
     }
 
-  /* Setting size to zero and then what we want it to be causes a clear if
-   * clear flag is set (which it should be.)
-   */
-  g_array_set_size (priv->min_widths, 0);
-  g_array_set_size (priv->pref_widths, 0);
-  g_array_set_size (priv->min_widths, priv->n_cols);
-  g_array_set_size (priv->pref_widths, priv->n_cols);
+  st_table_update_col_requests (ST_TABLE (self));
 
   min_widths = (gint *) priv->min_widths->data;
   pref_widths = (gint *) priv->pref_widths->data;
 
-  /* calculate minimum row widths */
-  for (child = clutter_actor_get_first_child (self);
-       child != NULL;
-       child = clutter_actor_get_next_sibling (child))
-    {
-      gint col, col_span;
-      gfloat w_min, w_pref;
-      StTableChild *meta;
-
-      meta = (StTableChild *) clutter_container_get_child_meta (CLUTTER_CONTAINER (self), child);
-
-      if (!meta->allocate_hidden && !CLUTTER_ACTOR_IS_VISIBLE (child))
-        continue;
-
-      /* get child properties */
-      col = meta->col;
-      col_span = meta->col_span;
-
-      _st_actor_get_preferred_width (child, -1, meta->y_fill, &w_min, &w_pref);
-
-      if (col_span == 1 && w_min > min_widths[col])
-        min_widths[col] = w_min;
-      if (col_span == 1 && w_pref > pref_widths[col])
-        pref_widths[col] = w_pref;
-    }
-
   total_min_width = (priv->n_cols - 1) * (float) priv->col_spacing;
   total_pref_width = total_min_width;
 
@@ -897,6 +941,14 @@ st_table_get_preferred_height (ClutterActor *self,
   st_theme_node_adjust_preferred_height (theme_node, min_height_p, natural_height_p);
 }
 
+static void
+st_table_queue_relayout (ClutterActor *self)
+{
+  st_table_invalidate_size_cache (ST_TABLE (self));
+
+  CLUTTER_ACTOR_CLASS (st_table_parent_class)->queue_relayout (self);
+}
+
 static void
 st_table_style_changed (StWidget *self)
 {
@@ -936,6 +988,7 @@ st_table_class_init (StTableClass *klass)
   actor_class->allocate = st_table_allocate;
   actor_class->get_preferred_width = st_table_get_preferred_width;
   actor_class->get_preferred_height = st_table_get_preferred_height;
+  actor_class->queue_relayout = st_table_queue_relayout;
 
   widget_class->style_changed = st_table_style_changed;
 
@@ -1008,6 +1061,8 @@ void _st_table_update_row_col (StTable *table,
                                gint     row,
                                gint     col)
 {
+  st_table_invalidate_size_cache (table);
+
   if (col > -1)
     table->priv->n_cols = MAX (table->priv->n_cols, col + 1);
 
@@ -32,6 +32,10 @@
 #define CACHE_PREFIX_RAW_CHECKSUM "raw-checksum:"
 #define CACHE_PREFIX_COMPRESSED_CHECKSUM "compressed-checksum:"
 
+/* Textures for raw data are uploaded in batches of at most this many
+ * per frame, so that a burst of them doesn't hold up a single frame */
+#define MAX_RAW_UPLOADS_PER_FRAME 4
+
 struct _StTextureCachePrivate
 {
   GtkIconTheme *icon_theme;
@@ -39,12 +43,18 @@ struct _StTextureCachePrivate
   /* Things that were loaded with a cache policy != NONE */
   GHashTable *keyed_cache; /* char * -> CoglTexture* */
 
-  /* Presently this is used to de-duplicate requests for GIcons and async URIs. */
+  /* Presently this is used to de-duplicate requests for GIcons, async URIs
+   * and raw data. */
   GHashTable *outstanding_requests; /* char * -> AsyncTextureLoadData * */
+
+  /* Loaded raw data waiting to be uploaded at the next frame */
+  GQueue *pending_uploads; /* AsyncTextureLoadData * */
+  guint upload_repaint_id;
 };
 
 static void st_texture_cache_dispose (GObject *object);
 static void st_texture_cache_finalize (GObject *object);
+static void texture_load_data_free (gpointer p);
 
 enum
 {
@@ -136,6 +146,7 @@ st_texture_cache_init (StTextureCache *self)
                                                    g_free, cogl_handle_unref);
   self->priv->outstanding_requests = g_hash_table_new_full (g_str_hash, g_str_equal,
                                                             g_free, NULL);
+  self->priv->pending_uploads = g_queue_new ();
 }
 
 static void
@@ -159,6 +170,17 @@ st_texture_cache_dispose (GObject *object)
     g_hash_table_destroy (self->priv->outstanding_requests);
   self->priv->outstanding_requests = NULL;
 
+  if (self->priv->upload_repaint_id)
+    clutter_threads_remove_repaint_func (self->priv->upload_repaint_id);
+  self->priv->upload_repaint_id = 0;
+
+  if (self->priv->pending_uploads)
+    {
+      g_queue_foreach (self->priv->pending_uploads, (GFunc) texture_load_data_free, NULL);
+      g_queue_free (self->priv->pending_uploads);
+    }
+  self->priv->pending_uploads = NULL;
+
   G_OBJECT_CLASS (st_texture_cache_parent_class)->dispose (object);
 }
 
@@ -303,6 +325,9 @@ typedef struct {
   GtkIconInfo *icon_info;
   StIconColors *colors;
   char *uri;
+
+  /* Decoded raw data, waiting to be uploaded */
+  GdkPixbuf *pixbuf;
 } AsyncTextureLoadData;
 
 static void
@@ -324,6 +349,16 @@ texture_load_data_destroy (gpointer p)
 
   if (data->textures)
     g_slist_free_full (data->textures, (GDestroyNotify) g_object_unref);
+
+  if (data->pixbuf)
+    g_object_unref (data->pixbuf);
+}
+
+static void
+texture_load_data_free (gpointer p)
+{
+  texture_load_data_destroy (p);
+  g_free (p);
 }
 
 /**
@@ -1443,6 +1478,254 @@ st_texture_cache_load_file_to_cairo_surface (StTextureCache *cache,
   return surface;
 }
 
+/* Loading raw data:
+ *
+ * This is used for every image sent along with a notification, so it
+ * has to be cheap on the main thread even when a burst of large images
+ * arrives. We copy the data, then hash it and scale it down to the
+ * requested size in a thread; the resulting texture is uploaded at the
+ * next frame, unless an identical image is cached already.
+ */
+typedef struct {
+  ClutterTexture *texture;
+
+  guchar *data;
+  gboolean has_alpha;
+  int width;
+  int height;
+  int rowstride;
+  int size;
+
+  char *key;
+  GdkPixbuf *pixbuf;
+} RawLoadData;
+
+static void
+raw_load_data_free (gpointer p)
+{
+  RawLoadData *data = p;
+
+  g_object_unref (data->texture);
+  g_free (data->key);
+  if (data->pixbuf)
+    g_object_unref (data->pixbuf);
+  g_free (data->data);
+  g_slice_free (RawLoadData, data);
+}
+
+#define RAW_HASH_PRIME_1 G_GUINT64_CONSTANT (0x9E3779B185EBCA87)
+#define RAW_HASH_PRIME_2 G_GUINT64_CONSTANT (0xC2B2AE3D27D4EB4F)
+#define RAW_HASH_PRIME_3 G_GUINT64_CONSTANT (0x165667B19E3779F9)
+
+static inline guint64
+raw_hash_rotl (guint64 x,
+               int     r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline guint64
+raw_hash_round (guint64 acc,
+                guint64 input)
+{
+  acc += input * RAW_HASH_PRIME_2;
+  acc = raw_hash_rotl (acc, 31);
+  return acc * RAW_HASH_PRIME_1;
+}
+
+static inline guint64
+raw_hash_avalanche (guint64 h)
+{
+  h ^= h >> 33;
+  h *= RAW_HASH_PRIME_2;
+  h ^= h >> 29;
+  h *= RAW_HASH_PRIME_3;
+  h ^= h >> 32;
+  return h;
+}
+
+/* Feeds @len bytes into the four lanes of the hash state. The lanes
+ * are independent of each other, so the compiler can vectorize or at
+ * least interleave them; this is many times faster than a
+ * cryptographic checksum, which we don't need for a cache key.
+ */
+static void
+raw_hash_update (guint64       state[4],
+                 const guchar *data,
+                 gsize         len)
+{
+  const guchar *end = data + len;
+  guint64 block[4];
+  int i;
+
+  for (; data + sizeof (block) <= end; data += sizeof (block))
+    {
+      memcpy (block, data, sizeof (block));
+      for (i = 0; i < 4; i++)
+        state[i] = raw_hash_round (state[i], GUINT64_FROM_LE (block[i]));
+    }
+
+  if (data < end)
+    {
+      memset (block, 0, sizeof (block));
+      memcpy (block, data, end - data);
+      for (i = 0; i < 4; i++)
+        state[i] = raw_hash_round (state[i], GUINT64_FROM_LE (block[i]) ^ (end - data));
+    }
+}
+
+/* Computes a 128 bit hash of the pixels of an image, ignoring the
+ * padding at the end of each row; the format, dimensions and rowstride
+ * are part of it.
+ */
+static char *
+raw_data_compute_key (RawLoadData *data)
+{
+  guint64 state[4];
+  guint64 h1, h2;
+  gsize row_length;
+  int y;
+
+  state[0] = RAW_HASH_PRIME_1 + RAW_HASH_PRIME_2 + data->width;
+  state[1] = RAW_HASH_PRIME_2 + data->height;
+  state[2] = RAW_HASH_PRIME_3 + data->rowstride;
+  state[3] = RAW_HASH_PRIME_1 * (data->has_alpha ? 2 : 1);
+
+  row_length = (gsize) data->width * (data->has_alpha ? 4 : 3);
+  for (y = 0; y < data->height; y++)
+    raw_hash_update (state, data->data + (gsize) y * data->rowstride, row_length);
+
+  h1 = raw_hash_rotl (state[0], 1) + raw_hash_rotl (state[1], 7) +
+       raw_hash_rotl (state[2], 12) + raw_hash_rotl (state[3], 18);
+  h2 = raw_hash_rotl (state[0], 29) ^ raw_hash_rotl (state[1], 41) ^
+       raw_hash_rotl (state[2], 53) ^ state[3];
+
+  return g_strdup_printf (CACHE_PREFIX_RAW_CHECKSUM "checksum=%016" G_GINT64_MODIFIER "x%016" G_GINT64_MODIFIER "x,size=%d",
+                          raw_hash_avalanche (h1), raw_hash_avalanche (h2 ^ h1),
+                          data->size);
+}
+
+static void
+free_raw_pixels (guchar   *pixels,
+                 gpointer  data)
+{
+  g_free (pixels);
+}
+
+static void
+load_raw_thread (GSimpleAsyncResult *result,
+                 GObject            *object,
+                 GCancellable       *cancellable)
+{
+  RawLoadData *data;
+  GdkPixbuf *pixbuf;
+  int scaled_width, scaled_height;
+
+  data = g_object_get_data (G_OBJECT (result), "load-raw-data");
+  g_assert (data != NULL);
+
+  if (data->width <= 0 || data->height <= 0)
+    return;
+
+  data->key = raw_data_compute_key (data);
+
+  /* The pixbuf takes over the data */
+  pixbuf = gdk_pixbuf_new_from_data (data->data, GDK_COLORSPACE_RGB,
+                                     data->has_alpha, 8,
+                                     data->width, data->height,
+                                     data->rowstride, free_raw_pixels, NULL);
+  data->data = NULL;
+
+  if (compute_pixbuf_scale (data->width, data->height, data->size, data->size,
+                            &scaled_width, &scaled_height))
+    {
+      data->pixbuf = gdk_pixbuf_scale_simple (pixbuf, scaled_width, scaled_height,
+                                              GDK_INTERP_BILINEAR);
+      g_object_unref (pixbuf);
+    }
+  else
+    {
+      data->pixbuf = pixbuf;
+    }
+}
+
+static gboolean
+upload_pending_textures (gpointer user_data)
+{
+  StTextureCache *cache = user_data;
+  AsyncTextureLoadData *request;
+  CoglHandle texdata;
+  GSList *iter;
+  int i;
+
+  for (i = 0; i < MAX_RAW_UPLOADS_PER_FRAME; i++)
+    {
+      request = g_queue_pop_head (cache->priv->pending_uploads);
+      if (request == NULL)
+        break;
+
+      g_hash_table_remove (cache->priv->outstanding_requests, request->key);
+
+      texdata = pixbuf_to_cogl_handle (request->pixbuf, FALSE);
+      g_hash_table_insert (cache->priv->keyed_cache, g_strdup (request->key),
+                           cogl_handle_ref (texdata));
+
+      for (iter = request->textures; iter; iter = iter->next)
+        set_texture_cogl_texture (iter->data, texdata);
+
+      cogl_handle_unref (texdata);
+      texture_load_data_free (request);
+    }
+
+  request = g_queue_peek_head (cache->priv->pending_uploads);
+  if (request == NULL)
+    {
+      cache->priv->upload_repaint_id = 0;
+      return FALSE;
+    }
+
+  /* Make sure there is a next frame for the rest */
+  clutter_actor_queue_redraw (request->textures->data);
+  return TRUE;
+}
+
+static void
+on_raw_loaded (GObject      *source,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+  StTextureCache *cache = ST_TEXTURE_CACHE (source);
+  AsyncTextureLoadData *request;
+  RawLoadData *data;
+
+  data = g_object_get_data (G_OBJECT (result), "load-raw-data");
+  if (data->pixbuf == NULL)
+    return;
+
+  if (ensure_request (cache, data->key, ST_TEXTURE_CACHE_POLICY_FOREVER,
+                      &request, CLUTTER_ACTOR (data->texture)))
+    {
+      /* Either cached already, or we've just added ourselves to an
+       * upload for the same data that's already pending */
+      return;
+    }
+
+  request->cache = cache;
+  request->key = data->key;
+  request->policy = ST_TEXTURE_CACHE_POLICY_FOREVER;
+  data->key = NULL;
+  request->pixbuf = data->pixbuf;
+  data->pixbuf = NULL;
+
+  g_queue_push_tail (cache->priv->pending_uploads, request);
+
+  if (cache->priv->upload_repaint_id == 0)
+    cache->priv->upload_repaint_id =
+      clutter_threads_add_repaint_func (upload_pending_textures, cache, NULL);
+
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (data->texture));
+}
+
 /**
  * st_texture_cache_load_from_raw:
  * @cache: a #StTextureCache
@@ -1455,6 +1738,8 @@ st_texture_cache_load_file_to_cairo_surface (StTextureCache *cache,
  * @size: size of icon to return
  *
  * Creates (or retrieves from cache) an icon based on raw pixel data.
+ * The image is scaled down to fit @size if necessary; the returned
+ * actor is filled asynchronously.
  *
  * Return value: (transfer none): a new #ClutterActor displaying a
  * pixbuf created from @data and the other parameters.
@@ -1471,35 +1756,29 @@ st_texture_cache_load_from_raw (StTextureCache    *cache,
                                 GError           **error)
 {
   ClutterTexture *texture;
-  CoglHandle texdata;
-  char *key;
-  char *checksum;
+  GSimpleAsyncResult *result;
+  RawLoadData *load_data;
 
   texture = create_default_texture ();
   clutter_actor_set_size (CLUTTER_ACTOR (texture), size, size);
 
-  /* In theory, two images of with different width and height could have the same
-   * pixel data and thus hash the same. (Say, a 16x16 and a 8x32 blank image.)
-   * We ignore this for now. If anybody hits this problem they should use
-   * GChecksum directly to compute a checksum including the width and height.
-   */
-  checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1, data, len);
-  key = g_strdup_printf (CACHE_PREFIX_RAW_CHECKSUM "checksum=%s", checksum);
-  g_free (checksum);
-
-  texdata = g_hash_table_lookup (cache->priv->keyed_cache, key);
-  if (texdata == NULL)
-    {
-      texdata = cogl_texture_new_from_data (width, height, COGL_TEXTURE_NONE,
-                                            has_alpha ? COGL_PIXEL_FORMAT_RGBA_8888 : COGL_PIXEL_FORMAT_RGB_888,
-                                            COGL_PIXEL_FORMAT_ANY,
-                                            rowstride, data);
-      g_hash_table_insert (cache->priv->keyed_cache, g_strdup (key), texdata);
-    }
-
-  g_free (key);
+  load_data = g_slice_new0 (RawLoadData);
+  load_data->texture = g_object_ref (texture);
+  load_data->data = g_memdup (data, len);
+  load_data->has_alpha = has_alpha;
+  load_data->width = width;
+  load_data->height = height;
+  load_data->rowstride = rowstride;
+  load_data->size = size;
+
+  result = g_simple_async_result_new (G_OBJECT (cache), on_raw_loaded, NULL,
+                                      st_texture_cache_load_from_raw);
+  g_object_set_data_full (G_OBJECT (result), "load-raw-data",
+                          load_data, raw_load_data_free);
+  g_simple_async_result_run_in_thread (result, load_raw_thread,
+                                       G_PRIORITY_DEFAULT, NULL);
+  g_object_unref (result);
 
-  set_texture_cogl_texture (texture, texdata);
   return CLUTTER_ACTOR (texture);
 }
 
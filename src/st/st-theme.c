@@ -42,6 +42,7 @@
 
 #include <gio/gio.h>
 
+#include "st-stylesheet-cache.h"
 #include "st-theme-node.h"
 #include "st-theme-private.h"
 
@@ -155,6 +156,34 @@ st_theme_class_init (StThemeClass *klass)
 
 }
 
+/* The specificity of a selector doesn't depend on the node it is
+ * matched against, so compute it once up front rather than each time
+ * the selector matches.
+ */
+static void
+compute_specificities (CRStyleSheet *stylesheet)
+{
+  CRStatement *cur_stmt;
+  CRSelector *cur_sel;
+
+  for (cur_stmt = stylesheet->statements; cur_stmt; cur_stmt = cur_stmt->next)
+    {
+      CRSelector *sel_list = NULL;
+
+      if (cur_stmt->type == RULESET_STMT && cur_stmt->kind.ruleset)
+        sel_list = cur_stmt->kind.ruleset->sel_list;
+      else if (cur_stmt->type == AT_MEDIA_RULE_STMT
+               && cur_stmt->kind.media_rule
+               && cur_stmt->kind.media_rule->rulesets
+               && cur_stmt->kind.media_rule->rulesets->kind.ruleset)
+        sel_list = cur_stmt->kind.media_rule->rulesets->kind.ruleset->sel_list;
+
+      for (cur_sel = sel_list; cur_sel; cur_sel = cur_sel->next)
+        if (cur_sel->simple_sel)
+          cr_simple_sel_compute_specificity (cur_sel->simple_sel);
+    }
+}
+
 static CRStyleSheet *
 parse_stylesheet (const char  *filename,
                   GError     **error)
@@ -165,17 +194,25 @@ parse_stylesheet (const char  *filename,
   if (filename == NULL)
     return NULL;
 
-  status = cr_om_parser_simply_parse_file ((const guchar *) filename,
-                                           CR_UTF_8,
-                                           &stylesheet);
-
-  if (status != CR_OK)
+  stylesheet = _st_stylesheet_cache_load (filename);
+  if (stylesheet == NULL)
     {
-      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
-                   "Error parsing stylesheet '%s'; errcode:%d", filename, status);
-      return NULL;
+      status = cr_om_parser_simply_parse_file ((const guchar *) filename,
+                                               CR_UTF_8,
+                                               &stylesheet);
+
+      if (status != CR_OK)
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                       "Error parsing stylesheet '%s'; errcode:%d", filename, status);
+          return NULL;
+        }
+
+      _st_stylesheet_cache_save (filename, stylesheet);
     }
 
+  compute_specificities (stylesheet);
+
   return stylesheet;
 }
 
@@ -909,18 +946,14 @@ add_matched_properties (StTheme      *a_this,
             {
               CRDeclaration *cur_decl = NULL;
 
-              /* In order to sort the matching properties, we need to compute the
+              /* In order to sort the matching properties, we need the
                * specificity of the selector that actually matched this
-               * element. In a non-thread-safe fashion, we store it in the
-               * ruleset. (Fixing this would mean cut-and-pasting
-               * cr_simple_sel_compute_specificity(), and have no need for
-               * thread-safety anyways.)
+               * element (computed when the stylesheet was loaded). In a
+               * non-thread-safe fashion, we store it in the ruleset.
                *
                * Once we've sorted the properties, the specificity no longer
                * matters and it can be safely overriden.
                */
-              cr_simple_sel_compute_specificity (cur_sel->simple_sel);
-
               cur_stmt->specificity = cur_sel->simple_sel->specificity;
 
               for (cur_decl = cur_stmt->kind.ruleset->decl_list; cur_decl; cur_decl = cur_decl->next)
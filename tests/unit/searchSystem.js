@@ -0,0 +1,69 @@
+/* -*- mode: js2; js2-basic-offset: 4; indent-tabs-mode: nil -*- */
+
+// Test cases for SearchSystem incremental searches
+
+const JsUnit = imports.jsUnit;
+const Lang = imports.lang;
+const Shell = imports.gi.Shell;
+
+const Environment = imports.ui.environment;
+Environment.init();
+const Search = imports.ui.search;
+
+const ITEMS = ['Firefox Web Browser', 'Files', 'Terminal'];
+
+function filterItems(items, terms) {
+    let matcher = Shell.SearchMatcher.new(terms);
+    return items.filter(function(item) {
+        return matcher.match(item) > 0;
+    });
+}
+
+const TestProvider = new Lang.Class({
+    Name: 'TestProvider',
+    Extends: Search.SearchProvider,
+
+    _init: function() {
+        this.parent('TEST');
+    },
+
+    getInitialResultSet: function(terms) {
+        return filterItems(ITEMS, terms);
+    },
+
+    getSubsearchResultSet: function(previousResults, terms) {
+        return filterItems(previousResults, terms);
+    }
+});
+
+let searchSystem = new Search.SearchSystem();
+searchSystem.registerProvider(new TestProvider());
+
+let results;
+searchSystem.connect('search-completed', function(system, providerResults) {
+    let [provider, items] = providerResults[0];
+    results = items;
+});
+
+// Type a misspelled "firefox" one character at a time; the shorter
+// prefixes only match exactly, and drop it
+let query = 'friefox';
+for (let i = 1; i <= query.length; i++) {
+    searchSystem.updateSearch(query.substring(0, i));
+
+    if (i == 3)
+        JsUnit.assertEquals('"fri" is matched exactly', -1, results.indexOf('Firefox Web Browser'));
+    if (i >= 4)
+        JsUnit.assertTrue('"' + query.substring(0, i) + '" matches Firefox',
+                          results.indexOf('Firefox Web Browser') != -1);
+}
+
+// Same once a term becomes long enough for two typos
+searchSystem.reset();
+query = 'frieffox';
+let found = false;
+for (let i = 1; i <= query.length; i++) {
+    searchSystem.updateSearch(query.substring(0, i));
+    found = results.indexOf('Firefox Web Browser') != -1;
+}
+JsUnit.assertTrue('"frieffox" matches Firefox', found);